@@ -0,0 +1,124 @@
+/*!
+ * \file include/AnimationStore.h
+ * \brief Keyframes of all moveables in a level
+ *
+ * \author xythobuz
+ */
+
+#ifndef _ANIMATION_STORE_H_
+#define _ANIMATION_STORE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/*!
+ * \brief All animations of a level, in structure-of-arrays form.
+ *
+ * Every keyframe stores one packed angle set per bone, with three 10bit
+ * angles (1024 steps per turn) in 32bits. The keyframes of one animation
+ * are consecutive, so decodeFrames() unpacks a whole animation in a single
+ * pass over one contiguous range. Animations, state changes, dispatches and
+ * commands keep the indices they have in the level file.
+ */
+class AnimationStore {
+  public:
+    struct Model {
+        int32_t id;
+        uint32_t firstBone; //!< Index into the bone tables
+        uint32_t numBones;
+        uint32_t startingMesh;
+        uint32_t firstAnimation; //!< noAnimation for static or engine animated models
+        uint32_t numAnimations;
+        uint32_t frame; //!< Keyframe shown without animation
+    };
+
+    struct Animation {
+        uint32_t firstFrame; //!< Index of the first keyframe
+        uint32_t numFrames; //!< 0 if no model uses this animation
+        uint16_t frameRate; //!< Engine ticks per keyframe
+        uint16_t stateID;
+        uint16_t frameStart, frameEnd; //!< In engine ticks
+        uint16_t nextAnimation, nextFrame;
+        uint16_t numStateChanges, stateChangeOffset;
+        uint16_t numCommands, commandOffset;
+    };
+
+    struct StateChange {
+        uint16_t stateID, numDispatches, dispatchOffset;
+    };
+
+    struct Dispatch {
+        int16_t low, high, nextAnimation, nextFrame;
+    };
+
+    const static uint32_t noAnimation = 0xFFFFFFFF;
+
+    static uint32_t packAngles(uint16_t x, uint16_t y, uint16_t z) {
+        return (uint32_t(x & 0x3FF) << 20) | (uint32_t(y & 0x3FF) << 10) | (z & 0x3FF);
+    }
+
+    //! Unpacks n angle sets into degrees
+    static void decodeAngles(const uint32_t* packed, unsigned long n,
+                             float* x, float* y, float* z);
+
+    void clear();
+    unsigned long getMemorySize();
+
+    unsigned long addModel(const Model& m);
+    unsigned long sizeModel() { return models.size(); }
+    Model& getModel(unsigned long i);
+
+    unsigned long addAnimation(const Animation& a);
+    unsigned long sizeAnimation() { return animations.size(); }
+    Animation& getAnimation(unsigned long i);
+
+    void addStateChange(const StateChange& s) { stateChanges.push_back(s); }
+    void addDispatch(const Dispatch& d) { dispatches.push_back(d); }
+    void addCommand(int16_t c) { commands.push_back(c); }
+    unsigned long sizeStateChange() { return stateChanges.size(); }
+    unsigned long sizeDispatch() { return dispatches.size(); }
+    unsigned long sizeCommand() { return commands.size(); }
+
+    // Bone tables, the parent is relative to the first bone of the model, -1 for the root
+    unsigned long addBone(int16_t parent, int32_t x, int32_t y, int32_t z, uint8_t flags);
+    int getBoneParent(unsigned long bone);
+    glm::vec3 getBoneOffset(unsigned long bone);
+    uint8_t getBoneFlags(unsigned long bone);
+
+    // Bounding box corners, position offset and numAngles packed angle sets
+    unsigned long addFrame(const int16_t bounds[6], const int16_t position[3],
+                           const uint32_t* packed, unsigned long numAngles);
+    unsigned long sizeFrame() { return frameAngles.size(); }
+    glm::vec3 getFramePosition(unsigned long frame);
+    void getFrameBounds(unsigned long frame, glm::vec3& min, glm::vec3& max);
+
+    /*!
+     * \brief Unpacks the angles of count consecutive keyframes.
+     * \param x,y,z receive getFrameAngleCount(first, count) values each
+     */
+    void decodeFrames(unsigned long first, unsigned long count, float* x, float* y, float* z);
+    unsigned long getFrameAngleCount(unsigned long first, unsigned long count);
+
+  private:
+    friend class LevelCache;
+
+    std::vector<Model> models;
+    std::vector<Animation> animations;
+    std::vector<StateChange> stateChanges;
+    std::vector<Dispatch> dispatches;
+    std::vector<int16_t> commands;
+
+    std::vector<uint32_t> frameAngles; // Index of the first angle set of each keyframe
+    std::vector<int16_t> frameBounds; // 6 per keyframe
+    std::vector<int16_t> framePositions; // 3 per keyframe
+    std::vector<uint32_t> angles;
+
+    std::vector<int16_t> boneParents;
+    std::vector<int32_t> boneOffsets; // 3 per bone
+    std::vector<uint8_t> boneFlags;
+};
+
+#endif
+
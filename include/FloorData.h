@@ -0,0 +1,124 @@
+/*!
+ * \file include/FloorData.h
+ * \brief Decoded FloorData of all sectors in a level
+ *
+ * \author xythobuz
+ */
+
+#ifndef _FLOOR_DATA_H_
+#define _FLOOR_DATA_H_
+
+#include <cstdint>
+#include <vector>
+
+enum FloorDataFlags {
+    FloorDataFlagKill = (1 << 0), //!< Lava, kills Lara on contact
+    FloorDataFlagClimbPosZ = (1 << 1), //!< Climbable walls, TR2 and later
+    FloorDataFlagClimbPosX = (1 << 2),
+    FloorDataFlagClimbNegZ = (1 << 3),
+    FloorDataFlagClimbNegX = (1 << 4),
+    FloorDataFlagMonkeySwing = (1 << 5), //!< TR3 and later
+    FloorDataFlagMinecartLeft = (1 << 6),
+    FloorDataFlagMinecartRight = (1 << 7)
+};
+
+enum FloorDataAction {
+    FloorDataActionObject = 0,
+    FloorDataActionCamera = 1, //!< Followed by one more word
+    FloorDataActionCurrent = 2,
+    FloorDataActionFlipMap = 3,
+    FloorDataActionFlipOn = 4,
+    FloorDataActionFlipOff = 5,
+    FloorDataActionLookAt = 6,
+    FloorDataActionEndLevel = 7,
+    FloorDataActionSoundtrack = 8,
+    FloorDataActionEffect = 9,
+    FloorDataActionSecret = 10
+};
+
+/*!
+ * \brief Opcode chains of the FloorData words, decoded once while loading.
+ *
+ * Every chain referenced by a sector becomes one small Info record. Its
+ * trigger and the actions of that trigger are stored in their own tables,
+ * so nothing has to walk the opcodes again at runtime. Record 0 is empty,
+ * it stands for sectors without FloorData.
+ */
+class FloorData {
+  public:
+    struct Info {
+        int8_t floorSlopeX, floorSlopeZ; //!< Quarter units of height per unit
+        int8_t ceilingSlopeX, ceilingSlopeZ;
+        uint16_t portal; //!< Room behind the walls of this sector, noPortal if none
+        uint8_t flags; //!< FloorDataFlags
+        uint8_t floorSplit; //!< TR3 floor triangulation function, 0 if none
+        uint8_t ceilingSplit;
+        uint8_t unused;
+        uint16_t floorCorners; //!< Corner heights of the triangulation
+        uint16_t ceilingCorners;
+        uint16_t trigger; //!< Index into the trigger table, noTrigger if none
+    };
+
+    struct Trigger {
+        uint8_t type; //!< Pad, switch, key, pickup, ...
+        uint8_t timer;
+        uint8_t mask; //!< Activation mask, 5bits
+        uint8_t oneShot;
+        uint32_t firstAction; //!< Index into the action table
+        uint32_t numActions;
+    };
+
+    struct Action {
+        uint16_t parameter; //!< Item, camera, soundtrack, ...
+        uint8_t type; //!< FloorDataAction
+        uint8_t timer; //!< Camera only
+        uint8_t once; //!< Camera only
+        uint8_t unused;
+    };
+
+    const static uint16_t noPortal = 0xFFFF;
+    const static uint16_t noTrigger = 0xFFFF;
+
+    FloorData() { clear(); }
+
+    void clear();
+    unsigned long getMemorySize();
+
+    /*!
+     * \brief Decodes the chain starting at offset into a new record.
+     *
+     * Decoding stops at the end of the chain, at the end of the data or
+     * at an unknown function, whatever comes first.
+     * \param data all FloorData words of the level
+     * \param size number of words
+     * \param offset index of the first word of the chain
+     * \returns index of the new record
+     */
+    unsigned long decode(const uint16_t* data, unsigned long size, unsigned long offset);
+
+    unsigned long sizeInfo() { return infos.size(); }
+    const Info& getInfo(unsigned long i) const { return infos[i]; }
+
+    unsigned long sizeTrigger() { return triggers.size(); }
+    const Trigger& getTrigger(unsigned long i) const { return triggers[i]; }
+
+    unsigned long sizeAction() { return actions.size(); }
+    const Action& getAction(unsigned long i) const { return actions[i]; }
+
+    unsigned long getUnknownFunctions() { return unknownFunctions; }
+
+    // Height of a sloped floor or ceiling at world coordinates x and z
+    static int floorHeight(const Info& info, int floor, int x, int z);
+    static int ceilingHeight(const Info& info, int ceiling, int x, int z);
+
+  private:
+    friend class LevelCache;
+
+    std::vector<Info> infos;
+    std::vector<Trigger> triggers;
+    std::vector<Action> actions;
+    unsigned long unknownFunctions;
+};
+
+#endif
+
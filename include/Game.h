@@ -8,17 +8,45 @@
 #ifndef _GAME_H_
 #define _GAME_H_
 
+#include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
 #include <string>
 
 #include "Entity.h"
+#include "utils/WorkQueue.h"
 
 class Game {
   public:
     static void destroy();
 
     static bool isLoaded() { return mLoaded; }
+
+    /*!
+     * \brief Starts loading a level on a background thread.
+     * A level that is still loading is cancelled first,
+     * update() starts the new one when the old worker has returned.
+     * \returns 0 if loading has been (or will be) started
+     */
     static int loadLevel(std::string level);
 
+    static bool isLoading() { return mLoading; }
+
+    //! Doesn't block, the load screen stays until update() sees the worker return
+    static void cancelLoading();
+    static float getLoadProgress() { return loadProgress; }
+    static std::string getLoadStatus();
+
+    //! Has to be called every frame, runs queued uploads and finishes loading
+    static void update();
+
+    //! Runs a job on the main thread, needed for OpenGL and OpenAL calls while loading
+    static std::future<void> runOnMainThread(std::function<void()> job);
+
+    //! Waits for a job, on the main thread itself the queued jobs run meanwhile
+    static void waitForMainThread(std::future<void>& job) { mainQueue.wait(job); }
+
     static void handleAction(ActionEvents action, bool isFinished);
     static void handleMouseMotion(int xrel, int yrel, int xabs, int yabs);
     static void handleControllerAxis(float value, KeyboardButton axis);
@@ -27,8 +55,22 @@ class Game {
     static void setLara(long lara);
 
   private:
+    static int loadWorker(std::string level);
+    static void finishLoading();
+    static void showLevel();
+    static void setLoadStatus(std::string status, float progress);
+
     static bool mLoaded;
     static long mLara;
+
+    static bool mLoading;
+    static std::string nextLevel;
+    static std::future<int> loadResult;
+    static std::atomic<bool> loadCancelled;
+    static std::atomic<float> loadProgress;
+    static std::string loadStatus;
+    static std::mutex loadStatusMutex;
+    static WorkQueue mainQueue;
     static bool activeEvents[ActionEventCount];
 };
 
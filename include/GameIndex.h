@@ -0,0 +1,72 @@
+/*!
+ * \file include/GameIndex.h
+ * \brief Index of the game installations shown in the Menu
+ *
+ * \author xythobuz
+ */
+
+#ifndef _GAME_INDEX_H_
+#define _GAME_INDEX_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FolderIndex;
+class ThreadPool;
+
+/*!
+ * \brief Scripts and title pictures of all games below the pak directory.
+ *
+ * Parsing every Script and decoding a picture for each game takes a while
+ * with many installations, so the results are kept in a small file. Entries
+ * are keyed by script path, size and modification time, only changed or new
+ * games are parsed again when scanning.
+ */
+class GameIndex {
+  public:
+    struct Entry {
+        std::string script; //!< Path of the tombpc.dat
+        std::string folder; //!< Installation the script belongs to
+        uint64_t size;
+        int64_t mtime;
+        bool valid; //!< Script could be parsed, kept anyway so it is not tried again
+
+        std::string language;
+        std::string description;
+        std::vector<std::string> levelNames;
+        std::vector<std::string> levelFiles;
+        std::vector<std::string> cutscenes;
+        std::vector<std::string> videos;
+        std::vector<std::string> pictures;
+        std::vector<std::string> titles;
+
+        std::vector<unsigned char> thumbnail; //!< RGBA, thumbnailSize squared, empty if none
+
+        Entry() : size(0), mtime(0), valid(false) { }
+    };
+
+    const static unsigned int thumbnailSize = 128;
+
+    //! \returns 0 on success, nothing is changed on error
+    int read(std::string file);
+    int write(std::string file);
+
+    /*!
+     * \brief Finds all games below pakDir, parsing new and changed ones on pool
+     * \returns number of entries that were added, changed or removed
+     */
+    unsigned long scan(std::string pakDir, ThreadPool& pool);
+
+    unsigned long size() { return entries.size(); }
+    Entry& get(unsigned long i) { return entries.at(i); }
+
+  private:
+    static void parse(Entry& e, unsigned int random, FolderIndex& folder);
+    static void loadThumbnail(Entry& e, std::string file);
+
+    std::vector<Entry> entries;
+};
+
+#endif
+
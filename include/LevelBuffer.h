@@ -0,0 +1,73 @@
+/*!
+ * \file include/LevelBuffer.h
+ * \brief Geometry of the whole level in one buffer
+ *
+ * \author xythobuz
+ */
+
+#ifndef _LEVEL_BUFFER_H_
+#define _LEVEL_BUFFER_H_
+
+#include <memory>
+#include <vector>
+
+#include "system/Shader.h"
+
+/*!
+ * \brief Textured geometry of all rooms and meshes in one vertex and index buffer
+ *
+ * Every room and every distinct Mesh is a sub-mesh, with its first index and
+ * base vertex. Room vertices are moved to world space, so all visible rooms
+ * share one matrix. Sub-meshes queued with add() while drawing a frame are
+ * submitted together by draw(), with glMultiDrawElementsIndirect() on GL 4.3
+ * or one glMultiDrawElementsBaseVertex() per distinct matrix before that.
+ */
+class LevelBuffer {
+  public:
+    /*!
+     * \brief Packs the geometry of the World.
+     * Has to run on the main thread, after prepare() and before the meshes
+     * free their vertices in upload().
+     */
+    static void build();
+    static void clear();
+
+    //! Built, enabled and drawing GAME textures from the texture array
+    static bool canDraw();
+
+    /*!
+     * \brief Queue a sub-mesh for the next draw()
+     * \param subMesh index from Mesh or RoomMesh, may be < 0
+     * \param MVP matrix for this sub-mesh, VP only for rooms
+     * \returns false if the sub-mesh has to be drawn on its own
+     */
+    static bool add(long subMesh, glm::mat4 MVP);
+    static void draw();
+
+    static void setEnabled(bool e) { enabled = e; }
+    static bool getEnabled() { return enabled; }
+
+    static unsigned long getMemorySize();
+    static unsigned long getLastCommands() { return lastCommands; }
+    static int getLastDrawCalls() { return lastDrawCalls; }
+
+  private:
+    struct SubMesh {
+        unsigned int first, count;
+        int baseVertex;
+
+        SubMesh(unsigned int f, unsigned int c, int b) : first(f), count(c), baseVertex(b) { }
+    };
+
+    static std::unique_ptr<ShaderMesh> buffers;
+    static std::vector<SubMesh> subMeshes;
+    static std::vector<DrawElementsIndirectCommand> commands;
+    static std::vector<glm::mat4> matrices;
+
+    static bool enabled;
+    static unsigned long lastCommands;
+    static int lastDrawCalls;
+};
+
+#endif
+
@@ -0,0 +1,76 @@
+/*!
+ * \file include/LevelCache.h
+ * \brief On-disk cache of prepared levels
+ *
+ * \author xythobuz
+ */
+
+#ifndef _LEVEL_CACHE_H_
+#define _LEVEL_CACHE_H_
+
+#include <cstdint>
+#include <string>
+
+class BinaryReader;
+class BinaryMapped;
+class CacheWriter;
+
+/*!
+ * \brief On-disk cache of fully prepared levels
+ *
+ * After a level has been loaded and prepared, the resulting GPU-ready state
+ * (mesh and room buffers, RGBA texture pages, tiles, world objects and
+ * sound tables) is stored in `<basedir>/cache/<hash>.orc`. Loading the same
+ * level again maps this file and rebuilds everything from it, without
+ * running any Loader or prepare() step.
+ *
+ * Cache files are keyed on a hash of the level file. Files with another
+ * format version or level hash are ignored and rewritten on the next load.
+ */
+class LevelCache {
+  public:
+    /*!
+     * \brief Rebuild a level from its cache file, if there is a valid one.
+     * Has to be called on an empty World and TextureManager.
+     * \param level level file that should be loaded
+     * \returns 0 on success, < 0 if there is no usable cache file
+     */
+    static int load(std::string level);
+
+    /*!
+     * \brief Store the currently loaded and prepared level.
+     * \param level level file that has been loaded
+     * \param lara Index of the Lara entity, or -1
+     * \returns 0 on success
+     */
+    static int write(std::string level, long lara);
+
+    static bool getEnabled() { return enabled; }
+    static void setEnabled(bool e) { enabled = e; }
+
+  private:
+    static int getCacheFile(std::string level, std::string& file, uint64_t& hash, uint64_t& size);
+
+    static int writeTextures(CacheWriter& w);
+    static void writeMeshes(CacheWriter& w);
+    static void writeRooms(CacheWriter& w);
+    static void writeWorld(CacheWriter& w);
+    static void writeAnimations(CacheWriter& w);
+    static void writeFloorData(CacheWriter& w);
+    static void writeNavigation(CacheWriter& w);
+    static void writeSound(CacheWriter& w);
+
+    static void readTextures(BinaryMapped& r);
+    static void readMeshes(BinaryReader& r);
+    static void readRooms(BinaryReader& r);
+    static void readWorld(BinaryReader& r);
+    static void readAnimations(BinaryReader& r);
+    static void readFloorData(BinaryReader& r);
+    static void readNavigation(BinaryReader& r);
+    static void readSound(BinaryMapped& r, std::string cacheFile);
+
+    static bool enabled;
+};
+
+#endif
+
@@ -9,8 +9,10 @@
 #define _LOG_H_
 
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 #include <glm/gtc/type_precision.hpp>
@@ -35,13 +37,25 @@ class Log {
     const static char endl = '\n';
 
     static void initialize();
+
+    // Can be used from any thread, each one gets its own buffers
     static LogLevel& get(int level);
-    static unsigned long size() { return wholeLog.size(); }
+
+    // Only to be used from the main thread
+    static unsigned long size();
     static LogEntry& getEntry(unsigned long i) { return wholeLog.at(i); }
 
   private:
+    static void add(std::string s, int level);
+
     static std::vector<LogLevel> logs;
     static std::vector<LogEntry> wholeLog;
+
+    // Entries from other threads, moved to wholeLog by the main thread
+    static std::thread::id mainThread;
+    static std::mutex mutex;
+    static std::vector<LogEntry> pending;
+
     friend class LogLevel;
 };
 
@@ -68,10 +82,7 @@ class LogLevel {
         if (printBuffer.str().back() == Log::endl) {
             std::string s = printBuffer.str().substr(0, printBuffer.str().length() - 1);
             printBuffer.str("");
-            Log::wholeLog.emplace_back(s, level);
-#ifdef DEBUG
-            std::cout << s << std::endl;
-#endif
+            Log::add(s, level);
         }
         return (*this);
     }
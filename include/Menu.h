@@ -8,10 +8,12 @@
 #ifndef _MENU_H_
 #define _MENU_H_
 
+#include <future>
+#include <string>
 #include <vector>
 
-#include "Script.h"
-#include "utils/Folder.h"
+#include "GameIndex.h"
+#include "utils/FolderIndex.h"
 
 class Menu {
   public:
@@ -26,11 +28,18 @@ class Menu {
     static const glm::vec4 selectedColor;
 
   private:
+    static void updateImages();
+
     static bool visible;
-    static Folder* mapFolder;
-    static std::vector<Script> scripts;
-    static std::vector<Folder> paths;
-    static std::vector<int> images;
+    static GameIndex games;
+    static std::vector<int> images; //!< Thumbnail of each game, or -1
+    static std::vector<int> slots; //!< Texture slots, reused for new thumbnails
+
+    // Checked for changes in the background, replaces games when done
+    static GameIndex scanned;
+    static std::future<unsigned long> scanResult;
+
+    static FolderIndex levels; //!< Files below the pak folder, walked on first Play
 };
 
 #endif
@@ -31,6 +31,20 @@ struct IndexedColoredRectangle {
         : v1(_v1), v2(_v2), v3(_v3), v4(_v4), index(paletteIndex) { }
 };
 
+// Consecutive triangles using the same texture, in an index buffer
+struct MeshDrawRange {
+    unsigned int texture, first, count;
+
+    MeshDrawRange(unsigned int t, unsigned int f, unsigned int c)
+        : texture(t), first(f), count(c) { }
+};
+
+// Reorders triangles so all using one texture are consecutive
+void sortTrianglesByTexture(std::vector<unsigned short>& indices,
+                            const std::vector<unsigned int>& textures);
+std::vector<MeshDrawRange> findDrawRanges(const std::vector<unsigned short>& indices,
+                                          const std::vector<unsigned int>& textures);
+
 // --------------------------------------
 
 class Mesh {
@@ -41,11 +55,39 @@ class Mesh {
          const std::vector<IndexedColoredRectangle>& coloredRectangles,
          const std::vector<IndexedColoredRectangle>& coloredTriangles);
     void prepare();
+    void upload();
     void display(glm::mat4 MVP, ShaderTexture* shaderTexture = nullptr);
 
+    // Textured part queued in the LevelBuffer if possible, colored part drawn now
+    void displayBatched(glm::mat4 MVP);
+
+    // Queued until drawInstances(), which draws each Mesh once for all its MVPs
+    void displayInstanced(glm::mat4 MVP);
+    static void drawInstances();
+
+    // Statistics of the last drawInstances()
+    static unsigned long getLastInstances() { return lastInstances; }
+    static unsigned long getLastInstanceDraws() { return lastInstanceDraws; }
+    static unsigned long getLastDrawsWithoutInstancing() { return lastDrawsWithout; }
+
     BoundingSphere& getBoundingSphere() { return sphere; }
 
+    // Bytes used by the vertex, index and texture buffers, on the CPU and GPU
+    unsigned long getMemorySize();
+
+    // Only valid after prepare(), before upload()
+    unsigned long sizeVertices() { return verticesBuff.size() + verticesColorBuff.size(); }
+    unsigned long sizeTriangles() { return (indicesBuff.size() + indicesColorBuff.size()) / 3; }
+
+    // Draw ranges of one static index buffer, or build indices per texture every frame
+    static void setDrawRanges(bool d) { drawRanges = d; }
+    static bool getDrawRanges() { return drawRanges; }
+
   private:
+    Mesh() : uploaded(false), levelIndex(-1) { }
+    friend class LevelBuffer;
+    friend class LevelCache;
+
     std::vector<unsigned short> indicesBuff;
     std::vector<glm::vec3> verticesBuff;
     std::vector<glm::vec2> uvsBuff;
@@ -56,7 +98,18 @@ class Mesh {
     std::vector<glm::vec3> colorsBuff;
     std::vector<unsigned int> colorsIndexBuff;
 
+    bool uploaded;
+    ShaderMesh buffers, colorBuffers;
+    std::vector<MeshDrawRange> ranges;
+    long levelIndex;
+    std::vector<glm::mat4> instances;
+
     BoundingSphere sphere;
+
+    static bool drawRanges;
+
+    static std::vector<Mesh*> instanced;
+    static unsigned long lastInstances, lastInstanceDraws, lastDrawsWithout;
 };
 
 #endif
@@ -0,0 +1,124 @@
+/*!
+ * \file include/Navigation.h
+ * \brief NPC navigation graph and path finder
+ *
+ * \author xythobuz
+ */
+
+#ifndef _NAVIGATION_H_
+#define _NAVIGATION_H_
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+/*!
+ * \brief Zone tables, one per class of NPC.
+ *
+ * Two boxes are only connected for an NPC if both have the same zone ID in
+ * its table. Swimming NPCs use the flying table. Every table exists for the
+ * normal and the flipped room state.
+ */
+enum NavigationZone {
+    NavigationZoneGround1 = 0, //!< Steps of one click, like Lara
+    NavigationZoneGround2, //!< Steps of two clicks
+    NavigationZoneGround3,
+    NavigationZoneGround4,
+    NavigationZoneFly, //!< Flying and swimming
+    NavigationZoneCount
+};
+
+enum NavigationBoxFlags {
+    NavigationBoxBlockable = (1 << 0), //!< Behind a door or something alike
+    NavigationBoxBlocked = (1 << 1)
+};
+
+/*!
+ * \brief Boxes, their overlaps and zones, as compressed sparse row graph.
+ *
+ * The neighbours of box b are neighbours[firstNeighbour[b]] up to
+ * neighbours[firstNeighbour[b + 1]]. Paths are found with A*, on a binary
+ * heap, with buffers kept per thread and reused by every query.
+ */
+class Navigation {
+  public:
+    struct Box {
+        int32_t xMin, xMax, zMin, zMax; //!< World coordinates
+        int16_t floor; //!< Y, grows downward
+        uint16_t flags; //!< NavigationBoxFlags
+    };
+
+    struct Query {
+        uint32_t start, goal; //!< Box indices
+        uint8_t zone; //!< NavigationZone
+        bool flipped; //!< Use the alternate room state
+    };
+
+    struct Result {
+        std::vector<uint32_t> path; //!< Boxes from start to goal, empty if unreachable
+        uint32_t cost;
+        uint32_t expanded; //!< Boxes taken from the heap
+    };
+
+    const static unsigned int zoneTables = NavigationZoneCount * 2;
+    const static uint32_t noPath = 0xFFFFFFFF;
+
+    Navigation() { clear(); }
+
+    void clear();
+    unsigned long getMemorySize();
+
+    /*!
+     * \brief Builds the graph from the tables of a level file.
+     * \param boxes all boxes
+     * \param overlapIndices index of the overlap list of each box, flags in bits 14 and 15
+     * \param overlaps box indices, the last one of each list has bit 15 set
+     * \param zones zoneTables arrays of boxes.size() zone IDs, normal state first
+     * \returns number of invalid overlap entries that were skipped
+     */
+    unsigned long build(const std::vector<Box>& boxes, const std::vector<uint16_t>& overlapIndices,
+                        const std::vector<uint16_t>& overlaps, const std::vector<int16_t>& zones);
+
+    unsigned long sizeBox() { return boxes.size(); }
+    const Box& getBox(unsigned long i) const { return boxes[i]; }
+    void setBlocked(unsigned long box, bool blocked);
+
+    unsigned long sizeNeighbours(unsigned long box) const {
+        return firstNeighbour[box + 1] - firstNeighbour[box];
+    }
+    const uint32_t* getNeighbours(unsigned long box) const {
+        return neighbours.data() + firstNeighbour[box];
+    }
+
+    int16_t getZone(unsigned long box, unsigned int zone, bool flipped) const {
+        return zones[(box * zoneTables) + zone + (flipped ? NavigationZoneCount : 0)];
+    }
+
+    /*!
+     * \brief Finds the cheapest path between two boxes.
+     *
+     * Boxes in another zone than start, and blocked boxes, are never entered.
+     * Costs are Manhattan distances between box centers.
+     * \returns cost of the path, noPath if goal can not be reached
+     */
+    uint32_t findPath(const Query& query, std::vector<uint32_t>& path, uint32_t* expanded = nullptr);
+
+    //! Solves all queries, spread over the threads of pool
+    void findPaths(const std::vector<Query>& queries, std::vector<Result>& results,
+                   ThreadPool& pool);
+
+  private:
+    friend class LevelCache;
+
+    uint32_t distance(uint32_t a, uint32_t b) const;
+
+    std::vector<Box> boxes;
+    std::vector<int32_t> centers; // x, y and z of every box
+    std::vector<uint32_t> firstNeighbour; // boxes.size() + 1 entries
+    std::vector<uint32_t> neighbours;
+    std::vector<int16_t> zones; // zoneTables per box
+};
+
+#endif
+
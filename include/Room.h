@@ -20,13 +20,29 @@ enum RoomFlags {
     RoomFlagUnderWater = (1 << 0)
 };
 
+/*!
+ * \brief Result of a height query at one point
+ */
+struct SectorHeight {
+    float floor; //!< Solid floor below the point, after following floor portals
+    float ceiling; //!< Solid ceiling above the point, after following ceiling portals
+    int room; //!< Room containing the point, -1 if unknown
+    int floorRoom; //!< Room owning the solid floor
+    int ceilingRoom; //!< Room owning the solid ceiling
+    unsigned int info; //!< FloorData record of the solid floor, triggers and flags
+    bool wall;
+};
+
 class Room {
   public:
     Room(glm::vec3 _pos, BoundingBox* _bbox, RoomMesh* _mesh, unsigned int f,
          int a, int x, int z, int i);
 
     void prepare() { mesh->prepare(); }
-    void display(glm::mat4 VP);
+
+    // Without geometry, after displayGeometry() has queued it in the LevelBuffer
+    void display(glm::mat4 VP, bool geometry = true);
+    void displayGeometry(glm::mat4 VP, bool batch = false);
 
     bool isWall(unsigned long sector);
     long getSector(float x, float z, float* floor, float* ceiling);
@@ -35,6 +51,7 @@ class Room {
     int getAdjoiningRoom(float x, float y, float z,
                          float x2, float y2, float z2);
 
+    glm::vec3 getPosition() { return pos; }
     BoundingBox& getBoundingBox() { return *bbox; }
     RoomMesh& getMesh() { return *mesh; }
 
@@ -44,7 +61,29 @@ class Room {
     int getNumZSectors() { return numZSectors; }
     int getIndex() { return roomIndex; }
 
-    void addSector(Sector* s) { sectors.emplace_back(s); }
+    // Grid of numXSectors * numZSectors, indexed with (x * numZSectors) + z
+    void setSectors(std::vector<Sector>& s);
+    unsigned long sizeSectors() { return sectors.size(); }
+    Sector& getSector(unsigned long index) { return sectors.at(index); }
+
+    //! Sector below the world position, clamped to the grid
+    const Sector& sectorAt(float x, float z) const {
+        int sx = (static_cast<int>(x) - static_cast<int>(pos.x)) >> 10;
+        int sz = (static_cast<int>(z) - static_cast<int>(pos.z)) >> 10;
+        sx = (sx < 0) ? 0 : ((sx >= numXSectors) ? (numXSectors - 1) : sx);
+        sz = (sz < 0) ? 0 : ((sz >= numZSectors) ? (numZSectors - 1) : sz);
+        return sectors[(sx * numZSectors) + sz];
+    }
+
+    /*!
+     * \brief Floor and ceiling heights of n points in this room.
+     *
+     * Points leaving the room vertically through a floor or ceiling portal
+     * are moved into the room above or below, points in border sectors
+     * through their wall portal. The floor and ceiling are then followed
+     * through portals until a solid one is found, and their slope applied.
+     */
+    void heightsAt(const glm::vec3* points, SectorHeight* out, unsigned long n);
 
     void addSprite(RoomSprite* s) { sprites.emplace_back(s); }
     unsigned long sizeSprites() { return sprites.size(); }
@@ -73,6 +112,8 @@ class Room {
     static bool getShowRoomGeometry() { return showRoomGeometry; }
 
   private:
+    friend class LevelCache;
+
     glm::vec3 pos;
     glm::mat4 model;
     std::unique_ptr<BoundingBox> bbox;
@@ -87,7 +128,7 @@ class Room {
     std::vector<std::unique_ptr<RoomSprite>> sprites;
     std::vector<std::unique_ptr<StaticModel>> models;
     std::vector<std::unique_ptr<Portal>> portals;
-    std::vector<std::unique_ptr<Sector>> sectors;
+    std::vector<Sector> sectors;
 
     static bool showBoundingBox;
     static bool showRoomModels;
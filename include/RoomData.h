@@ -8,24 +8,35 @@
 #ifndef _ROOM_DATA_H_
 #define _ROOM_DATA_H_
 
+#include <vector>
+
 #include "BoundingBox.h"
 
 class StaticModel {
   public:
     StaticModel(glm::vec3 pos, float angle, int i);
-    void display(glm::mat4 VP);
+    void display(glm::mat4 VP, bool batch = false);
     void displayUI();
 
+    // Group models by mesh each frame, drawn by Mesh::drawInstances()
+    static void setInstanced(bool i) { instanced = i; }
+    static bool getInstanced() { return instanced; }
+    static bool canDrawInstanced();
+
     glm::vec3 getCenter();
     float getRadius();
     void displayBoundingSphere(glm::mat4 VP, glm::vec3 color);
 
   private:
+    friend class LevelCache;
+
     void find();
 
     int id;
     int cache;
     glm::mat4 model;
+
+    static bool instanced;
 };
 
 // --------------------------------------
@@ -35,12 +46,16 @@ class RoomSprite {
     RoomSprite(glm::vec3 p, int s) : pos(p), sprite(s) { }
     void display(glm::mat4 VP);
     void displayUI();
+    void appendBatch(std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs,
+                     std::vector<float>& layers);
 
     glm::vec3 getCenter();
     float getRadius();
     void displayBoundingSphere(glm::mat4 VP, glm::vec3 color);
 
   private:
+    friend class LevelCache;
+
     glm::vec3 pos;
     int sprite;
 };
@@ -79,17 +94,36 @@ class Portal {
 
 // --------------------------------------
 
+/*!
+ * \brief One 1024x1024 cell of the sector grid of a Room.
+ *
+ * Heights are absolute world coordinates, y grows downward, so the
+ * floor has the larger value. Kept small and trivially copyable, a
+ * Room stores its sectors in one contiguous array.
+ */
 class Sector {
   public:
-    Sector(float f, float c, bool w) : floor(f), ceiling(c), wall(w) { }
-    float getFloor();
-    float getCeiling();
-    bool isWall();
-
-  private:
-    float floor;
-    float ceiling;
-    bool wall;
+    const static uint8_t noRoom = 0xFF;
+    const static uint16_t noBox = 0xFFFF;
+
+    Sector() : floor(0), ceiling(0), floorData(0), box(noBox),
+        roomBelow(noRoom), roomAbove(noRoom), wall(0), unused(0) { }
+    Sector(int16_t f, int16_t c, uint16_t fd, uint16_t b, uint8_t below, uint8_t above, bool w)
+        : floor(f), ceiling(c), floorData(fd), box(b), roomBelow(below), roomAbove(above),
+          wall(w ? 1 : 0), unused(0) { }
+
+    float getFloor() const { return floor; }
+    float getCeiling() const { return ceiling; }
+    bool isWall() const { return wall != 0; }
+
+    int16_t floor;
+    int16_t ceiling;
+    uint16_t floorData; //!< FloorData offset while loading, then its FloorData record
+    uint16_t box; //!< noBox if none
+    uint8_t roomBelow; //!< noRoom if the floor is solid
+    uint8_t roomAbove; //!< noRoom if the ceiling is solid
+    uint8_t wall;
+    uint8_t unused;
 };
 
 #endif
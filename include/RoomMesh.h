@@ -30,13 +30,33 @@ class RoomMesh {
              const std::vector<IndexedRectangle>& rectangles,
              const std::vector<IndexedRectangle>& triangles);
     void prepare();
+    void upload();
     void display(glm::mat4 MVP);
 
+    // Sub-mesh in the LevelBuffer, with world space vertices, or < 0
+    long getLevelIndex() { return levelIndex; }
+
+    // Bytes used by this mesh on the CPU and GPU
+    unsigned long getMemorySize();
+
+    // Vertices are only valid after prepare(), before upload(), like in Mesh
+    unsigned long sizeVertices() { return verticesBuff.size(); }
+    unsigned long sizeTriangles() { return indicesBuff.size() / 3; }
+
   private:
+    RoomMesh() : uploaded(false), levelIndex(-1) { }
+    friend class LevelBuffer;
+    friend class LevelCache;
+
     std::vector<unsigned short> indicesBuff;
     std::vector<glm::vec3> verticesBuff;
     std::vector<glm::vec2> uvsBuff;
     std::vector<unsigned int> texturesBuff;
+
+    bool uploaded;
+    ShaderMesh buffers;
+    std::vector<MeshDrawRange> ranges;
+    long levelIndex;
 };
 
 #endif
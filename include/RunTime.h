@@ -35,9 +35,18 @@ class RunTime {
     static bool isRunning() { return gameIsRunning; }
     static void setRunning(bool run) { gameIsRunning = run; }
 
+    // No window, OpenGL or audio, for tools and benchmarks.
+    // TextureManager and Sound are not initialized then, so they skip uploads.
+    static bool isHeadless() { return headless; }
+    static void setHeadless(bool h) { headless = h; }
+
     static bool getShowFPS() { return showFPS; }
     static void setShowFPS(bool f) { showFPS = f; }
 
+    // Loaders share meshes with identical data, not only identical offsets
+    static bool getHashMeshes() { return hashMeshes; }
+    static void setHashMeshes(bool h) { hashMeshes = h; }
+
     static unsigned long getFPS() { return fps; }
     static const std::vector<float>& getHistoryFPS() { return history; }
     static float getLastFrameTime() { return lastFrameTime / 1000.0f; }
@@ -53,7 +62,9 @@ class RunTime {
 
     static KeyboardButton keyBindings[ActionEventCount];
     static bool gameIsRunning;
+    static bool headless;
     static bool showFPS;
+    static bool hashMeshes;
 
     static unsigned long lastTime, lastFrameTime;
     static unsigned long frameCount, frameCount2;
@@ -23,6 +23,8 @@ class BoneTag {
     char getFlag() { return flag; }
 
   private:
+    friend class LevelCache;
+
     int mesh;
     glm::vec3 off, rot;
     char flag;
@@ -54,6 +56,8 @@ class AnimationFrame {
     void add(BoneFrame* f);
 
   private:
+    friend class LevelCache;
+
     char rate;
     std::vector<BoneFrame*> frame;
 };
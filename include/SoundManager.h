@@ -8,13 +8,20 @@
 #ifndef _SOUNDMANAGER_H_
 #define _SOUNDMANAGER_H_
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
+class BinaryMapped;
+
 class SoundSource {
   public:
     SoundSource(glm::vec3 p, int i, int f)
-        : pos(p), id(i), flags(f), source(-1), playing(false) { }
+        : pos(p), id(i), flags(f), source(-1), playing(false), active(false) { }
     void prepare();
+    void release();
     void play();
     void stop();
     glm::vec3 getPos() { return pos; }
@@ -22,11 +29,13 @@ class SoundSource {
     int getFlags() { return flags; }
     int getSource() { return source; }
     bool isPlaying() { return playing; }
+    bool isActive() { return active; }
 
   private:
     glm::vec3 pos;
     int id, flags, source;
-    bool playing;
+    bool playing; //!< Should be heard when the camera is close
+    bool active; //!< Sample bound, camera close enough
 };
 
 class SoundDetail {
@@ -42,6 +51,15 @@ class SoundDetail {
     float volume;
 };
 
+/*!
+ * \brief Sound tables of the level and its samples.
+ *
+ * Samples are only indexed while loading, as offsets into a memory mapped
+ * file (MAIN.SFX, the level itself or the level cache). A sound buffer is
+ * created when a sample is played for the first time, or when the camera
+ * comes close to a sound source using it. Buffers that are not playing are
+ * deleted again, least recently used first, to stay below the memory budget.
+ */
 class SoundManager {
   public:
     static void clear();
@@ -52,18 +70,55 @@ class SoundManager {
     static void addSoundDetail(int sample, float volume);
     static void addSampleIndex(int index);
 
+    // Maps f until clear(), returns the index for addSample(), or < 0 on error
+    static int addSampleFile(std::string f);
+    static const char* getSampleFile(unsigned int file, long long* size = nullptr);
+    static void addSample(unsigned int file, long long offset, uint32_t length);
+    static unsigned long sizeSamples() { return samples.size(); }
+    static const char* getSample(unsigned long sample, uint32_t* length);
+
     // index --> SoundMap --> SoundDetails --> SampleIndices --> play
     static int getIndex(int index, float* volume = nullptr, SoundDetail** sd = nullptr);
     static int playSound(int index);
 
+    //! Binds sample to source, loading it if needed. Creates the source if it is -1.
+    static int bindSample(int sample, int& source, float volume, bool atListener, bool loop);
+
+    static void setMemoryBudget(unsigned long bytes);
+    static unsigned long getMemoryBudget() { return memoryBudget; }
+    static unsigned long getMemoryUsed() { return bufferMemory; }
+
+    // Also starts the sound sources close to pos and releases far away ones
     static void listenAt(glm::vec3 pos, glm::vec3 at, glm::vec3 up);
     static void display();
 
   private:
+    friend class LevelCache;
+
+    struct Sample {
+        unsigned int file;
+        long long offset;
+        uint32_t length;
+        int buffer; //!< -1 if not loaded
+        unsigned long lastUse;
+        std::vector<std::pair<int, bool>> users; //!< Sources bound to buffer, at listener?
+
+        Sample(unsigned int f, long long o, uint32_t l)
+            : file(f), offset(o), length(l), buffer(-1), lastUse(0) { }
+    };
+
+    static int loadSample(unsigned long sample);
+    static void unloadSample(unsigned long sample);
+    static void evictSamples(unsigned long needed);
+
     static std::vector<SoundSource> soundSources;
     static std::vector<int> soundMap;
     static std::vector<SoundDetail> soundDetails;
     static std::vector<int> sampleIndices;
+
+    static std::vector<std::unique_ptr<BinaryMapped>> sampleFiles;
+    static std::vector<Sample> samples;
+    static unsigned long memoryBudget, bufferMemory, useCounter;
 };
 
 #endif
@@ -17,11 +17,18 @@ class Sprite {
     Sprite(int tile, int x, int y, int width, int height);
     void display(glm::mat4 MVP);
 
+    // Adds this sprite, transformed by model, to one texture array draw
+    void appendBatch(glm::mat4 model, std::vector<glm::vec3>& vertices,
+                     std::vector<glm::vec2>& uvs, std::vector<float>& layers);
+
     int getTexture() { return texture; }
     glm::vec4 getUVs() { return uv2D; }
     BoundingSphere& getBoundingSphere() { return boundingSphere; }
 
   private:
+    Sprite() : texture(0) { }
+    friend class LevelCache;
+
     int texture;
     std::vector<glm::vec3> vertexBuff;
     std::vector<glm::vec2> uvBuff;
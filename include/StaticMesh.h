@@ -17,7 +17,7 @@ class StaticMesh {
   public:
     StaticMesh(int i, int m, BoundingBox* b1, BoundingBox* b2)
         : id(i), mesh(m), bbox1(b1), bbox2(b2) { }
-    void display(glm::mat4 MVP);
+    void display(glm::mat4 MVP, bool batch = false, bool instanced = false);
     void displayUI();
 
     BoundingSphere& getBoundingSphere();
@@ -28,6 +28,8 @@ class StaticMesh {
     static bool getShowBoundingBox() { return showBoundingBox; }
 
   private:
+    friend class LevelCache;
+
     int id;
     int mesh;
     std::unique_ptr<BoundingBox> bbox1, bbox2;
@@ -35,6 +35,8 @@ class TextureTile {
     glm::vec2 getUV(unsigned int i);
 
   private:
+    friend class LevelCache;
+
     unsigned int attribute;
     unsigned int texture;
     std::vector<TextureTileVertex> vertices;
@@ -117,12 +119,52 @@ class TextureManager {
 
     static unsigned int getTextureID(int n, TextureStorage s);
 
+    /*!
+     * \brief Reads back the pixels of a loaded texture
+     * \param n ID of texture to read
+     * \param s Place where texture is stored
+     * \param image will be filled with RGBA pixel data
+     * \param width will be set to the width of the texture
+     * \param height will be set to the height of the texture
+     * \returns 0 on success
+     */
+    static int getTextureData(unsigned int n, TextureStorage s, std::vector<unsigned char>& image,
+                              unsigned int* width, unsigned int* height);
+
     static void setPalette(int index, glm::vec4 color);
     static glm::vec4 getPalette(int index);
 
     static void addIndexedTexture(unsigned char* image, unsigned int width, unsigned int height);
 
+    /*!
+     * \brief Allocates a texture array for the GAME textures about to be loaded.
+     * loadBufferSlot() fills the layer of every 256x256 GAME texture from
+     * the same data as its 2D texture.
+     * \param layers number of GAME textures
+     */
+    static void reserveTextureArray(unsigned int layers);
+
+    /*!
+     * \brief Finishes the reserved texture array, once all layers are filled
+     * \returns 0 on success, < 0 if the textures can't share one array
+     */
+    static int buildTextureArray();
+    static bool hasTextureArray() { return textureArray != 0; }
+
+    /*!
+     * \brief Bind the texture array to its texture unit.
+     * \returns ID of GL texture unit to which the array is bound.
+     */
+    static int bindTextureArray();
+
+    // Draw GAME textures from the array, instead of one texture per draw
+    static void setTextureArray(bool a) { useArray = a; }
+    static bool getTextureArray() { return useArray; }
+    static bool useTextureArray();
+
   private:
+    friend class LevelCache;
+
     static std::vector<unsigned int>& getIds(TextureStorage s);
     static std::vector<int>& getUnits(TextureStorage s);
 
@@ -144,6 +186,14 @@ class TextureManager {
 
     static std::array<glm::vec4, 256> colorPalette;
     static std::vector<std::tuple<unsigned char*, unsigned int, unsigned int>> indexedTextures;
+
+    static unsigned int textureArray;
+    static int textureArrayUnit;
+    static std::vector<bool> textureArrayLayers;
+    static bool useArray;
+
+    // Set by initialize(), without it textures only get slots but no GL objects
+    static bool hasContext;
 };
 
 #endif
@@ -12,8 +12,11 @@
 #include <memory>
 #include <vector>
 
+#include "AnimationStore.h"
 #include "Entity.h"
+#include "FloorData.h"
 #include "Mesh.h"
+#include "Navigation.h"
 #include "Room.h"
 #include "SkeletalModel.h"
 #include "Sprite.h"
@@ -50,10 +53,26 @@ class World {
     static unsigned long sizeStaticMesh();
     static StaticMesh& getStaticMesh(unsigned long index);
 
+    // Mesh indices can share one Mesh, which must not be modified after prepare()
     static void addMesh(Mesh* mesh);
+    static void addMeshReference(unsigned long index);
     static unsigned long sizeMesh();
     static Mesh& getMesh(unsigned long index);
 
+    // Every distinct Mesh, used by one or more mesh indices
+    static unsigned long sizeMeshResource();
+    static Mesh& getMeshResource(unsigned long index);
+    static unsigned long getMeshResourceIndex(unsigned long index);
+
+    // Keyframes of all moveables, SkeletalModels only keep their default frame
+    static AnimationStore& getAnimations() { return animations; }
+
+    // Sectors keep the index of their record in here, instead of a FloorData offset
+    static FloorData& getFloorData() { return floorData; }
+
+    // Boxes, overlaps and zones used by NPCs to find their way
+    static Navigation& getNavigation() { return navigation; }
+
     static void displayUI();
 
   private:
@@ -64,6 +83,10 @@ class World {
     static std::vector<std::unique_ptr<SkeletalModel>> models;
     static std::vector<std::unique_ptr<StaticMesh>> staticMeshes;
     static std::vector<std::unique_ptr<Mesh>> meshes;
+    static std::vector<unsigned long> meshIndices;
+    static AnimationStore animations;
+    static FloorData floorData;
+    static Navigation navigation;
 };
 
 #endif
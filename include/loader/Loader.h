@@ -8,11 +8,17 @@
 #ifndef _LOADER_LOADER_H_
 #define _LOADER_LOADER_H_
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
+#include <vector>
 #include <cstdint>
 
 #include "utils/binary.h"
+#include "utils/ThreadPool.h"
 
 class Loader {
   public:
@@ -28,11 +34,67 @@ class Loader {
     static LoaderVersion checkFile(std::string f);
     static std::unique_ptr<Loader> createLoader(std::string f);
 
+    //! Byte range of one section in the level file, recorded while scanning
+    struct Section {
+        std::string name;
+        long long offset;
+        long long size;
+        long long time; //!< Microseconds spent scanning, without decoding jobs
+
+        Section(std::string n, long long o) : name(n), offset(o), size(0), time(0) { }
+    };
+
+    //! Mesh pointer table entries and how many of them could share one Mesh
+    struct MeshStats {
+        unsigned long pointers; //!< Valid entries in the mesh pointer table
+        unsigned long offsets; //!< Distinct offsets in the mesh data
+        unsigned long decoded; //!< Meshes decoded, after comparing contents
+        long long bytesSkipped; //!< Mesh data that did not have to be decoded
+        unsigned long memorySaved; //!< Mesh buffer bytes that are not duplicated
+
+        MeshStats() : pointers(0), offsets(0), decoded(0), bytesSkipped(0), memorySaved(0) { }
+    };
+
+    //! Thrown out of load() when loading has been cancelled
+    struct Cancelled { };
+
+    Loader() : sectionOpen(false), hashMeshes(true), cancel(nullptr) { }
     virtual ~Loader();
     virtual int load(std::string f) = 0;
 
+    const std::vector<Section>& getSections() { return sections; }
+
+    // Also share meshes with identical data at different offsets
+    void setHashMeshes(bool h) { hashMeshes = h; }
+    const MeshStats& getMeshStats() { return meshStats; }
+
+    // Called from load() with the part of the file scanned so far (0 to 1),
+    // before the first and after every section
+    void setProgressCallback(std::function<void(float)> f) { progress = f; }
+
+    // Checked at the start of every section, load() throws Cancelled once it is set
+    void setCancelFlag(const std::atomic<bool>* c) { cancel = c; }
+
   protected:
-    BinaryFile file;
+    void beginSection(std::string name);
+    void endSection();
+
+    BinaryMapped file;
+    std::vector<Section> sections;
+    bool sectionOpen;
+    std::chrono::steady_clock::time_point sectionStart;
+
+    bool hashMeshes;
+    MeshStats meshStats;
+
+    std::function<void(float)> progress;
+    const std::atomic<bool>* cancel;
+
+    // Decoding jobs for independent sections, run while scanning continues.
+    // They use members of the derived loaders, whose destructors wait for them.
+    ThreadPool pool;
+    std::vector<std::future<void>> jobs;
+    void waitForJobs();
 };
 
 #endif
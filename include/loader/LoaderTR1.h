@@ -19,16 +19,16 @@ class LoaderTR1 : public LoaderTR2 {
     virtual void loadTextures();
     virtual void loadRoomLights();
     virtual void loadRoomStaticMeshes(std::vector<StaticModel*>& staticModels);
-    virtual void loadRoomVertex(RoomVertexTR2& vert);
+    virtual void loadRoomVertices(BinaryReader& room, std::vector<RoomVertexTR2>& vertices,
+                                  uint16_t numVertices);
     virtual void loadItems();
     virtual void loadBoxesOverlapsZones();
     virtual void loadSoundMap();
-    virtual void loadSoundSamples();
+    virtual void loadSoundSamples(std::string f);
 
     virtual int getPaletteIndex(uint16_t index);
-    virtual void loadAngleSet(BoneFrame* bf, BinaryReader& frame, uint16_t numMeshes,
-                              uint16_t startingMesh, uint32_t meshTree,
-                              uint32_t numMeshTrees, std::vector<int32_t> meshTrees);
+    virtual void loadAngleSet(BinaryReader& frame, long long size, uint16_t numBones,
+                              uint32_t* angles);
 };
 
 #endif
@@ -9,16 +9,64 @@
 #define _LOADER_LOADER_TR2_H_
 
 #include <array>
+#include <atomic>
 #include <cstdint>
+#include <mutex>
+#include <utility>
 
+#include "Mesh.h"
+#include "Navigation.h"
+#include "Room.h"
 #include "RoomData.h"
 #include "RoomMesh.h"
 #include "SkeletalModel.h"
 #include "utils/binary.h"
+#include "utils/BufferPool.h"
 #include "loader/Loader.h"
 
+// On-disk layouts, read in bulk with BinaryReader::readStruct()
+
+struct Vertex_t {
+    typedef int16_t Field;
+    int16_t x, y, z;
+};
+
+struct RoomVertex_t {
+    typedef int16_t Field;
+    int16_t x, y, z, light1;
+    uint16_t attributes;
+    int16_t light2;
+};
+
+struct Rectangle_t {
+    typedef uint16_t Field;
+    uint16_t vertices[4], texture;
+};
+
+struct Triangle_t {
+    typedef uint16_t Field;
+    uint16_t vertices[3], texture;
+};
+
+struct Portal_t {
+    typedef int16_t Field;
+    uint16_t adjoiningRoom;
+    Vertex_t normal;
+    Vertex_t vertices[4];
+};
+
+struct Sector_t {
+    typedef uint16_t Field;
+    uint16_t indexFloorData;
+    uint16_t indexBox;
+    uint16_t below; // uint8_t roomBelow, int8_t floor
+    uint16_t above; // uint8_t roomAbove, int8_t ceiling
+};
+
 class LoaderTR2 : public Loader {
   public:
+    LoaderTR2();
+    virtual ~LoaderTR2();
     virtual int load(std::string f);
 
   protected:
@@ -27,8 +75,10 @@ class LoaderTR2 : public Loader {
     virtual void loadRoomLights();
     virtual void loadRoomStaticMeshes(std::vector<StaticModel*>& staticModels);
     virtual void loadRoomDataEnd(int16_t& alternateRoom, unsigned int& roomFlags);
-    virtual void loadRoomVertex(RoomVertexTR2& vert);
-    virtual void loadRoomMesh(std::vector<IndexedRectangle>& rectangles,
+    virtual void loadRoomVertices(BinaryReader& room, std::vector<RoomVertexTR2>& vertices,
+                                  uint16_t numVertices);
+    virtual void loadRoomMesh(BinaryReader& room, long long size,
+                              std::vector<IndexedRectangle>& rectangles,
                               std::vector<IndexedRectangle>& triangles,
                               uint16_t& numRectangles, uint16_t& numTriangles);
     virtual void loadRooms();
@@ -41,6 +91,11 @@ class LoaderTR2 : public Loader {
     virtual void loadCameras();
     virtual void loadSoundSources();
     virtual void loadBoxesOverlapsZones();
+    // Zones are Navigation::zoneTables arrays, as in TR2 and later
+    void buildNavigation(const std::vector<Navigation::Box>& boxes,
+                         const std::vector<uint16_t>& overlapIndices,
+                         const std::vector<uint16_t>& overlaps,
+                         const std::vector<int16_t>& zones);
     virtual void loadAnimatedTextures();
     virtual void loadItems();
     virtual void loadCinematicFrames();
@@ -50,15 +105,62 @@ class LoaderTR2 : public Loader {
     virtual void loadSampleIndices();
 
     virtual void loadExternalSoundFile(std::string f);
-    virtual int loadSoundFiles(BinaryReader& sfx, unsigned int count = 0);
+    // Indexes count RIFF files (0 for all) at offset in a SoundManager sample file
+    virtual int loadSoundFiles(unsigned int sampleFile, long long offset, long long size,
+                               unsigned int count = 0);
 
     virtual int getPaletteIndex(uint16_t index);
-    virtual void loadAngleSet(BoneFrame* bf, BinaryReader& frame, uint16_t numMeshes,
-                              uint16_t startingMesh, uint32_t meshTree,
-                              uint32_t numMeshTrees, std::vector<int32_t> meshTrees);
-    virtual BoneFrame* loadFrame(BinaryReader& frame, uint16_t numMeshes,
-                                 uint16_t startingMesh, uint32_t meshTree,
-                                 uint32_t numMeshTrees, std::vector<int32_t> meshTrees);
+    virtual void loadAnimationSpeed();
+    // Reads numBones packed angle sets from a frame of size bytes, missing ones are zero
+    virtual void loadAngleSet(BinaryReader& frame, long long size, uint16_t numBones,
+                              uint32_t* angles);
+    // Adds the keyframe at data to the AnimationStore, returns its index or -1
+    long loadFrame(const char* data, long long size, uint16_t numBones);
+
+    // Reads a 16bit count, limited to the elements of elementSize bytes left
+    // before size, so a corrupt count can't cause a huge allocation
+    static uint16_t readCount(BinaryReader& r, long long size, std::size_t elementSize);
+
+    // These run on the pool, they must not use file or any global state
+    void decodeRoom(unsigned int index, const char* data, long long size,
+                    std::vector<StaticModel*> staticModels,
+                    int16_t alternateRoom, unsigned int roomFlags);
+    virtual Mesh* decodeMesh(const char* data, long long size);
+
+    // Waits for all decoding jobs, then adds their results in file order
+    void mergeResults();
+    void decodeFloorData();
+
+    // Called by the decoding jobs, queues the upload of a finished page
+    void queueUpload(unsigned int slot, unsigned char* page);
+    // Waits for all texture decoding jobs and the uploads they have queued
+    void uploadTextures();
+
+    struct DecodedRoom {
+        Room* room;
+        bool validSize; // Room data matched the size given in its header
+        bool empty; // No portals, vertices or faces
+
+        DecodedRoom() : room(nullptr), validSize(true), empty(false) { }
+    };
+
+    // Texture pages are decoded into pooled buffers, every finished page is
+    // handed to the main thread right away, so its buffer is soon reused
+    std::vector<std::future<void>> textureJobs;
+    std::vector<std::future<void>> textureUploads;
+    std::mutex textureUploadsMutex;
+    BufferPool texturePool;
+    std::atomic<long long> textureDecodeTime; // Microseconds, summed over all workers
+    std::atomic<long long> textureUploadTime; // Microseconds, on the main thread
+
+    std::vector<DecodedRoom> rooms;
+    std::vector<uint16_t> floorData; // Raw words, decoded in mergeResults()
+    // Distinct meshes, and the slot in meshes for every mesh pointer table entry
+    std::vector<Mesh*> meshes;
+    std::vector<unsigned int> meshIndices;
+
+    std::vector<uint32_t> frameAngles; // Scratch buffer of loadFrame()
+    const static unsigned int invalidMesh = 0xFFFFFFFF;
 };
 
 #endif
@@ -0,0 +1,68 @@
+/*!
+ * \file include/loader/LoaderTR4.h
+ * \brief TR4 level file loader
+ *
+ * \author xythobuz
+ */
+
+#ifndef _LOADER_LOADER_TR4_H_
+#define _LOADER_LOADER_TR4_H_
+
+#include "loader/LoaderTR3.h"
+
+// Mesh faces carry an additional effects word in TR4
+
+struct RectangleTR4_t {
+    typedef uint16_t Field;
+    uint16_t vertices[4], texture, effects;
+};
+
+struct TriangleTR4_t {
+    typedef uint16_t Field;
+    uint16_t vertices[3], texture, effects;
+};
+
+/*!
+ * \brief Loader for zlib-compressed TR4 levels.
+ *
+ * Texture pages and level geometry are stored in separate compressed
+ * chunks. Each chunk is inflated on its own pool worker, texture pages
+ * straight into pooled buffers. The geometry is parsed by the LoaderTR2
+ * code as soon as it is available, while the textures still decompress.
+ * Section offsets after "Geometry" are relative to the inflated geometry.
+ */
+class LoaderTR4 : public LoaderTR3 {
+  public:
+    virtual ~LoaderTR4();
+    virtual int load(std::string f);
+
+  protected:
+    virtual void loadRoomLights();
+    virtual void loadSprites();
+    virtual void loadCameras();
+    virtual void loadAnimatedTextures();
+    virtual void loadTextiles();
+    virtual void loadAnimationSpeed();
+    // Single angles have 4096 steps per turn in TR4
+    virtual void loadAngleSet(BinaryReader& frame, long long size, uint16_t numBones,
+                              uint32_t* angles);
+    virtual Mesh* decodeMesh(const char* data, long long size);
+
+    struct Chunk {
+        const char* data;
+        uint32_t compressed;
+        uint32_t uncompressed;
+
+        Chunk() : data(nullptr), compressed(0), uncompressed(0) { }
+    };
+
+    int readChunk(std::string name, Chunk& chunk);
+
+    // Runs on the pool, inflates count pages of 16 or 32bit and queues their uploads
+    void inflatePages(Chunk chunk, unsigned int first, unsigned int count, unsigned int bpp);
+
+    BinaryMapped container; // The level file itself, file holds the inflated geometry
+};
+
+#endif
+
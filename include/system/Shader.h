@@ -20,23 +20,81 @@ class ShaderBuffer {
     ShaderBuffer() : created(false), buffer(0), boundSize(0) { }
     ~ShaderBuffer();
 
-    void bufferData(int elem, int size, void* data);
+    void bufferData(int elem, int size, const void* data,
+                    gl::GLenum usage = gl::GL_DYNAMIC_DRAW);
 
     template<typename T>
-    void bufferData(std::vector<T> v)
-    { bufferData(v.size(), sizeof(T), &v[0]); }
+    void bufferData(const std::vector<T>& v, gl::GLenum usage = gl::GL_DYNAMIC_DRAW)
+    { bufferData(v.size(), sizeof(T), v.data(), usage); }
 
     void bindBuffer();
     void bindBuffer(int location, int size);
     void unbind(int location);
 
+    // mat4 attribute in four locations, advancing once per instance
+    void bindMatrixBuffer(int location);
+    void unbindMatrix(int location);
+
     unsigned int getBuffer() { orAssert(created); return buffer; }
     int getSize() { return boundSize; }
 
+    //! Bytes given to bufferData() since the last resetUploadedBytes()
+    static unsigned long getUploadedBytes() { return uploadedBytes; }
+    static void resetUploadedBytes() { uploadedBytes = 0; }
+
   private:
     bool created;
     unsigned int buffer;
     int boundSize;
+
+    static unsigned long uploadedBytes;
+};
+
+/*!
+ * \brief Geometry that does not change, uploaded once with its own vertex array.
+ *
+ * Positions are attribute 0, UVs or colors attribute 1, like in the shaders
+ * below. Without indices, an index buffer can be bound while drawing.
+ */
+class ShaderMesh {
+  public:
+    ShaderMesh() : vertexArray(0), memory(0) { }
+    ~ShaderMesh();
+
+    void upload(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>& uvs,
+                const std::vector<unsigned short>& indices = std::vector<unsigned short>());
+    void upload(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& colors,
+                const std::vector<unsigned short>& indices = std::vector<unsigned short>());
+
+    // Texture array layer of each vertex, as attribute 2
+    void uploadLayers(const std::vector<float>& layers);
+
+    // One matrix per instance as attributes 3 to 6, or one for all while bound
+    void uploadInstances(const std::vector<glm::mat4>& matrices);
+    void setInstance(const glm::mat4& matrix);
+
+    bool isUploaded() { return vertexArray != 0; }
+    void bind();
+    int getIndexCount() { return indexBuffer.getSize(); }
+    unsigned long getMemorySize() { return memory; }
+
+  private:
+    void upload(const std::vector<glm::vec3>& vertices, const void* other, int otherSize,
+                const std::vector<unsigned short>& indices);
+
+    unsigned int vertexArray;
+    ShaderBuffer vertexBuffer, otherBuffer, indexBuffer, layerBuffer, instanceBuffer;
+    unsigned long memory;
+};
+
+// One command of glMultiDrawElementsIndirect(), in the layout GL reads
+struct DrawElementsIndirectCommand {
+    unsigned int count, instanceCount, firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+
+    DrawElementsIndirectCommand(unsigned int c, unsigned int f, int b)
+        : count(c), instanceCount(1), firstIndex(f), baseVertex(b), baseInstance(0) { }
 };
 
 class ShaderTexture {
@@ -71,6 +129,7 @@ class Shader {
     void loadUniform(int uni, glm::vec4 vec);
     void loadUniform(int uni, glm::mat4 mat);
     void loadUniform(int uni, int texture, TextureStorage store);
+    void loadUniformTextureArray(int uni);
 
     static int initialize();
     static void shutdown();
@@ -94,6 +153,49 @@ class Shader {
                            gl::GLenum mode = gl::GL_TRIANGLES, ShaderTexture* target = nullptr,
                            Shader& shader = textureShader);
 
+    // Static geometry, with a range of its own indices, indices for one texture,
+    // or all of its own indices
+    static void drawGL(ShaderMesh& mesh, unsigned int first, unsigned int count,
+                       glm::mat4 MVP, unsigned int texture, TextureStorage store,
+                       gl::GLenum mode = gl::GL_TRIANGLES, ShaderTexture* target = nullptr,
+                       Shader& shader = textureShader);
+    static void drawGL(ShaderMesh& mesh, std::vector<unsigned short>& indices, glm::mat4 MVP,
+                       unsigned int texture, TextureStorage store,
+                       gl::GLenum mode = gl::GL_TRIANGLES, ShaderTexture* target = nullptr,
+                       Shader& shader = textureShader);
+    static void drawGL(ShaderMesh& mesh, glm::mat4 MVP, gl::GLenum mode = gl::GL_TRIANGLES,
+                       ShaderTexture* target = nullptr, Shader& shader = colorShader);
+
+    // GAME textures from the texture array, with the layer of each vertex
+    static void drawGLArray(ShaderMesh& mesh, glm::mat4 MVP, gl::GLenum mode = gl::GL_TRIANGLES,
+                            ShaderTexture* target = nullptr,
+                            Shader& shader = textureArrayShader);
+    static void drawGLArray(std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs,
+                            std::vector<float>& layers, glm::mat4 MVP,
+                            gl::GLenum mode = gl::GL_TRIANGLES, ShaderTexture* target = nullptr,
+                            Shader& shader = textureArrayShader);
+
+    /*!
+     * \brief Draws many meshes of one ShaderMesh, textured from the texture array.
+     * The matrix of each command is passed as its instance attribute.
+     * \returns number of GL draw calls that were needed
+     */
+    static int drawGLMulti(ShaderMesh& mesh, std::vector<DrawElementsIndirectCommand>& commands,
+                           std::vector<glm::mat4>& matrices, ShaderTexture* target = nullptr,
+                           Shader& shader = levelShader);
+
+    // All indices of a ShaderMesh once per matrix, textured from the texture array
+    static void drawGLInstanced(ShaderMesh& mesh, std::vector<glm::mat4>& matrices,
+                                gl::GLenum mode = gl::GL_TRIANGLES,
+                                ShaderTexture* target = nullptr, Shader& shader = levelShader);
+
+    static bool isVersionAtLeast(int major, int minor);
+    static bool hasExtension(const char* name);
+    static bool hasMultiDrawIndirect();
+
+    // The shared vertex array used by all other drawGL() calls
+    static void bindDefaultVertexArray();
+
     static void drawGL(std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& colors,
                        glm::mat4 MVP, gl::GLenum mode = gl::GL_TRIANGLES,
                        ShaderTexture* target = nullptr, Shader& shader = colorShader);
@@ -114,7 +216,7 @@ class Shader {
   private:
     int programID;
     std::vector<unsigned int> uniforms;
-    ShaderBuffer vertexBuffer, otherBuffer, indexBuffer;
+    ShaderBuffer vertexBuffer, otherBuffer, indexBuffer, layerBuffer, indirectBuffer;
 
     static void bindProperBuffer(ShaderTexture* target);
 
@@ -122,6 +224,13 @@ class Shader {
     static const char* textureShaderVertex;
     static const char* textureShaderFragment;
 
+    static Shader textureArrayShader;
+    static const char* textureArrayShaderVertex;
+    static const char* textureArrayShaderFragment;
+
+    static Shader levelShader;
+    static const char* levelShaderVertex;
+
     static Shader colorShader;
     static const char* colorShaderVertex;
     static const char* colorShaderFragment;
@@ -17,12 +17,15 @@ class Sound {
     static void clear();
 
     static int numBuffers();
-    static int loadBuffer(unsigned char* buffer, unsigned int length);
+    static int loadBuffer(const unsigned char* buffer, unsigned int length);
+    static void deleteBuffer(int buffer);
 
     static int numSources(bool atListener = false);
     static int addSource(int buffer, float volume = 1.0f, bool atListener = false, bool loop = false);
 
     static int sourceAt(int source, glm::vec3 pos);
+    static int sourceBuffer(int source, int buffer, bool atListener = false);
+    static bool isPlaying(int source, bool atListener = false);
     static void listenAt(glm::vec3 pos, glm::vec3 at, glm::vec3 up);
 
     static void play(int source, bool atListener = false);
@@ -36,6 +39,10 @@ class Sound {
     static float getVolume();
 
     static std::string getVersion(bool linked);
+
+  private:
+    // Set by initialize(), without it buffers are neither loaded nor freed
+    static bool hasBackend;
 };
 
 #endif
@@ -18,12 +18,15 @@ class SoundAL {
     static void clear();
 
     static int numBuffers();
-    static int loadBuffer(unsigned char* buffer, unsigned int length);
+    static int loadBuffer(const unsigned char* buffer, unsigned int length);
+    static void deleteBuffer(int buffer);
 
     static int numSources(bool atListener);
     static int addSource(int buffer, float vol, bool atListener, bool loop);
 
     static int sourceAt(int source, glm::vec3 pos);
+    static int sourceBuffer(int source, int buffer, bool atListener);
+    static bool isPlaying(int source, bool atListener);
     static void listenAt(glm::vec3 pos, glm::vec3 at, glm::vec3 up);
 
     static void play(int source, bool atListener);
@@ -0,0 +1,46 @@
+/*!
+ * \file include/utils/BufferPool.h
+ * \brief Reusable fixed size buffers
+ *
+ * \author xythobuz
+ */
+
+#ifndef _UTILS_BUFFERPOOL_H_
+#define _UTILS_BUFFERPOOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/*!
+ * \brief Thread-safe pool of equally sized buffers.
+ *
+ * At most maxBuffers buffers are allocated, get() then blocks
+ * until another thread returns one with put().
+ * All buffers are freed when the pool is destroyed.
+ */
+class BufferPool {
+  public:
+    BufferPool(std::size_t bufferSize, std::size_t maxBuffers);
+    ~BufferPool();
+
+    unsigned char* get();
+    void put(unsigned char* buffer);
+
+    std::size_t getBufferSize() { return size; }
+    std::size_t getCapacity() { return capacity; }
+    std::size_t getAllocated() { return allocated; }
+
+  private:
+    std::size_t size;
+    std::size_t capacity;
+    std::size_t allocated;
+    std::vector<unsigned char*> free;
+    std::vector<unsigned char*> all;
+    std::mutex mutex;
+    std::condition_variable returned;
+};
+
+#endif
+
@@ -0,0 +1,79 @@
+/*!
+ * \file include/utils/FolderIndex.h
+ * \brief Single pass recursive file search
+ *
+ * \author xythobuz
+ */
+
+#ifndef _UTILS_FOLDER_INDEX_H_
+#define _UTILS_FOLDER_INDEX_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "utils/Folder.h"
+
+class ThreadPool;
+
+/*!
+ * \brief Names of all files below a folder, read once and kept in memory.
+ *
+ * Folder::findRecursiveFilesEndingWith() lists the whole tree again for
+ * every suffix. This walks it a single time, reading subfolders in parallel
+ * relative to the descriptor of their parent, and answers any number of
+ * suffix queries from the index until invalidate() is called.
+ *
+ * Files are returned in the same order Folder uses: sorted, the files of a
+ * folder before those of its subfolders.
+ */
+class FolderIndex {
+  public:
+    explicit FolderIndex(std::string folder = "", bool listDotFiles = false);
+
+    std::string& getPath() { return path; }
+
+    //! Walks a different folder next time, the index is dropped if it changed
+    void setFolder(std::string folder);
+
+    //! Drops the index, the tree is walked again on the next query
+    void invalidate();
+
+    /*!
+     * \brief Walks the tree, unless there already is an index
+     * \param pool subfolders are read on its workers, nullptr for one thread
+     * \returns 0 on success
+     */
+    int scan(ThreadPool* pool = nullptr);
+
+    unsigned long fileCount();
+    unsigned long folderCount();
+
+    /*!
+     * \brief Appends all files ending with any of the suffixes.
+     *
+     * Thread-safe, scans on the calling thread if there is no index yet.
+     * \param below only search this folder and its subfolders, empty for all
+     */
+    void find(std::vector<File>& found, const std::vector<std::string>& suffixes,
+              std::string below = "", bool casesensitive = false);
+
+  private:
+    struct Node;
+
+    int walk(Node& node, ThreadPool* pool);
+    void flatten(Node& node);
+
+    std::string path; //!< Full path, with '/' at end
+    bool listDot;
+    bool scanned;
+
+    std::vector<std::string> folders; //!< Full paths, with '/' at end, depth-first
+    std::vector<std::pair<uint32_t, std::string>> files; //!< Folder index and name
+
+    std::mutex mutex;
+};
+
+#endif
+
@@ -0,0 +1,56 @@
+/*!
+ * \file include/utils/ThreadPool.h
+ * \brief Simple worker thread pool
+ *
+ * \author xythobuz
+ */
+
+#ifndef _UTILS_THREADPOOL_H_
+#define _UTILS_THREADPOOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+  public:
+    /*!
+     * \brief Starts the worker threads
+     * \param threads number of workers, 0 for one per hardware thread
+     */
+    explicit ThreadPool(unsigned int threads = 0);
+    ~ThreadPool();
+
+    unsigned int size() { return workers.size(); }
+
+    /*!
+     * \brief Queues a job
+     * \returns future that becomes ready when the job has finished
+     */
+    std::future<void> push(std::function<void()> job);
+
+    /*!
+     * \brief Runs f(0) ... f(count - 1) on the workers and the calling thread.
+     *
+     * Returns when all calls have finished. Safe to call from inside a job.
+     * The first exception thrown by f is rethrown here, after all calls.
+     */
+    void parallelFor(std::size_t count, std::function<void(std::size_t)> f);
+
+  private:
+    void work();
+
+    std::vector<std::thread> workers;
+    std::deque<std::packaged_task<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stop;
+};
+
+#endif
+
@@ -0,0 +1,63 @@
+/*!
+ * \file include/utils/WorkQueue.h
+ * \brief Jobs that have to run on one specific thread
+ *
+ * \author xythobuz
+ */
+
+#ifndef _UTILS_WORKQUEUE_H_
+#define _UTILS_WORKQUEUE_H_
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+/*!
+ * \brief Queue of jobs executed by the thread owning the queue.
+ *
+ * Used for work that is only allowed on the main thread (eg. OpenGL calls),
+ * while it is requested from a background thread.
+ */
+class WorkQueue {
+  public:
+    //! The constructing thread owns the queue
+    WorkQueue();
+
+    /*!
+     * \brief Queues a job for the owning thread.
+     *
+     * Jobs pushed from the owning thread itself run immediately,
+     * unless they are deferred to the next run().
+     * \param job work to do on the owning thread
+     * \param defer also queue the job when pushed from the owning thread
+     * \returns future that becomes ready when the job has finished
+     */
+    std::future<void> push(std::function<void()> job, bool defer = false);
+
+    /*!
+     * \brief Runs queued jobs, has to be called from the owning thread
+     * \param budget time in ms after which no further job is started, 0 for no limit
+     * \returns number of jobs that have been run
+     */
+    unsigned long run(unsigned long budget = 0);
+
+    /*!
+     * \brief Waits for a job, eg. one returned by push().
+     *
+     * On the owning thread, queued jobs are run meanwhile,
+     * so jobs pushed by other threads can't deadlock it.
+     */
+    void wait(std::future<void>& job);
+
+    bool empty();
+
+  private:
+    std::thread::id owner;
+    std::deque<std::packaged_task<void()>> jobs;
+    std::mutex mutex;
+};
+
+#endif
+
@@ -8,8 +8,12 @@
 #ifndef _UTILS_BINARY_H_
 #define _UTILS_BINARY_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 class BinaryReader {
   public:
@@ -33,7 +37,33 @@ class BinaryReader {
 
     virtual float readFloat();
 
+    // Length prefixed, as written by BinaryWriter::writeString()
+    std::string readString();
+
+    // Bulk reads of n little-endian values, converted to host byte order
+    template<typename T>
+    void readArray(T* dst, std::size_t n) {
+        static_assert(std::is_arithmetic<T>::value, "readArray() needs arithmetic types");
+        readBulk(reinterpret_cast<char*>(dst), n, sizeof(T));
+    }
+
+    /*!
+     * \brief Bulk read of n structs matching the on-disk layout.
+     *
+     * T has to be a POD consisting only of members of the same size,
+     * given by its `Field` typedef (eg. `typedef int16_t Field;`),
+     * so byte order conversion can be done per member.
+     */
+    template<typename T>
+    void readStruct(T* dst, std::size_t n = 1) {
+        typedef typename T::Field F;
+        static_assert(std::is_pod<T>::value, "readStruct() needs POD types");
+        static_assert((sizeof(T) % sizeof(F)) == 0, "readStruct() needs uniform members");
+        readBulk(reinterpret_cast<char*>(dst), n * (sizeof(T) / sizeof(F)), sizeof(F));
+    }
+
   private:
+    void readBulk(char* d, std::size_t count, std::size_t size);
     virtual void read(char* d, int c) = 0;
 };
 
@@ -73,5 +103,100 @@ class BinaryMemory : public BinaryReader {
     long long max;
 };
 
+/*!
+ * \brief Reads a whole file through a read-only memory mapping.
+ *
+ * Besides the usual BinaryReader interface, this allows direct pointer
+ * access into the mapped data, so parsers can work on it in place
+ * instead of copying it into temporary buffers first.
+ * Falls back to reading the file into memory where mmap is not available.
+ */
+class BinaryMapped : public BinaryReader {
+  public:
+    explicit BinaryMapped(std::string f = "");
+    virtual ~BinaryMapped();
+
+    int open(std::string f = "");
+    void close();
+
+    // Takes ownership of a buffer allocated with new[], instead of a file
+    int open(char* buffer, long long size);
+
+    virtual long long tell();
+    virtual void seek(long long pos = 0);
+    virtual bool eof();
+
+    long long size() { return max; }
+
+    // Pointers stay valid until the file is closed
+    const char* pointer(long long pos);
+    const char* pointer() { return pointer(offset); }
+    const char* span(long long n);
+
+  private:
+    virtual void read(char* d, int c);
+
+    const char* data;
+    long long offset;
+    long long max;
+    bool mapped;
+};
+
+/*!
+ * \brief Writes little-endian values, to be read back by BinaryReader
+ */
+class BinaryWriter {
+  public:
+    explicit BinaryWriter(std::string f)
+        : file(f, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc) { }
+
+    bool good() { return file.good(); }
+    void close() { file.close(); }
+
+    template<typename T>
+    void writeArray(const T* d, std::size_t n) {
+        static_assert(std::is_arithmetic<T>::value, "writeArray() needs arithmetic types");
+#ifdef WORDS_BIGENDIAN
+        for (std::size_t i = 0; i < n; i++) {
+            char tmp[sizeof(T)];
+            const char* s = reinterpret_cast<const char*>(d + i);
+            for (std::size_t j = 0; j < sizeof(T); j++)
+                tmp[j] = s[sizeof(T) - j - 1];
+            file.write(tmp, sizeof(T));
+        }
+#else
+        file.write(reinterpret_cast<const char*>(d), n * sizeof(T));
+#endif
+    }
+
+    void writeU8(uint8_t v) { writeArray(&v, 1); }
+    void writeU16(uint16_t v) { writeArray(&v, 1); }
+    void write16(int16_t v) { writeArray(&v, 1); }
+    void writeU32(uint32_t v) { writeArray(&v, 1); }
+    void write32(int32_t v) { writeArray(&v, 1); }
+    void writeU64(uint64_t v) { writeArray(&v, 1); }
+    void write64(int64_t v) { writeArray(&v, 1); }
+    void writeFloat(float v) { writeArray(&v, 1); }
+
+    void writeString(const std::string& s) {
+        writeU32(s.size());
+        if (!s.empty())
+            writeArray(s.data(), s.size());
+    }
+
+    template<typename T>
+    void writeVector(const std::vector<T>& v) {
+        writeU32(v.size());
+        if (!v.empty())
+            writeArray(&v[0], v.size());
+    }
+
+  private:
+    std::ofstream file;
+};
+
+// 64bit FNV-1a, over whole words where possible
+uint64_t hashData(const char* data, long long size);
+
 #endif
 
@@ -8,11 +8,28 @@
 #ifndef _UTILS_FILESYSTEM_H_
 #define _UTILS_FILESYSTEM_H_
 
+#include <cstdint>
 #include <string>
 
 std::string getCurrentWorkingDirectory();
 
 std::string getHomeDirectory();
 
+/*!
+ * \brief Creates a single directory, if it does not exist yet
+ * \param path directory to create
+ * \returns 0 on success or if it already exists
+ */
+int createDirectory(std::string path);
+
+/*!
+ * \brief Reads size and last modification time of a file
+ * \param path file to check
+ * \param size will be set to the size in bytes
+ * \param mtime will be set to the modification time, in seconds
+ * \returns 0 on success
+ */
+int getFileInfo(std::string path, uint64_t* size, int64_t* mtime);
+
 #endif
 
@@ -20,14 +20,40 @@
  */
 int pcxCheck(const char* filename);
 
+/*!
+ * \brief Check the header of a PCX image in memory
+ * \param data contents of a PCX file
+ * \param size number of bytes in data
+ * \param width place where image width will be stored, if not nullptr
+ * \param height place where image height will be stored, if not nullptr
+ * \returns 0 on success
+ */
+int pcxCheck(const unsigned char* data, unsigned long size,
+             unsigned int* width = nullptr, unsigned int* height = nullptr);
+
+/*!
+ * \brief Decode a PCX image in memory
+ *
+ * The RLE data is expanded one scanline at a time and the palette is
+ * applied straight into image, there is no full size temporary buffer.
+ * \param data contents of a PCX file
+ * \param size number of bytes in data
+ * \param image RGBA buffer of (width * height * 4) bytes, sizes from pcxCheck()
+ * \returns 0 on success
+ */
+int pcxDecode(const unsigned char* data, unsigned long size, unsigned char* image);
+
 /*!
  * \brief Load a PCX image file into a buffer
+ *
+ * The file is mapped and its header is only checked once, calling
+ * pcxCheck() first is not needed.
  * \param filename path of file to read
  * \param image place where allocated buffer of size (width * height * (bpp / 8)) will be allocated
  * \param width place where image width will be stored
  * \param height place where image height will be stored
  * \param mode place where Color Mode of image will be stored
- * \param bpp place where pixel width will be stored (8, 24, 32)
+ * \param bpp place where pixel width will be stored (always 32, RGBA)
  * \returns 0 on success
  */
 int pcxLoad(const char* filename, unsigned char** image,
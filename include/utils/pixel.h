@@ -8,17 +8,64 @@
 #ifndef _UTILS_PIXEL_H_
 #define _UTILS_PIXEL_H_
 
+class ThreadPool;
+
+/*!
+ * \brief Instruction sets of the pixel format kernels below.
+ *
+ * The best one the CPU supports is chosen on first use. SCALAR is the
+ * reference all others have to match exactly.
+ */
+enum class PixelSIMD {
+    SCALAR,
+    SSE2,
+    AVX2,
+    NEON
+};
+
+bool pixelHasSIMD(PixelSIMD s);
+PixelSIMD pixelGetSIMD();
+const char* pixelSIMDName(PixelSIMD s);
+
+//! \returns 0 on success, -1 if not supported by this CPU or build
+int pixelSetSIMD(PixelSIMD s);
+
 unsigned char* generateColorTexture(glm::vec4 rgba, unsigned int width,
                                     unsigned int height, unsigned int bpp);
 
 void argb2rgba32(unsigned char* image, unsigned int w, unsigned int h);
+void bgra2rgba32(unsigned char* image, unsigned int w, unsigned int h);
 
 // Returns newly allocated buffer
-unsigned char* argb16to32(unsigned char* image, unsigned int w, unsigned int h);
+unsigned char* argb16to32(const unsigned char* image, unsigned int w, unsigned int h);
+// Fused ARGB1555 to RGBA8888, into a buffer of w * h * 4 bytes
+void argb16torgba32(const unsigned char* image, unsigned char* out,
+                    unsigned int w, unsigned int h);
+
 unsigned char* grayscale2rgba(unsigned char* image, unsigned int w, unsigned int h);
 
+// 8bit indices to RGBA8888, palette has 256 RGBA entries
+void palette2rgba32(const unsigned char* image, const unsigned char* palette,
+                    unsigned char* out, unsigned int w, unsigned int h);
+
+/*!
+ * \brief Resamples an image to any size, with integer weights.
+ *
+ * Scales separately in x and y. Enlarging interpolates between the two
+ * nearest pixels, shrinking averages all covered pixels, so thumbnails
+ * can be made in one step.
+ * \param image source with (width * height * channels) bytes
+ * \param out destination with (outWidth * outHeight * channels) bytes
+ * \param channels 1 to 4
+ * \param pool rows are split across its workers, nullptr for this thread only
+ */
+void resampleImage(const unsigned char* image, unsigned int width, unsigned int height,
+                   unsigned char* out, unsigned int outWidth, unsigned int outHeight,
+                   unsigned int channels, ThreadPool* pool = nullptr);
+
+// Returns newly allocated buffer with power-of-two sizes, or nullptr if already fine
 unsigned char* scaleBuffer(unsigned char* image, unsigned int* w, unsigned int* h,
-                           unsigned int bpp);
+                           unsigned int bpp, ThreadPool* pool = nullptr);
 
 #endif
 
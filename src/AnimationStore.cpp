@@ -0,0 +1,147 @@
+/*!
+ * \file src/AnimationStore.cpp
+ * \brief Keyframes of all moveables in a level
+ *
+ * \author xythobuz
+ */
+
+#include "global.h"
+#include "AnimationStore.h"
+
+const uint32_t AnimationStore::noAnimation;
+
+void AnimationStore::decodeAngles(const uint32_t* packed, unsigned long n,
+                                  float* x, float* y, float* z) {
+    // Kept free of branches and aliasing, so the compiler can vectorize it
+    const float scale = 360.0f / 1024.0f;
+    for (unsigned long i = 0; i < n; i++) {
+        uint32_t p = packed[i];
+        x[i] = static_cast<float>((p >> 20) & 0x3FF) * scale;
+        y[i] = static_cast<float>((p >> 10) & 0x3FF) * scale;
+        z[i] = static_cast<float>(p & 0x3FF) * scale;
+    }
+}
+
+void AnimationStore::clear() {
+    models.clear();
+    animations.clear();
+    stateChanges.clear();
+    dispatches.clear();
+    commands.clear();
+
+    frameAngles.clear();
+    frameBounds.clear();
+    framePositions.clear();
+    angles.clear();
+
+    boneParents.clear();
+    boneOffsets.clear();
+    boneFlags.clear();
+}
+
+unsigned long AnimationStore::getMemorySize() {
+    return (models.size() * sizeof(Model))
+           + (animations.size() * sizeof(Animation))
+           + (stateChanges.size() * sizeof(StateChange))
+           + (dispatches.size() * sizeof(Dispatch))
+           + (commands.size() * sizeof(int16_t))
+           + (frameAngles.size() * sizeof(uint32_t))
+           + (frameBounds.size() * sizeof(int16_t))
+           + (framePositions.size() * sizeof(int16_t))
+           + (angles.size() * sizeof(uint32_t))
+           + (boneParents.size() * sizeof(int16_t))
+           + (boneOffsets.size() * sizeof(int32_t))
+           + (boneFlags.size() * sizeof(uint8_t));
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned long AnimationStore::addModel(const Model& m) {
+    models.push_back(m);
+    return models.size() - 1;
+}
+
+AnimationStore::Model& AnimationStore::getModel(unsigned long i) {
+    orAssertLessThan(i, models.size());
+    return models.at(i);
+}
+
+unsigned long AnimationStore::addAnimation(const Animation& a) {
+    animations.push_back(a);
+    return animations.size() - 1;
+}
+
+AnimationStore::Animation& AnimationStore::getAnimation(unsigned long i) {
+    orAssertLessThan(i, animations.size());
+    return animations.at(i);
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned long AnimationStore::addBone(int16_t parent, int32_t x, int32_t y, int32_t z,
+                                      uint8_t flags) {
+    boneParents.push_back(parent);
+    boneOffsets.push_back(x);
+    boneOffsets.push_back(y);
+    boneOffsets.push_back(z);
+    boneFlags.push_back(flags);
+    return boneParents.size() - 1;
+}
+
+int AnimationStore::getBoneParent(unsigned long bone) {
+    orAssertLessThan(bone, boneParents.size());
+    return boneParents.at(bone);
+}
+
+glm::vec3 AnimationStore::getBoneOffset(unsigned long bone) {
+    orAssertLessThan(bone, boneParents.size());
+    return glm::vec3(boneOffsets.at(bone * 3), boneOffsets.at((bone * 3) + 1),
+                     boneOffsets.at((bone * 3) + 2));
+}
+
+uint8_t AnimationStore::getBoneFlags(unsigned long bone) {
+    orAssertLessThan(bone, boneFlags.size());
+    return boneFlags.at(bone);
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned long AnimationStore::addFrame(const int16_t bounds[6], const int16_t position[3],
+                                       const uint32_t* packed, unsigned long numAngles) {
+    frameAngles.push_back(angles.size());
+    frameBounds.insert(frameBounds.end(), bounds, bounds + 6);
+    framePositions.insert(framePositions.end(), position, position + 3);
+    angles.insert(angles.end(), packed, packed + numAngles);
+    return frameAngles.size() - 1;
+}
+
+glm::vec3 AnimationStore::getFramePosition(unsigned long frame) {
+    orAssertLessThan(frame, frameAngles.size());
+    return glm::vec3(framePositions.at(frame * 3), framePositions.at((frame * 3) + 1),
+                     framePositions.at((frame * 3) + 2));
+}
+
+void AnimationStore::getFrameBounds(unsigned long frame, glm::vec3& min, glm::vec3& max) {
+    orAssertLessThan(frame, frameAngles.size());
+    const int16_t* b = &frameBounds.at(frame * 6);
+    min = glm::vec3(b[0], b[1], b[2]);
+    max = glm::vec3(b[3], b[4], b[5]);
+}
+
+unsigned long AnimationStore::getFrameAngleCount(unsigned long first, unsigned long count) {
+    orAssertLessThanEqual(first + count, frameAngles.size());
+    if (count == 0)
+        return 0;
+
+    unsigned long end = ((first + count) < frameAngles.size())
+                        ? frameAngles.at(first + count) : angles.size();
+    return end - frameAngles.at(first);
+}
+
+void AnimationStore::decodeFrames(unsigned long first, unsigned long count,
+                                  float* x, float* y, float* z) {
+    unsigned long n = getFrameAngleCount(first, count);
+    if (n > 0)
+        decodeAngles(&angles.at(frameAngles.at(first)), n, x, y, z);
+}
+
@@ -12,9 +12,9 @@
 
 #include "global.h"
 #include "RunTime.h"
+#include "SoundManager.h"
 #include "World.h"
 #include "system/Shader.h"
-#include "system/Sound.h"
 #include "system/Window.h"
 #include "Camera.h"
 
@@ -210,7 +210,7 @@ bool Camera::update() {
 
     glm::vec3 at(0.0f, 0.0f, -1.0f);
     glm::vec3 up(0.0f, 1.0f, 0.0f);
-    Sound::listenAt(pos, quaternion * at, quaternion * up);
+    SoundManager::listenAt(pos, quaternion * at, quaternion * up);
 
     dirty = false;
     return updateViewFrustum;
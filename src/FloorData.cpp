@@ -0,0 +1,199 @@
+/*!
+ * \file src/FloorData.cpp
+ * \brief Decoded FloorData of all sectors in a level
+ *
+ * \author xythobuz
+ */
+
+#include "global.h"
+#include "FloorData.h"
+
+const uint16_t FloorData::noPortal;
+const uint16_t FloorData::noTrigger;
+
+// Functions in the lower 5bits of a setup word
+enum FloorDataFunction {
+    FunctionPortal = 0x01,
+    FunctionFloorSlope = 0x02,
+    FunctionCeilingSlope = 0x03,
+    FunctionTrigger = 0x04,
+    FunctionKill = 0x05,
+    FunctionClimb = 0x06,
+    FunctionFirstSplit = 0x07, // TR3 triangulation, floors are 0x07, 0x08 and 0x0B to 0x0E
+    FunctionLastSplit = 0x12,
+    FunctionMonkeySwing = 0x13,
+    FunctionMinecartLeft = 0x14,
+    FunctionMinecartRight = 0x15
+};
+
+static bool isFloorSplit(uint16_t function) {
+    return (function == 0x07) || (function == 0x08)
+           || ((function >= 0x0B) && (function <= 0x0E));
+}
+
+void FloorData::clear() {
+    infos.clear();
+    triggers.clear();
+    actions.clear();
+    unknownFunctions = 0;
+
+    // Record 0, for sectors without FloorData
+    decode(nullptr, 0, 0);
+}
+
+unsigned long FloorData::getMemorySize() {
+    return (infos.size() * sizeof(Info)) + (triggers.size() * sizeof(Trigger))
+           + (actions.size() * sizeof(Action));
+}
+
+unsigned long FloorData::decode(const uint16_t* data, unsigned long size,
+                                unsigned long offset) {
+    Info info;
+    info.floorSlopeX = info.floorSlopeZ = 0;
+    info.ceilingSlopeX = info.ceilingSlopeZ = 0;
+    info.portal = noPortal;
+    info.flags = info.floorSplit = info.ceilingSplit = info.unused = 0;
+    info.floorCorners = info.ceilingCorners = 0;
+    info.trigger = noTrigger;
+
+    // The first word is a dummy, offset 0 means no FloorData
+    bool end = (offset == 0);
+    while ((!end) && (offset < size)) {
+        uint16_t setup = data[offset++];
+        uint16_t function = setup & 0x1F;
+        uint16_t sub = (setup >> 8) & 0x7F;
+        end = (setup & 0x8000) != 0;
+
+        if (function == FunctionPortal) {
+            if (offset >= size)
+                break;
+            info.portal = data[offset++];
+        } else if ((function == FunctionFloorSlope) || (function == FunctionCeilingSlope)) {
+            if (offset >= size)
+                break;
+            uint16_t slope = data[offset++];
+            int8_t x = static_cast<int8_t>(slope & 0xFF);
+            int8_t z = static_cast<int8_t>(slope >> 8);
+            if (function == FunctionFloorSlope) {
+                info.floorSlopeX = x;
+                info.floorSlopeZ = z;
+            } else {
+                info.ceilingSlopeX = x;
+                info.ceilingSlopeZ = z;
+            }
+        } else if (function == FunctionTrigger) {
+            if (offset >= size)
+                break;
+            uint16_t triggerSetup = data[offset++];
+
+            Trigger trigger;
+            trigger.type = sub;
+            trigger.timer = triggerSetup & 0xFF;
+            trigger.oneShot = (triggerSetup & 0x0100) ? 1 : 0;
+            trigger.mask = (triggerSetup >> 9) & 0x1F;
+            trigger.firstAction = actions.size();
+            trigger.numActions = 0;
+
+            // Actions follow until one has its top bit set
+            bool last = false;
+            while ((!last) && (offset < size)) {
+                uint16_t a = data[offset++];
+                last = (a & 0x8000) != 0;
+
+                Action action;
+                action.parameter = a & 0x03FF;
+                action.type = (a >> 10) & 0x1F;
+                action.timer = action.once = action.unused = 0;
+
+                if ((action.type == FloorDataActionCamera) && (offset < size)) {
+                    uint16_t camera = data[offset++];
+                    action.timer = camera & 0xFF;
+                    action.once = (camera & 0x0100) ? 1 : 0;
+                    last = (camera & 0x8000) != 0;
+                }
+
+                actions.push_back(action);
+                trigger.numActions++;
+            }
+
+            orAssertLessThan(triggers.size(), noTrigger);
+            info.trigger = triggers.size();
+            triggers.push_back(trigger);
+        } else if (function == FunctionKill) {
+            info.flags |= FloorDataFlagKill;
+        } else if (function == FunctionClimb) {
+            // One bit per climbable wall, in the subfunction
+            info.flags |= (sub & 0x0F) << 1;
+        } else if ((function >= FunctionFirstSplit) && (function <= FunctionLastSplit)) {
+            if (offset >= size)
+                break;
+            uint16_t corners = data[offset++];
+            if (isFloorSplit(function)) {
+                info.floorSplit = function;
+                info.floorCorners = corners;
+            } else {
+                info.ceilingSplit = function;
+                info.ceilingCorners = corners;
+            }
+        } else if (function == FunctionMonkeySwing) {
+            info.flags |= FloorDataFlagMonkeySwing;
+        } else if (function == FunctionMinecartLeft) {
+            info.flags |= FloorDataFlagMinecartLeft;
+        } else if (function == FunctionMinecartRight) {
+            info.flags |= FloorDataFlagMinecartRight;
+        } else {
+            // Length unknown, the rest of the chain can not be parsed
+            unknownFunctions++;
+            break;
+        }
+    }
+
+    infos.push_back(info);
+    return infos.size() - 1;
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Slopes raise or lower the sector height by up to a quarter of the slope
+ * value per unit, towards the edge given by the sign. This is how the
+ * original engine interpolates tilted sectors.
+ */
+int FloorData::floorHeight(const Info& info, int floor, int x, int z) {
+    int sx = info.floorSlopeX;
+    int sz = info.floorSlopeZ;
+    x &= 0x3FF;
+    z &= 0x3FF;
+
+    if (sz < 0)
+        floor -= (sz * z) >> 2;
+    else
+        floor += (sz * (0x3FF - z)) >> 2;
+
+    if (sx < 0)
+        floor -= (sx * x) >> 2;
+    else
+        floor += (sx * (0x3FF - x)) >> 2;
+
+    return floor;
+}
+
+int FloorData::ceilingHeight(const Info& info, int ceiling, int x, int z) {
+    int sx = info.ceilingSlopeX;
+    int sz = info.ceilingSlopeZ;
+    x &= 0x3FF;
+    z &= 0x3FF;
+
+    if (sz < 0)
+        ceiling += (sz * z) >> 2;
+    else
+        ceiling -= (sz * (0x3FF - z)) >> 2;
+
+    if (sx < 0)
+        ceiling += (sx * (0x3FF - x)) >> 2;
+    else
+        ceiling -= (sx * x) >> 2;
+
+    return ceiling;
+}
+
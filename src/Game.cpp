@@ -5,24 +5,56 @@
  * \author xythobuz
  */
 
+#include <chrono>
+
 #include "global.h"
 #include "Camera.h"
 #include "Console.h"
 #include "Game.h"
+#include "LevelBuffer.h"
+#include "LevelCache.h"
 #include "loader/Loader.h"
 #include "Log.h"
 #include "Menu.h"
 #include "Render.h"
+#include "RunTime.h"
 #include "SoundManager.h"
 #include "TextureManager.h"
 #include "UI.h"
 #include "World.h"
+#include "utils/ThreadPool.h"
+
+// Time per frame spent on queued uploads while loading, in ms
+const static unsigned long uploadBudget = 8;
+
+// Returned by the load worker when cancelled
+const static int loadCancelledError = -3;
 
 bool Game::mLoaded = false;
 long Game::mLara = -1;
 bool Game::activeEvents[ActionEventCount];
 
+bool Game::mLoading = false;
+std::string Game::nextLevel;
+std::future<int> Game::loadResult;
+std::atomic<bool> Game::loadCancelled(false);
+std::atomic<float> Game::loadProgress(0.0f);
+std::string Game::loadStatus;
+std::mutex Game::loadStatusMutex;
+WorkQueue Game::mainQueue;
+
 void Game::destroy() {
+    // The worker and its queued uploads still use the World, so they have to finish first
+    if (mLoading) {
+        cancelLoading();
+        nextLevel.clear();
+        while (mLoading) {
+            if (loadResult.valid())
+                loadResult.wait_for(std::chrono::milliseconds(1));
+            update();
+        }
+    }
+
     mLoaded = false;
     mLara = -1;
 
@@ -35,51 +67,209 @@ void Game::destroy() {
     Render::clearRoomList();
     SoundManager::clear();
     TextureManager::clear();
+    LevelBuffer::clear();
     World::destroy();
 }
 
 int Game::loadLevel(std::string level) {
+    if (mLoading) {
+        cancelLoading();
+        nextLevel = level;
+        return 0;
+    }
+
     destroy();
 
+    if (Loader::checkFile(level) == Loader::TR_UNKNOWN) {
+        Log::get(LOG_ERROR) << "No suitable loader for this level!" << Log::endl;
+        return -1;
+    }
+
     Log::get(LOG_INFO) << "Loading " << level << Log::endl;
+    Menu::setVisible(false);
+
+    loadCancelled = false;
+    setLoadStatus("Starting", 0.0f);
+    mLoading = true;
+    loadResult = std::async(std::launch::async, loadWorker, level);
+    return 0;
+}
+
+int Game::loadWorker(std::string level) {
+    // A valid cache file replaces both the Loader and all prepare() steps
+    setLoadStatus("Reading level cache", 0.0f);
+    if (LevelCache::load(level) == 0)
+        return 0;
+
+    if (loadCancelled)
+        return loadCancelledError;
+
     auto loader = Loader::createLoader(level);
-    if (loader) {
-        int error = loader->load(level);
+    if (!loader) {
+        Log::get(LOG_ERROR) << "No suitable loader for this level!" << Log::endl;
+        return -1;
+    }
+
+    setLoadStatus("Loading level", 0.05f);
+    loader->setHashMeshes(RunTime::getHashMeshes());
+    loader->setProgressCallback([](float p) {
+        loadProgress = 0.05f + (p * 0.65f);
+    });
+    loader->setCancelFlag(&loadCancelled);
+    int error = 0;
+    try {
+        error = loader->load(level);
+    } catch (Loader::Cancelled&) {
+        return loadCancelledError;
+    }
+    if (error != 0) {
+        Log::get(LOG_ERROR) << "Error loading level (" << error << ")..." << Log::endl;
+        return -2;
+    }
+
+    if (loadCancelled)
+        return loadCancelledError;
+
+    // Texture tiles are only read from here on, so this can run in parallel
+    setLoadStatus("Preparing geometry", 0.7f);
+    ThreadPool pool;
+    pool.parallelFor(World::sizeMeshResource(), [](std::size_t i) {
+        World::getMeshResource(i).prepare();
+    });
+    pool.parallelFor(World::sizeRoom(), [](std::size_t i) {
+        World::getRoom(i).prepare();
+    });
+
+    if (loadCancelled)
+        return loadCancelledError;
+
+    setLoadStatus("Preparing textures", 0.85f);
+    runOnMainThread([]() {
+        TextureManager::prepare();
+    }).wait();
+
+    if (LevelCache::getEnabled() && (!loadCancelled)) {
+        setLoadStatus("Writing level cache", 0.9f);
+        error = LevelCache::write(level, mLara);
         if (error != 0) {
-            Log::get(LOG_ERROR) << "Error loading level (" << error << ")..." << Log::endl;
-            destroy();
-            return -2;
+            Log::get(LOG_WARNING) << "Could not write level cache (" << error << ")" << Log::endl;
         }
+    }
 
-        for (int i = 0; i < World::sizeMesh(); i++) {
-            World::getMesh(i).prepare();
-        }
+    return loadCancelled ? loadCancelledError : 0;
+}
 
-        for (int i = 0; i < World::sizeRoom(); i++) {
-            World::getRoom(i).prepare();
-        }
+void Game::update() {
+    mainQueue.run(uploadBudget);
 
+    if (!mLoading)
+        return;
+
+    // The worker result is taken once, then the uploads it queued are drained
+    if (loadResult.valid()) {
+        if (loadResult.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            finishLoading();
+    } else if (mainQueue.empty()) {
+        showLevel();
+    }
+
+    if ((!mLoading) && (!nextLevel.empty())) {
+        std::string level = nextLevel;
+        nextLevel.clear();
+        loadLevel(level);
+    }
+}
+
+void Game::cancelLoading() {
+    if ((!mLoading) || loadCancelled)
+        return;
+
+    // The worker stops at its next check, its jobs for this thread still run in update()
+    loadCancelled = true;
+    setLoadStatus("Cancelling", loadProgress);
+}
+
+void Game::finishLoading() {
+    mainQueue.run();
+    int error = loadResult.get();
+
+    if (error != 0) {
+        mLoading = false;
+        if (error == loadCancelledError)
+            Log::get(LOG_INFO) << "Loading cancelled" << Log::endl;
+        destroy();
+        Menu::setVisible(true);
+        return;
+    }
+
+    // The load worker can't use GL, so update() runs these within its per frame budget
+    setLoadStatus("Uploading", 0.95f);
+    auto upload = [](std::function<void()> job) {
+        mainQueue.push([job]() {
+            if (!loadCancelled)
+                job();
+        }, true);
+    };
+
+    upload([]() {
         SoundManager::prepareSources();
-        TextureManager::prepare();
+    });
+    upload([]() {
+        TextureManager::buildTextureArray();
+    });
+    upload([]() {
+        LevelBuffer::build();
+    });
 
-        mLoaded = true;
-        Render::setMode(RenderMode::Texture);
-        Menu::setVisible(false);
-
-        if (mLara == -1) {
-            Log::get(LOG_WARNING) << "Can't find Lara entity in level?!" << Log::endl;
-        } else {
-            Camera::setPosition(glm::vec3(getLara().getPosition().x,
-                                          getLara().getPosition().y - 1024.0f,
-                                          getLara().getPosition().z));
-            Camera::setRoom(getLara().getRoom());
-        }
+    // Geometry goes to the GPU once, one mesh per job
+    for (unsigned long i = 0; i < World::sizeMeshResource(); i++) {
+        upload([i]() {
+            World::getMeshResource(i).upload();
+        });
+    }
+    for (unsigned long i = 0; i < World::sizeRoom(); i++) {
+        upload([i]() {
+            World::getRoom(i).getMesh().upload();
+        });
+    }
+}
+
+void Game::showLevel() {
+    mLoading = false;
+
+    if (loadCancelled) {
+        Log::get(LOG_INFO) << "Loading cancelled" << Log::endl;
+        destroy();
+        Menu::setVisible(true);
+        return;
+    }
+
+    mLoaded = true;
+    Render::setMode(RenderMode::Texture);
+
+    if (mLara == -1) {
+        Log::get(LOG_WARNING) << "Can't find Lara entity in level?!" << Log::endl;
     } else {
-        Log::get(LOG_ERROR) << "No suitable loader for this level!" << Log::endl;
-        return -1;
+        Camera::setPosition(glm::vec3(getLara().getPosition().x,
+                                      getLara().getPosition().y - 1024.0f,
+                                      getLara().getPosition().z));
+        Camera::setRoom(getLara().getRoom());
     }
+}
 
-    return 0;
+std::string Game::getLoadStatus() {
+    std::lock_guard<std::mutex> lock(loadStatusMutex);
+    return loadStatus;
+}
+
+void Game::setLoadStatus(std::string status, float progress) {
+    std::lock_guard<std::mutex> lock(loadStatusMutex);
+    loadStatus = status;
+    loadProgress = progress;
+}
+
+std::future<void> Game::runOnMainThread(std::function<void()> job) {
+    return mainQueue.push(job);
 }
 
 void Game::handleAction(ActionEvents action, bool isFinished) {
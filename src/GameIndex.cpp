@@ -0,0 +1,250 @@
+/*!
+ * \file src/GameIndex.cpp
+ * \brief Index of the game installations shown in the Menu
+ *
+ * \author xythobuz
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+#include "stb/stb_image.h"
+
+#include "global.h"
+#include "Log.h"
+#include "Script.h"
+#include "TextureManager.h"
+#include "utils/binary.h"
+#include "utils/filesystem.h"
+#include "utils/Folder.h"
+#include "utils/FolderIndex.h"
+#include "utils/pcx.h"
+#include "utils/pixel.h"
+#include "utils/random.h"
+#include "utils/strings.h"
+#include "utils/ThreadPool.h"
+#include "GameIndex.h"
+
+// Bump whenever the layout of the index file changes
+const static uint32_t indexVersion = 1;
+const static uint32_t indexMagic = 0x4947524F; // "ORGI"
+const static uint32_t indexEnd = 0x444E4549; // "IEND"
+
+const unsigned int GameIndex::thumbnailSize;
+
+static void writeStrings(BinaryWriter& w, const std::vector<std::string>& v) {
+    w.writeU32(v.size());
+    for (auto& s : v)
+        w.writeString(s);
+}
+
+static void readStrings(BinaryReader& r, std::vector<std::string>& v) {
+    v.resize(r.readU32());
+    for (auto& s : v)
+        s = r.readString();
+}
+
+/*
+ * Averages all source pixels covered by each thumbnail pixel. Pictures
+ * are only ever shown as small squares in the menu, so the aspect ratio
+ * is not kept.
+ */
+static void scaleThumbnail(const unsigned char* image, unsigned int w, unsigned int h,
+                           unsigned int channels, std::vector<unsigned char>& out) {
+    const unsigned int size = GameIndex::thumbnailSize;
+    out.resize(size * size * 4);
+    resampleImage(image, w, h, &out[0], size, size, channels);
+    if (channels == 3) {
+        // Expanded in place, from the back
+        for (unsigned int i = size * size; i-- > 0;) {
+            out[(i * 4) + 3] = 255;
+            out[(i * 4) + 2] = out[(i * 3) + 2];
+            out[(i * 4) + 1] = out[(i * 3) + 1];
+            out[i * 4] = out[i * 3];
+        }
+    }
+}
+
+int GameIndex::read(std::string file) {
+    BinaryMapped r;
+    if (r.open(file) != 0)
+        return -1;
+
+    if (r.size() < (4 + 4 + 4 + 4))
+        return -2;
+
+    uint32_t magic = r.readU32();
+    uint32_t version = r.readU32();
+    r.seek(r.size() - 4);
+    uint32_t end = r.readU32();
+    if ((magic != indexMagic) || (version != indexVersion) || (end != indexEnd)) {
+        Log::get(LOG_DEBUG) << "Ignoring outdated game index " << file << Log::endl;
+        return -3;
+    }
+
+    r.seek(8);
+    std::vector<Entry> found(r.readU32());
+    for (auto& e : found) {
+        e.script = r.readString();
+        e.folder = r.readString();
+        e.size = r.readU64();
+        e.mtime = r.read64();
+        e.valid = (r.readU8() != 0);
+        e.language = r.readString();
+        e.description = r.readString();
+        readStrings(r, e.levelNames);
+        readStrings(r, e.levelFiles);
+        readStrings(r, e.cutscenes);
+        readStrings(r, e.videos);
+        readStrings(r, e.pictures);
+        readStrings(r, e.titles);
+
+        e.thumbnail.resize(r.readU32());
+        if (!e.thumbnail.empty())
+            r.readArray(&e.thumbnail[0], e.thumbnail.size());
+    }
+
+    if (r.tell() != (r.size() - 4))
+        return -4;
+
+    entries.swap(found);
+    return 0;
+}
+
+int GameIndex::write(std::string file) {
+    // Written to a temporary file first, so read() never sees partial files
+    std::string tempFile = file + ".tmp";
+    {
+        BinaryWriter w(tempFile);
+        if (!w.good())
+            return -1;
+
+        w.writeU32(indexMagic);
+        w.writeU32(indexVersion);
+        w.writeU32(entries.size());
+        for (auto& e : entries) {
+            w.writeString(e.script);
+            w.writeString(e.folder);
+            w.writeU64(e.size);
+            w.write64(e.mtime);
+            w.writeU8(e.valid ? 1 : 0);
+            w.writeString(e.language);
+            w.writeString(e.description);
+            writeStrings(w, e.levelNames);
+            writeStrings(w, e.levelFiles);
+            writeStrings(w, e.cutscenes);
+            writeStrings(w, e.videos);
+            writeStrings(w, e.pictures);
+            writeStrings(w, e.titles);
+            w.writeVector(e.thumbnail);
+        }
+        w.writeU32(indexEnd);
+
+        if (!w.good()) {
+            w.close();
+            std::remove(tempFile.c_str());
+            return -2;
+        }
+    }
+
+    std::remove(file.c_str());
+    if (std::rename(tempFile.c_str(), file.c_str()) != 0) {
+        std::remove(tempFile.c_str());
+        return -3;
+    }
+
+    return 0;
+}
+
+unsigned long GameIndex::scan(std::string pakDir, ThreadPool& pool) {
+    std::map<std::string, Entry*> known;
+    for (auto& e : entries)
+        known[e.script] = &e;
+
+    // Walked once, the pictures of each game are looked up in the same index
+    FolderIndex folder(pakDir);
+    folder.scan(&pool);
+    std::vector<File> files;
+    folder.find(files, { "tombpc.dat" });
+
+    std::vector<Entry> found(files.size());
+    std::vector<std::pair<unsigned long, unsigned int>> stale;
+    for (unsigned long i = 0; i < files.size(); i++) {
+        Entry& e = found.at(i);
+        e.script = files.at(i).getPath();
+        getFileInfo(e.script, &e.size, &e.mtime);
+
+        auto k = known.find(e.script);
+        if ((k != known.end()) && (k->second->size == e.size) && (k->second->mtime == e.mtime)) {
+            e = std::move(*k->second);
+        } else {
+            // randomInteger() is not thread-safe, so the picture is chosen here
+            stale.emplace_back(i, randomInteger(0x7FFF));
+        }
+    }
+
+    pool.parallelFor(stale.size(), [&found, &stale, &folder](std::size_t i) {
+        parse(found.at(stale.at(i).first), stale.at(i).second, folder);
+    });
+
+    unsigned long changed = stale.size() + (entries.size() - (found.size() - stale.size()));
+    entries.swap(found);
+    return changed;
+}
+
+void GameIndex::parse(Entry& e, unsigned int random, FolderIndex& folder) {
+    e.folder = convertPathDelimiter(removeLastPathElement(e.script));
+
+    Script s;
+    e.valid = (s.load(e.script) == 0);
+    if (!e.valid) {
+        Log::get(LOG_ERROR) << "Invalid Script: \"" << e.script << "\"!" << Log::endl;
+        return;
+    }
+
+    e.language = s.getLanguage();
+    e.description = s.getDescription();
+    for (unsigned int i = 0; i < s.levelCount(); i++) {
+        e.levelNames.push_back(s.getLevelName(i));
+        e.levelFiles.push_back(s.getLevelFilename(i));
+    }
+    for (unsigned int i = 0; i < s.cutsceneCount(); i++)
+        e.cutscenes.push_back(s.getCutsceneFilename(i));
+    for (unsigned int i = 0; i < s.videoCount(); i++)
+        e.videos.push_back(s.getVideoFilename(i));
+    for (unsigned int i = 0; i < s.pictureCount(); i++)
+        e.pictures.push_back(s.getPictureFilename(i));
+    for (unsigned int i = 0; i < s.titleCount(); i++)
+        e.titles.push_back(s.getTitleFilename(i));
+
+    // Use one of the pictures of this game
+    std::vector<File> texFiles;
+    folder.find(texFiles, { ".pcx", ".bmp", ".png", ".tga", ".jpg" }, e.folder);
+    if (texFiles.size() > 0)
+        loadThumbnail(e, texFiles.at(random % texFiles.size()).getPath());
+}
+
+void GameIndex::loadThumbnail(Entry& e, std::string file) {
+    if (stringEndsWith(file, ".pcx")) {
+        unsigned char* image;
+        unsigned int w, h, bpp;
+        ColorMode c;
+        if (pcxLoad(file.c_str(), &image, &w, &h, &c, &bpp) == 0) {
+            scaleThumbnail(image, w, h, bpp / 8, e.thumbnail);
+            delete [] image;
+        }
+    } else {
+        int x, y, n;
+        unsigned char* data = stbi_load(file.c_str(), &x, &y, &n, 0);
+        if (data) {
+            if ((n == 3) || (n == 4))
+                scaleThumbnail(data, x, y, n, e.thumbnail);
+            stbi_image_free(data);
+        }
+    }
+
+    if (e.thumbnail.empty())
+        Log::get(LOG_ERROR) << "Can't load image \"" << file << "\"!" << Log::endl;
+}
+
@@ -0,0 +1,113 @@
+/*!
+ * \file src/LevelBuffer.cpp
+ * \brief Geometry of the whole level in one buffer
+ *
+ * \author xythobuz
+ */
+
+#include "global.h"
+#include "Log.h"
+#include "RunTime.h"
+#include "TextureManager.h"
+#include "World.h"
+#include "LevelBuffer.h"
+
+std::unique_ptr<ShaderMesh> LevelBuffer::buffers;
+std::vector<LevelBuffer::SubMesh> LevelBuffer::subMeshes;
+std::vector<DrawElementsIndirectCommand> LevelBuffer::commands;
+std::vector<glm::mat4> LevelBuffer::matrices;
+bool LevelBuffer::enabled = true;
+unsigned long LevelBuffer::lastCommands = 0;
+int LevelBuffer::lastDrawCalls = 0;
+
+void LevelBuffer::build() {
+    clear();
+    if (RunTime::isHeadless())
+        return;
+
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec2> uvs;
+    std::vector<float> layers;
+    std::vector<unsigned short> indices;
+
+    // Indices stay relative to their sub-mesh, so 16 bits are still enough
+    auto append = [&](const std::vector<glm::vec3>& v, const std::vector<glm::vec2>& uv,
+                      const std::vector<unsigned int>& tex,
+                      const std::vector<unsigned short>& ind, glm::vec3 offset) -> long {
+        if ((ind.size() == 0) || (v.size() == 0))
+            return -1;
+
+        orAssertEqual(v.size(), uv.size());
+        orAssertEqual(v.size(), tex.size());
+        subMeshes.emplace_back(indices.size(), ind.size(), vertices.size());
+        for (auto& vert : v)
+            vertices.push_back(vert + offset);
+        uvs.insert(uvs.end(), uv.begin(), uv.end());
+        for (auto t : tex)
+            layers.push_back(float(t));
+        indices.insert(indices.end(), ind.begin(), ind.end());
+        return subMeshes.size() - 1;
+    };
+
+    for (unsigned long i = 0; i < World::sizeRoom(); i++) {
+        Room& room = World::getRoom(i);
+        RoomMesh& mesh = room.getMesh();
+        mesh.levelIndex = append(mesh.verticesBuff, mesh.uvsBuff, mesh.texturesBuff,
+                                 mesh.indicesBuff, room.getPosition());
+    }
+
+    for (unsigned long i = 0; i < World::sizeMeshResource(); i++) {
+        Mesh& mesh = World::getMeshResource(i);
+        mesh.levelIndex = append(mesh.verticesBuff, mesh.uvsBuff, mesh.texturesBuff,
+                                 mesh.indicesBuff, glm::vec3(0.0f, 0.0f, 0.0f));
+    }
+
+    if (indices.size() == 0)
+        return;
+
+    buffers.reset(new ShaderMesh());
+    buffers->upload(vertices, uvs, indices);
+    buffers->uploadLayers(layers);
+
+    Log::get(LOG_DEBUG) << "Level buffer: " << subMeshes.size() << " meshes, "
+                        << vertices.size() << " vertices, "
+                        << (buffers->getMemorySize() / 1024) << "KB" << Log::endl;
+}
+
+void LevelBuffer::clear() {
+    buffers.reset();
+    subMeshes.clear();
+    commands.clear();
+    matrices.clear();
+    lastCommands = 0;
+    lastDrawCalls = 0;
+}
+
+bool LevelBuffer::canDraw() {
+    return enabled && buffers && TextureManager::useTextureArray();
+}
+
+bool LevelBuffer::add(long subMesh, glm::mat4 MVP) {
+    if ((subMesh < 0) || !canDraw())
+        return false;
+
+    auto& s = subMeshes.at(subMesh);
+    commands.emplace_back(s.count, s.first, s.baseVertex);
+    matrices.push_back(MVP);
+    return true;
+}
+
+void LevelBuffer::draw() {
+    lastCommands = commands.size();
+    lastDrawCalls = 0;
+    if (buffers)
+        lastDrawCalls = Shader::drawGLMulti(*buffers, commands, matrices);
+
+    commands.clear();
+    matrices.clear();
+}
+
+unsigned long LevelBuffer::getMemorySize() {
+    return (buffers ? buffers->getMemorySize() : 0) + (subMeshes.size() * sizeof(SubMesh));
+}
+
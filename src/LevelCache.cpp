@@ -0,0 +1,890 @@
+/*!
+ * \file src/LevelCache.cpp
+ * \brief On-disk cache of prepared levels
+ *
+ * \author xythobuz
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#include "global.h"
+#include "Game.h"
+#include "Log.h"
+#include "RunTime.h"
+#include "SoundManager.h"
+#include "TextureManager.h"
+#include "World.h"
+#include "utils/binary.h"
+#include "utils/filesystem.h"
+#include "LevelCache.h"
+
+// Bump whenever the layout of the cache file or of any prepared buffer changes
+const static uint32_t cacheVersion = 7;
+const static uint32_t cacheMagic = 0x0043524F; // "ORC\0"
+const static uint32_t cacheEnd = 0x444E4543; // "CEND"
+
+bool LevelCache::enabled = true;
+
+static_assert(sizeof(glm::vec2) == (2 * sizeof(float)), "glm::vec2 needs to be packed");
+static_assert(sizeof(glm::vec3) == (3 * sizeof(float)), "glm::vec3 needs to be packed");
+static_assert(sizeof(glm::vec4) == (4 * sizeof(float)), "glm::vec4 needs to be packed");
+
+//! BinaryWriter for the glm types used by the prepared buffers
+class CacheWriter : public BinaryWriter {
+  public:
+    explicit CacheWriter(std::string f) : BinaryWriter(f) { }
+
+    void writeVec3(glm::vec3 v) { writeArray(&v.x, 3); }
+
+    using BinaryWriter::writeVector;
+
+    void writeVector(const std::vector<glm::vec2>& v) {
+        writeU32(v.size());
+        if (!v.empty())
+            writeArray(&v[0].x, v.size() * 2);
+    }
+
+    void writeVector(const std::vector<glm::vec3>& v) {
+        writeU32(v.size());
+        if (!v.empty())
+            writeArray(&v[0].x, v.size() * 3);
+    }
+};
+
+template<typename T>
+static void readVector(BinaryReader& r, std::vector<T>& v) {
+    v.resize(r.readU32());
+    if (!v.empty())
+        r.readArray(&v[0], v.size());
+}
+
+static void readVector(BinaryReader& r, std::vector<glm::vec2>& v) {
+    v.resize(r.readU32());
+    if (!v.empty())
+        r.readArray(&v[0].x, v.size() * 2);
+}
+
+static void readVector(BinaryReader& r, std::vector<glm::vec3>& v) {
+    v.resize(r.readU32());
+    if (!v.empty())
+        r.readArray(&v[0].x, v.size() * 3);
+}
+
+static glm::vec3 readVec3(BinaryReader& r) {
+    glm::vec3 v;
+    r.readArray(&v.x, 3);
+    return v;
+}
+
+// ----------------------------------------------------------------------------
+
+int LevelCache::getCacheFile(std::string level, std::string& file, uint64_t& hash,
+                             uint64_t& size) {
+    BinaryMapped f;
+    if (f.open(level) != 0)
+        return -1;
+
+    hash = hashData(f.pointer(0), f.size());
+    size = f.size();
+
+    std::ostringstream name;
+    name << RunTime::getBaseDir() << "/cache/" << std::hex << std::setw(16)
+         << std::setfill('0') << hash << ".orc";
+    file = name.str();
+    return 0;
+}
+
+int LevelCache::load(std::string level) {
+    if (!enabled)
+        return -1;
+
+    std::string cacheFile;
+    uint64_t hash, size;
+    if (getCacheFile(level, cacheFile, hash, size) != 0)
+        return -2;
+
+    BinaryMapped r;
+    if (r.open(cacheFile) != 0)
+        return -3;
+
+    // Header and end marker, so a damaged file never gets parsed
+    const long long headerSize = 4 + 4 + 8 + 8;
+    if (r.size() < (headerSize + 4))
+        return -4;
+
+    uint32_t magic = r.readU32();
+    uint32_t version = r.readU32();
+    uint64_t fileHash = r.readU64();
+    uint64_t fileSize = r.readU64();
+    r.seek(r.size() - 4);
+    uint32_t end = r.readU32();
+    if ((magic != cacheMagic) || (version != cacheVersion) || (fileHash != hash)
+        || (fileSize != size) || (end != cacheEnd)) {
+        Log::get(LOG_DEBUG) << "Ignoring outdated level cache " << cacheFile << Log::endl;
+        return -5;
+    }
+
+    r.seek(headerSize);
+    readTextures(r);
+    readMeshes(r);
+    readRooms(r);
+    readWorld(r);
+    readSound(r, cacheFile);
+
+    int32_t lara = r.read32();
+    orAssertEqual(r.tell(), r.size() - 4);
+    if (lara >= 0)
+        Game::setLara(lara);
+
+    Log::get(LOG_INFO) << "Loaded level from cache " << cacheFile << Log::endl;
+    return 0;
+}
+
+int LevelCache::write(std::string level, long lara) {
+    if (!enabled)
+        return -1;
+
+    std::string cacheFile;
+    uint64_t hash, size;
+    if (getCacheFile(level, cacheFile, hash, size) != 0)
+        return -2;
+
+    if (createDirectory(RunTime::getBaseDir() + "/cache") != 0) {
+        Log::get(LOG_WARNING) << "Could not create level cache directory" << Log::endl;
+        return -3;
+    }
+
+    // Written to a temporary file first, so load() never sees partial files
+    std::string tempFile = cacheFile + ".tmp";
+    {
+        CacheWriter w(tempFile);
+        if (!w.good())
+            return -4;
+
+        w.writeU32(cacheMagic);
+        w.writeU32(cacheVersion);
+        w.writeU64(hash);
+        w.writeU64(size);
+
+        int error = writeTextures(w);
+        if (error == 0) {
+            writeMeshes(w);
+            writeRooms(w);
+            writeWorld(w);
+            writeSound(w);
+
+            // Right in front of the end marker, see load()
+            w.write32(lara);
+            w.writeU32(cacheEnd);
+        }
+
+        if ((error != 0) || (!w.good())) {
+            w.close();
+            std::remove(tempFile.c_str());
+            return -5;
+        }
+    }
+
+    std::remove(cacheFile.c_str());
+    if (std::rename(tempFile.c_str(), cacheFile.c_str()) != 0) {
+        std::remove(tempFile.c_str());
+        return -6;
+    }
+
+    Log::get(LOG_DEBUG) << "Wrote level cache " << cacheFile << Log::endl;
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+
+int LevelCache::writeTextures(CacheWriter& w) {
+    w.writeU32(TextureManager::numTextures(TextureStorage::GAME));
+    for (int i = 0; i < TextureManager::numTextures(TextureStorage::GAME); i++) {
+        std::vector<unsigned char> image;
+        unsigned int width = 0, height = 0;
+        int error = 0;
+        Game::runOnMainThread([&]() {
+            error = TextureManager::getTextureData(i, TextureStorage::GAME, image, &width, &height);
+        }).wait();
+        if (error != 0)
+            return -1;
+        w.writeU32(width);
+        w.writeU32(height);
+        w.writeArray(&image[0], image.size());
+    }
+
+    for (int i = 0; i < 256; i++) {
+        glm::vec4 c = TextureManager::getPalette(i);
+        w.writeArray(&c.x, 4);
+    }
+
+    w.writeU32(TextureManager::numTiles());
+    for (int i = 0; i < TextureManager::numTiles(); i++) {
+        TextureTile& t = TextureManager::getTile(i);
+        w.writeU32(t.attribute);
+        w.writeU32(t.texture);
+        w.writeU32(t.vertices.size());
+        for (auto& v : t.vertices) {
+            w.write32(v.xCoordinate);
+            w.write32(v.xPixel);
+            w.write32(v.yCoordinate);
+            w.write32(v.yPixel);
+        }
+    }
+
+    w.writeU32(TextureManager::animations.size());
+    for (auto& a : TextureManager::animations)
+        w.writeVector(a);
+
+    return 0;
+}
+
+void LevelCache::readTextures(BinaryMapped& r) {
+    // Uploaded on the main thread, straight from the mapping.
+    // RGBA data is not modified by loadBufferSlot().
+    std::vector<std::future<void>> uploads;
+    uint32_t numTextures = r.readU32();
+    uploads.push_back(Game::runOnMainThread([numTextures]() {
+        TextureManager::reserveTextureArray(numTextures);
+    }));
+    for (uint32_t i = 0; i < numTextures; i++) {
+        uint32_t width = r.readU32();
+        uint32_t height = r.readU32();
+        unsigned char* image = reinterpret_cast<unsigned char*>(const_cast<char*>(
+                                   r.span(width * height * 4)));
+        uploads.push_back(Game::runOnMainThread([image, width, height, i]() {
+            TextureManager::loadBufferSlot(image, width, height, ColorMode::RGBA, 32,
+                                           TextureStorage::GAME, i);
+        }));
+    }
+
+    for (int i = 0; i < 256; i++) {
+        glm::vec4 c;
+        r.readArray(&c.x, 4);
+        TextureManager::setPalette(i, c);
+    }
+
+    uint32_t numTiles = r.readU32();
+    for (uint32_t i = 0; i < numTiles; i++) {
+        uint32_t attribute = r.readU32();
+        uint32_t texture = r.readU32();
+        TextureTile* t = new TextureTile(attribute, texture);
+        uint32_t numVertices = r.readU32();
+        for (uint32_t v = 0; v < numVertices; v++) {
+            int32_t vert[4];
+            r.readArray(vert, 4);
+            t->add(TextureTileVertex(vert[0], vert[1], vert[2], vert[3]));
+        }
+        TextureManager::addTile(t);
+    }
+
+    uint32_t numAnimations = r.readU32();
+    for (uint32_t i = 0; i < numAnimations; i++) {
+        std::vector<int32_t> tiles;
+        readVector(r, tiles);
+        for (auto& t : tiles)
+            TextureManager::addAnimatedTile(i, t);
+    }
+
+    for (auto& u : uploads)
+        u.get();
+}
+
+void LevelCache::writeMeshes(CacheWriter& w) {
+    w.writeU32(World::sizeMeshResource());
+    for (unsigned long i = 0; i < World::sizeMeshResource(); i++) {
+        Mesh& m = World::getMeshResource(i);
+        w.writeVector(m.indicesBuff);
+        w.writeVector(m.verticesBuff);
+        w.writeVector(m.uvsBuff);
+        w.writeVector(m.texturesBuff);
+        w.writeVector(m.indicesColorBuff);
+        w.writeVector(m.verticesColorBuff);
+        w.writeVector(m.colorsBuff);
+        w.writeVector(m.colorsIndexBuff);
+        w.writeVec3(m.sphere.getPosition());
+        w.writeFloat(m.sphere.getRadius());
+    }
+
+    // Mesh index to distinct mesh
+    w.writeU32(World::sizeMesh());
+    for (unsigned long i = 0; i < World::sizeMesh(); i++)
+        w.writeU32(World::getMeshResourceIndex(i));
+}
+
+void LevelCache::readMeshes(BinaryReader& r) {
+    uint32_t numMeshes = r.readU32();
+    std::vector<Mesh*> meshes;
+    for (uint32_t i = 0; i < numMeshes; i++) {
+        Mesh* m = new Mesh();
+        readVector(r, m->indicesBuff);
+        readVector(r, m->verticesBuff);
+        readVector(r, m->uvsBuff);
+        readVector(r, m->texturesBuff);
+        readVector(r, m->indicesColorBuff);
+        readVector(r, m->verticesColorBuff);
+        readVector(r, m->colorsBuff);
+        readVector(r, m->colorsIndexBuff);
+        m->sphere.setPosition(readVec3(r));
+        m->sphere.setRadius(r.readFloat());
+        meshes.push_back(m);
+    }
+
+    // Distinct meshes are added with their first index, in the same order
+    uint32_t numIndices = r.readU32();
+    std::vector<long> first(numMeshes, -1);
+    for (uint32_t i = 0; i < numIndices; i++) {
+        uint32_t mesh = r.readU32();
+        orAssertLessThan(mesh, numMeshes);
+        if (first.at(mesh) < 0) {
+            first.at(mesh) = World::sizeMesh();
+            World::addMesh(meshes.at(mesh));
+        } else {
+            World::addMeshReference(first.at(mesh));
+        }
+    }
+}
+
+void LevelCache::writeRooms(CacheWriter& w) {
+    w.writeU32(World::sizeRoom());
+    for (unsigned long i = 0; i < World::sizeRoom(); i++) {
+        Room& room = World::getRoom(i);
+        w.writeVec3(room.pos);
+        w.writeVec3(room.bbox->getCorner(0));
+        w.writeVec3(room.bbox->getCorner(7));
+        w.writeVector(room.mesh->indicesBuff);
+        w.writeVector(room.mesh->verticesBuff);
+        w.writeVector(room.mesh->uvsBuff);
+        w.writeVector(room.mesh->texturesBuff);
+        w.writeU32(room.flags);
+        w.write32(room.alternateRoom);
+        w.write32(room.numXSectors);
+        w.write32(room.numZSectors);
+        w.write32(room.roomIndex);
+
+        w.writeU32(room.sprites.size());
+        for (auto& s : room.sprites) {
+            w.writeVec3(s->pos);
+            w.write32(s->sprite);
+        }
+
+        w.writeU32(room.models.size());
+        for (auto& m : room.models) {
+            w.write32(m->id);
+            w.writeArray(&m->model[0][0], 16);
+        }
+
+        w.writeU32(room.portals.size());
+        for (auto& p : room.portals) {
+            w.write32(p->getAdjoiningRoom());
+            w.writeVec3(p->getNormal());
+            for (int v = 0; v < 4; v++)
+                w.writeVec3(p->getVertex(v));
+        }
+
+        w.writeU32(room.sectors.size());
+        for (auto& s : room.sectors) {
+            w.write16(s.floor);
+            w.write16(s.ceiling);
+            w.writeU16(s.floorData);
+            w.writeU16(s.box);
+            w.writeU8(s.roomBelow);
+            w.writeU8(s.roomAbove);
+            w.writeU8(s.wall);
+        }
+    }
+}
+
+void LevelCache::readRooms(BinaryReader& r) {
+    uint32_t numRooms = r.readU32();
+    for (uint32_t i = 0; i < numRooms; i++) {
+        glm::vec3 pos = readVec3(r);
+        glm::vec3 min = readVec3(r);
+        glm::vec3 max = readVec3(r);
+
+        RoomMesh* mesh = new RoomMesh();
+        readVector(r, mesh->indicesBuff);
+        readVector(r, mesh->verticesBuff);
+        readVector(r, mesh->uvsBuff);
+        readVector(r, mesh->texturesBuff);
+
+        uint32_t flags = r.readU32();
+        int32_t alternateRoom = r.read32();
+        int32_t numXSectors = r.read32();
+        int32_t numZSectors = r.read32();
+        int32_t roomIndex = r.read32();
+
+        Room* room = new Room(pos, new BoundingBox(min, max), mesh, flags, alternateRoom,
+                              numXSectors, numZSectors, roomIndex);
+
+        uint32_t numSprites = r.readU32();
+        for (uint32_t s = 0; s < numSprites; s++) {
+            glm::vec3 p = readVec3(r);
+            room->addSprite(new RoomSprite(p, r.read32()));
+        }
+
+        uint32_t numModels = r.readU32();
+        for (uint32_t m = 0; m < numModels; m++) {
+            StaticModel* model = new StaticModel(glm::vec3(0.0f, 0.0f, 0.0f), 0.0f, r.read32());
+            r.readArray(&model->model[0][0], 16);
+            room->addModel(model);
+        }
+
+        uint32_t numPortals = r.readU32();
+        for (uint32_t p = 0; p < numPortals; p++) {
+            int32_t adjoiningRoom = r.read32();
+            glm::vec3 normal = readVec3(r);
+            glm::vec3 vert[4];
+            for (int v = 0; v < 4; v++)
+                vert[v] = readVec3(r);
+            room->addPortal(new Portal(adjoiningRoom, normal, vert[0], vert[1], vert[2], vert[3]));
+        }
+
+        std::vector<Sector> sectors(r.readU32());
+        for (auto& s : sectors) {
+            s.floor = r.read16();
+            s.ceiling = r.read16();
+            s.floorData = r.readU16();
+            s.box = r.readU16();
+            s.roomBelow = r.readU8();
+            s.roomAbove = r.readU8();
+            s.wall = r.readU8();
+        }
+        room->setSectors(sectors);
+
+        World::addRoom(room);
+    }
+}
+
+void LevelCache::writeWorld(CacheWriter& w) {
+    w.writeU32(World::sizeSprite());
+    for (unsigned long i = 0; i < World::sizeSprite(); i++) {
+        Sprite& s = World::getSprite(i);
+        w.write32(s.texture);
+        w.writeVector(s.vertexBuff);
+        w.writeVector(s.uvBuff);
+        w.writeArray(&s.uv2D.x, 4);
+        w.writeVec3(s.boundingSphere.getPosition());
+        w.writeFloat(s.boundingSphere.getRadius());
+    }
+
+    w.writeU32(World::sizeSpriteSequence());
+    for (unsigned long i = 0; i < World::sizeSpriteSequence(); i++) {
+        SpriteSequence& s = World::getSpriteSequence(i);
+        w.write32(s.getID());
+        w.write32(s.getStart());
+        w.write32(s.size());
+    }
+
+    w.writeU32(World::sizeStaticMesh());
+    for (unsigned long i = 0; i < World::sizeStaticMesh(); i++) {
+        StaticMesh& s = World::getStaticMesh(i);
+        w.write32(s.id);
+        w.write32(s.mesh);
+        w.writeVec3(s.bbox1->getCorner(0));
+        w.writeVec3(s.bbox1->getCorner(7));
+        w.writeVec3(s.bbox2->getCorner(0));
+        w.writeVec3(s.bbox2->getCorner(7));
+    }
+
+    w.writeU32(World::sizeSkeletalModel());
+    for (unsigned long i = 0; i < World::sizeSkeletalModel(); i++) {
+        SkeletalModel& m = World::getSkeletalModel(i);
+        w.write32(m.getID());
+        w.writeU32(m.size());
+        for (unsigned long a = 0; a < m.size(); a++) {
+            AnimationFrame& af = m.get(a);
+            w.write32(af.rate);
+            w.writeU32(af.size());
+            for (unsigned long f = 0; f < af.size(); f++) {
+                BoneFrame& bf = af.get(f);
+                w.writeVec3(bf.getPosition());
+                w.writeU32(bf.size());
+                for (unsigned long t = 0; t < bf.size(); t++) {
+                    BoneTag& bt = bf.get(t);
+                    w.write32(bt.mesh);
+                    w.writeVec3(bt.off);
+                    w.writeVec3(bt.rot);
+                    w.write32(bt.flag);
+                }
+            }
+        }
+    }
+
+    writeAnimations(w);
+    writeFloorData(w);
+    writeNavigation(w);
+
+    w.writeU32(World::sizeEntity());
+    for (unsigned long i = 0; i < World::sizeEntity(); i++) {
+        Entity& e = World::getEntity(i);
+        w.write32(e.getID());
+        w.write32(e.getRoom());
+        w.writeVec3(e.getPosition());
+        w.writeVec3(e.getRotation());
+    }
+}
+
+void LevelCache::readWorld(BinaryReader& r) {
+    uint32_t numSprites = r.readU32();
+    for (uint32_t i = 0; i < numSprites; i++) {
+        Sprite* s = new Sprite();
+        s->texture = r.read32();
+        readVector(r, s->vertexBuff);
+        readVector(r, s->uvBuff);
+        r.readArray(&s->uv2D.x, 4);
+        s->boundingSphere.setPosition(readVec3(r));
+        s->boundingSphere.setRadius(r.readFloat());
+        World::addSprite(s);
+    }
+
+    uint32_t numSequences = r.readU32();
+    for (uint32_t i = 0; i < numSequences; i++) {
+        int32_t seq[3];
+        r.readArray(seq, 3);
+        World::addSpriteSequence(new SpriteSequence(seq[0], seq[1], seq[2]));
+    }
+
+    uint32_t numStaticMeshes = r.readU32();
+    for (uint32_t i = 0; i < numStaticMeshes; i++) {
+        int32_t id = r.read32();
+        int32_t mesh = r.read32();
+        glm::vec3 corner[4];
+        for (int c = 0; c < 4; c++)
+            corner[c] = readVec3(r);
+        World::addStaticMesh(new StaticMesh(id, mesh, new BoundingBox(corner[0], corner[1]),
+                                            new BoundingBox(corner[2], corner[3])));
+    }
+
+    uint32_t numModels = r.readU32();
+    for (uint32_t i = 0; i < numModels; i++) {
+        SkeletalModel* m = new SkeletalModel(r.read32());
+        uint32_t numAnimations = r.readU32();
+        for (uint32_t a = 0; a < numAnimations; a++) {
+            AnimationFrame* af = new AnimationFrame(static_cast<char>(r.read32()));
+            uint32_t numFrames = r.readU32();
+            for (uint32_t f = 0; f < numFrames; f++) {
+                BoneFrame* bf = new BoneFrame(readVec3(r));
+                uint32_t numTags = r.readU32();
+                for (uint32_t t = 0; t < numTags; t++) {
+                    int32_t mesh = r.read32();
+                    glm::vec3 off = readVec3(r);
+                    glm::vec3 rot = readVec3(r);
+                    bf->add(new BoneTag(mesh, off, rot, static_cast<char>(r.read32())));
+                }
+                af->add(bf);
+            }
+            m->add(af);
+        }
+        World::addSkeletalModel(m);
+    }
+
+    readAnimations(r);
+    readFloorData(r);
+    readNavigation(r);
+
+    uint32_t numEntities = r.readU32();
+    for (uint32_t i = 0; i < numEntities; i++) {
+        int32_t id = r.read32();
+        int32_t room = r.read32();
+        glm::vec3 pos = readVec3(r);
+        glm::vec3 rot = readVec3(r);
+        World::addEntity(new Entity(id, room, pos, rot));
+    }
+}
+
+void LevelCache::writeAnimations(CacheWriter& w) {
+    AnimationStore& s = World::getAnimations();
+
+    w.writeU32(s.models.size());
+    for (auto& m : s.models) {
+        w.write32(m.id);
+        w.writeU32(m.firstBone);
+        w.writeU32(m.numBones);
+        w.writeU32(m.startingMesh);
+        w.writeU32(m.firstAnimation);
+        w.writeU32(m.numAnimations);
+        w.writeU32(m.frame);
+    }
+
+    w.writeU32(s.animations.size());
+    for (auto& a : s.animations) {
+        w.writeU32(a.firstFrame);
+        w.writeU32(a.numFrames);
+        uint16_t fields[10] = { a.frameRate, a.stateID, a.frameStart, a.frameEnd,
+                                a.nextAnimation, a.nextFrame, a.numStateChanges,
+                                a.stateChangeOffset, a.numCommands, a.commandOffset
+                              };
+        w.writeArray(fields, 10);
+    }
+
+    w.writeU32(s.stateChanges.size());
+    for (auto& c : s.stateChanges) {
+        uint16_t fields[3] = { c.stateID, c.numDispatches, c.dispatchOffset };
+        w.writeArray(fields, 3);
+    }
+
+    w.writeU32(s.dispatches.size());
+    for (auto& d : s.dispatches) {
+        int16_t fields[4] = { d.low, d.high, d.nextAnimation, d.nextFrame };
+        w.writeArray(fields, 4);
+    }
+
+    w.writeVector(s.commands);
+    w.writeVector(s.frameAngles);
+    w.writeVector(s.frameBounds);
+    w.writeVector(s.framePositions);
+    w.writeVector(s.angles);
+    w.writeVector(s.boneParents);
+    w.writeVector(s.boneOffsets);
+    w.writeVector(s.boneFlags);
+}
+
+void LevelCache::readAnimations(BinaryReader& r) {
+    AnimationStore& s = World::getAnimations();
+
+    s.models.resize(r.readU32());
+    for (auto& m : s.models) {
+        m.id = r.read32();
+        m.firstBone = r.readU32();
+        m.numBones = r.readU32();
+        m.startingMesh = r.readU32();
+        m.firstAnimation = r.readU32();
+        m.numAnimations = r.readU32();
+        m.frame = r.readU32();
+    }
+
+    s.animations.resize(r.readU32());
+    for (auto& a : s.animations) {
+        a.firstFrame = r.readU32();
+        a.numFrames = r.readU32();
+        uint16_t fields[10];
+        r.readArray(fields, 10);
+        a.frameRate = fields[0];
+        a.stateID = fields[1];
+        a.frameStart = fields[2];
+        a.frameEnd = fields[3];
+        a.nextAnimation = fields[4];
+        a.nextFrame = fields[5];
+        a.numStateChanges = fields[6];
+        a.stateChangeOffset = fields[7];
+        a.numCommands = fields[8];
+        a.commandOffset = fields[9];
+    }
+
+    s.stateChanges.resize(r.readU32());
+    for (auto& c : s.stateChanges) {
+        uint16_t fields[3];
+        r.readArray(fields, 3);
+        c.stateID = fields[0];
+        c.numDispatches = fields[1];
+        c.dispatchOffset = fields[2];
+    }
+
+    s.dispatches.resize(r.readU32());
+    for (auto& d : s.dispatches) {
+        int16_t fields[4];
+        r.readArray(fields, 4);
+        d.low = fields[0];
+        d.high = fields[1];
+        d.nextAnimation = fields[2];
+        d.nextFrame = fields[3];
+    }
+
+    readVector(r, s.commands);
+    readVector(r, s.frameAngles);
+    readVector(r, s.frameBounds);
+    readVector(r, s.framePositions);
+    readVector(r, s.angles);
+    readVector(r, s.boneParents);
+    readVector(r, s.boneOffsets);
+    readVector(r, s.boneFlags);
+}
+
+void LevelCache::writeSound(CacheWriter& w) {
+    w.writeVector(SoundManager::soundMap);
+    w.writeVector(SoundManager::sampleIndices);
+
+    w.writeU32(SoundManager::soundDetails.size());
+    for (auto& d : SoundManager::soundDetails) {
+        w.write32(d.getSample());
+        w.writeFloat(d.getVolume());
+    }
+
+    w.writeU32(SoundManager::soundSources.size());
+    for (auto& s : SoundManager::soundSources) {
+        w.writeVec3(s.getPos());
+        w.write32(s.getID());
+        w.write32(s.getFlags());
+    }
+
+    // Straight out of the mapped sample files, nothing is decoded
+    w.writeU32(SoundManager::sizeSamples());
+    for (unsigned long i = 0; i < SoundManager::sizeSamples(); i++) {
+        uint32_t length = 0;
+        const char* data = SoundManager::getSample(i, &length);
+        w.writeU32(length);
+        w.writeArray(data, length);
+    }
+}
+
+void LevelCache::readSound(BinaryMapped& r, std::string cacheFile) {
+    std::vector<int32_t> table;
+    readVector(r, table);
+    for (auto& t : table)
+        SoundManager::addSoundMapEntry(t);
+
+    readVector(r, table);
+    for (auto& t : table)
+        SoundManager::addSampleIndex(t);
+
+    uint32_t numDetails = r.readU32();
+    for (uint32_t i = 0; i < numDetails; i++) {
+        int32_t sample = r.read32();
+        SoundManager::addSoundDetail(sample, r.readFloat());
+    }
+
+    uint32_t numSources = r.readU32();
+    for (uint32_t i = 0; i < numSources; i++) {
+        glm::vec3 pos = readVec3(r);
+        int32_t id = r.read32();
+        SoundManager::addSoundSource(pos, id, r.read32());
+    }
+
+    // Samples are only indexed, the cache file stays mapped for the SoundManager
+    uint32_t numSamples = r.readU32();
+    int sampleFile = -1;
+    if (numSamples > 0) {
+        sampleFile = SoundManager::addSampleFile(cacheFile);
+        orAssertGreaterThanEqual(sampleFile, 0);
+    }
+    for (uint32_t i = 0; i < numSamples; i++) {
+        uint32_t length = r.readU32();
+        SoundManager::addSample(sampleFile, r.tell(), length);
+        r.span(length);
+    }
+}
+
+void LevelCache::writeFloorData(CacheWriter& w) {
+    FloorData& f = World::getFloorData();
+
+    w.writeU32(f.infos.size());
+    for (auto& i : f.infos) {
+        int8_t slopes[4] = { i.floorSlopeX, i.floorSlopeZ, i.ceilingSlopeX, i.ceilingSlopeZ };
+        w.writeArray(slopes, 4);
+        uint8_t bytes[3] = { i.flags, i.floorSplit, i.ceilingSplit };
+        w.writeArray(bytes, 3);
+        uint16_t fields[4] = { i.portal, i.floorCorners, i.ceilingCorners, i.trigger };
+        w.writeArray(fields, 4);
+    }
+
+    w.writeU32(f.triggers.size());
+    for (auto& t : f.triggers) {
+        uint8_t bytes[4] = { t.type, t.timer, t.mask, t.oneShot };
+        w.writeArray(bytes, 4);
+        w.writeU32(t.firstAction);
+        w.writeU32(t.numActions);
+    }
+
+    w.writeU32(f.actions.size());
+    for (auto& a : f.actions) {
+        w.writeU16(a.parameter);
+        uint8_t bytes[3] = { a.type, a.timer, a.once };
+        w.writeArray(bytes, 3);
+    }
+}
+
+void LevelCache::readFloorData(BinaryReader& r) {
+    FloorData& f = World::getFloorData();
+
+    f.infos.resize(r.readU32());
+    for (auto& i : f.infos) {
+        int8_t slopes[4];
+        r.readArray(slopes, 4);
+        i.floorSlopeX = slopes[0];
+        i.floorSlopeZ = slopes[1];
+        i.ceilingSlopeX = slopes[2];
+        i.ceilingSlopeZ = slopes[3];
+        uint8_t bytes[3];
+        r.readArray(bytes, 3);
+        i.flags = bytes[0];
+        i.floorSplit = bytes[1];
+        i.ceilingSplit = bytes[2];
+        i.unused = 0;
+        uint16_t fields[4];
+        r.readArray(fields, 4);
+        i.portal = fields[0];
+        i.floorCorners = fields[1];
+        i.ceilingCorners = fields[2];
+        i.trigger = fields[3];
+    }
+
+    f.triggers.resize(r.readU32());
+    for (auto& t : f.triggers) {
+        uint8_t bytes[4];
+        r.readArray(bytes, 4);
+        t.type = bytes[0];
+        t.timer = bytes[1];
+        t.mask = bytes[2];
+        t.oneShot = bytes[3];
+        t.firstAction = r.readU32();
+        t.numActions = r.readU32();
+    }
+
+    f.actions.resize(r.readU32());
+    for (auto& a : f.actions) {
+        a.parameter = r.readU16();
+        uint8_t bytes[3];
+        r.readArray(bytes, 3);
+        a.type = bytes[0];
+        a.timer = bytes[1];
+        a.once = bytes[2];
+        a.unused = 0;
+    }
+}
+
+void LevelCache::writeNavigation(CacheWriter& w) {
+    Navigation& n = World::getNavigation();
+
+    w.writeU32(n.boxes.size());
+    for (auto& b : n.boxes) {
+        int32_t bounds[4] = { b.xMin, b.xMax, b.zMin, b.zMax };
+        w.writeArray(bounds, 4);
+        w.write16(b.floor);
+        w.writeU16(b.flags);
+    }
+
+    w.writeVector(n.centers);
+    w.writeVector(n.firstNeighbour);
+    w.writeVector(n.neighbours);
+    w.writeVector(n.zones);
+}
+
+void LevelCache::readNavigation(BinaryReader& r) {
+    Navigation& n = World::getNavigation();
+
+    n.boxes.resize(r.readU32());
+    for (auto& b : n.boxes) {
+        int32_t bounds[4];
+        r.readArray(bounds, 4);
+        b.xMin = bounds[0];
+        b.xMax = bounds[1];
+        b.zMin = bounds[2];
+        b.zMax = bounds[3];
+        b.floor = r.read16();
+        b.flags = r.readU16();
+    }
+
+    readVector(r, n.centers);
+    readVector(r, n.firstNeighbour);
+    readVector(r, n.neighbours);
+    readVector(r, n.zones);
+}
+
@@ -10,8 +10,12 @@
 
 std::vector<LogLevel> Log::logs;
 std::vector<LogEntry> Log::wholeLog;
+std::thread::id Log::mainThread;
+std::mutex Log::mutex;
+std::vector<LogEntry> Log::pending;
 
 void Log::initialize() {
+    mainThread = std::this_thread::get_id();
     for (int i = 0; i < LOG_COUNT; i++)
         logs.emplace_back(i);
 }
@@ -19,6 +23,36 @@ void Log::initialize() {
 LogLevel& Log::get(int level) {
     orAssertGreaterThanEqual(level, 0);
     orAssertLessThan(level, LOG_COUNT);
-    return logs.at(level);
+
+    if (std::this_thread::get_id() == mainThread)
+        return logs.at(level);
+
+    // Freed with their thread, so short-lived workers don't pile up buffers
+    thread_local std::vector<LogLevel> threadLogs;
+    if (threadLogs.empty()) {
+        for (int i = 0; i < LOG_COUNT; i++)
+            threadLogs.emplace_back(i);
+    }
+    return threadLogs.at(level);
+}
+
+unsigned long Log::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& e : pending)
+        wholeLog.push_back(e);
+    pending.clear();
+    return wholeLog.size();
+}
+
+void Log::add(std::string s, int level) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (std::this_thread::get_id() == mainThread)
+        wholeLog.emplace_back(s, level);
+    else
+        pending.emplace_back(s, level);
+
+#ifdef DEBUG
+    std::cout << s << std::endl;
+#endif
 }
 
@@ -5,6 +5,8 @@
  * \author xythobuz
  */
 
+#include <chrono>
+
 #include "imgui/imgui.h"
 
 #include "global.h"
@@ -15,72 +17,93 @@
 #include "UI.h"
 #include "TextureManager.h"
 #include "system/Window.h"
-#include "utils/random.h"
+#include "utils/filesystem.h"
+#include "utils/FolderIndex.h"
 #include "utils/strings.h"
+#include "utils/ThreadPool.h"
 #include "Menu.h"
 
 const glm::vec4 Menu::textColor(0.5f, 0.7f, 1.0f, 1.0f);
 const glm::vec4 Menu::selectedColor(1.0f, 0.0f, 0.0f, 1.0f);
 
 bool Menu::visible = false;
-Folder* Menu::mapFolder = nullptr;
-std::vector<Script> Menu::scripts;
-std::vector<Folder> Menu::paths;
+GameIndex Menu::games;
 std::vector<int> Menu::images;
+std::vector<int> Menu::slots;
+GameIndex Menu::scanned;
+std::future<unsigned long> Menu::scanResult;
+FolderIndex Menu::levels;
 
 int Menu::initialize() {
     shutdown();
-    mapFolder = new Folder(RunTime::getPakDir());
-
-    std::vector<File> files;
-    mapFolder->findRecursiveFilesEndingWith(files, "tombpc.dat");
-    for (auto& f : files) {
-        scripts.emplace_back();
-        auto s = scripts.size() - 1;
-
-        images.push_back(-1);
-        auto i = images.size() - 1;
-
-        std::string path = convertPathDelimiter(removeLastPathElement(f.getPath()));
-        paths.emplace_back(path);
-        auto p = paths.size() - 1;
-
-        if (scripts.at(s).load(f.getPath()) != 0) {
-            Log::get(LOG_ERROR) << "Invalid Script: \"" << f.getPath()
-                                << "\"!" << Log::endl;
-            scripts.pop_back();
-        } else {
-            // Load one of the pictures of this level
-            std::vector<File> texFiles;
-            paths.at(p).findRecursiveFilesEndingWith(texFiles, ".pcx");
-            paths.at(p).findRecursiveFilesEndingWith(texFiles, ".bmp");
-            paths.at(p).findRecursiveFilesEndingWith(texFiles, ".png");
-            paths.at(p).findRecursiveFilesEndingWith(texFiles, ".tga");
-            paths.at(p).findRecursiveFilesEndingWith(texFiles, ".jpg");
-
-            if (texFiles.size() > 0) {
-                int which = randomInteger(texFiles.size() - 1);
-                images.at(i) = TextureManager::loadImage(texFiles.at(which).getPath(),
-                               TextureStorage::SYSTEM);
+
+    // The last known games are shown right away
+    std::string dir = RunTime::getBaseDir() + "/cache";
+    std::string indexFile = dir + "/games.idx";
+    if (games.read(indexFile) == 0)
+        updateImages();
+
+    // Parsing scripts and decoding pictures only happens for new or changed games
+    scanned = games;
+    std::string pakDir = RunTime::getPakDir();
+    levels.setFolder(pakDir);
+    levels.invalidate();
+    scanResult = std::async(std::launch::async, [dir, indexFile, pakDir]() {
+        ThreadPool pool;
+        unsigned long changed = scanned.scan(pakDir, pool);
+        if (changed > 0) {
+            if ((createDirectory(dir) != 0) || (scanned.write(indexFile) != 0)) {
+                Log::get(LOG_WARNING) << "Could not write game index " << indexFile << Log::endl;
             }
         }
-    }
+        return changed;
+    });
 
     return 0;
 }
 
 void Menu::shutdown() {
-    if (mapFolder != nullptr) {
-        delete mapFolder;
-        mapFolder = nullptr;
-    }
+    if (scanResult.valid())
+        scanResult.wait();
+    scanResult = std::future<unsigned long>();
+
+    games = GameIndex();
+    scanned = GameIndex();
+    images.clear();
+}
+
+void Menu::updateImages() {
+    images.clear();
+    unsigned long used = 0;
+    for (unsigned long i = 0; i < games.size(); i++) {
+        GameIndex::Entry& e = games.get(i);
+        if (e.thumbnail.empty()) {
+            images.push_back(-1);
+            continue;
+        }
 
-    scripts.clear();
-    paths.clear();
-    images.clear(); //! \fixme free texture slots
+        int slot = (used < slots.size()) ? slots.at(used) : -1;
+        int id = TextureManager::loadBufferSlot(&e.thumbnail[0], GameIndex::thumbnailSize,
+                                                GameIndex::thumbnailSize, ColorMode::RGBA, 32,
+                                                TextureStorage::SYSTEM, slot);
+        if ((id >= 0) && (used >= slots.size()))
+            slots.push_back(id);
+        if (id >= 0)
+            used++;
+        images.push_back(id);
+    }
 }
 
 void Menu::display() {
+    if (scanResult.valid()
+        && (scanResult.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+        if (scanResult.get() > 0) {
+            games = std::move(scanned);
+            scanned = GameIndex();
+            updateImages();
+        }
+    }
+
     if (!visible)
         return;
 
@@ -141,9 +164,12 @@ void Menu::display() {
     }
 
     // List found games
-    for (int i = 0; i < scripts.size(); i++) {
+    for (int i = 0; i < games.size(); i++) {
+        GameIndex::Entry& e = games.get(i);
+        if (!e.valid)
+            continue;
+
         ImGui::PushID(i);
-        Script& s = scripts.at(i);
 
         if (images.at(i) >= 0) {
             auto bm = TextureManager::getBufferManager(images.at(i), TextureStorage::SYSTEM);
@@ -151,22 +177,21 @@ void Menu::display() {
         }
         ImGui::NextColumn();
 
-        ImGui::TextWrapped("Language: %s", s.getLanguage().c_str());
-        ImGui::TextWrapped("Description: %s", s.getDescription().c_str());
+        ImGui::TextWrapped("Language: %s", e.language.c_str());
+        ImGui::TextWrapped("Description: %s", e.description.c_str());
 
-        if (ImGui::TreeNode("", "%d Levels", s.levelCount())) {
-            for (int l = 0; l < s.levelCount(); l++) {
+        if (ImGui::TreeNode("", "%lu Levels", e.levelFiles.size())) {
+            for (int l = 0; l < e.levelFiles.size(); l++) {
                 ImGui::PushID(l);
                 ImGui::Bullet();
-                ImGui::TextWrapped("%s (%s)", s.getLevelName(l).c_str(), s.getLevelFilename(l).c_str());
+                ImGui::TextWrapped("%s (%s)", e.levelNames.at(l).c_str(), e.levelFiles.at(l).c_str());
                 ImGui::SameLine();
                 if (ImGui::Button("Play level")) {
                     std::vector<File> levelFiles;
-                    paths.at(i).findRecursiveFilesEndingWith(levelFiles,
-                            getLastPathElement(s.getLevelFilename(l)));
+                    levels.find(levelFiles, { getLastPathElement(e.levelFiles.at(l)) }, e.folder);
                     if (levelFiles.size() == 0) {
                         Log::get(LOG_ERROR) << "Could not find level \""
-                                            << getLastPathElement(s.getLevelFilename(l))
+                                            << getLastPathElement(e.levelFiles.at(l))
                                             << "\"!" << Log::endl;
                     } else {
                         Game::loadLevel(levelFiles.at(0).getPath());
@@ -177,34 +202,34 @@ void Menu::display() {
             ImGui::TreePop();
         }
 
-        if (ImGui::TreeNode("", "%d Cut-Scenes", s.cutsceneCount())) {
-            for (int c = 0; c < s.cutsceneCount(); c++) {
+        if (ImGui::TreeNode("", "%lu Cut-Scenes", e.cutscenes.size())) {
+            for (auto& c : e.cutscenes) {
                 ImGui::Bullet();
-                ImGui::TextWrapped("%s", s.getCutsceneFilename(c).c_str());
+                ImGui::TextWrapped("%s", c.c_str());
             }
             ImGui::TreePop();
         }
 
-        if (ImGui::TreeNode("", "%d Videos", s.videoCount())) {
-            for (int v = 0; v < s.videoCount(); v++) {
+        if (ImGui::TreeNode("", "%lu Videos", e.videos.size())) {
+            for (auto& v : e.videos) {
                 ImGui::Bullet();
-                ImGui::TextWrapped("%s", s.getVideoFilename(v).c_str());
+                ImGui::TextWrapped("%s", v.c_str());
             }
             ImGui::TreePop();
         }
 
-        if (ImGui::TreeNode("", "%d Pictures", s.pictureCount())) {
-            for (int p = 0; p < s.pictureCount(); p++) {
+        if (ImGui::TreeNode("", "%lu Pictures", e.pictures.size())) {
+            for (auto& p : e.pictures) {
                 ImGui::Bullet();
-                ImGui::TextWrapped("%s", s.getPictureFilename(p).c_str());
+                ImGui::TextWrapped("%s", p.c_str());
             }
             ImGui::TreePop();
         }
 
-        if (ImGui::TreeNode("", "%d Titles", s.titleCount())) {
-            for (int t = 0; t < s.titleCount(); t++) {
+        if (ImGui::TreeNode("", "%lu Titles", e.titles.size())) {
+            for (auto& t : e.titles) {
                 ImGui::Bullet();
-                ImGui::TextWrapped("%s", s.getTitleFilename(t).c_str());
+                ImGui::TextWrapped("%s", t.c_str());
             }
             ImGui::TreePop();
         }
@@ -213,13 +238,16 @@ void Menu::display() {
         ImGui::TextWrapped("Real Gameplay not yet implemented!");
         ImGui::NextColumn();
 
-        if (i < (scripts.size() - 1))
+        if (i < (games.size() - 1))
             ImGui::Separator();
         ImGui::PopID();
     }
     ImGui::Columns(1);
 
-    if (scripts.size() == 0) {
+    if ((games.size() == 0) && scanResult.valid()) {
+        ImGui::TextWrapped("Searching for games in your PAK folder \"%s\"...",
+                           RunTime::getPakDir().c_str());
+    } else if (games.size() == 0) {
         ImGui::TextWrapped("OpenRaiders built-in TombRaider-Script detection mechanism could not find any suitable TR2/TR3 script files (called \"TOMBPC.DAT\") in your PAK folder \"%s\"! Use the \"Select Level File\" Button to load a single level without starting the entire game.",
                            RunTime::getPakDir().c_str());
     }
@@ -6,17 +6,62 @@
  */
 
 #include "global.h"
+#include "LevelBuffer.h"
 #include "TextureManager.h"
 #include "Mesh.h"
 
+#include <algorithm>
+
 #include <glbinding/gl/gl.h>
 #include <glm/glm.hpp>
 
+bool Mesh::drawRanges = true;
+std::vector<Mesh*> Mesh::instanced;
+unsigned long Mesh::lastInstances = 0;
+unsigned long Mesh::lastInstanceDraws = 0;
+unsigned long Mesh::lastDrawsWithout = 0;
+
+void sortTrianglesByTexture(std::vector<unsigned short>& indices,
+                            const std::vector<unsigned int>& textures) {
+    orAssertEqual(indices.size() % 3, 0);
+
+    std::vector<unsigned long> order(indices.size() / 3);
+    for (unsigned long i = 0; i < order.size(); i++)
+        order.at(i) = i;
+
+    // Stable, so the triangle order within one texture does not change
+    std::stable_sort(order.begin(), order.end(), [&](unsigned long a, unsigned long b) {
+        return textures.at(indices.at(a * 3)) < textures.at(indices.at(b * 3));
+    });
+
+    std::vector<unsigned short> sorted;
+    sorted.reserve(indices.size());
+    for (auto t : order) {
+        sorted.push_back(indices.at(t * 3));
+        sorted.push_back(indices.at((t * 3) + 1));
+        sorted.push_back(indices.at((t * 3) + 2));
+    }
+    indices = std::move(sorted);
+}
+
+std::vector<MeshDrawRange> findDrawRanges(const std::vector<unsigned short>& indices,
+                                          const std::vector<unsigned int>& textures) {
+    std::vector<MeshDrawRange> ranges;
+    for (unsigned long i = 0; i < indices.size(); i += 3) {
+        unsigned int texture = textures.at(indices.at(i));
+        if ((ranges.size() > 0) && (ranges.back().texture == texture))
+            ranges.back().count += 3;
+        else
+            ranges.emplace_back(texture, i, 3);
+    }
+    return ranges;
+}
+
 Mesh::Mesh(const std::vector<glm::vec3>& vert,
            const std::vector<IndexedRectangle>& rect,
            const std::vector<IndexedRectangle>& tri,
            const std::vector<IndexedColoredRectangle>& coloredRect,
-           const std::vector<IndexedColoredRectangle>& coloredTri) {
+           const std::vector<IndexedColoredRectangle>& coloredTri) : uploaded(false), levelIndex(-1) {
     for (auto& t : rect) {
         indicesBuff.push_back(0);
         verticesBuff.emplace_back(vert.at(t.v1).x, vert.at(t.v1).y, vert.at(t.v1).z);
@@ -92,6 +137,8 @@ void Mesh::prepare() {
     orAssertEqual(vert.size(), tex.size());
     orAssertEqual(vert.size(), uvBuff.size());
 
+    sortTrianglesByTexture(ind, tex);
+
     indicesBuff = std::move(ind);
     verticesBuff = std::move(vert);
     uvsBuff = std::move(uvBuff);
@@ -148,10 +195,41 @@ void Mesh::prepare() {
     sphere.setRadius(radius);
 }
 
-void Mesh::display(glm::mat4 MVP, ShaderTexture* shaderTexture) {
+// Runs on the main thread, after prepare() and after the LevelCache has been written
+void Mesh::upload() {
+    if (uploaded)
+        return;
+
     if (indicesBuff.size() > 0) {
-        Shader::drawGLBuffer(verticesBuff, uvsBuff);
+        buffers.upload(verticesBuff, uvsBuff, indicesBuff);
+        ranges = findDrawRanges(indicesBuff, texturesBuff);
+        buffers.uploadLayers(std::vector<float>(texturesBuff.begin(), texturesBuff.end()));
+    }
+
+    if (indicesColorBuff.size() > 0)
+        colorBuffers.upload(verticesColorBuff, colorsBuff, indicesColorBuff);
+
+    // Only the indices and textures are still needed, without draw ranges
+    std::vector<glm::vec3>().swap(verticesBuff);
+    std::vector<glm::vec2>().swap(uvsBuff);
+    std::vector<unsigned short>().swap(indicesColorBuff);
+    std::vector<glm::vec3>().swap(verticesColorBuff);
+    std::vector<glm::vec3>().swap(colorsBuff);
+    std::vector<unsigned int>().swap(colorsIndexBuff);
+    uploaded = true;
+}
+
+void Mesh::display(glm::mat4 MVP, ShaderTexture* shaderTexture) {
+    upload();
 
+    if (TextureManager::useTextureArray()) {
+        if (buffers.isUploaded())
+            Shader::drawGLArray(buffers, MVP, gl::GL_TRIANGLES, shaderTexture);
+    } else if (drawRanges) {
+        for (auto& r : ranges)
+            Shader::drawGL(buffers, r.first, r.count, MVP, r.texture, TextureStorage::GAME,
+                           gl::GL_TRIANGLES, shaderTexture);
+    } else if (indicesBuff.size() > 0) {
         for (int i = 0; i < TextureManager::numTextures(TextureStorage::GAME); i++) {
             std::vector<unsigned short> indices;
             for (int n = 0; n < indicesBuff.size(); n++) {
@@ -160,13 +238,76 @@ void Mesh::display(glm::mat4 MVP, ShaderTexture* shaderTexture) {
                 }
             }
 
-            Shader::drawGLOnly(indices, MVP, i, TextureStorage::GAME,
+            if (indices.size() > 0)
+                Shader::drawGL(buffers, indices, MVP, i, TextureStorage::GAME,
                                gl::GL_TRIANGLES, shaderTexture);
         }
     }
 
-    if (indicesColorBuff.size() > 0)
-        Shader::drawGL(verticesColorBuff, colorsBuff, indicesColorBuff, MVP, gl::GL_TRIANGLES,
-                       shaderTexture);
+    if (colorBuffers.isUploaded())
+        Shader::drawGL(colorBuffers, MVP, gl::GL_TRIANGLES, shaderTexture);
+}
+
+void Mesh::displayBatched(glm::mat4 MVP) {
+    upload();
+
+    if (!LevelBuffer::add(levelIndex, MVP)) {
+        display(MVP);
+        return;
+    }
+
+    if (colorBuffers.isUploaded())
+        Shader::drawGL(colorBuffers, MVP);
+}
+
+void Mesh::displayInstanced(glm::mat4 MVP) {
+    if (instances.size() == 0)
+        instanced.push_back(this);
+    instances.push_back(MVP);
+}
+
+void Mesh::drawInstances() {
+    lastInstances = 0;
+    lastInstanceDraws = 0;
+    lastDrawsWithout = 0;
+
+    for (auto m : instanced) {
+        m->upload();
+
+        // Without instancing, every model needs its textured and colored draw
+        unsigned long draws = (m->buffers.isUploaded() ? 1 : 0)
+                              + (m->colorBuffers.isUploaded() ? 1 : 0);
+        lastInstances += m->instances.size();
+        lastDrawsWithout += m->instances.size() * draws;
+
+        if (m->buffers.isUploaded()) {
+            Shader::drawGLInstanced(m->buffers, m->instances);
+            lastInstanceDraws++;
+        }
+
+        // Rare, so colored faces are still drawn one model at a time
+        if (m->colorBuffers.isUploaded()) {
+            for (auto& MVP : m->instances)
+                Shader::drawGL(m->colorBuffers, MVP);
+            lastInstanceDraws += m->instances.size();
+        }
+
+        m->instances.clear();
+    }
+
+    instanced.clear();
+}
+
+unsigned long Mesh::getMemorySize() {
+    return (indicesBuff.size() * sizeof(unsigned short))
+           + (verticesBuff.size() * sizeof(glm::vec3))
+           + (uvsBuff.size() * sizeof(glm::vec2))
+           + (texturesBuff.size() * sizeof(unsigned int))
+           + (indicesColorBuff.size() * sizeof(unsigned short))
+           + (verticesColorBuff.size() * sizeof(glm::vec3))
+           + (colorsBuff.size() * sizeof(glm::vec3))
+           + (colorsIndexBuff.size() * sizeof(unsigned int))
+           + (ranges.size() * sizeof(MeshDrawRange))
+           + buffers.getMemorySize() + colorBuffers.getMemorySize();
 }
 
@@ -0,0 +1,229 @@
+/*!
+ * \file src/Navigation.cpp
+ * \brief NPC navigation graph and path finder
+ *
+ * \author xythobuz
+ */
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "global.h"
+#include "utils/ThreadPool.h"
+#include "Navigation.h"
+
+const unsigned int Navigation::zoneTables;
+const uint32_t Navigation::noPath;
+
+namespace {
+    struct HeapEntry {
+        uint32_t estimate; // Cost so far plus heuristic
+        uint32_t box;
+
+        bool operator<(const HeapEntry& other) const {
+            // std::push_heap builds a max heap, the cheapest entry has to be on top
+            return estimate > other.estimate;
+        }
+    };
+
+    /*
+     * Buffers of one thread, sized for the largest graph searched so far.
+     * Instead of clearing them for every query, a box only counts as visited
+     * if its stamp matches the one of the running query.
+     */
+    struct Scratch {
+        std::vector<uint32_t> cost;
+        std::vector<uint32_t> parent;
+        std::vector<uint32_t> stamp;
+        std::vector<HeapEntry> heap;
+        uint32_t current;
+
+        Scratch() : current(0) { }
+
+        void begin(unsigned long size) {
+            if (stamp.size() < size) {
+                cost.resize(size);
+                parent.resize(size);
+                stamp.resize(size, 0);
+            }
+
+            current++;
+            if (current == 0) {
+                // Wrapped around, old stamps could match again
+                std::fill(stamp.begin(), stamp.end(), 0);
+                current = 1;
+            }
+            heap.clear();
+        }
+    };
+
+    thread_local Scratch scratch;
+}
+
+void Navigation::clear() {
+    boxes.clear();
+    centers.clear();
+    firstNeighbour.assign(1, 0);
+    neighbours.clear();
+    zones.clear();
+}
+
+unsigned long Navigation::getMemorySize() {
+    return (boxes.size() * sizeof(Box)) + (centers.size() * sizeof(int32_t))
+           + (firstNeighbour.size() * sizeof(uint32_t)) + (neighbours.size() * sizeof(uint32_t))
+           + (zones.size() * sizeof(int16_t));
+}
+
+unsigned long Navigation::build(const std::vector<Box>& b,
+                                const std::vector<uint16_t>& overlapIndices,
+                                const std::vector<uint16_t>& overlaps,
+                                const std::vector<int16_t>& z) {
+    orAssertEqual(overlapIndices.size(), b.size());
+    orAssertEqual(z.size(), b.size() * zoneTables);
+
+    clear();
+    boxes = b;
+    unsigned long invalid = 0;
+
+    centers.reserve(boxes.size() * 3);
+    firstNeighbour.reserve(boxes.size() + 1);
+    neighbours.reserve(overlaps.size());
+    for (unsigned long i = 0; i < boxes.size(); i++) {
+        Box& box = boxes.at(i);
+        centers.push_back((box.xMin + box.xMax) / 2);
+        centers.push_back(box.floor);
+        centers.push_back((box.zMin + box.zMax) / 2);
+
+        uint16_t index = overlapIndices.at(i);
+        box.flags = 0;
+        if (index & 0x8000)
+            box.flags |= NavigationBoxBlockable;
+        if (index & 0x4000)
+            box.flags |= NavigationBoxBlocked;
+
+        // Lists end with the entry that has its top bit set
+        for (unsigned long o = index & 0x3FFF; o < overlaps.size(); o++) {
+            uint32_t n = overlaps.at(o) & 0x7FFF;
+            if (n < b.size())
+                neighbours.push_back(n);
+            else
+                invalid++;
+
+            if (overlaps.at(o) & 0x8000)
+                break;
+        }
+        firstNeighbour.push_back(neighbours.size());
+    }
+
+    // One array per table in the file, one group of tables per box in here
+    zones.resize(z.size());
+    for (unsigned int t = 0; t < zoneTables; t++)
+        for (unsigned long i = 0; i < boxes.size(); i++)
+            zones[(i * zoneTables) + t] = z[(t * boxes.size()) + i];
+
+    return invalid;
+}
+
+void Navigation::setBlocked(unsigned long box, bool blocked) {
+    orAssertLessThan(box, boxes.size());
+    if (blocked)
+        boxes.at(box).flags |= NavigationBoxBlocked;
+    else
+        boxes.at(box).flags &= ~NavigationBoxBlocked;
+}
+
+uint32_t Navigation::distance(uint32_t a, uint32_t b) const {
+    const int32_t* ca = &centers[a * 3];
+    const int32_t* cb = &centers[b * 3];
+    return std::abs(ca[0] - cb[0]) + std::abs(ca[1] - cb[1]) + std::abs(ca[2] - cb[2]);
+}
+
+uint32_t Navigation::findPath(const Query& query, std::vector<uint32_t>& path,
+                              uint32_t* expanded) {
+    path.clear();
+    if (expanded != nullptr)
+        *expanded = 0;
+
+    if ((query.start >= boxes.size()) || (query.goal >= boxes.size())
+        || (query.zone >= NavigationZoneCount))
+        return noPath;
+
+    // Different zones are never connected, no search needed
+    int16_t zone = getZone(query.start, query.zone, query.flipped);
+    if (getZone(query.goal, query.zone, query.flipped) != zone)
+        return noPath;
+
+    unsigned int table = query.zone + (query.flipped ? NavigationZoneCount : 0);
+    Scratch& s = scratch;
+    s.begin(boxes.size());
+
+    s.stamp[query.start] = s.current;
+    s.cost[query.start] = 0;
+    s.parent[query.start] = query.start;
+    s.heap.push_back({ distance(query.start, query.goal), query.start });
+
+    uint32_t count = 0;
+    bool found = false;
+    while (!s.heap.empty()) {
+        std::pop_heap(s.heap.begin(), s.heap.end());
+        HeapEntry e = s.heap.back();
+        s.heap.pop_back();
+
+        // Boxes are pushed again when a cheaper way is found, skip the old entries
+        uint32_t cost = s.cost[e.box];
+        if (e.estimate != (cost + distance(e.box, query.goal)))
+            continue;
+
+        count++;
+        if (e.box == query.goal) {
+            found = true;
+            break;
+        }
+
+        for (uint32_t i = firstNeighbour[e.box]; i < firstNeighbour[e.box + 1]; i++) {
+            uint32_t n = neighbours[i];
+            if ((zones[(n * zoneTables) + table] != zone)
+                || (boxes[n].flags & NavigationBoxBlocked))
+                continue;
+
+            uint32_t c = cost + distance(e.box, n);
+            if ((s.stamp[n] == s.current) && (s.cost[n] <= c))
+                continue;
+
+            s.stamp[n] = s.current;
+            s.cost[n] = c;
+            s.parent[n] = e.box;
+            s.heap.push_back({ c + distance(n, query.goal), n });
+            std::push_heap(s.heap.begin(), s.heap.end());
+        }
+    }
+
+    if (expanded != nullptr)
+        *expanded = count;
+
+    if (!found)
+        return noPath;
+
+    for (uint32_t b = query.goal; b != query.start; b = s.parent[b])
+        path.push_back(b);
+    path.push_back(query.start);
+    std::reverse(path.begin(), path.end());
+    return s.cost[query.goal];
+}
+
+void Navigation::findPaths(const std::vector<Query>& queries, std::vector<Result>& results,
+                           ThreadPool& pool) {
+    results.resize(queries.size());
+
+    // Small chunks keep the threads busy, even if some queries are far more expensive
+    const std::size_t chunk = 16;
+    std::size_t chunks = (queries.size() + chunk - 1) / chunk;
+    pool.parallelFor(chunks, [&](std::size_t c) {
+        std::size_t end = std::min(queries.size(), (c + 1) * chunk);
+        for (std::size_t i = c * chunk; i < end; i++) {
+            Result& r = results[i];
+            r.cost = findPath(queries[i], r.path, &r.expanded);
+        }
+    });
+}
+
@@ -13,6 +13,8 @@
 #include "BoundingBox.h"
 #include "BoundingSphere.h"
 #include "Camera.h"
+#include "Game.h"
+#include "LevelBuffer.h"
 #include "Log.h"
 #include "Menu.h"
 #include "Selector.h"
@@ -36,7 +38,8 @@ bool Render::displayVisibilityCheck = false;
 void Render::display() {
     gl::glClear(gl::GL_COLOR_BUFFER_BIT | gl::GL_DEPTH_BUFFER_BIT);
 
-    if (mode == RenderMode::LoadScreen) {
+    // The world is still being filled while loading, so it can't be drawn
+    if ((mode == RenderMode::LoadScreen) || Game::isLoading()) {
         ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
         ImGui::SetNextWindowSize(ImVec2(Window::getSize().x, Window::getSize().y));
         ImGui::Begin("SplashWindow", nullptr, ImGuiWindowFlags_NoTitleBar
@@ -45,6 +48,25 @@ void Render::display() {
                      | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoSavedSettings);
         auto bm = TextureManager::getBufferManager(TEXTURE_SPLASH, TextureStorage::SYSTEM);
         ImGui::Image(bm, ImVec2(Window::getSize().x, Window::getSize().y));
+
+        if (Game::isLoading()) {
+            // Progress bar with status text along the bottom of the splash screen
+            glm::vec2 size = Window::getSize();
+            ImVec2 a(size.x * 0.1f, size.y - 60.0f);
+            ImVec2 b(size.x * 0.9f, size.y - 40.0f);
+            ImVec2 c(a.x + ((b.x - a.x) * Game::getLoadProgress()), b.y);
+            ImGui::GetWindowDrawList()->AddRectFilled(a, b, ImColor(0.2f, 0.2f, 0.2f, 0.8f));
+            ImGui::GetWindowDrawList()->AddRectFilled(a, c, ImColor(0.9f, 0.9f, 0.9f, 0.8f));
+
+            ImGui::SetCursorPos(ImVec2(a.x, a.y - 30.0f));
+            ImGui::Text("%s (%d%%)", Game::getLoadStatus().c_str(),
+                        int(Game::getLoadProgress() * 100.0f));
+            ImGui::SetCursorPos(ImVec2(b.x - 60.0f, a.y - 30.0f));
+            if (ImGui::Button("Cancel##load")) {
+                Game::cancelLoading();
+            }
+        }
+
         ImGui::End();
         return;
     }
@@ -65,6 +87,15 @@ void Render::display() {
         buildRoomList(VP);
     }
 
+    // Room geometry and static models first, submitted together
+    bool batch = LevelBuffer::canDraw() || StaticModel::canDrawInstanced();
+    if (batch) {
+        for (int r = roomList.size() - 1; r >= 0; r--)
+            roomList.at(r).room->displayGeometry(VP, true);
+        LevelBuffer::draw();
+        Mesh::drawInstances();
+    }
+
     for (int r = roomList.size() - 1; r >= 0; r--) {
         auto& rl = roomList.at(r);
 
@@ -77,7 +108,7 @@ void Render::display() {
         //ImGui::Text("%.2f %.2f", rl.portalSize.x, rl.portalSize.y);
         //ImGui::Text("--");
 
-        rl.room->display(VP);
+        rl.room->display(VP, !batch);
 
         for (int i = 0; i < World::sizeEntity(); i++) {
             auto& e = World::getEntity(i);
@@ -343,6 +374,31 @@ void Render::displayUI() {
             Entity::setShowEntityModels(showEntityModels);
         }
 
+        bool drawRanges = Mesh::getDrawRanges();
+        if (ImGui::Checkbox("Static Draw Ranges##render", &drawRanges)) {
+            Mesh::setDrawRanges(drawRanges);
+        }
+        ImGui::SameLine();
+        bool textureArray = TextureManager::getTextureArray();
+        if (ImGui::Checkbox("Texture Array##render", &textureArray)) {
+            TextureManager::setTextureArray(textureArray);
+        }
+        bool levelBuffer = LevelBuffer::getEnabled();
+        if (ImGui::Checkbox("Level Buffer##render", &levelBuffer)) {
+            LevelBuffer::setEnabled(levelBuffer);
+        }
+        ImGui::SameLine();
+        ImGui::Text("%lu meshes in %d draws (%s)", LevelBuffer::getLastCommands(),
+                    LevelBuffer::getLastDrawCalls(),
+                    Shader::hasMultiDrawIndirect() ? "indirect" : "base vertex");
+        bool instanced = StaticModel::getInstanced();
+        if (ImGui::Checkbox("Instanced Models##render", &instanced)) {
+            StaticModel::setInstanced(instanced);
+        }
+        ImGui::SameLine();
+        ImGui::Text("%lu models in %lu draws, %lu without", Mesh::getLastInstances(),
+                    Mesh::getLastInstanceDraws(), Mesh::getLastDrawsWithoutInstancing());
+
         ImGui::Separator();
         if (ImGui::Button("New Splash##render")) {
             TextureManager::initializeSplash();
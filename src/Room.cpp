@@ -7,8 +7,12 @@
 
 #include "global.h"
 #include "Camera.h"
+#include "LevelBuffer.h"
 #include "Log.h"
 #include "Room.h"
+#include "TextureManager.h"
+#include "World.h"
+#include "system/Shader.h"
 
 #include "imgui/imgui.h"
 
@@ -26,20 +30,28 @@ Room::Room(glm::vec3 _pos, BoundingBox* _bbox, RoomMesh* _mesh, unsigned int f,
     model = glm::translate(glm::mat4(1.0f), pos);
 }
 
-void Room::display(glm::mat4 VP) {
-    if (showRoomGeometry) {
-        mesh->display(VP * model);
-    }
-
-    if (showRoomModels) {
-        for (auto& m : models) {
-            m->display(VP);
-        }
+void Room::display(glm::mat4 VP, bool geometry) {
+    if (geometry) {
+        displayGeometry(VP);
     }
 
     if (showRoomSprites) {
-        for (auto& s : sprites) {
-            s->display(VP);
+        if (TextureManager::useTextureArray()) {
+            // All sprites of this room in one draw, kept to reuse their memory
+            static std::vector<glm::vec3> vertices;
+            static std::vector<glm::vec2> uvs;
+            static std::vector<float> layers;
+            vertices.clear();
+            uvs.clear();
+            layers.clear();
+            for (auto& s : sprites)
+                s->appendBatch(vertices, uvs, layers);
+            if (vertices.size() > 0)
+                Shader::drawGLArray(vertices, uvs, layers, VP);
+        } else {
+            for (auto& s : sprites) {
+                s->display(VP);
+            }
         }
     }
 
@@ -54,11 +66,25 @@ void Room::display(glm::mat4 VP) {
     }
 }
 
+void Room::displayGeometry(glm::mat4 VP, bool batch) {
+    if (showRoomGeometry) {
+        // The level buffer already has the vertices of rooms in world space
+        if (!(batch && LevelBuffer::add(mesh->getLevelIndex(), VP)))
+            mesh->display(VP * model);
+    }
+
+    if (showRoomModels) {
+        for (auto& m : models) {
+            m->display(VP, batch);
+        }
+    }
+}
+
 bool Room::isWall(unsigned long sector) {
     orAssertLessThan(sector, sectors.size());
 
     //! \fixme is (sector > 0) correct??
-    return ((sector > 0) && sectors.at(sector)->isWall());
+    return ((sector > 0) && sectors.at(sector).isWall());
 }
 
 long Room::getSector(float x, float z, float* floor, float* ceiling) {
@@ -68,8 +94,8 @@ long Room::getSector(float x, float z, float* floor, float* ceiling) {
     long sector = getSector(x, z);
 
     if ((sector >= 0) && (sector < (long)sectors.size())) {
-        *floor = sectors.at(sector)->getFloor();
-        *ceiling = sectors.at(sector)->getCeiling();
+        *floor = sectors.at(sector).getFloor();
+        *ceiling = sectors.at(sector).getCeiling();
     }
 
     return sector;
@@ -88,7 +114,94 @@ long Room::getSector(float x, float z) {
 void Room::getHeightAtPosition(float x, float* y, float z) {
     long sector = getSector(x, z);
     if ((sector >= 0) && (sector < (long)sectors.size()))
-        *y = sectors.at(sector)->getFloor();
+        *y = sectors.at(sector).getFloor();
+}
+
+void Room::setSectors(std::vector<Sector>& s) {
+    orAssertEqual(s.size(), static_cast<unsigned long>(numXSectors * numZSectors));
+    sectors.swap(s);
+}
+
+// Limits portal chains, so broken levels can not loop forever
+const static int maxPortalSteps = 32;
+
+// Room with sectors behind a portal, or nullptr
+static Room* portalRoom(unsigned int index) {
+    if (index >= World::sizeRoom())
+        return nullptr;
+    Room& r = World::getRoom(index);
+    return (r.sizeSectors() > 0) ? &r : nullptr;
+}
+
+void Room::heightsAt(const glm::vec3* points, SectorHeight* out, unsigned long n) {
+    FloorData& floorData = World::getFloorData();
+
+    for (unsigned long i = 0; i < n; i++) {
+        const glm::vec3& p = points[i];
+        SectorHeight& h = out[i];
+
+        if (sectors.empty()) {
+            h.floor = h.ceiling = p.y;
+            h.room = h.floorRoom = h.ceilingRoom = -1;
+            h.info = 0;
+            h.wall = true;
+            continue;
+        }
+
+        // Move the point through wall portals of border sectors, then through
+        // floor and ceiling portals into its room.
+        // y grows downward, so below the floor means a larger value.
+        Room* room = this;
+        const Sector* s = &sectorAt(p.x, p.z);
+        for (int step = 0; step < maxPortalSteps; step++) {
+            Room* next = nullptr;
+            uint16_t portal = floorData.getInfo(s->floorData).portal;
+            if (portal != FloorData::noPortal)
+                next = portalRoom(portal);
+            else if ((p.y > s->floor) && (s->roomBelow != Sector::noRoom))
+                next = portalRoom(s->roomBelow);
+            else if ((p.y < s->ceiling) && (s->roomAbove != Sector::noRoom))
+                next = portalRoom(s->roomAbove);
+
+            if (next == nullptr)
+                break;
+            room = next;
+            s = &room->sectorAt(p.x, p.z);
+        }
+
+        h.room = room->roomIndex;
+        h.wall = s->isWall();
+
+        // The solid floor may be further down, the sector could be a floor portal
+        const Sector* f = s;
+        Room* floorRoom = room;
+        for (int step = 0; (step < maxPortalSteps) && (f->roomBelow != Sector::noRoom); step++) {
+            Room* next = portalRoom(f->roomBelow);
+            if (next == nullptr)
+                break;
+            floorRoom = next;
+            f = &floorRoom->sectorAt(p.x, p.z);
+        }
+
+        // Triggers and slopes belong to the sector with the solid floor
+        const FloorData::Info& info = floorData.getInfo(f->floorData);
+        int x = static_cast<int>(p.x), z = static_cast<int>(p.z);
+        h.floor = FloorData::floorHeight(info, f->floor, x, z);
+        h.floorRoom = floorRoom->roomIndex;
+        h.info = f->floorData;
+
+        const Sector* c = s;
+        Room* ceilingRoom = room;
+        for (int step = 0; (step < maxPortalSteps) && (c->roomAbove != Sector::noRoom); step++) {
+            Room* next = portalRoom(c->roomAbove);
+            if (next == nullptr)
+                break;
+            ceilingRoom = next;
+            c = &ceilingRoom->sectorAt(p.x, p.z);
+        }
+        h.ceiling = FloorData::ceilingHeight(floorData.getInfo(c->floorData), c->ceiling, x, z);
+        h.ceilingRoom = ceilingRoom->roomIndex;
+    }
 }
 
 int Room::getAdjoiningRoom(float x, float y, float z,
@@ -7,6 +7,7 @@
 
 #include "global.h"
 #include "Camera.h"
+#include "TextureManager.h"
 #include "World.h"
 #include "system/Shader.h"
 #include "RoomData.h"
@@ -15,6 +16,8 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+bool StaticModel::instanced = true;
+
 StaticModel::StaticModel(glm::vec3 pos, float angle, int i) : id(i), cache(-1) {
     glm::mat4 translate = glm::translate(glm::mat4(1.0f), pos);
     glm::mat4 rotate = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f));
@@ -49,9 +52,13 @@ void StaticModel::displayBoundingSphere(glm::mat4 VP, glm::vec3 color) {
     World::getStaticMesh(cache).getBoundingSphere().display(VP * model, color);
 }
 
-void StaticModel::display(glm::mat4 VP) {
+void StaticModel::display(glm::mat4 VP, bool batch) {
     find();
-    World::getStaticMesh(cache).display(VP * model);
+    World::getStaticMesh(cache).display(VP * model, batch, batch && canDrawInstanced());
+}
+
+bool StaticModel::canDrawInstanced() {
+    return instanced && TextureManager::useTextureArray();
 }
 
 void StaticModel::displayUI() {
@@ -82,6 +89,14 @@ void RoomSprite::display(glm::mat4 VP) {
     World::getSprite(sprite).display(VP * (translate * rotate));
 }
 
+void RoomSprite::appendBatch(std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs,
+                             std::vector<float>& layers) {
+    glm::mat4 translate = glm::translate(glm::mat4(1.0f), pos);
+    glm::mat4 rotate = glm::rotate(glm::mat4(1.0f), -Camera::getRotation().x,
+                                   glm::vec3(0.0f, 1.0f, 0.0f));
+    World::getSprite(sprite).appendBatch(translate * rotate, vertices, uvs, layers);
+}
+
 void RoomSprite::displayUI() {
     ImGui::Text("Sprite %d", sprite);
 }
@@ -112,15 +127,6 @@ void Portal::displayUI() {
 
 // ----------------------------------------------------------------------------
 
-float Sector::getFloor() {
-    return floor;
-}
-
-float Sector::getCeiling() {
-    return ceiling;
-}
-
-bool Sector::isWall() {
-    return wall;
-}
+const uint8_t Sector::noRoom;
+const uint16_t Sector::noBox;
 
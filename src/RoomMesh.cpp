@@ -12,7 +12,7 @@
 
 RoomMesh::RoomMesh(const std::vector<RoomVertexTR2>& vert,
                    const std::vector<IndexedRectangle>& rect,
-                   const std::vector<IndexedRectangle>& tri) {
+                   const std::vector<IndexedRectangle>& tri) : uploaded(false), levelIndex(-1) {
     for (auto& t : rect) {
         indicesBuff.push_back(0);
         verticesBuff.push_back(glm::vec3(vert.at(t.v1).x, vert.at(t.v1).y, vert.at(t.v1).z));
@@ -63,15 +63,39 @@ void RoomMesh::prepare() {
     orAssertEqual(vert.size(), tex.size());
     orAssertEqual(vert.size(), uvsBuff.size());
 
+    sortTrianglesByTexture(ind, tex);
+
     indicesBuff = std::move(ind);
     verticesBuff = std::move(vert);
     texturesBuff = std::move(tex);
 }
 
-void RoomMesh::display(glm::mat4 MVP) {
+// Runs on the main thread, like Mesh::upload()
+void RoomMesh::upload() {
+    if (uploaded)
+        return;
+
     if (indicesBuff.size() > 0) {
-        Shader::drawGLBuffer(verticesBuff, uvsBuff);
+        buffers.upload(verticesBuff, uvsBuff, indicesBuff);
+        ranges = findDrawRanges(indicesBuff, texturesBuff);
+        buffers.uploadLayers(std::vector<float>(texturesBuff.begin(), texturesBuff.end()));
+    }
+
+    std::vector<glm::vec3>().swap(verticesBuff);
+    std::vector<glm::vec2>().swap(uvsBuff);
+    uploaded = true;
+}
+
+void RoomMesh::display(glm::mat4 MVP) {
+    upload();
 
+    if (TextureManager::useTextureArray()) {
+        if (buffers.isUploaded())
+            Shader::drawGLArray(buffers, MVP);
+    } else if (Mesh::getDrawRanges()) {
+        for (auto& r : ranges)
+            Shader::drawGL(buffers, r.first, r.count, MVP, r.texture, TextureStorage::GAME);
+    } else if (indicesBuff.size() > 0) {
         for (int i = 0; i < TextureManager::numTextures(TextureStorage::GAME); i++) {
             std::vector<unsigned short> indices;
             for (int n = 0; n < indicesBuff.size(); n++) {
@@ -80,8 +104,18 @@ void RoomMesh::display(glm::mat4 MVP) {
                 }
             }
 
-            Shader::drawGLOnly(indices, MVP, i, TextureStorage::GAME);
+            if (indices.size() > 0)
+                Shader::drawGL(buffers, indices, MVP, i, TextureStorage::GAME);
         }
     }
 }
 
+unsigned long RoomMesh::getMemorySize() {
+    return (indicesBuff.size() * sizeof(unsigned short))
+           + (verticesBuff.size() * sizeof(glm::vec3))
+           + (uvsBuff.size() * sizeof(glm::vec2))
+           + (texturesBuff.size() * sizeof(unsigned int))
+           + (ranges.size() * sizeof(MeshDrawRange))
+           + buffers.getMemorySize();
+}
+
@@ -8,6 +8,7 @@
 #include "imgui/imgui.h"
 
 #include "global.h"
+#include "LevelCache.h"
 #include "system/Sound.h"
 #include "system/Window.h"
 #include "utils/strings.h"
@@ -20,7 +21,9 @@ std::string RunTime::audioDir;
 std::string RunTime::dataDir;
 KeyboardButton RunTime::keyBindings[ActionEventCount];
 bool RunTime::gameIsRunning = false;
+bool RunTime::headless = false;
 bool RunTime::showFPS = false;
+bool RunTime::hashMeshes = true;
 unsigned long RunTime::lastTime = 0;
 unsigned long RunTime::lastFrameTime = 0;
 unsigned long RunTime::frameCount = 0;
@@ -99,6 +102,13 @@ void RunTime::display() {
         if (ImGui::Checkbox("Fullscreen##runtime", &fullscreen)) {
             Window::setFullscreen(fullscreen);
         }
+        ImGui::SameLine();
+        bool cache = LevelCache::getEnabled();
+        if (ImGui::Checkbox("Level Cache##runtime", &cache)) {
+            LevelCache::setEnabled(cache);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Mesh Hashing##runtime", &hashMeshes);
 
         float vol = Sound::getVolume();
         if (ImGui::SliderFloat("Volume##runtime", &vol, 0.0f, 1.0f)) {
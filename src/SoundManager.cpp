@@ -11,36 +11,58 @@
 #include "Camera.h"
 #include "Log.h"
 #include "system/Sound.h"
+#include "utils/binary.h"
 #include "SoundManager.h"
 
+// A bit beyond the 15 sectors a source can be heard
+const static float prefetchDistance = 1024.0f * 20.0f;
+const static unsigned long defaultMemoryBudget = 16 * 1024 * 1024;
+
 void SoundSource::prepare() {
-    if (source != -1)
+    if (source == -2)
         return;
 
     float vol;
     int index = SoundManager::getIndex(id, &vol);
-    if ((index < 0) || (index > Sound::numBuffers())) {
+    if ((index < 0) || (index >= SoundManager::sizeSamples())) {
         Log::get(LOG_ERROR) << "Invalid SoundSource ID (" << index << ", "
-                            << Sound::numBuffers() << ")!" << Log::endl;
+                            << SoundManager::sizeSamples() << ")!" << Log::endl;
         source = -2;
-    } else {
-        source = Sound::addSource(index, vol, false, true);
-        if (source < 0) {
-            source = -2;
-        } else {
-            int ret = Sound::sourceAt(source, pos);
-            if (ret < 0) {
-                Log::get(LOG_ERROR) << "Error positioning SoundSource " << id << Log::endl;
-            }
+        return;
+    }
+
+    bool created = (source == -1);
+    if (SoundManager::bindSample(index, source, vol, false, true) != 0) {
+        source = -2;
+        return;
+    }
+
+    if (created) {
+        int ret = Sound::sourceAt(source, pos);
+        if (ret < 0) {
+            Log::get(LOG_ERROR) << "Error positioning SoundSource " << id << Log::endl;
         }
     }
+
+    active = true;
+    if (playing && (!Sound::isPlaying(source, false)))
+        Sound::play(source, false);
+}
+
+void SoundSource::release() {
+    active = false;
+
+    // Not playing anymore, so the sample can be evicted
+    if (source >= 0)
+        Sound::stop(source);
 }
 
 void SoundSource::play() {
     playing = true;
 
-    if (source >= 0)
-        Sound::play(source, false);
+    // The sample could have been evicted while stopped
+    if (active)
+        prepare();
 }
 
 void SoundSource::stop() {
@@ -56,6 +78,11 @@ std::vector<SoundSource> SoundManager::soundSources;
 std::vector<int> SoundManager::soundMap;
 std::vector<SoundDetail> SoundManager::soundDetails;
 std::vector<int> SoundManager::sampleIndices;
+std::vector<std::unique_ptr<BinaryMapped>> SoundManager::sampleFiles;
+std::vector<SoundManager::Sample> SoundManager::samples;
+unsigned long SoundManager::memoryBudget = defaultMemoryBudget;
+unsigned long SoundManager::bufferMemory = 0;
+unsigned long SoundManager::useCounter = 0;
 
 void SoundManager::clear() {
     soundSources.clear();
@@ -63,27 +90,25 @@ void SoundManager::clear() {
     soundDetails.clear();
     sampleIndices.clear();
 
+    // Deletes all sources and buffers, before the mappings go away
     Sound::clear();
+
+    samples.clear();
+    sampleFiles.clear();
+    bufferMemory = 0;
+    useCounter = 0;
 }
 
 int SoundManager::prepareSources() {
-    for (int i = 0; i < soundMap.size(); i++) {
-        float vol;
-        SoundDetail* sd;
-        int index = getIndex(i, &vol, &sd);
-        if ((index >= 0) && (index < Sound::numBuffers())) {
-            int ret = Sound::addSource(index, vol, true, false);
-            if (ret < 0) {
-                Log::get(LOG_ERROR) << "Error adding SoundSource " << index << Log::endl;
-            }
-            sd->setSource(ret);
-        }
-    }
+    // Started once the camera comes close, see listenAt()
+    for (auto& s : soundSources)
+        s.play();
 
-    for (int i = 0; i < soundSources.size(); i++) {
-        soundSources.at(i).prepare();
-        soundSources.at(i).play();
-    }
+    unsigned long size = 0;
+    for (auto& s : samples)
+        size += s.length;
+    Log::get(LOG_DEBUG) << "SoundManager: " << samples.size() << " samples (" << size
+                        << " bytes) indexed, " << soundSources.size() << " sources" << Log::endl;
 
     return 0;
 }
@@ -104,6 +129,36 @@ void SoundManager::addSampleIndex(int index) {
     sampleIndices.push_back(index);
 }
 
+int SoundManager::addSampleFile(std::string f) {
+    std::unique_ptr<BinaryMapped> file(new BinaryMapped());
+    if (file->open(f) != 0)
+        return -1;
+
+    sampleFiles.push_back(std::move(file));
+    return sampleFiles.size() - 1;
+}
+
+const char* SoundManager::getSampleFile(unsigned int file, long long* size) {
+    orAssertLessThan(file, sampleFiles.size());
+    if (size != nullptr)
+        *size = sampleFiles.at(file)->size();
+    return sampleFiles.at(file)->pointer(0);
+}
+
+void SoundManager::addSample(unsigned int file, long long offset, uint32_t length) {
+    orAssertLessThan(file, sampleFiles.size());
+    orAssertLessThanEqual(offset + length, sampleFiles.at(file)->size());
+    samples.emplace_back(file, offset, length);
+}
+
+const char* SoundManager::getSample(unsigned long sample, uint32_t* length) {
+    orAssertLessThan(sample, samples.size());
+    Sample& s = samples.at(sample);
+    if (length != nullptr)
+        *length = s.length;
+    return sampleFiles.at(s.file)->pointer(s.offset);
+}
+
 int SoundManager::getIndex(int index, float* volume, SoundDetail** sd) {
     if (index <= -1)
         return -1;
@@ -143,18 +198,141 @@ int SoundManager::getIndex(int index, float* volume, SoundDetail** sd) {
 
 int SoundManager::playSound(int index) {
     if ((index >= 0) && (index < soundMap.size())) {
+        float vol;
         SoundDetail* sd;
-        int i = getIndex(index, nullptr, &sd);
-        if ((i < 0) || (i >= Sound::numBuffers()))
+        int i = getIndex(index, &vol, &sd);
+        if ((i < 0) || (i >= samples.size()))
             return -2;
 
-        Sound::play(sd->getSource(), true);
+        // Nothing would be heard, so don't load anything
+        if (!Sound::getEnabled())
+            return 0;
+
+        int source = sd->getSource();
+        if (bindSample(i, source, vol, true, false) != 0)
+            return -3;
+
+        sd->setSource(source);
+        Sound::play(source, true);
         return 0;
     } else {
         return -1;
     }
 }
 
+int SoundManager::bindSample(int sample, int& source, float volume, bool atListener, bool loop) {
+    int buffer = loadSample(sample);
+    if (buffer < 0)
+        return -1;
+
+    Sample& s = samples.at(sample);
+    if (source < 0) {
+        source = Sound::addSource(buffer, volume, atListener, loop);
+        if (source < 0) {
+            Log::get(LOG_ERROR) << "Error adding SoundSource for sample " << sample << Log::endl;
+            source = -1;
+            return -2;
+        }
+    } else {
+        for (auto& u : s.users) {
+            if ((u.first == source) && (u.second == atListener))
+                return 0; // Still bound
+        }
+
+        if (Sound::sourceBuffer(source, buffer, atListener) != 0)
+            return -3;
+    }
+
+    s.users.emplace_back(source, atListener);
+    return 0;
+}
+
+int SoundManager::loadSample(unsigned long sample) {
+    if (sample >= samples.size())
+        return -1;
+
+    Sample& s = samples.at(sample);
+    s.lastUse = ++useCounter;
+    if (s.buffer >= 0)
+        return s.buffer;
+
+    evictSamples(s.length);
+
+    const char* data = sampleFiles.at(s.file)->pointer(s.offset);
+    s.buffer = Sound::loadBuffer(reinterpret_cast<const unsigned char*>(data), s.length);
+    if (s.buffer < 0) {
+        Log::get(LOG_ERROR) << "Error loading sample " << sample << Log::endl;
+        s.buffer = -1;
+        return -2;
+    }
+
+    bufferMemory += s.length;
+    return s.buffer;
+}
+
+void SoundManager::unloadSample(unsigned long sample) {
+    Sample& s = samples.at(sample);
+    if (s.buffer < 0)
+        return;
+
+    for (auto& u : s.users)
+        Sound::sourceBuffer(u.first, -1, u.second);
+    s.users.clear();
+
+    Sound::deleteBuffer(s.buffer);
+    s.buffer = -1;
+    bufferMemory -= s.length;
+}
+
+void SoundManager::evictSamples(unsigned long needed) {
+    while ((bufferMemory + needed) > memoryBudget) {
+        long oldest = -1;
+        for (unsigned long i = 0; i < samples.size(); i++) {
+            Sample& s = samples.at(i);
+            if ((s.buffer < 0) || ((oldest >= 0) && (s.lastUse >= samples.at(oldest).lastUse)))
+                continue;
+
+            bool idle = true;
+            for (auto& u : s.users) {
+                if (Sound::isPlaying(u.first, u.second)) {
+                    idle = false;
+                    break;
+                }
+            }
+
+            if (idle)
+                oldest = i;
+        }
+
+        // Everything loaded is playing, go over the budget for now
+        if (oldest < 0)
+            break;
+
+        unloadSample(oldest);
+    }
+}
+
+void SoundManager::setMemoryBudget(unsigned long bytes) {
+    memoryBudget = bytes;
+    evictSamples(0);
+}
+
+void SoundManager::listenAt(glm::vec3 pos, glm::vec3 at, glm::vec3 up) {
+    Sound::listenAt(pos, at, up);
+
+    // Nothing would be heard, so don't load anything
+    if (!Sound::getEnabled())
+        return;
+
+    for (auto& s : soundSources) {
+        bool near = glm::distance(s.getPos(), pos) < prefetchDistance;
+        if (near && (!s.isActive()))
+            s.prepare();
+        else if ((!near) && s.isActive())
+            s.release();
+    }
+}
+
 void SoundManager::display() {
     if (ImGui::CollapsingHeader("Sound Sources")) {
         ImGui::Columns(5, "soundsources");
@@ -247,9 +425,14 @@ void SoundManager::display() {
             }
             ImGui::NextColumn();
             ImGui::PushID(i);
-            if (sd.getSource() >= 0) {
+            if ((sd.getSample() >= 0) && (sd.getSample() < sampleIndices.size())) {
                 if (ImGui::Button("Play")) {
-                    Sound::play(sd.getSource(), true);
+                    int source = sd.getSource();
+                    if (bindSample(sampleIndices.at(sd.getSample()), source, sd.getVolume(),
+                                   true, false) == 0) {
+                        sd.setSource(source);
+                        Sound::play(source, true);
+                    }
                 }
             }
             ImGui::PopID();
@@ -266,11 +449,19 @@ void SoundManager::display() {
                 Sound::setEnabled(true);
             }
             return;
-        } else if (Sound::numBuffers() == 0) {
-            ImGui::Text("No Sounds currently loaded!");
+        } else if (samples.size() == 0) {
+            ImGui::Text("No Sounds in this level!");
             return;
         }
 
+        unsigned long loaded = 0;
+        for (auto& s : samples) {
+            if (s.buffer >= 0)
+                loaded++;
+        }
+        ImGui::Text("%lu of %lu samples loaded, %lu of %lu KB", loaded, samples.size(),
+                    bufferMemory / 1024, memoryBudget / 1024);
+
         static int index = 0;
         ImGui::Text("Map");
         ImGui::SameLine();
@@ -59,6 +59,14 @@ void Sprite::display(glm::mat4 MVP) {
     Shader::drawGL(vertexBuff, uvBuff, MVP, texture, TextureStorage::GAME);
 }
 
+void Sprite::appendBatch(glm::mat4 model, std::vector<glm::vec3>& vertices,
+                         std::vector<glm::vec2>& uvs, std::vector<float>& layers) {
+    for (auto& v : vertexBuff)
+        vertices.emplace_back(model * glm::vec4(v, 1.0f));
+    uvs.insert(uvs.end(), uvBuff.begin(), uvBuff.end());
+    layers.insert(layers.end(), uvBuff.size(), float(texture));
+}
+
 // ----------------------------------------------------------------------------
 
 void SpriteSequence::display(glm::mat4 MVP, int index) {
@@ -17,8 +17,13 @@ BoundingSphere& StaticMesh::getBoundingSphere() {
     return World::getMesh(mesh).getBoundingSphere();
 }
 
-void StaticMesh::display(glm::mat4 MVP) {
-    World::getMesh(mesh).display(MVP);
+void StaticMesh::display(glm::mat4 MVP, bool batch, bool instanced) {
+    if (instanced)
+        World::getMesh(mesh).displayInstanced(MVP);
+    else if (batch)
+        World::getMesh(mesh).displayBatched(MVP);
+    else
+        World::getMesh(mesh).display(MVP);
 
     if (showBoundingBox) {
         bbox1->display(MVP, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
@@ -6,19 +6,24 @@
  * \author xythobuz
  */
 
+#include <memory>
+
 #include "imgui/imgui.h"
 #include "stb/stb_image.h"
 
 #include "global.h"
 #include "Game.h"
 #include "Log.h"
+#include "Render.h"
 #include "RunTime.h"
 #include "World.h"
-#include "utils/Folder.h"
+#include "utils/FolderIndex.h"
 #include "utils/pcx.h"
 #include "utils/pixel.h"
 #include "utils/random.h"
 #include "utils/strings.h"
+#include "utils/ThreadPool.h"
+#include "system/Shader.h"
 #include "TextureManager.h"
 
 #include <glbinding/gl/gl.h>
@@ -49,6 +54,10 @@ glm::vec2 TextureTile::getUV(unsigned int i) {
 
 #define COLOR_PALETTE_SIZE 256
 
+// All TR texture pages have this size, with mipmaps down to 1x1
+const static unsigned int arraySize = 256;
+const static unsigned int arrayLevels = 9;
+
 std::vector<unsigned int> TextureManager::mTextureIdsGame;
 std::vector<unsigned int> TextureManager::mTextureIdsSystem;
 std::vector<TextureTile*> TextureManager::tiles;
@@ -60,11 +69,20 @@ std::vector<BufferManager> TextureManager::gameBuffers;
 std::vector<BufferManager> TextureManager::systemBuffers;
 std::array<glm::vec4, 256> TextureManager::colorPalette;
 std::vector<std::tuple<unsigned char*, unsigned int, unsigned int>> TextureManager::indexedTextures;
+unsigned int TextureManager::textureArray = 0;
+int TextureManager::textureArrayUnit = -1;
+std::vector<bool> TextureManager::textureArrayLayers;
+bool TextureManager::useArray = true;
+bool TextureManager::hasContext = false;
 
 int TextureManager::initialize() {
     orAssertEqual(mTextureIdsGame.size(), 0);
     orAssertEqual(mTextureIdsSystem.size(), 0);
 
+    hasContext = true;
+
+    Log::get(LOG_DEBUG) << "Pixel kernels: " << pixelSIMDName(pixelGetSIMD()) << Log::endl;
+
     while (mTextureIdsSystem.size() < 2) {
         unsigned int id;
         gl::glGenTextures(1, &id);
@@ -83,13 +101,11 @@ int TextureManager::initialize() {
 }
 
 int TextureManager::initializeSplash() {
-    Folder f(RunTime::getPakDir());
+    // Kept between calls, a new splash only walks the pak folder again if it changed
+    static FolderIndex pakFolder;
+    pakFolder.setFolder(RunTime::getPakDir());
     std::vector<File> files;
-    f.findRecursiveFilesEndingWith(files, ".pcx");
-    f.findRecursiveFilesEndingWith(files, ".bmp");
-    f.findRecursiveFilesEndingWith(files, ".png");
-    f.findRecursiveFilesEndingWith(files, ".tga");
-    f.findRecursiveFilesEndingWith(files, ".jpg");
+    pakFolder.find(files, { ".pcx", ".bmp", ".png", ".tga", ".jpg" });
     if (files.size() == 0) {
         if (loadImage(RunTime::getDataDir() + "/splash.tga", TextureStorage::SYSTEM, TEXTURE_SPLASH) < 0) {
             return -2;
@@ -117,15 +133,24 @@ void TextureManager::shutdown() {
     systemBuffers.clear();
 
     clear();
+    hasContext = false;
 }
 
 void TextureManager::clear() {
     while (mTextureIdsGame.size() > 0) {
         unsigned int id = mTextureIdsGame.at(mTextureIdsGame.size() - 1);
-        gl::glDeleteTextures(1, &id);
+        if (hasContext)
+            gl::glDeleteTextures(1, &id);
         mTextureIdsGame.pop_back();
     }
 
+    if (textureArray != 0) {
+        gl::glDeleteTextures(1, &textureArray);
+        textureArray = 0;
+    }
+    textureArrayUnit = -1;
+    textureArrayLayers.clear();
+
     while (!tiles.empty()) {
         delete tiles.at(tiles.size() - 1);
         tiles.pop_back();
@@ -156,6 +181,13 @@ int TextureManager::loadBufferSlot(unsigned char* image,
     if (slot < 0)
         slot = getIds(s).size();
 
+    if (!hasContext) {
+        // Only keep track of the slots
+        while (getIds(s).size() <= slot)
+            getIds(s).push_back(0);
+        return slot;
+    }
+
     while (getIds(s).size() <= slot) {
         unsigned int id;
         gl::glGenTextures(1, &id);
@@ -205,6 +237,15 @@ int TextureManager::loadBufferSlot(unsigned char* image,
         gl::glTexParameteri(gl::GL_TEXTURE_2D, gl::GL_TEXTURE_MAG_FILTER, gl::GLint(gl::GL_NEAREST));
     }
 
+    // The reserved array layer gets the same data, so it never has to be read back
+    if ((s == TextureStorage::GAME) && (slot < textureArrayLayers.size()) && (image != nullptr)
+        && (width == arraySize) && (height == arraySize)) {
+        bindTextureArray();
+        gl::glTexSubImage3D(gl::GL_TEXTURE_2D_ARRAY, 0, 0, 0, slot, arraySize, arraySize, 1,
+                            glcMode, gl::GL_UNSIGNED_BYTE, image);
+        textureArrayLayers.at(slot) = true;
+    }
+
     return slot;
 }
 
@@ -241,6 +282,30 @@ unsigned int TextureManager::getTextureID(int n, TextureStorage s) {
     return getIds(s).at(n);
 }
 
+int TextureManager::getTextureData(unsigned int n, TextureStorage s,
+                                   std::vector<unsigned char>& image,
+                                   unsigned int* width, unsigned int* height) {
+    orAssertLessThan(n, getIds(s).size());
+    orAssert(width != nullptr);
+    orAssert(height != nullptr);
+
+    bindTexture(n, s);
+
+    gl::GLint w = 0, h = 0;
+    gl::glGetTexLevelParameteriv(gl::GL_TEXTURE_2D, 0, gl::GL_TEXTURE_WIDTH, &w);
+    gl::glGetTexLevelParameteriv(gl::GL_TEXTURE_2D, 0, gl::GL_TEXTURE_HEIGHT, &h);
+    if ((w <= 0) || (h <= 0))
+        return -1;
+
+    image.resize(w * h * 4);
+    gl::glPixelStorei(gl::GL_PACK_ALIGNMENT, 1);
+    gl::glGetTexImage(gl::GL_TEXTURE_2D, 0, gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, &image[0]);
+
+    *width = w;
+    *height = h;
+    return 0;
+}
+
 void TextureManager::addTile(TextureTile* t) {
     tiles.push_back(t);
 }
@@ -324,22 +389,99 @@ void TextureManager::addIndexedTexture(unsigned char* image, unsigned int width,
 }
 
 void TextureManager::prepare() {
+    // Converted once, the same truncation as before, then expanded as bytes
+    unsigned char palette[COLOR_PALETTE_SIZE * 4];
+    for (int i = 0; i < COLOR_PALETTE_SIZE; i++) {
+        palette[i * 4] = static_cast<unsigned char>(colorPalette[i].x * 255);
+        palette[(i * 4) + 1] = static_cast<unsigned char>(colorPalette[i].y * 255);
+        palette[(i * 4) + 2] = static_cast<unsigned char>(colorPalette[i].z * 255);
+        palette[(i * 4) + 3] = static_cast<unsigned char>(colorPalette[i].w * 255);
+    }
+
+    reserveTextureArray(indexedTextures.size());
     for (int i = 0; i < indexedTextures.size(); i++) {
         auto tex = indexedTextures.at(i);
         unsigned char* img = std::get<0>(tex);
         unsigned int width = std::get<1>(tex);
         unsigned int height = std::get<2>(tex);
         unsigned char* image = new unsigned char[width * height * 4];
-        for (unsigned int j = 0; j < (width * height); j++) {
-            auto col = getPalette(img[j]);
-            image[j * 4] = static_cast<unsigned char>(col.x * 255);
-            image[(j * 4) + 1] = static_cast<unsigned char>(col.y * 255);
-            image[(j * 4) + 2] = static_cast<unsigned char>(col.z * 255);
-            image[(j * 4) + 3] = static_cast<unsigned char>(col.w * 255);
-        }
+        palette2rgba32(img, palette, image, width, height);
         delete [] img;
         loadBufferSlot(image, width, height, ColorMode::RGBA, 32, TextureStorage::GAME, i, true);
+        delete [] image;
+    }
+}
+
+void TextureManager::reserveTextureArray(unsigned int layers) {
+    if ((!hasContext) || (layers == 0))
+        return;
+
+    if (textureArray == 0) {
+        gl::glGenTextures(1, &textureArray);
+        textureArrayUnit = nextFreeTextureUnit++;
     }
+    bindTextureArray();
+
+    // glTexStorage3D() is core since 4.2, but the context only asks for 3.3
+    if (Shader::isVersionAtLeast(4, 2) || Shader::hasExtension("GL_ARB_texture_storage")) {
+        // Immutable storage can't be resized, so a new array is needed every time
+        if (textureArrayLayers.size() > 0) {
+            gl::glDeleteTextures(1, &textureArray);
+            gl::glGenTextures(1, &textureArray);
+            bindTextureArray();
+        }
+        gl::glTexStorage3D(gl::GL_TEXTURE_2D_ARRAY, arrayLevels, gl::GL_RGBA8, arraySize,
+                           arraySize, layers);
+    } else {
+        gl::glTexImage3D(gl::GL_TEXTURE_2D_ARRAY, 0, gl::GLint(gl::GL_RGBA8), arraySize, arraySize,
+                         layers, 0, gl::GL_RGBA, gl::GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    textureArrayLayers.assign(layers, false);
+}
+
+int TextureManager::buildTextureArray() {
+    if ((!hasContext) || (textureArray == 0))
+        return 0;
+
+    // The 2D textures stay, for the texture viewers, the level cache and comparisons
+    unsigned int layers = numTextures(TextureStorage::GAME);
+    for (unsigned int i = 0; i < layers; i++) {
+        if ((i >= textureArrayLayers.size()) || (!textureArrayLayers.at(i))) {
+            Log::get(LOG_WARNING) << "Texture " << i << " is not " << arraySize << "x" << arraySize
+                                  << ", not using a texture array" << Log::endl;
+            gl::glDeleteTextures(1, &textureArray);
+            textureArray = 0;
+            textureArrayLayers.clear();
+            return -1;
+        }
+    }
+
+    // Same trilinear filtering as the GAME textures in loadBufferSlot()
+    bindTextureArray();
+    gl::glTexParameteri(gl::GL_TEXTURE_2D_ARRAY, gl::GL_TEXTURE_WRAP_S, gl::GLint(gl::GL_REPEAT));
+    gl::glTexParameteri(gl::GL_TEXTURE_2D_ARRAY, gl::GL_TEXTURE_WRAP_T, gl::GLint(gl::GL_REPEAT));
+    gl::glTexParameteri(gl::GL_TEXTURE_2D_ARRAY, gl::GL_TEXTURE_MAG_FILTER, gl::GLint(gl::GL_LINEAR));
+    gl::glTexParameteri(gl::GL_TEXTURE_2D_ARRAY, gl::GL_TEXTURE_MIN_FILTER,
+                        gl::GLint(gl::GL_LINEAR_MIPMAP_LINEAR));
+    gl::glGenerateMipmap(gl::GL_TEXTURE_2D_ARRAY);
+
+    Log::get(LOG_DEBUG) << "Texture array with " << layers << " layers" << Log::endl;
+    return 0;
+}
+
+int TextureManager::bindTextureArray() {
+    orAssert(textureArray != 0);
+    orAssertLessThan(textureArrayUnit, 80); //! \fixme Query GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS
+
+    gl::glActiveTexture(gl::GL_TEXTURE0 + textureArrayUnit);
+    gl::glBindTexture(gl::GL_TEXTURE_2D_ARRAY, textureArray);
+    return textureArrayUnit;
+}
+
+bool TextureManager::useTextureArray() {
+    // Solid mode replaces every GAME texture with the splash, which is not in the array
+    return useArray && (textureArray != 0) && (Render::getMode() != RenderMode::Solid);
 }
 
 int TextureManager::loadImage(std::string filename, TextureStorage s, int slot) {
@@ -367,28 +509,27 @@ int TextureManager::loadImage(std::string filename, TextureStorage s, int slot)
 }
 
 int TextureManager::loadPCX(std::string filename, TextureStorage s, int slot) {
-    int error = pcxCheck(filename.c_str());
-    if (!error) {
-        unsigned char* image;
-        unsigned int w, h, bpp;
-        ColorMode c;
-
-        error = pcxLoad(filename.c_str(), &image, &w, &h, &c, &bpp);
-        if (!error) {
-            unsigned char* image2 = scaleBuffer(image, &w, &h, bpp);
-            if (image2) {
-                delete [] image;
-                image = image2;
-            }
-            int id = loadBufferSlot(image, w, h, c, bpp, s, slot);
-            delete [] image;
-            return id;
-        }
-
-        return -5;
+    unsigned char* image;
+    unsigned int w, h, bpp;
+    ColorMode c;
+
+    // Invalid headers are -1 to -8, broken image data is -9
+    int error = pcxLoad(filename.c_str(), &image, &w, &h, &c, &bpp);
+    if (error != 0)
+        return (error > -9) ? -4 : -5;
+
+    // Big pictures, like title screens, are resampled on all cores
+    std::unique_ptr<ThreadPool> pool;
+    if ((w * h) >= (256 * 256))
+        pool.reset(new ThreadPool());
+    unsigned char* image2 = scaleBuffer(image, &w, &h, bpp, pool.get());
+    if (image2) {
+        delete [] image;
+        image = image2;
     }
-
-    return -4;
+    int id = loadBufferSlot(image, w, h, c, bpp, s, slot);
+    delete [] image;
+    return id;
 }
 
 std::vector<unsigned int>& TextureManager::getIds(TextureStorage s) {
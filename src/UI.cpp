@@ -19,6 +19,7 @@
 #include "SoundManager.h"
 #include "TextureManager.h"
 #include "World.h"
+#include "system/Shader.h"
 #include "system/Sound.h"
 #include "system/Window.h"
 #include "utils/time.h"
@@ -259,6 +260,8 @@ void UI::display() {
 #ifdef DEBUG
             ImGui::SameLine();
             ImGui::Text("%lu CPF", RunTime::getCallCount());
+            ImGui::SameLine();
+            ImGui::Text("%lu KB/F", ShaderBuffer::getUploadedBytes() / 1024);
 #endif
 
             ImGui::Text("X: %.1f (%.2f)", Camera::getPosition().x, Camera::getRotation().x);
@@ -296,9 +299,13 @@ void UI::display() {
 
         Render::displayUI();
         RunTime::display();
-        World::displayUI();
-        SoundManager::display();
-        TextureManager::display();
+
+        // These are still being filled by the loader thread
+        if (!Game::isLoading()) {
+            World::displayUI();
+            SoundManager::display();
+            TextureManager::display();
+        }
 
         if (ImGui::CollapsingHeader("Library Versions")) {
             ImGui::TextWrapped("%s", VERSION);
@@ -17,6 +17,10 @@ std::vector<std::unique_ptr<Entity>> World::entities;
 std::vector<std::unique_ptr<SkeletalModel>> World::models;
 std::vector<std::unique_ptr<StaticMesh>> World::staticMeshes;
 std::vector<std::unique_ptr<Mesh>> World::meshes;
+std::vector<unsigned long> World::meshIndices;
+AnimationStore World::animations;
+FloorData World::floorData;
+Navigation World::navigation;
 
 void World::destroy() {
     rooms.clear();
@@ -26,6 +30,10 @@ void World::destroy() {
     models.clear();
     staticMeshes.clear();
     meshes.clear();
+    meshIndices.clear();
+    animations.clear();
+    floorData.clear();
+    navigation.clear();
 }
 
 void World::addRoom(Room* room) {
@@ -107,18 +115,38 @@ StaticMesh& World::getStaticMesh(unsigned long index) {
 }
 
 void World::addMesh(Mesh* mesh) {
+    meshIndices.push_back(meshes.size());
     meshes.emplace_back(mesh);
 }
 
+void World::addMeshReference(unsigned long index) {
+    orAssertLessThan(index, meshIndices.size());
+    meshIndices.push_back(meshIndices.at(index));
+}
+
 unsigned long World::sizeMesh() {
-    return meshes.size();
+    return meshIndices.size();
 }
 
 Mesh& World::getMesh(unsigned long index) {
+    orAssertLessThan(index, meshIndices.size());
+    return *meshes.at(meshIndices.at(index));
+}
+
+unsigned long World::sizeMeshResource() {
+    return meshes.size();
+}
+
+Mesh& World::getMeshResource(unsigned long index) {
     orAssertLessThan(index, meshes.size());
     return *meshes.at(index);
 }
 
+unsigned long World::getMeshResourceIndex(unsigned long index) {
+    orAssertLessThan(index, meshIndices.size());
+    return meshIndices.at(index);
+}
+
 void World::displayUI() {
     // Rooms
     if (ImGui::CollapsingHeader("Room Listing")) {
@@ -218,5 +246,16 @@ void World::displayUI() {
 
         ImGui::Columns(1);
     }
+
+    // Meshes
+    if (ImGui::CollapsingHeader("Mesh Listing")) {
+        unsigned long memory = 0, shared = 0;
+        for (auto& m : meshes)
+            memory += m->getMemorySize();
+        for (auto i : meshIndices)
+            shared += meshes.at(i)->getMemorySize();
+        ImGui::Text("%lu indices share %lu meshes", meshIndices.size(), meshes.size());
+        ImGui::Text("%lu KB used, %lu KB without sharing", memory / 1024, shared / 1024);
+    }
 }
 
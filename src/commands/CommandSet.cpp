@@ -7,8 +7,14 @@
 
 #include "global.h"
 #include "Camera.h"
+#include "LevelBuffer.h"
+#include "LevelCache.h"
 #include "Log.h"
+#include "Mesh.h"
+#include "RoomData.h"
 #include "RunTime.h"
+#include "SoundManager.h"
+#include "TextureManager.h"
 #include "system/Sound.h"
 #include "system/Window.h"
 #include "utils/strings.h"
@@ -37,6 +43,13 @@ void CommandSet::printHelp() {
     Log::get(LOG_USER) << "  mouse_x    FLOAT" << Log::endl;
     Log::get(LOG_USER) << "  mouse_y    FLOAT" << Log::endl;
     Log::get(LOG_USER) << "  fps        BOOL" << Log::endl;
+    Log::get(LOG_USER) << "  cache      BOOL" << Log::endl;
+    Log::get(LOG_USER) << "  meshhash   BOOL" << Log::endl;
+    Log::get(LOG_USER) << "  soundmem   INT (KB)" << Log::endl;
+    Log::get(LOG_USER) << "  drawranges BOOL" << Log::endl;
+    Log::get(LOG_USER) << "  texarray   BOOL" << Log::endl;
+    Log::get(LOG_USER) << "  levelbuf   BOOL" << Log::endl;
+    Log::get(LOG_USER) << "  instancing BOOL" << Log::endl;
     Log::get(LOG_USER) << "Enclose STRINGs with \"\"!" << Log::endl;
 }
 
@@ -114,6 +127,55 @@ int CommandSet::execute(std::istream& args) {
             return -8;
         }
         RunTime::setShowFPS(fps);
+    } else if (var.compare("cache") == 0) {
+        bool cache = true;
+        if (!(args >> cache)) {
+            Log::get(LOG_USER) << "set-cache-Error: Invalid value" << Log::endl;
+            return -9;
+        }
+        LevelCache::setEnabled(cache);
+    } else if (var.compare("meshhash") == 0) {
+        bool hash = true;
+        if (!(args >> hash)) {
+            Log::get(LOG_USER) << "set-meshhash-Error: Invalid value" << Log::endl;
+            return -10;
+        }
+        RunTime::setHashMeshes(hash);
+    } else if (var.compare("soundmem") == 0) {
+        unsigned long kb = 0;
+        if (!(args >> kb)) {
+            Log::get(LOG_USER) << "set-soundmem-Error: Invalid value" << Log::endl;
+            return -11;
+        }
+        SoundManager::setMemoryBudget(kb * 1024);
+    } else if (var.compare("drawranges") == 0) {
+        bool ranges = true;
+        if (!(args >> ranges)) {
+            Log::get(LOG_USER) << "set-drawranges-Error: Invalid value" << Log::endl;
+            return -12;
+        }
+        Mesh::setDrawRanges(ranges);
+    } else if (var.compare("texarray") == 0) {
+        bool array = true;
+        if (!(args >> array)) {
+            Log::get(LOG_USER) << "set-texarray-Error: Invalid value" << Log::endl;
+            return -13;
+        }
+        TextureManager::setTextureArray(array);
+    } else if (var.compare("levelbuf") == 0) {
+        bool level = true;
+        if (!(args >> level)) {
+            Log::get(LOG_USER) << "set-levelbuf-Error: Invalid value" << Log::endl;
+            return -14;
+        }
+        LevelBuffer::setEnabled(level);
+    } else if (var.compare("instancing") == 0) {
+        bool instanced = true;
+        if (!(args >> instanced)) {
+            Log::get(LOG_USER) << "set-instancing-Error: Invalid value" << Log::endl;
+            return -15;
+        }
+        StaticModel::setInstanced(instanced);
     } else if (var.compare("basedir") == 0) {
         std::string temp;
         args >> temp;
@@ -161,6 +223,13 @@ void CommandGet::printHelp() {
     Log::get(LOG_USER) << "  mouse_x" << Log::endl;
     Log::get(LOG_USER) << "  mouse_y" << Log::endl;
     Log::get(LOG_USER) << "  fps" << Log::endl;
+    Log::get(LOG_USER) << "  cache" << Log::endl;
+    Log::get(LOG_USER) << "  meshhash" << Log::endl;
+    Log::get(LOG_USER) << "  soundmem" << Log::endl;
+    Log::get(LOG_USER) << "  drawranges" << Log::endl;
+    Log::get(LOG_USER) << "  texarray" << Log::endl;
+    Log::get(LOG_USER) << "  levelbuf" << Log::endl;
+    Log::get(LOG_USER) << "  instancing" << Log::endl;
 }
 
 int CommandGet::execute(std::istream& args) {
@@ -181,6 +250,20 @@ int CommandGet::execute(std::istream& args) {
         Log::get(LOG_USER) << glm::degrees(Camera::getSensitivityY()) << Log::endl;
     } else if (var.compare("fps") == 0) {
         Log::get(LOG_USER) << RunTime::getShowFPS() << Log::endl;
+    } else if (var.compare("cache") == 0) {
+        Log::get(LOG_USER) << LevelCache::getEnabled() << Log::endl;
+    } else if (var.compare("meshhash") == 0) {
+        Log::get(LOG_USER) << RunTime::getHashMeshes() << Log::endl;
+    } else if (var.compare("soundmem") == 0) {
+        Log::get(LOG_USER) << (SoundManager::getMemoryBudget() / 1024) << Log::endl;
+    } else if (var.compare("drawranges") == 0) {
+        Log::get(LOG_USER) << Mesh::getDrawRanges() << Log::endl;
+    } else if (var.compare("texarray") == 0) {
+        Log::get(LOG_USER) << TextureManager::getTextureArray() << Log::endl;
+    } else if (var.compare("levelbuf") == 0) {
+        Log::get(LOG_USER) << LevelBuffer::getEnabled() << Log::endl;
+    } else if (var.compare("instancing") == 0) {
+        Log::get(LOG_USER) << StaticModel::getInstanced() << Log::endl;
     } else if (var.compare("basedir") == 0) {
         Log::get(LOG_USER) << RunTime::getBaseDir() << Log::endl;
     } else if (var.compare("pakdir") == 0) {
@@ -0,0 +1,645 @@
+/*!
+ * \file src/levelinfo.cpp
+ * \brief Offline level validation and statistics
+ *
+ * Loads every level below the given folders, without window, OpenGL or
+ * audio, and reports what the loader found and how long each part took.
+ *
+ * \author xythobuz
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "global.h"
+#include "Log.h"
+#include "RunTime.h"
+#include "Script.h"
+#include "SoundManager.h"
+#include "TextureManager.h"
+#include "World.h"
+#include "loader/Loader.h"
+#include "utils/FolderIndex.h"
+#include "utils/strings.h"
+#include "utils/ThreadPool.h"
+
+#include <ezoptionparser/ezOptionParser.hpp>
+
+#if defined(HAVE_UNISTD_H) && defined(HAVE_SYS_WAIT_H) && defined(HAVE_POLL_H) \
+    && defined(HAVE_FORK) && defined(HAVE_WAITPID) && defined(HAVE_POLL)
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define USE_FORK
+#endif
+
+const static std::vector<std::string> levelSuffixes = {
+    ".phd", ".tr2", ".tr4", ".tub"
+};
+
+// Level textures are 256x256 RGBA pages, with mipmaps
+const static unsigned long long textureBytes = (256 * 256 * 4 * 4) / 3;
+
+// More would only repeat the same problem for every face or mesh
+const static unsigned long maxErrors = 20;
+
+namespace {
+    struct SectionInfo {
+        std::string name;
+        long long size;
+        long long time; //!< Microseconds
+    };
+
+    struct LevelInfo {
+        std::string file;
+        int version;
+        bool valid; //!< Loaded and prepared without errors
+        bool crashed; //!< Assertion or signal, counts and times are missing
+        std::vector<SectionInfo> sections;
+        long long loadTime, prepareTime; //!< Microseconds
+        std::vector<std::pair<std::string, unsigned long long>> counts;
+        std::vector<std::string> errors;
+
+        explicit LevelInfo(std::string f = "") : file(f), version(0), valid(false),
+            crashed(false), loadTime(0), prepareTime(0) { }
+
+        unsigned long long count(std::string name) const {
+            for (auto& c : counts) {
+                if (c.first == name)
+                    return c.second;
+            }
+            return 0;
+        }
+    };
+
+    struct ScriptInfo {
+        std::string file;
+        bool valid;
+        std::string description;
+        unsigned int levels;
+        std::vector<std::string> errors;
+
+        explicit ScriptInfo(std::string f = "") : file(f), valid(false), levels(0) { }
+    };
+}
+
+template<typename T>
+static long long elapsed(T start) {
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Same steps as Game::loadWorker(), without the level cache. The prepare()
+ * calls resolve all texture tile and palette references.
+ */
+static int loadLevel(LevelInfo& info) {
+    auto loader = Loader::createLoader(info.file);
+    if (!loader) {
+        info.errors.push_back("Unknown level version");
+        return -1;
+    }
+    info.version = Loader::checkFile(info.file);
+
+    auto start = std::chrono::steady_clock::now();
+    loader->setHashMeshes(RunTime::getHashMeshes());
+    int error = loader->load(info.file);
+    for (auto& s : loader->getSections())
+        info.sections.push_back({ s.name, s.size, s.time });
+    loader.reset();
+    info.loadTime = elapsed(start);
+    if (error != 0) {
+        info.errors.push_back("Loader returned " + std::to_string(error));
+        return -2;
+    }
+
+    start = std::chrono::steady_clock::now();
+    ThreadPool pool;
+    pool.parallelFor(World::sizeMeshResource(), [](std::size_t i) {
+        World::getMeshResource(i).prepare();
+    });
+    pool.parallelFor(World::sizeRoom(), [](std::size_t i) {
+        World::getRoom(i).prepare();
+    });
+    TextureManager::prepare();
+    info.prepareTime = elapsed(start);
+
+    unsigned long long vertices = 0, triangles = 0, geometry = 0;
+    for (unsigned long i = 0; i < World::sizeRoom(); i++) {
+        RoomMesh& m = World::getRoom(i).getMesh();
+        vertices += m.sizeVertices();
+        triangles += m.sizeTriangles();
+        geometry += m.getMemorySize();
+    }
+    for (unsigned long i = 0; i < World::sizeMeshResource(); i++) {
+        Mesh& m = World::getMeshResource(i);
+        vertices += m.sizeVertices();
+        triangles += m.sizeTriangles();
+        geometry += m.getMemorySize();
+    }
+
+    unsigned long long textures = TextureManager::numTextures();
+    info.counts.emplace_back("rooms", World::sizeRoom());
+    info.counts.emplace_back("vertices", vertices);
+    info.counts.emplace_back("triangles", triangles);
+    info.counts.emplace_back("textures", textures);
+    info.counts.emplace_back("tiles", TextureManager::numTiles());
+    info.counts.emplace_back("meshes", World::sizeMesh());
+    info.counts.emplace_back("meshResources", World::sizeMeshResource());
+    info.counts.emplace_back("skeletalModels", World::sizeSkeletalModel());
+    info.counts.emplace_back("staticMeshes", World::sizeStaticMesh());
+    info.counts.emplace_back("animations", World::getAnimations().sizeAnimation());
+    info.counts.emplace_back("keyframes", World::getAnimations().sizeFrame());
+    info.counts.emplace_back("sprites", World::sizeSprite());
+    info.counts.emplace_back("entities", World::sizeEntity());
+    info.counts.emplace_back("samples", SoundManager::sizeSamples());
+    info.counts.emplace_back("geometryBytes", geometry);
+    info.counts.emplace_back("textureBytes", textures * textureBytes);
+    info.counts.emplace_back("gpuBytes", geometry + (textures * textureBytes));
+    return 0;
+}
+
+static void analyzeLevel(LevelInfo& info) {
+    unsigned long logStart = Log::size();
+
+    int error;
+    try {
+        error = loadLevel(info);
+    } catch (std::exception& e) {
+        // Out of range indices in broken files end up here
+        info.errors.push_back(std::string("Exception: ") + e.what());
+        error = -3;
+    }
+
+    // Everything the loader complained about, from all its threads
+    unsigned long logEnd = Log::size();
+    for (unsigned long i = logStart; i < logEnd; i++) {
+        LogEntry& e = Log::getEntry(i);
+        if (e.level <= LOG_WARNING)
+            info.errors.push_back(e.text);
+    }
+
+    if (info.errors.size() > maxErrors) {
+        unsigned long more = info.errors.size() - maxErrors;
+        info.errors.resize(maxErrors);
+        info.errors.push_back("... and " + std::to_string(more) + " more");
+    }
+
+    info.valid = (error == 0) && info.errors.empty();
+
+    World::destroy();
+    TextureManager::clear();
+    SoundManager::clear();
+}
+
+static void analyzeScript(ScriptInfo& info, FolderIndex& index) {
+    Script s;
+    int error = s.load(info.file);
+    if (error != 0) {
+        info.errors.push_back("Script could not be parsed (" + std::to_string(error) + ")");
+        return;
+    }
+
+    info.description = s.getDescription();
+    info.levels = s.levelCount();
+
+    // Found the same way the Menu does, by name below the script folder
+    std::string folder = convertPathDelimiter(removeLastPathElement(info.file));
+    for (unsigned int i = 0; i < s.levelCount(); i++) {
+        std::string name = getLastPathElement(convertPathDelimiter(s.getLevelFilename(i)));
+        std::vector<File> found;
+        index.find(found, { name }, folder);
+        if (found.size() == 0)
+            info.errors.push_back("Level \"" + name + "\" is missing");
+    }
+
+    info.valid = info.errors.empty();
+}
+
+// ----------------------------------------------------------------------------
+
+#ifdef USE_FORK
+
+/*
+ * Results are sent from the child as a list of length-prefixed strings,
+ * in the order of the LevelInfo members.
+ */
+static void putString(std::string& b, const std::string& s) {
+    b += std::to_string(s.size()) + ":" + s;
+}
+
+static void putNumber(std::string& b, long long n) {
+    putString(b, std::to_string(n));
+}
+
+static bool getString(const std::string& b, unsigned long& pos, std::string& s) {
+    unsigned long colon = b.find(':', pos);
+    if (colon == std::string::npos)
+        return false;
+    unsigned long length = std::strtoul(b.c_str() + pos, nullptr, 10);
+    if ((colon + 1 + length) > b.size())
+        return false;
+    s = b.substr(colon + 1, length);
+    pos = colon + 1 + length;
+    return true;
+}
+
+static bool getNumber(const std::string& b, unsigned long& pos, long long& n) {
+    std::string s;
+    if (!getString(b, pos, s))
+        return false;
+    n = std::strtoll(s.c_str(), nullptr, 10);
+    return true;
+}
+
+static std::string serialize(const LevelInfo& info) {
+    std::string b;
+    putNumber(b, info.version);
+    putNumber(b, info.valid ? 1 : 0);
+    putNumber(b, info.loadTime);
+    putNumber(b, info.prepareTime);
+    putNumber(b, info.sections.size());
+    for (auto& s : info.sections) {
+        putString(b, s.name);
+        putNumber(b, s.size);
+        putNumber(b, s.time);
+    }
+    putNumber(b, info.counts.size());
+    for (auto& c : info.counts) {
+        putString(b, c.first);
+        putNumber(b, c.second);
+    }
+    putNumber(b, info.errors.size());
+    for (auto& e : info.errors)
+        putString(b, e);
+    return b;
+}
+
+static bool deserialize(const std::string& b, LevelInfo& info) {
+    unsigned long pos = 0;
+    long long n, valid, a, c;
+    std::string s;
+    if (!(getNumber(b, pos, n) && getNumber(b, pos, valid) && getNumber(b, pos, info.loadTime)
+          && getNumber(b, pos, info.prepareTime) && getNumber(b, pos, c)))
+        return false;
+    info.version = n;
+    info.valid = (valid != 0);
+
+    for (long long i = 0; i < c; i++) {
+        if (!(getString(b, pos, s) && getNumber(b, pos, n) && getNumber(b, pos, a)))
+            return false;
+        info.sections.push_back({ s, n, a });
+    }
+
+    if (!getNumber(b, pos, c))
+        return false;
+    for (long long i = 0; i < c; i++) {
+        if (!(getString(b, pos, s) && getNumber(b, pos, n)))
+            return false;
+        info.counts.emplace_back(s, n);
+    }
+
+    if (!getNumber(b, pos, c))
+        return false;
+    for (long long i = 0; i < c; i++) {
+        if (!getString(b, pos, s))
+            return false;
+        info.errors.push_back(s);
+    }
+    return true;
+}
+
+/*
+ * World, TextureManager and SoundManager only hold one level at a time,
+ * so every level gets its own process. A failed assertion or a crash in
+ * the loader then only takes down the check of that one file.
+ */
+static int analyzeLevels(std::vector<LevelInfo>& levels, unsigned int jobs) {
+    struct Child {
+        pid_t pid;
+        int fd;
+        unsigned long index;
+        std::string data;
+    };
+
+    std::vector<Child> running;
+    unsigned long next = 0;
+    while ((next < levels.size()) || (running.size() > 0)) {
+        while ((running.size() < jobs) && (next < levels.size())) {
+            int p[2];
+            if (pipe(p) != 0) {
+                std::cerr << "Could not create pipe!" << std::endl;
+                return -1;
+            }
+
+            std::cout.flush();
+            pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "Could not start process!" << std::endl;
+                close(p[0]);
+                close(p[1]);
+                return -2;
+            } else if (pid == 0) {
+                // Assertions and debug output must not end up in the report
+                close(p[0]);
+                dup2(2, 1);
+                analyzeLevel(levels.at(next));
+                std::string b = serialize(levels.at(next));
+                for (unsigned long written = 0; written < b.size();) {
+                    ssize_t w = write(p[1], b.c_str() + written, b.size() - written);
+                    if (w <= 0)
+                        _exit(2);
+                    written += w;
+                }
+                close(p[1]);
+                _exit(0);
+            }
+
+            close(p[1]);
+            running.push_back({ pid, p[0], next++, "" });
+        }
+
+        std::vector<struct pollfd> fds;
+        for (auto& c : running)
+            fds.push_back({ c.fd, POLLIN, 0 });
+        if (poll(&fds[0], fds.size(), -1) < 0)
+            continue;
+
+        for (long i = running.size() - 1; i >= 0; i--) {
+            if (fds.at(i).revents == 0)
+                continue;
+
+            Child& c = running.at(i);
+            char buffer[4096];
+            ssize_t r = read(c.fd, buffer, sizeof(buffer));
+            if (r > 0) {
+                c.data.append(buffer, r);
+                continue;
+            }
+
+            close(c.fd);
+            int status = 0;
+            waitpid(c.pid, &status, 0);
+            LevelInfo& info = levels.at(c.index);
+            if ((!WIFEXITED(status)) || (WEXITSTATUS(status) != 0) || !deserialize(c.data, info)) {
+                info.crashed = true;
+                info.valid = false;
+                if (WIFSIGNALED(status))
+                    info.errors.push_back("Crashed with signal " + std::to_string(WTERMSIG(status)));
+                else
+                    info.errors.push_back("Crashed");
+            }
+            running.erase(running.begin() + i);
+        }
+    }
+
+    return 0;
+}
+
+#else
+
+// Without fork() all levels are loaded one after another, in this process
+static int analyzeLevels(std::vector<LevelInfo>& levels, unsigned int jobs) {
+    for (auto& l : levels)
+        analyzeLevel(l);
+    return 0;
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+
+static std::string jsonString(const std::string& s) {
+    std::ostringstream o;
+    o << "\"";
+    for (char c : s) {
+        if ((c == '"') || (c == '\\')) {
+            o << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            o << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c)
+              << std::dec << std::setfill(' ');
+        } else {
+            o << c;
+        }
+    }
+    o << "\"";
+    return o.str();
+}
+
+static void writeJSON(std::ostream& out, std::vector<ScriptInfo>& scripts,
+                      std::vector<LevelInfo>& levels) {
+    auto errors = [&out](const std::vector<std::string>& e) {
+        out << "\"errors\": [";
+        for (unsigned long i = 0; i < e.size(); i++)
+            out << ((i > 0) ? ", " : "") << jsonString(e.at(i));
+        out << "]";
+    };
+
+    out << "{" << std::endl << "  \"scripts\": [" << std::endl;
+    for (unsigned long i = 0; i < scripts.size(); i++) {
+        auto& s = scripts.at(i);
+        out << "    {\"file\": " << jsonString(s.file) << ", \"valid\": "
+            << (s.valid ? "true" : "false") << ", \"description\": " << jsonString(s.description)
+            << ", \"levels\": " << s.levels << ", ";
+        errors(s.errors);
+        out << "}" << ((i < (scripts.size() - 1)) ? "," : "") << std::endl;
+    }
+
+    out << "  ]," << std::endl << "  \"levels\": [" << std::endl;
+    for (unsigned long i = 0; i < levels.size(); i++) {
+        auto& l = levels.at(i);
+        out << "    {" << std::endl;
+        out << "      \"file\": " << jsonString(l.file) << ", \"version\": " << l.version
+            << ", \"valid\": " << (l.valid ? "true" : "false") << ", \"crashed\": "
+            << (l.crashed ? "true" : "false") << "," << std::endl;
+        out << "      \"loadUs\": " << l.loadTime << ", \"prepareUs\": " << l.prepareTime
+            << "," << std::endl;
+
+        out << "      \"sections\": [";
+        for (unsigned long s = 0; s < l.sections.size(); s++) {
+            auto& sec = l.sections.at(s);
+            out << ((s > 0) ? ", " : "") << "{\"name\": " << jsonString(sec.name)
+                << ", \"bytes\": " << sec.size << ", \"timeUs\": " << sec.time << "}";
+        }
+        out << "]," << std::endl << "      \"counts\": {";
+        for (unsigned long n = 0; n < l.counts.size(); n++)
+            out << ((n > 0) ? ", " : "") << "\"" << l.counts.at(n).first << "\": "
+                << l.counts.at(n).second;
+        out << "}," << std::endl << "      ";
+        errors(l.errors);
+        out << std::endl << "    }" << ((i < (levels.size() - 1)) ? "," : "") << std::endl;
+    }
+    out << "  ]" << std::endl << "}" << std::endl;
+}
+
+static void printTable(std::vector<ScriptInfo>& scripts, std::vector<LevelInfo>& levels,
+                       bool showSections) {
+    for (auto& s : scripts) {
+        std::cout << (s.valid ? "OK    " : "ERROR ") << s.file << " (" << s.levels << " levels, \""
+                  << s.description << "\")" << std::endl;
+        for (auto& e : s.errors)
+            std::cout << "      " << e << std::endl;
+    }
+    if (scripts.size() > 0)
+        std::cout << std::endl;
+
+    std::cout << std::left << std::setw(6) << "" << std::right << std::setw(4) << "TR"
+              << std::setw(7) << "Rooms" << std::setw(9) << "Vertices" << std::setw(9) << "Faces"
+              << std::setw(6) << "Tex" << std::setw(7) << "Meshes" << std::setw(7) << "Anims"
+              << std::setw(9) << "GPU KB" << std::setw(10) << "Load ms" << std::setw(10)
+              << "Prep ms" << "  File" << std::endl;
+
+    for (auto& l : levels) {
+        std::cout << std::left << std::setw(6) << (l.valid ? "OK" : (l.crashed ? "CRASH" : "ERROR"))
+                  << std::right << std::setw(4) << l.version
+                  << std::setw(7) << l.count("rooms") << std::setw(9) << l.count("vertices")
+                  << std::setw(9) << l.count("triangles") << std::setw(6) << l.count("textures")
+                  << std::setw(7) << l.count("meshes") << std::setw(7) << l.count("animations")
+                  << std::setw(9) << (l.count("gpuBytes") / 1024)
+                  << std::setw(10) << std::fixed << std::setprecision(1) << (l.loadTime / 1000.0)
+                  << std::setw(10) << (l.prepareTime / 1000.0) << "  " << l.file << std::endl;
+
+        if (showSections) {
+            for (auto& s : l.sections)
+                std::cout << std::setw(30) << s.name << std::setw(12) << s.size << " bytes"
+                          << std::setw(10) << std::setprecision(3) << (s.time / 1000.0) << " ms"
+                          << std::endl;
+        }
+
+        for (auto& e : l.errors)
+            std::cout << "      " << e << std::endl;
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+int main(int argc, const char* argv[]) {
+    ez::ezOptionParser opt;
+    opt.overview = "Checks Tomb Raider levels and scripts, without window, OpenGL or audio";
+    opt.syntax = "openraider-levelinfo [OPTIONS] FOLDER_OR_FILE [...]";
+    opt.example = "openraider-levelinfo --jobs 8 --json ~/.OpenRaider/paks";
+    opt.footer = VERSION;
+
+    opt.add("", 0, 0, 0, "Display usage instructions.", "-h", "-help", "--help", "--usage");
+    opt.add("", 0, 1, 0, "Levels checked at the same time, default is one per core",
+            "-j", "--jobs");
+    opt.add("", 0, 0, 0, "Print JSON instead of a table", "--json");
+    opt.add("", 0, 0, 0, "Also print the time of every file section", "-s", "--sections");
+
+    opt.parse(argc, argv);
+
+    // Paths may come before or after the options
+    std::vector<std::string> paths;
+    for (unsigned long i = 1; i < opt.firstArgs.size(); i++)
+        paths.push_back(*opt.firstArgs.at(i));
+    for (auto arg : opt.lastArgs)
+        paths.push_back(*arg);
+
+    if (opt.isSet("-h") || (paths.size() == 0)) {
+        std::string usage;
+        opt.getUsage(usage);
+        std::cout << usage << std::endl;
+        return -1;
+    }
+
+    std::vector<std::string> badOptions;
+    if (!opt.gotExpected(badOptions)) {
+        for (int i = 0; i < badOptions.size(); i++) {
+            std::cout << "ERROR: Got unexpected number of arguments for option " << badOptions[i] << "." <<
+                      std::endl;
+        }
+        std::string usage;
+        opt.getUsage(usage);
+        std::cout << usage << std::endl;
+        return -2;
+    }
+
+    unsigned int jobs = std::thread::hardware_concurrency();
+    if (opt.isSet("-j")) {
+        int j;
+        opt.get("-j")->getInt(j);
+        jobs = (j > 0) ? j : 1;
+    }
+    if (jobs == 0)
+        jobs = 1;
+
+    Log::initialize();
+    RunTime::setHeadless(true);
+
+    std::vector<std::string> levelFiles, scriptFiles;
+    {
+        // The pool only lives while walking, no threads are running when forking
+        ThreadPool pool;
+        for (auto& path : paths) {
+            if (stringEndsWith(path, "tombpc.dat")) {
+                scriptFiles.push_back(path);
+                continue;
+            }
+
+            bool isLevel = false;
+            for (auto& s : levelSuffixes)
+                isLevel |= stringEndsWith(path, s);
+            if (isLevel) {
+                levelFiles.push_back(path);
+                continue;
+            }
+
+            FolderIndex index(path);
+            if (index.scan(&pool) != 0) {
+                std::cout << "Could not read \"" << path << "\"!" << std::endl;
+                return -3;
+            }
+
+            std::vector<File> found;
+            index.find(found, levelSuffixes);
+            for (auto& f : found)
+                levelFiles.push_back(f.getPath());
+
+            found.clear();
+            index.find(found, { "tombpc.dat" });
+            for (auto& f : found)
+                scriptFiles.push_back(f.getPath());
+        }
+    }
+
+    // Scripts are small and do not touch the World, so threads are enough
+    std::vector<ScriptInfo> scripts(scriptFiles.begin(), scriptFiles.end());
+    {
+        ThreadPool pool;
+        pool.parallelFor(scripts.size(), [&scripts](std::size_t i) {
+            FolderIndex index(removeLastPathElement(scripts.at(i).file));
+            analyzeScript(scripts.at(i), index);
+        });
+    }
+
+    std::vector<LevelInfo> levels(levelFiles.begin(), levelFiles.end());
+    auto start = std::chrono::steady_clock::now();
+    if (analyzeLevels(levels, jobs) != 0)
+        return -4;
+    long long total = elapsed(start);
+
+    if (opt.isSet("--json"))
+        writeJSON(std::cout, scripts, levels);
+    else
+        printTable(scripts, levels, opt.isSet("-s"));
+
+    unsigned long failed = 0;
+    for (auto& s : scripts)
+        failed += s.valid ? 0 : 1;
+    for (auto& l : levels)
+        failed += l.valid ? 0 : 1;
+
+    std::cerr << levels.size() << " levels and " << scripts.size() << " scripts checked in "
+              << (total / 1000) << "ms, " << failed << " with errors" << std::endl;
+    return (failed > 0) ? 1 : 0;
+}
+
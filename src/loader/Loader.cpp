@@ -11,6 +11,7 @@
 #include "loader/LoaderTR1.h"
 #include "loader/LoaderTR2.h"
 #include "loader/LoaderTR3.h"
+#include "loader/LoaderTR4.h"
 
 Loader::LoaderVersion Loader::checkFile(std::string f) {
     BinaryFile file;
@@ -52,12 +53,50 @@ std::unique_ptr<Loader> Loader::createLoader(std::string f) {
         case TR_3:
             return std::unique_ptr<Loader>(new LoaderTR3());
 
-        case TR_UNKNOWN:
         case TR_4:
+            return std::unique_ptr<Loader>(new LoaderTR4());
+
+        case TR_UNKNOWN:
         case TR_5:
             return nullptr;
     }
 }
 
-Loader::~Loader() { }
+Loader::~Loader() {
+}
+
+void Loader::beginSection(std::string name) {
+    // Progress is reported when the previous section is closed
+    bool reported = sectionOpen;
+    endSection();
+
+    if ((cancel != nullptr) && (*cancel))
+        throw Cancelled();
+
+    sections.emplace_back(name, file.tell());
+    sectionOpen = true;
+    sectionStart = std::chrono::steady_clock::now();
+
+    if (progress && (!reported) && (file.size() > 0))
+        progress(float(file.tell()) / float(file.size()));
+}
+
+void Loader::endSection() {
+    if (!sectionOpen)
+        return;
+
+    sectionOpen = false;
+    sections.back().size = file.tell() - sections.back().offset;
+    sections.back().time = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - sectionStart).count();
+
+    if (progress && (file.size() > 0))
+        progress(float(file.tell()) / float(file.size()));
+}
+
+void Loader::waitForJobs() {
+    for (auto& j : jobs)
+        j.get();
+    jobs.clear();
+}
 
@@ -5,6 +5,8 @@
  * \author xythobuz
  */
 
+#include <algorithm>
+
 #include "global.h"
 #include "Game.h"
 #include "Log.h"
@@ -27,37 +29,63 @@ int LoaderTR1::load(std::string f) {
     if (unfinishedBusiness)
         Log::get(LOG_INFO) << "LoaderTR1: Detected Unfinished Business level!" << Log::endl;
 
+    beginSection("Textures");
     loadTextures();
 
     file.seek(file.tell() + 4); // Unused value?
 
+    beginSection("Rooms");
     loadRooms();
+    beginSection("FloorData");
     loadFloorData();
+    beginSection("Meshes");
     loadMeshes();
+    beginSection("Moveables");
     loadMoveables();
+    beginSection("StaticMeshes");
     loadStaticMeshes();
+    beginSection("Textiles");
     loadTextiles();
+    beginSection("Sprites");
     loadSprites();
 
-    if (unfinishedBusiness)
+    if (unfinishedBusiness) {
+        beginSection("Palette");
         loadPalette();
+    }
 
+    beginSection("Cameras");
     loadCameras();
+    beginSection("SoundSources");
     loadSoundSources();
+    beginSection("BoxesOverlapsZones");
     loadBoxesOverlapsZones();
+    beginSection("AnimatedTextures");
     loadAnimatedTextures();
+    beginSection("Items");
     loadItems();
 
+    beginSection("LightMap");
     file.seek(file.tell() + 8192); // TODO light map!
 
-    if (!unfinishedBusiness)
+    if (!unfinishedBusiness) {
+        beginSection("Palette");
         loadPalette();
+    }
 
+    beginSection("CinematicFrames");
     loadCinematicFrames();
+    beginSection("DemoData");
     loadDemoData();
+    beginSection("SoundMap");
     loadSoundMap();
+    beginSection("SoundDetails");
     loadSoundDetails();
-    loadSoundSamples();
+    beginSection("SoundSamples");
+    loadSoundSamples(f);
+    endSection();
+
+    mergeResults();
 
     return 0;
 }
@@ -139,13 +167,25 @@ void LoaderTR1::loadRoomStaticMeshes(std::vector<StaticModel*>& staticModels) {
     }
 }
 
-void LoaderTR1::loadRoomVertex(RoomVertexTR2& vert) {
-    vert.x = file.read16();
-    vert.y = file.read16();
-    vert.z = file.read16();
-    vert.light1 = file.read16();
-    vert.attributes = 0;
-    vert.light2 = vert.light1;
+struct RoomVertexTR1_t {
+    typedef int16_t Field;
+    int16_t x, y, z, light;
+};
+
+void LoaderTR1::loadRoomVertices(BinaryReader& room, std::vector<RoomVertexTR2>& vertices,
+                                 uint16_t numVertices) {
+    std::vector<RoomVertexTR1_t> raw(numVertices);
+    room.readStruct(raw.data(), numVertices);
+
+    vertices.resize(numVertices);
+    for (unsigned int v = 0; v < numVertices; v++) {
+        vertices[v].x = raw[v].x;
+        vertices[v].y = raw[v].y;
+        vertices[v].z = raw[v].z;
+        vertices[v].light1 = raw[v].light;
+        vertices[v].attributes = 0;
+        vertices[v].light2 = raw[v].light;
+    }
 }
 
 void LoaderTR1::loadItems() {
@@ -194,59 +234,45 @@ void LoaderTR1::loadItems() {
 
 void LoaderTR1::loadBoxesOverlapsZones() {
     uint32_t numBoxes = file.readU32();
+    std::vector<Navigation::Box> boxes(numBoxes);
+    std::vector<uint16_t> overlapIndices(numBoxes);
     for (unsigned int b = 0; b < numBoxes; b++) {
         // Sectors (not scaled!)
-        int32_t zMin = file.read32();
-        int32_t zMax = file.read32();
-        int32_t xMin = file.read32();
-        int32_t xMax = file.read32();
+        Navigation::Box& box = boxes.at(b);
+        box.zMin = file.read32();
+        box.zMax = file.read32();
+        box.xMin = file.read32();
+        box.xMax = file.read32();
 
-        int16_t trueFloor = file.read16(); // Y value (no scaling)
+        box.floor = file.read16(); // Y value (no scaling)
+        box.flags = 0;
 
         // Index into overlaps[]. The high bit is sometimes set
         // this occurs in front of swinging doors and the like
-        uint16_t overlapIndex = file.readU16();
-
-        // TODO store boxes somewhere
+        overlapIndices.at(b) = file.readU16();
     }
 
+    // Apparently used by NPCs to decide where to go next.
+    // List of neighboring boxes for each box.
+    // Each entry is a uint16, 0x8000 set marks end of list.
     uint32_t numOverlaps = file.readU32();
-    std::vector<std::vector<uint16_t>> overlaps;
-    overlaps.emplace_back();
-    unsigned int list = 0;
-    for (unsigned int o = 0; o < numOverlaps; o++) {
-        // Apparently used by NPCs to decide where to go next.
-        // List of neighboring boxes for each box.
-        // Each entry is a uint16, 0x8000 set marks end of list.
-        uint16_t e = file.readU16();
-        overlaps.at(list).push_back(e);
-        if (e & 0x8000) {
-            overlaps.emplace_back();
-            list++;
-        }
-    }
-
-    // TODO store overlaps somewhere
-
-    for (unsigned int z = 0; z < numBoxes; z++) {
-        // Normal room state
-        int16_t ground1 = file.read16();
-        int16_t ground2 = file.read16();
-        int16_t fly = file.read16();
-
-        // Alternate room state
-        int16_t ground1alt = file.read16();
-        int16_t ground2alt = file.read16();
-        int16_t flyAlt = file.read16();
-
-        // TODO store zones somewhere
-    }
-
-    if ((numBoxes > 0) || (numOverlaps > 0))
-        Log::get(LOG_INFO) << "LoaderTR1: Found NPC NavigationHints (" << numBoxes
-                           << ", " << numOverlaps << ", " << list << "), unimplemented!" << Log::endl;
-    else
-        Log::get(LOG_INFO) << "LoaderTR1: No NPC NavigationHints in this level?!" << Log::endl;
+    std::vector<uint16_t> overlaps(numOverlaps);
+    if (numOverlaps > 0)
+        file.readArray(&overlaps[0], numOverlaps);
+
+    // Two ground zones and the fly zone, for the normal and the alternate
+    // room state, one array each. The missing ground zones use the second one.
+    const static unsigned int fileZones[Navigation::zoneTables] = { 0, 1, 1, 1, 2, 3, 4, 4, 4, 5 };
+    std::vector<int16_t> raw(numBoxes * 6);
+    if (numBoxes > 0)
+        file.readArray(&raw[0], raw.size());
+    std::vector<int16_t> zones(numBoxes * Navigation::zoneTables);
+    for (unsigned int z = 0; z < Navigation::zoneTables; z++)
+        std::copy(raw.begin() + (fileZones[z] * numBoxes),
+                  raw.begin() + ((fileZones[z] + 1) * numBoxes),
+                  zones.begin() + (z * numBoxes));
+
+    buildNavigation(boxes, overlapIndices, overlaps, zones);
 }
 
 void LoaderTR1::loadSoundMap() {
@@ -255,22 +281,25 @@ void LoaderTR1::loadSoundMap() {
     }
 }
 
-void LoaderTR1::loadSoundSamples() {
+void LoaderTR1::loadSoundSamples(std::string f) {
     uint32_t soundSampleSize = file.readU32();
-    std::vector<uint8_t> buffer;
-    for (int i = 0; i < soundSampleSize; i++) {
-        buffer.push_back(file.readU8());
-    }
+    long long base = file.tell();
+    file.span(soundSampleSize);
+
+    // The samples stay in the level file, mapped again for the SoundManager
+    int sampleFile = SoundManager::addSampleFile(f);
+    if (sampleFile < 0)
+        Log::get(LOG_ERROR) << "LoaderTR1: Can't map SoundSamples!" << Log::endl;
 
     uint32_t numSampleIndices = file.readU32();
     for (unsigned int i = 0; i < numSampleIndices; i++) {
         SoundManager::addSampleIndex(i);
         uint32_t sampleOffset = file.readU32();
         orAssertLessThan(sampleOffset, soundSampleSize);
-        char* tmpPtr = reinterpret_cast<char*>(&buffer[sampleOffset]);
-        BinaryMemory sample(tmpPtr, soundSampleSize - sampleOffset);
-        int ret = loadSoundFiles(sample, 1);
-        orAssertEqual(ret, 1);
+        if (sampleFile >= 0) {
+            int ret = loadSoundFiles(sampleFile, base + sampleOffset, soundSampleSize - sampleOffset, 1);
+            orAssertEqual(ret, 1);
+        }
     }
 
     if (numSampleIndices > 0)
@@ -283,49 +312,25 @@ int LoaderTR1::getPaletteIndex(uint16_t index) {
     return index;
 }
 
-void LoaderTR1::loadAngleSet(BoneFrame* bf, BinaryReader& frame, uint16_t numMeshes,
-                             uint16_t startingMesh, uint32_t meshTree,
-                             uint32_t numMeshTrees, std::vector<int32_t> meshTrees) {
-    /*! \fixme
-     * The TR Rosetta Stone documentation says:
-     *     number of angle sets to follow;
-     *     these start with the first mesh, and meshes
-     *     without angles get zero angles.
-     * I'm not sure what this means. This code may be wrong.
-     */
-    uint16_t numValues = frame.readU16();
-
-    orAssertEqual(numValues, numMeshes);
-
-    for (int i = 0; i < numValues; i++) {
-        int mesh = startingMesh + i;
-        glm::vec3 offset(0.0f, 0.0f, 0.0f);
-        float rotation[3] = { 0.0f, 0.0f, 0.0f };
-        char flag = (i == 0) ? 2 : 0;
-
-        // Nonprimary tag - positioned relative to first tag
-        if (i != 0) {
-            char* tmp = reinterpret_cast<char*>(&meshTrees[0]) + meshTree; // TODO (meshTree * 4)?
-            tmp += (i - 1) * 16; // TODO ?
-            BinaryMemory tree(tmp, (numMeshTrees * 4) - meshTree - ((i - 1) * 16));
-
-            flag = static_cast<char>(tree.readU32());
-            offset.x = tree.read32();
-            offset.y = tree.read32();
-            offset.z = tree.read32();
-
-            uint16_t b = frame.readU16();
-            uint16_t a = frame.readU16();
-            rotation[0] = (a & 0x3FF0) >> 4;
-            rotation[1] = ((a & 0x000F) << 6) | ((b & 0xFC00) >> 10);
-            rotation[2] = b & 0x03FF;
-            for (int n = 0; n < 3; n++)
-                rotation[n] = rotation[n] * 360.0f / 1024.0f;
-        }
-
-        glm::vec3 rot(rotation[0], rotation[1], rotation[2]);
-        BoneTag* bt = new BoneTag(mesh, offset, rot, flag);
-        bf->add(bt);
+void LoaderTR1::loadAngleSet(BinaryReader& frame, long long size, uint16_t numBones,
+                             uint32_t* angles) {
+    // Number of angle sets to follow. These start with the first mesh,
+    // meshes without angles get zero angles. Always three-axis rotations,
+    // with both words swapped compared to TR2.
+    uint16_t numValues = 0;
+    if ((frame.tell() + 2) <= size)
+        numValues = frame.readU16();
+
+    for (int i = 0; i < numBones; i++) {
+        angles[i] = 0;
+        if ((i >= numValues) || ((frame.tell() + 4) > size))
+            continue;
+
+        uint16_t b = frame.readU16();
+        uint16_t a = frame.readU16();
+        angles[i] = AnimationStore::packAngles((a & 0x3FF0) >> 4,
+                                               ((a & 0x000F) << 6) | ((b & 0xFC00) >> 10),
+                                               b & 0x03FF);
     }
 }
 
@@ -5,6 +5,11 @@
  * \author xythobuz
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "global.h"
@@ -15,12 +20,25 @@
 #include "SoundManager.h"
 #include "TextureManager.h"
 #include "World.h"
-#include "system/Sound.h"
 #include "utils/pixel.h"
 #include "loader/LoaderTR2.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
+const unsigned int LoaderTR2::invalidMesh;
+
+// Decoding is ahead of the uploads, this many pages per worker may wait for them
+const static unsigned int pagesPerWorker = 2;
+
+LoaderTR2::LoaderTR2() : texturePool(256 * 256 * 4, pagesPerWorker * pool.size()),
+    textureDecodeTime(0), textureUploadTime(0) { }
+
+LoaderTR2::~LoaderTR2() {
+    // Queued uploads still use the texture pool, jobs the decoded results
+    uploadTextures();
+    waitForJobs();
+}
+
 int LoaderTR2::load(std::string f) {
     if (file.open(f) != 0) {
         return 1; // Could not open file
@@ -30,39 +48,146 @@ int LoaderTR2::load(std::string f) {
         return 2; // Not a TR2 level?!
     }
 
+    beginSection("Palette");
     loadPalette();
+    beginSection("Textures");
     loadTextures();
 
     file.seek(file.tell() + 4); // Unused value?
 
+    beginSection("Rooms");
     loadRooms();
+    beginSection("FloorData");
     loadFloorData();
+    beginSection("Meshes");
     loadMeshes();
+    beginSection("Moveables");
     loadMoveables();
+    beginSection("StaticMeshes");
     loadStaticMeshes();
+    beginSection("Textiles");
     loadTextiles();
+    beginSection("Sprites");
     loadSprites();
+    beginSection("Cameras");
     loadCameras();
+    beginSection("SoundSources");
     loadSoundSources();
+    beginSection("BoxesOverlapsZones");
     loadBoxesOverlapsZones();
+    beginSection("AnimatedTextures");
     loadAnimatedTextures();
+    beginSection("Items");
     loadItems();
 
+    beginSection("LightMap");
     file.seek(file.tell() + 8192); // Skip Light map, only for 8bit coloring
 
+    beginSection("CinematicFrames");
     loadCinematicFrames();
+    beginSection("DemoData");
     loadDemoData();
+    beginSection("SoundMap");
     loadSoundMap();
+    beginSection("SoundDetails");
     loadSoundDetails();
+    beginSection("SampleIndices");
     loadSampleIndices();
+    endSection();
+
+    mergeResults();
 
     loadExternalSoundFile(f);
 
     return 0;
 }
 
+void LoaderTR2::mergeResults() {
+    uploadTextures();
+    waitForJobs();
+
+    decodeFloorData();
+
+    for (unsigned int i = 0; i < rooms.size(); i++) {
+        auto& r = rooms.at(i);
+        World::addRoom(r.room);
+
+        if (!r.validSize)
+            Log::get(LOG_DEBUG) << "LoaderTR2: Room " << i << " data size mismatch!" << Log::endl;
+
+        // Sanity check
+        if (r.empty)
+            Log::get(LOG_DEBUG) << "LoaderTR2: Room " << i << " seems invalid!" << Log::endl;
+    }
+    rooms.clear();
+
+    // Invalid meshes have been skipped before, too.
+    // Entries sharing a decoded Mesh become references to the first one.
+    std::vector<long> worldIndex(meshes.size(), -1);
+    for (auto slot : meshIndices) {
+        if ((slot == invalidMesh) || (meshes.at(slot) == nullptr))
+            continue;
+
+        if (worldIndex.at(slot) < 0) {
+            worldIndex.at(slot) = World::sizeMesh();
+            World::addMesh(meshes.at(slot));
+        } else {
+            World::addMeshReference(worldIndex.at(slot));
+            meshStats.memorySaved += meshes.at(slot)->getMemorySize();
+        }
+    }
+    meshes.clear();
+    meshIndices.clear();
+}
+
 // ---- Textures ----
 
+void LoaderTR2::queueUpload(unsigned int slot, unsigned char* page) {
+    auto upload = Game::runOnMainThread([this, slot, page]() {
+        auto start = std::chrono::steady_clock::now();
+        int r = TextureManager::loadBufferSlot(page, 256, 256,
+                                               ColorMode::RGBA, 32,
+                                               TextureStorage::GAME, slot);
+        orAssertGreaterThanEqual(r, 0); //! \fixme properly handle error when texture could not be loaded!
+        texturePool.put(page);
+        textureUploadTime += std::chrono::duration_cast<std::chrono::microseconds>(
+                                 std::chrono::steady_clock::now() - start).count();
+    });
+
+    std::lock_guard<std::mutex> lock(textureUploadsMutex);
+    textureUploads.push_back(std::move(upload));
+}
+
+void LoaderTR2::uploadTextures() {
+    if (textureJobs.size() == 0)
+        return;
+
+    // Decoding waits for pooled pages, so the uploads have to keep running meanwhile
+    auto start = std::chrono::steady_clock::now();
+    for (auto& j : textureJobs) {
+        Game::waitForMainThread(j);
+        j.get();
+    }
+    auto decoded = std::chrono::steady_clock::now();
+
+    // No more uploads are queued now. Without a separate loader thread,
+    // they only run here, otherwise most of them are done already.
+    for (auto& u : textureUploads)
+        Game::waitForMainThread(u);
+
+    auto ms = [](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    };
+    Log::get(LOG_INFO) << "LoaderTR2: Textures decoded in " << (textureDecodeTime / 1000)
+                       << "ms (workers), uploaded in " << (textureUploadTime / 1000)
+                       << "ms, waited " << ms(decoded - start) << "ms for decoding, "
+                       << ms(std::chrono::steady_clock::now() - start) << "ms total, "
+                       << texturePool.getAllocated() << " buffers" << Log::endl;
+
+    textureJobs.clear();
+    textureUploads.clear();
+}
+
 void LoaderTR2::loadPalette() {
     file.seek(file.tell() + 768); // Skip 8bit palette, 256 * 3 bytes
 
@@ -83,20 +208,21 @@ void LoaderTR2::loadTextures() {
 
     file.seek(file.tell() + (numTextures * 256 * 256)); // Skip 8bit textures
 
-    // Read the 16bit textures, numTextures * 256 * 256 * 2 bytes
+    // Read the 16bit textures, numTextures * 256 * 256 * 2 bytes.
+    // They are converted to 32bit on the pool, then uploaded on the main thread.
+    Game::runOnMainThread([numTextures]() {
+        TextureManager::reserveTextureArray(numTextures);
+    });
     for (unsigned int i = 0; i < numTextures; i++) {
-        std::array<uint8_t, 256 * 256 * 2> arr;
-        for (auto& x : arr) {
-            x = file.readU8();
-        }
-
-        // Convert 16bit textures to 32bit textures
-        unsigned char* img = argb16to32(&arr[0], 256, 256);
-        int r = TextureManager::loadBufferSlot(img, 256, 256,
-                                               ColorMode::ARGB, 32,
-                                               TextureStorage::GAME, i);
-        orAssertGreaterThanEqual(r, 0); //! \fixme properly handle error when texture could not be loaded!
-        delete [] img;
+        auto page = reinterpret_cast<const unsigned char*>(file.span(256 * 256 * 2));
+        textureJobs.push_back(pool.push([this, i, page] {
+            auto start = std::chrono::steady_clock::now();
+            unsigned char* img = texturePool.get();
+            argb16torgba32(page, img, 256, 256);
+            textureDecodeTime += std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now() - start).count();
+            queueUpload(i, img);
+        }));
     }
 
     if (numTextures > 0)
@@ -246,181 +372,67 @@ void LoaderTR2::loadRoomDataEnd(int16_t& alternateRoom, unsigned int& roomFlags)
     }
 }
 
-void LoaderTR2::loadRoomVertex(RoomVertexTR2& vert) {
-    vert.x = file.read16();
-    vert.y = file.read16();
-    vert.z = file.read16();
-    vert.light1 = file.read16();
-    vert.attributes = file.readU16();
-    vert.light2 = file.read16();
+void LoaderTR2::loadRoomVertices(BinaryReader& room, std::vector<RoomVertexTR2>& vertices,
+                                 uint16_t numVertices) {
+    std::vector<RoomVertex_t> raw(numVertices);
+    room.readStruct(raw.data(), numVertices);
+
+    vertices.resize(numVertices);
+    for (unsigned int v = 0; v < numVertices; v++) {
+        vertices[v].x = raw[v].x;
+        vertices[v].y = raw[v].y;
+        vertices[v].z = raw[v].z;
+        vertices[v].light1 = raw[v].light1;
+        vertices[v].attributes = raw[v].attributes;
+        vertices[v].light2 = raw[v].light2;
+    }
 }
 
-void LoaderTR2::loadRoomMesh(std::vector<IndexedRectangle>& rectangles,
+void LoaderTR2::loadRoomMesh(BinaryReader& room, long long size,
+                             std::vector<IndexedRectangle>& rectangles,
                              std::vector<IndexedRectangle>& triangles,
                              uint16_t& numRectangles, uint16_t& numTriangles) {
-    numRectangles = file.readU16();
-    for (unsigned int r = 0; r < numRectangles; r++) {
-        // Indices into the vertex list read just before
-        uint16_t vertex1 = file.readU16();
-        uint16_t vertex2 = file.readU16();
-        uint16_t vertex3 = file.readU16();
-        uint16_t vertex4 = file.readU16();
-
-        // Index into the object-texture list
-        uint16_t texture = file.readU16();
-
-        rectangles.emplace_back(texture, vertex1, vertex2, vertex3, vertex4);
-    }
-
-    numTriangles = file.readU16();
-    for (unsigned int t = 0; t < numTriangles; t++) {
-        // Indices into the room vertex list
-        uint16_t vertex1 = file.readU16();
-        uint16_t vertex2 = file.readU16();
-        uint16_t vertex3 = file.readU16();
-
-        // Index into the object-texture list
-        uint16_t texture = file.readU16();
-
-        triangles.emplace_back(texture, vertex1, vertex2, vertex3);
-    }
+    // Vertices are indices into the vertex list read just before,
+    // texture is an index into the object-texture list
+    numRectangles = readCount(room, size, sizeof(Rectangle_t));
+    std::vector<Rectangle_t> rects(numRectangles);
+    room.readStruct(rects.data(), numRectangles);
+    rectangles.reserve(numRectangles);
+    for (auto& r : rects)
+        rectangles.emplace_back(r.texture, r.vertices[0], r.vertices[1],
+                                r.vertices[2], r.vertices[3]);
+
+    numTriangles = readCount(room, size, sizeof(Triangle_t));
+    std::vector<Triangle_t> tris(numTriangles);
+    room.readStruct(tris.data(), numTriangles);
+    triangles.reserve(numTriangles);
+    for (auto& t : tris)
+        triangles.emplace_back(t.texture, t.vertices[0], t.vertices[1], t.vertices[2]);
 }
 
 void LoaderTR2::loadRooms() {
     uint16_t numRooms = file.readU16();
+    rooms.resize(numRooms);
     for (unsigned int i = 0; i < numRooms; i++) {
-        // Room Header
-        int32_t xOffset = file.read32();
-        int32_t zOffset = file.read32();
-        int32_t yBottom = file.read32(); // lowest point == largest y value
-        int32_t yTop = file.read32(); // highest point == smallest y value
-
-        glm::vec3 pos(xOffset, 0.0f, zOffset);
+        // Only walk over the geometry here, it is decoded on the pool
+        long long start = file.tell();
+        file.seek(start + 16); // Room header, xOffset, zOffset, yBottom, yTop
 
         // Number of data words (2 bytes) to follow
         uint32_t dataToFollow = file.readU32();
-
-        glm::vec3 bbox[2] = {
-            glm::vec3(0.0f, 0.0f, 0.0f),
-            glm::vec3(0.0f, 0.0f, 0.0f)
-        };
-
-        uint16_t numVertices = file.readU16();
-        std::vector<RoomVertexTR2> vertices;
-        for (unsigned int v = 0; v < numVertices; v++) {
-            RoomVertexTR2 vert;
-            loadRoomVertex(vert);
-            vertices.push_back(vert);
-
-            // Fill bounding box
-            if (v == 0) {
-                for (int n = 0; n < 2; n++) {
-                    bbox[n].x = vert.x;
-                    bbox[n].y = vert.y;
-                    bbox[n].z = vert.z;
-                }
-            } else {
-                if (vert.x < bbox[0].x)
-                    bbox[0].x = vert.x;
-                if (vert.x > bbox[1].x)
-                    bbox[1].x = vert.x;
-                if (vert.y < bbox[0].y)
-                    bbox[0].y = vert.y;
-                if (vert.y > bbox[1].y)
-                    bbox[1].y = vert.y;
-                if (vert.z < bbox[0].z)
-                    bbox[0].z = vert.z;
-                if (vert.z > bbox[1].z)
-                    bbox[1].z = vert.z;
-            }
-        }
-
-        bbox[0] += pos;
-        bbox[1] += pos;
-
-        std::vector<IndexedRectangle> rectangles;
-        std::vector<IndexedRectangle> triangles;
-        uint16_t numRectangles, numTriangles;
-        loadRoomMesh(rectangles, triangles, numRectangles, numTriangles);
-
-        uint16_t numSprites = file.readU16();
-        std::vector<RoomSprite*> roomSprites;
-        for (unsigned int s = 0; s < numSprites; s++) {
-            uint16_t vertex = file.readU16(); // Index into vertex list
-            uint16_t sprite = file.readU16(); // Index into sprite list
-
-            auto& v = vertices.at(vertex);
-            roomSprites.push_back(new RoomSprite(glm::vec3(v.x, v.y, v.z) + pos, sprite));
-        }
+        file.seek(file.tell() + (dataToFollow * 2)); // Vertices, faces, sprites
 
         uint16_t numPortals = file.readU16();
-        std::vector<Portal*> portals;
-        for (unsigned int p = 0; p < numPortals; p++) {
-            // Which room this portal leads to
-            uint16_t adjoiningRoom = file.readU16();
-
-            // Which way the portal faces
-            // The normal points away from the adjacent room
-            // To be seen through, it must point toward the viewpoint
-            int16_t xNormal = file.read16();
-            int16_t yNormal = file.read16();
-            int16_t zNormal = file.read16();
-
-            // The corners of this portal
-            // The right-hand rule applies with respect to the normal
-            int16_t xCorner1 = file.read16();
-            int16_t yCorner1 = file.read16();
-            int16_t zCorner1 = file.read16();
-            int16_t xCorner2 = file.read16();
-            int16_t yCorner2 = file.read16();
-            int16_t zCorner2 = file.read16();
-            int16_t xCorner3 = file.read16();
-            int16_t yCorner3 = file.read16();
-            int16_t zCorner3 = file.read16();
-            int16_t xCorner4 = file.read16();
-            int16_t yCorner4 = file.read16();
-            int16_t zCorner4 = file.read16();
-
-            portals.push_back(new Portal(adjoiningRoom,
-                                         glm::vec3(xNormal, yNormal, zNormal),
-                                         glm::vec3(xCorner1, yCorner1, zCorner1) + pos,
-                                         glm::vec3(xCorner2, yCorner2, zCorner2) + pos,
-                                         glm::vec3(xCorner3, yCorner3, zCorner3) + pos,
-                                         glm::vec3(xCorner4, yCorner4, zCorner4) + pos));
-        }
+        file.seek(file.tell() + (numPortals * sizeof(Portal_t)));
 
         uint16_t numZSectors = file.readU16();
         uint16_t numXSectors = file.readU16();
-        for (unsigned int s = 0; s < (numZSectors * numXSectors); s++) {
-            // Sectors are 1024*1024 world coordinates. Floor and Ceiling are
-            // signed numbers of 256 units of height.
-            // Floor/Ceiling value of 0x81 is used to indicate impenetrable
-            // walls around the sector.
-            // Floor values are used by the original engine to determine
-            // what objects can be traversed and how. Relative steps of 1 (256)
-            // can be walked up, 2..7 must be jumped up, larger than 7 is too high
-            // If RoomAbove/Below is not none, the Ceiling/Floor is a collisional
-            // portal to that room
-            uint16_t indexFloorData = file.readU16();
-            uint16_t indexBox = file.readU16(); // 0xFFFF if none
-            uint8_t roomBelow = file.readU8(); // 0xFF if none
-            int8_t floor = file.read8(); // Absolute height of floor (divided by 256)
-            uint8_t roomAbove = file.readU8(); // 0xFF if none
-            int8_t ceiling = file.read8(); // Absolute height of ceiling (/ 256)
-
-            // In TR3 indexBox is more complicated. Only bits 4-14 are the 'real' index.
-            // Bits 0-3 are most likely some kind of flag (footstep sound?).
-            // There is a special value of the 'real' index, 2047 or 0x7FF.
-
-            bool wall = false;
-            if (((floor & 0xFF) == 0x81) || ((ceiling & 0xFF) == 0x81)) {
-                wall = true;
-            }
+        file.seek(file.tell() + (numZSectors * numXSectors * sizeof(Sector_t)));
 
-            //room->addSector(new Sector(floor * 256.0f, ceiling * 256.0f, wall));
-            // TODO store sectors
-        }
+        long long size = file.tell() - start;
+        const char* data = file.pointer(start);
 
+        // The rest has a version dependent size, so read it right away
         loadRoomLights();
 
         std::vector<StaticModel*> staticModels;
@@ -430,51 +442,216 @@ void LoaderTR2::loadRooms() {
         unsigned int roomFlags = 0;
         loadRoomDataEnd(alternateRoom, roomFlags);
 
-        BoundingBox* boundingbox = new BoundingBox(bbox[0], bbox[1]);
-        RoomMesh* mesh = new RoomMesh(vertices, rectangles, triangles);
-        Room* room = new Room(pos, boundingbox, mesh, roomFlags, alternateRoom,
-                              numXSectors, numZSectors, i);
+        jobs.push_back(pool.push([=] {
+            decodeRoom(i, data, size, staticModels, alternateRoom, roomFlags);
+        }));
+    }
+
+    if (numRooms > 0)
+        Log::get(LOG_INFO) << "LoaderTR2: Found " << numRooms << " Rooms!" << Log::endl;
+    else
+        Log::get(LOG_INFO) << "LoaderTR2: No Rooms in this Level?!" << Log::endl;
+}
 
-        for (auto p : portals)
-            room->addPortal(p);
+void LoaderTR2::decodeRoom(unsigned int i, const char* data, long long size,
+                           std::vector<StaticModel*> staticModels,
+                           int16_t alternateRoom, unsigned int roomFlags) {
+    BinaryMemory mem(data, size);
+
+    // Room Header
+    int32_t xOffset = mem.read32();
+    int32_t zOffset = mem.read32();
+    int32_t yBottom = mem.read32(); // lowest point == largest y value
+    int32_t yTop = mem.read32(); // highest point == smallest y value
+
+    glm::vec3 pos(xOffset, 0.0f, zOffset);
+
+    // Number of data words (2 bytes) to follow
+    uint32_t dataToFollow = mem.readU32();
+    long long dataEnd = mem.tell() + (dataToFollow * 2);
+
+    glm::vec3 bbox[2] = {
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 0.0f)
+    };
+
+    uint16_t numVertices = mem.readU16();
+    std::vector<RoomVertexTR2> vertices;
+    loadRoomVertices(mem, vertices, numVertices);
+
+    // Fill bounding box
+    for (unsigned int v = 0; v < numVertices; v++) {
+        auto& vert = vertices[v];
+        if (v == 0) {
+            for (int n = 0; n < 2; n++) {
+                bbox[n].x = vert.x;
+                bbox[n].y = vert.y;
+                bbox[n].z = vert.z;
+            }
+        } else {
+            if (vert.x < bbox[0].x)
+                bbox[0].x = vert.x;
+            if (vert.x > bbox[1].x)
+                bbox[1].x = vert.x;
+            if (vert.y < bbox[0].y)
+                bbox[0].y = vert.y;
+            if (vert.y > bbox[1].y)
+                bbox[1].y = vert.y;
+            if (vert.z < bbox[0].z)
+                bbox[0].z = vert.z;
+            if (vert.z > bbox[1].z)
+                bbox[1].z = vert.z;
+        }
+    }
 
-        for (auto m : staticModels)
-            room->addModel(m);
+    bbox[0] += pos;
+    bbox[1] += pos;
 
-        for (auto s : roomSprites)
-            room->addSprite(s);
+    std::vector<IndexedRectangle> rectangles;
+    std::vector<IndexedRectangle> triangles;
+    uint16_t numRectangles, numTriangles;
+    loadRoomMesh(mem, size, rectangles, triangles, numRectangles, numTriangles);
 
-        World::addRoom(room);
+    uint16_t numSprites = mem.readU16();
+    std::vector<RoomSprite*> roomSprites;
+    for (unsigned int s = 0; s < numSprites; s++) {
+        uint16_t vertex = mem.readU16(); // Index into vertex list
+        uint16_t sprite = mem.readU16(); // Index into sprite list
 
-        // Sanity check
-        if ((numPortals == 0) && (numVertices == 0)
-            && (numRectangles == 0) && (numTriangles == 0))
-            Log::get(LOG_DEBUG) << "LoaderTR2: Room " << i << " seems invalid: " << numPortals << "p "
-                                << numRectangles << "r " << numTriangles << "t " << numVertices
-                                << "v" << Log::endl;
+        auto& v = vertices.at(vertex);
+        roomSprites.push_back(new RoomSprite(glm::vec3(v.x, v.y, v.z) + pos, sprite));
     }
 
-    if (numRooms > 0)
-        Log::get(LOG_INFO) << "LoaderTR2: Found " << numRooms << " Rooms!" << Log::endl;
-    else
-        Log::get(LOG_INFO) << "LoaderTR2: No Rooms in this Level?!" << Log::endl;
+    // Anything else in the data block is unknown, skip it
+    DecodedRoom& result = rooms.at(i);
+    result.validSize = (mem.tell() == dataEnd);
+    mem.seek(dataEnd);
+
+    uint16_t numPortals = mem.readU16();
+    std::vector<Portal_t> rawPortals(numPortals);
+    mem.readStruct(rawPortals.data(), numPortals);
+    std::vector<Portal*> portals;
+    for (auto& p : rawPortals) {
+        // adjoiningRoom is the room this portal leads to.
+        // The normal points away from the adjacent room,
+        // to be seen through, it must point toward the viewpoint.
+        // The right-hand rule applies to the corners with respect to the normal.
+        glm::vec3 corners[4];
+        for (int c = 0; c < 4; c++)
+            corners[c] = glm::vec3(p.vertices[c].x, p.vertices[c].y, p.vertices[c].z) + pos;
+
+        portals.push_back(new Portal(p.adjoiningRoom,
+                                     glm::vec3(p.normal.x, p.normal.y, p.normal.z),
+                                     corners[0], corners[1], corners[2], corners[3]));
+    }
+
+    uint16_t numZSectors = mem.readU16();
+    uint16_t numXSectors = mem.readU16();
+    std::vector<Sector_t> sectors(numZSectors * numXSectors);
+    mem.readStruct(sectors.data(), sectors.size());
+    std::vector<Sector> grid;
+    grid.reserve(sectors.size());
+    for (auto& sector : sectors) {
+        // Sectors are 1024*1024 world coordinates. Floor and Ceiling are
+        // signed numbers of 256 units of height.
+        // Floor/Ceiling value of 0x81 is used to indicate impenetrable
+        // walls around the sector.
+        // Floor values are used by the original engine to determine
+        // what objects can be traversed and how. Relative steps of 1 (256)
+        // can be walked up, 2..7 must be jumped up, larger than 7 is too high
+        // If RoomAbove/Below is not none, the Ceiling/Floor is a collisional
+        // portal to that room
+        uint16_t indexFloorData = sector.indexFloorData;
+        uint16_t indexBox = sector.indexBox; // 0xFFFF if none
+        uint8_t roomBelow = sector.below & 0xFF; // 0xFF if none
+        int8_t floor = static_cast<int8_t>(sector.below >> 8); // Absolute height of floor (divided by 256)
+        uint8_t roomAbove = sector.above & 0xFF; // 0xFF if none
+        int8_t ceiling = static_cast<int8_t>(sector.above >> 8); // Absolute height of ceiling (/ 256)
+
+        // In TR3 indexBox is more complicated. Only bits 4-14 are the 'real' index.
+        // Bits 0-3 are most likely some kind of flag (footstep sound?).
+        // There is a special value of the 'real' index, 2047 or 0x7FF.
+
+        bool wall = false;
+        if (((floor & 0xFF) == 0x81) || ((ceiling & 0xFF) == 0x81)) {
+            wall = true;
+        }
+
+        // Sectors are stored column by column, which already is (x * numZSectors) + z
+        grid.emplace_back(floor * 256, ceiling * 256, indexFloorData, indexBox,
+                          roomBelow, roomAbove, wall);
+    }
+
+    BoundingBox* boundingbox = new BoundingBox(bbox[0], bbox[1]);
+    RoomMesh* mesh = new RoomMesh(vertices, rectangles, triangles);
+    Room* room = new Room(pos, boundingbox, mesh, roomFlags, alternateRoom,
+                          numXSectors, numZSectors, i);
+
+    for (auto p : portals)
+        room->addPortal(p);
+
+    room->setSectors(grid);
+
+    for (auto m : staticModels)
+        room->addModel(m);
+
+    for (auto s : roomSprites)
+        room->addSprite(s);
+
+    result.room = room;
+    result.empty = (numPortals == 0) && (numVertices == 0)
+                   && (numRectangles == 0) && (numTriangles == 0);
 }
 
 void LoaderTR2::loadFloorData() {
     uint32_t numFloorData = file.readU32();
-    for (unsigned int f = 0; f < numFloorData; f++) {
-        uint16_t unused = file.readU16();
-
-        // TODO store floor data somewhere
-    }
+    floorData.resize(numFloorData);
+    if (numFloorData > 0)
+        file.readArray(&floorData[0], numFloorData);
 
     if (numFloorData > 0)
-        Log::get(LOG_INFO) << "LoaderTR2: Found " << numFloorData << " words FloorData, unimplemented!" <<
-                           Log::endl;
+        Log::get(LOG_INFO) << "LoaderTR2: Found " << numFloorData << " words FloorData!" << Log::endl;
     else
         Log::get(LOG_INFO) << "LoaderTR2: No FloorData in this level?!" << Log::endl;
 }
 
+void LoaderTR2::decodeFloorData() {
+    // Every referenced chain is decoded once, sectors sharing it share the record
+    FloorData& decoded = World::getFloorData();
+    std::vector<uint16_t> records(floorData.size(), 0);
+    unsigned long invalid = 0;
+    for (auto& r : rooms) {
+        for (unsigned long s = 0; s < r.room->sizeSectors(); s++) {
+            Sector& sector = r.room->getSector(s);
+            uint16_t offset = sector.floorData;
+            if (offset >= floorData.size()) {
+                invalid++;
+                offset = 0;
+            }
+
+            // Offset 0 is the dummy word, also when the level has no FloorData at all
+            if (offset == 0) {
+                sector.floorData = 0;
+                continue;
+            }
+
+            if (records.at(offset) == 0)
+                records.at(offset) = decoded.decode(&floorData[0], floorData.size(), offset);
+            sector.floorData = records.at(offset);
+        }
+    }
+
+    Log::get(LOG_INFO) << "LoaderTR2: Decoded " << decoded.sizeInfo() << " FloorData records, "
+                       << decoded.sizeTrigger() << " triggers, " << decoded.sizeAction()
+                       << " actions" << Log::endl;
+
+    if ((invalid > 0) || (decoded.getUnknownFunctions() > 0))
+        Log::get(LOG_DEBUG) << "LoaderTR2: " << invalid << " invalid FloorData offsets, "
+                            << decoded.getUnknownFunctions() << " unknown functions!" << Log::endl;
+
+    floorData.clear();
+}
+
 void LoaderTR2::loadSprites() {
     uint32_t numSpriteTextures = file.readU32();
     for (unsigned int s = 0; s < numSpriteTextures; s++) {
@@ -523,124 +700,193 @@ int LoaderTR2::getPaletteIndex(uint16_t index) {
 }
 
 void LoaderTR2::loadMeshes() {
-    // Number of bitu16s of mesh data to follow
-    // Read all the mesh data into a buffer, because
-    // only afterward we can read the number of meshes
-    // in this data block
+    // Number of bitu16s of mesh data to follow.
+    // Only afterward we can read the number of meshes
+    // in this data block, so remember where it is.
     uint32_t numMeshData = file.readU32();
-    std::vector<uint16_t> buffer;
-    for (unsigned int i = 0; i < numMeshData; i++) {
-        buffer.push_back(file.readU16());
-    }
+    const char* buffer = file.span(numMeshData * 2);
 
     uint32_t numMeshPointers = file.readU32();
+    std::vector<uint32_t> meshPointers(numMeshPointers);
+    file.readArray(meshPointers.data(), numMeshPointers);
+
+    // Many entries use the same offset, each offset is only decoded once
+    meshStats = MeshStats();
+    meshIndices.assign(numMeshPointers, invalidMesh);
+    std::unordered_map<uint32_t, unsigned int> slots;
+    auto offsets = std::make_shared<std::vector<uint32_t>>();
     for (unsigned int i = 0; i < numMeshPointers; i++) {
-        uint32_t meshPointer = file.readU32();
-
+        uint32_t meshPointer = meshPointers.at(i);
         if (numMeshData < (meshPointer / 2)) {
             Log::get(LOG_DEBUG) << "LoaderTR2: Invalid Mesh: "
                                 << (meshPointer / 2) << " > " << numMeshData << Log::endl;
             continue;
         }
 
-        char* tmpPtr = reinterpret_cast<char*>(&buffer[meshPointer / 2]);
-        BinaryMemory mem(tmpPtr, (numMeshData * 2) - meshPointer);
-
-        int16_t mx = mem.read16();
-        int16_t my = mem.read16();
-        int16_t mz = mem.read16();
-        int32_t collisionSize = mem.read32();
-        // TODO store mesh collision info somewhere
-
-        uint16_t numVertices = mem.readU16();
-        std::vector<glm::vec3> vertices;
-        for (int v = 0; v < numVertices; v++) {
-            int16_t x = mem.read16();
-            int16_t y = mem.read16();
-            int16_t z = mem.read16();
-            vertices.emplace_back(x, y, z);
+        auto slot = slots.find(meshPointer);
+        if (slot == slots.end()) {
+            slot = slots.emplace(meshPointer, offsets->size()).first;
+            offsets->push_back(meshPointer);
         }
+        meshIndices.at(i) = slot->second;
+        meshStats.pointers++;
+    }
+    meshStats.offsets = offsets->size();
+
+    // Meshes are stored back to back, so each one ends where the next begins
+    std::vector<uint32_t> sorted(*offsets);
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<uint32_t> lengths;
+    lengths.reserve(offsets->size());
+    for (auto offset : *offsets) {
+        auto next = std::upper_bound(sorted.begin(), sorted.end(), offset);
+        lengths.push_back(((next != sorted.end()) ? *next : (numMeshData * 2)) - offset);
+    }
 
-        int16_t numNormals = mem.read16();
-        if (numNormals > 0) {
-            // External vertex lighting is used, with the lighting calculated
-            // from the rooms ambient and point-source lighting values. The
-            // latter appears to use a simple Lambert law for directionality:
-            // intensity is proportional to
-            //      max((normal direction).(direction to source), 0)
-            for (int n = 0; n < numNormals; n++) {
-                int16_t x = mem.read16();
-                int16_t y = mem.read16();
-                int16_t z = mem.read16();
-
-                //mesh->addNormal(glm::vec3(x, y, z));
+    if (hashMeshes && (offsets->size() > 0)) {
+        // Identical data at another offset is shared, too
+        std::vector<unsigned int> remap(offsets->size());
+        auto unique = std::make_shared<std::vector<uint32_t>>();
+        std::unordered_multimap<uint64_t, unsigned int> hashes;
+        for (unsigned int i = 0; i < offsets->size(); i++) {
+            const char* data = buffer + offsets->at(i);
+            uint64_t hash = hashData(data, lengths.at(i));
+            remap.at(i) = unique->size();
+
+            auto range = hashes.equal_range(hash);
+            for (auto h = range.first; h != range.second; ++h) {
+                unsigned int other = h->second;
+                if ((lengths.at(other) == lengths.at(i))
+                    && (std::memcmp(buffer + offsets->at(other), data, lengths.at(i)) == 0)) {
+                    remap.at(i) = remap.at(other);
+                    break;
+                }
             }
-        } else if (numNormals < 0) {
-            // Internal vertex lighting is used,
-            // using the data included with the mesh
-            for (int l = 0; l < (numNormals * -1); l++) {
-                int16_t light = mem.read16();
-                // TODO store lights somewhere
+
+            if (remap.at(i) == unique->size()) {
+                hashes.emplace(hash, i);
+                unique->push_back(offsets->at(i));
             }
         }
 
-        int16_t numTexturedRectangles = mem.read16();
-        std::vector<IndexedRectangle> texturedRectangles;
-        for (int r = 0; r < numTexturedRectangles; r++) {
-            uint16_t vertex1 = mem.readU16();
-            uint16_t vertex2 = mem.readU16();
-            uint16_t vertex3 = mem.readU16();
-            uint16_t vertex4 = mem.readU16();
-            uint16_t texture = mem.readU16();
+        for (auto& slot : meshIndices)
+            if (slot != invalidMesh)
+                slot = remap.at(slot);
 
-            texturedRectangles.emplace_back(texture, vertex1, vertex2, vertex3, vertex4);
-        }
+        std::vector<uint32_t> uniqueLengths(unique->size());
+        for (unsigned int i = 0; i < offsets->size(); i++)
+            uniqueLengths.at(remap.at(i)) = lengths.at(i);
+        lengths = uniqueLengths;
+        offsets = unique;
+    }
 
-        int16_t numTexturedTriangles = mem.read16();
-        std::vector<IndexedRectangle> texturedTriangles;
-        for (int t = 0; t < numTexturedTriangles; t++) {
-            uint16_t vertex1 = mem.readU16();
-            uint16_t vertex2 = mem.readU16();
-            uint16_t vertex3 = mem.readU16();
-            uint16_t texture = mem.readU16();
+    meshStats.decoded = offsets->size();
+    std::vector<bool> seen(offsets->size(), false);
+    for (auto slot : meshIndices) {
+        if (slot == invalidMesh)
+            continue;
+        if (seen.at(slot))
+            meshStats.bytesSkipped += lengths.at(slot);
+        seen.at(slot) = true;
+    }
 
-            texturedTriangles.emplace_back(texture, vertex1, vertex2, vertex3);
-        }
+    // Meshes are small, so decode them in batches on the pool
+    static const unsigned int batchSize = 64;
+    unsigned int numMeshes = offsets->size();
+    meshes.assign(numMeshes, nullptr);
+    for (unsigned int start = 0; start < numMeshes; start += batchSize) {
+        jobs.push_back(pool.push([this, start, buffer, numMeshData, numMeshes, offsets] {
+            for (unsigned int i = start; (i < (start + batchSize)) && (i < numMeshes); i++) {
+                uint32_t offset = offsets->at(i);
+                meshes.at(i) = decodeMesh(buffer + offset, (numMeshData * 2) - offset);
+            }
+        }));
+    }
 
-        int16_t numColoredRectangles = mem.read16();
-        std::vector<IndexedColoredRectangle> coloredRectangles;
-        for (int r = 0; r < numColoredRectangles; r++) {
-            uint16_t vertex1 = mem.readU16();
-            uint16_t vertex2 = mem.readU16();
-            uint16_t vertex3 = mem.readU16();
-            uint16_t vertex4 = mem.readU16();
-            uint16_t texture = mem.readU16();
-
-            int index = getPaletteIndex(texture);
-            coloredRectangles.emplace_back(index, vertex1, vertex2, vertex3, vertex4);
-        }
+    if (numMeshPointers > 0)
+        Log::get(LOG_INFO) << "LoaderTR2: Found " << numMeshPointers << " Meshes, decoding "
+                           << numMeshes << " (" << (meshStats.pointers - meshStats.offsets)
+                           << " shared offsets, " << (meshStats.offsets - numMeshes)
+                           << " identical)!" << Log::endl;
+    else
+        Log::get(LOG_INFO) << "LoaderTR2: No Meshes in this level?!" << Log::endl;
+}
 
-        int16_t numColoredTriangles = mem.read16();
-        std::vector<IndexedColoredRectangle> coloredTriangles;
-        for (int t = 0; t < numColoredTriangles; t++) {
-            uint16_t vertex1 = mem.readU16();
-            uint16_t vertex2 = mem.readU16();
-            uint16_t vertex3 = mem.readU16();
-            uint16_t texture = mem.readU16();
+uint16_t LoaderTR2::readCount(BinaryReader& r, long long size, std::size_t elementSize) {
+    if ((r.tell() + 2) > size)
+        return 0;
 
-            int index = getPaletteIndex(texture);
-            coloredTriangles.emplace_back(index, vertex1, vertex2, vertex3);
-        }
+    uint16_t count = r.readU16();
+    long long left = (size - r.tell()) / static_cast<long long>(elementSize);
+    return (count > left) ? static_cast<uint16_t>(left) : count;
+}
 
-        Mesh* mesh = new Mesh(vertices, texturedRectangles, texturedTriangles,
-                              coloredRectangles, coloredTriangles);
-        World::addMesh(mesh);
+Mesh* LoaderTR2::decodeMesh(const char* data, long long size) {
+    BinaryMemory mem(data, size);
+
+    int16_t mx = mem.read16();
+    int16_t my = mem.read16();
+    int16_t mz = mem.read16();
+    int32_t collisionSize = mem.read32();
+    // TODO store mesh collision info somewhere
+
+    uint16_t numVertices = readCount(mem, size, sizeof(Vertex_t));
+    std::vector<Vertex_t> rawVertices(numVertices);
+    mem.readStruct(rawVertices.data(), numVertices);
+    std::vector<glm::vec3> vertices;
+    vertices.reserve(numVertices);
+    for (auto& v : rawVertices)
+        vertices.emplace_back(v.x, v.y, v.z);
+
+    int16_t numNormals = mem.read16();
+    if (numNormals > 0) {
+        // External vertex lighting is used, with the lighting calculated
+        // from the rooms ambient and point-source lighting values. The
+        // latter appears to use a simple Lambert law for directionality:
+        // intensity is proportional to
+        //      max((normal direction).(direction to source), 0)
+        // TODO store normals somewhere
+        mem.seek(mem.tell() + (numNormals * sizeof(Vertex_t)));
+    } else if (numNormals < 0) {
+        // Internal vertex lighting is used,
+        // using the data included with the mesh
+        // TODO store lights somewhere
+        mem.seek(mem.tell() + (numNormals * -2));
     }
 
-    if (numMeshPointers > 0)
-        Log::get(LOG_INFO) << "LoaderTR2: Found " << numMeshPointers << " Meshes!" << Log::endl;
-    else
-        Log::get(LOG_INFO) << "LoaderTR2: No Meshes in this level?!" << Log::endl;
+    uint16_t numTexturedRectangles = readCount(mem, size, sizeof(Rectangle_t));
+    std::vector<Rectangle_t> rects(numTexturedRectangles);
+    mem.readStruct(rects.data(), rects.size());
+    std::vector<IndexedRectangle> texturedRectangles;
+    for (auto& r : rects)
+        texturedRectangles.emplace_back(r.texture, r.vertices[0], r.vertices[1],
+                                        r.vertices[2], r.vertices[3]);
+
+    uint16_t numTexturedTriangles = readCount(mem, size, sizeof(Triangle_t));
+    std::vector<Triangle_t> tris(numTexturedTriangles);
+    mem.readStruct(tris.data(), tris.size());
+    std::vector<IndexedRectangle> texturedTriangles;
+    for (auto& t : tris)
+        texturedTriangles.emplace_back(t.texture, t.vertices[0], t.vertices[1], t.vertices[2]);
+
+    uint16_t numColoredRectangles = readCount(mem, size, sizeof(Rectangle_t));
+    rects.resize(numColoredRectangles);
+    mem.readStruct(rects.data(), rects.size());
+    std::vector<IndexedColoredRectangle> coloredRectangles;
+    for (auto& r : rects)
+        coloredRectangles.emplace_back(getPaletteIndex(r.texture), r.vertices[0],
+                                       r.vertices[1], r.vertices[2], r.vertices[3]);
+
+    uint16_t numColoredTriangles = readCount(mem, size, sizeof(Triangle_t));
+    tris.resize(numColoredTriangles);
+    mem.readStruct(tris.data(), tris.size());
+    std::vector<IndexedColoredRectangle> coloredTriangles;
+    for (auto& t : tris)
+        coloredTriangles.emplace_back(getPaletteIndex(t.texture), t.vertices[0],
+                                      t.vertices[1], t.vertices[2]);
+
+    return new Mesh(vertices, texturedRectangles, texturedTriangles,
+                    coloredRectangles, coloredTriangles);
 }
 
 void LoaderTR2::loadStaticMeshes() {
@@ -684,133 +930,97 @@ void LoaderTR2::loadStaticMeshes() {
 
 // ---- Moveables ----
 
-struct Animation_t {
-    uint32_t frameOffset;
-    uint8_t frameRate, frameSize;
-    uint16_t stateID, frameStart, frameEnd, nextAnimation;
-    uint16_t nextFrame, numStateChanges, stateChangeOffset;
-    uint16_t numAnimCommands, animCommandOffset;
-
-    Animation_t(uint32_t fo, uint8_t fr, uint8_t fs, uint16_t si,
-                uint16_t fst, uint16_t fe, uint16_t na, uint16_t nf,
-                uint16_t ns, uint16_t so, uint16_t nac, uint16_t ao)
-        : frameOffset(fo), frameRate(fr), frameSize(fs),
-          stateID(si), frameStart(fst), frameEnd(fe), nextAnimation(na),
-          nextFrame(nf), numStateChanges(ns), stateChangeOffset(so),
-          numAnimCommands(nac), animCommandOffset(ao) { }
+struct Moveable_t {
+    uint32_t objectID;
+    uint16_t numMeshes, startingMesh;
+    uint32_t meshTree, frameOffset;
+    uint16_t animation;
 };
 
-struct StateChange_t {
-    uint16_t stateID, numAnimDispatches, animDispatchOffset;
-
-    StateChange_t(uint16_t s, uint16_t n, uint16_t a)
-        : stateID(s), numAnimDispatches(n), animDispatchOffset(a) { }
-};
-
-struct AnimDispatch_t {
-    int16_t low, high, nextAnimation, nextFrame;
-
-    AnimDispatch_t(int16_t l, int16_t h, int16_t na, int16_t nf)
-        : low(l), high(h), nextAnimation(na), nextFrame(nf) { }
-};
+void LoaderTR2::loadAngleSet(BinaryReader& frame, long long size, uint16_t numBones,
+                             uint32_t* angles) {
+    for (int i = 0; i < numBones; i++) {
+        angles[i] = 0;
+        if ((frame.tell() + 2) > size)
+            continue;
 
-void LoaderTR2::loadAngleSet(BoneFrame* bf, BinaryReader& frame, uint16_t numMeshes,
-                             uint16_t startingMesh, uint32_t meshTree,
-                             uint32_t numMeshTrees, std::vector<int32_t> meshTrees) {
-    for (int i = 0; i < numMeshes; i++) {
-        int mesh = startingMesh + i;
-        glm::vec3 offset(0.0f, 0.0f, 0.0f);
-        float rotation[3] = { 0.0f, 0.0f, 0.0f };
-        char flag = (i == 0) ? 2 : 0;
-
-        // Nonprimary tag - positioned relative to first tag
-        if (i != 0) {
-            char* tmp = reinterpret_cast<char*>(&meshTrees[0]) + meshTree; // TODO (meshTree * 4)?
-            tmp += (i - 1) * 16; // TODO ?
-            BinaryMemory tree(tmp, (numMeshTrees * 4) - meshTree - ((i - 1) * 16));
-            flag = static_cast<char>(tree.readU32());
-            offset.x = tree.read32();
-            offset.y = tree.read32();
-            offset.z = tree.read32();
-
-            uint16_t a = frame.readU16();
-            if (a & 0xC000) {
-                // Single angle
-                int index = 0;
-                if ((a & 0x8000) && (a & 0x4000))
-                    index = 2;
-                else if (a & 0x4000)
-                    index = 1;
-                rotation[index] = (static_cast<float>(a & 0x03FF)) * 360.0f / 1024.0f;
-            } else {
-                // Three angles
-                uint16_t b = frame.readU16();
-                rotation[0] = (a & 0x3FF0) >> 4;
-                rotation[1] = ((a & 0x000F) << 6) | ((b & 0xFC00) >> 10);
-                rotation[2] = b & 0x03FF;
-                for (int n = 0; n < 3; n++)
-                    rotation[n] = rotation[n] * 360.0f / 1024.0f;
-            }
+        uint16_t a = frame.readU16();
+        if (a & 0xC000) {
+            // Single angle
+            uint16_t angle = a & 0x03FF;
+            if ((a & 0x8000) && (a & 0x4000))
+                angles[i] = AnimationStore::packAngles(0, 0, angle);
+            else if (a & 0x4000)
+                angles[i] = AnimationStore::packAngles(0, angle, 0);
+            else
+                angles[i] = AnimationStore::packAngles(angle, 0, 0);
+        } else if ((frame.tell() + 2) <= size) {
+            // Three angles
+            uint16_t b = frame.readU16();
+            angles[i] = AnimationStore::packAngles((a & 0x3FF0) >> 4,
+                                                   ((a & 0x000F) << 6) | ((b & 0xFC00) >> 10),
+                                                   b & 0x03FF);
         }
-
-        glm::vec3 rot(rotation[0], rotation[1], rotation[2]);
-        BoneTag* bt = new BoneTag(mesh, offset, rot, flag);
-        bf->add(bt);
     }
 }
 
-BoneFrame* LoaderTR2::loadFrame(BinaryReader& frame, uint16_t numMeshes,
-                                uint16_t startingMesh, uint32_t meshTree,
-                                uint32_t numMeshTrees, std::vector<int32_t> meshTrees) {
-    int16_t bb1x = frame.read16();
-    int16_t bb1y = frame.read16();
-    int16_t bb1z = frame.read16();
-    int16_t bb2x = frame.read16();
-    int16_t bb2y = frame.read16();
-    int16_t bb2z = frame.read16();
-
-    glm::vec3 pos;
-    pos.x = frame.read16();
-    pos.y = frame.read16();
-    pos.z = frame.read16();
-
-    BoneFrame* bf = new BoneFrame(pos);
-    loadAngleSet(bf, frame, numMeshes, startingMesh, meshTree, numMeshTrees, meshTrees);
-
-    return bf;
+long LoaderTR2::loadFrame(const char* data, long long size, uint16_t numBones) {
+    // Bounding box corners, followed by the offset
+    Vertex_t header[3];
+    if (size < static_cast<long long>(sizeof(header)))
+        return -1;
+
+    BinaryMemory frame(data, size);
+    frame.readStruct(header, 3);
+    int16_t bounds[6] = { header[0].x, header[0].y, header[0].z,
+                          header[1].x, header[1].y, header[1].z
+                        };
+    int16_t position[3] = { header[2].x, header[2].y, header[2].z };
+
+    frameAngles.resize(numBones);
+    loadAngleSet(frame, size, numBones, frameAngles.data());
+    return World::getAnimations().addFrame(bounds, position, frameAngles.data(), numBones);
+}
+
+void LoaderTR2::loadAnimationSpeed() {
+    file.seek(file.tell() + 8); // Skip 8 unknown bytes
 }
 
 void LoaderTR2::loadMoveables() {
+    AnimationStore& store = World::getAnimations();
+
     uint32_t numAnimations = file.readU32();
-    std::vector<Animation_t> animations;
+    std::vector<uint32_t> frameOffsets; // *Byte* Offset into Frames[] (so divide by 2!)
+    std::vector<uint8_t> frameSizes;
     for (unsigned int a = 0; a < numAnimations; a++) {
-        // *Byte* Offset into Frames[] (so divide by 2!)
-        uint32_t frameOffset = file.readU32();
-        uint8_t frameRate = file.readU8(); // Engine ticks per frame
+        AnimationStore::Animation anim;
+        frameOffsets.push_back(file.readU32());
+        anim.frameRate = file.readU8(); // Engine ticks per frame
 
         // Number of bit16s in Frames[] used by this animation
         // Be careful when parsing frames using the FrameSize value
         // as the size of each frame, since an animations frame range
         // may extend into the next animations frame range, and that
         // may have a different FrameSize value.
-        uint8_t frameSize = file.readU8();
+        frameSizes.push_back(file.readU8());
 
-        uint16_t stateID = file.readU16();
+        anim.stateID = file.readU16();
 
-        file.seek(file.tell() + 8); // Skip 8 unknown bytes
+        loadAnimationSpeed();
 
-        uint16_t frameStart = file.readU16(); // First frame in this animation
-        uint16_t frameEnd = file.readU16(); // Last frame in this animation
-        uint16_t nextAnimation = file.readU16();
-        uint16_t nextFrame = file.readU16();
-        uint16_t numStateChanges = file.readU16();
-        uint16_t stateChangeOffset = file.readU16(); // Index into StateChanges[]
-        uint16_t numAnimCommands = file.readU16(); // How many animation commands to use
-        uint16_t animCommandOffset = file.readU16(); // Index into AnimCommand[]
+        anim.frameStart = file.readU16(); // First frame in this animation
+        anim.frameEnd = file.readU16(); // Last frame in this animation
+        anim.nextAnimation = file.readU16();
+        anim.nextFrame = file.readU16();
+        anim.numStateChanges = file.readU16();
+        anim.stateChangeOffset = file.readU16(); // Index into StateChanges[]
+        anim.numCommands = file.readU16(); // How many animation commands to use
+        anim.commandOffset = file.readU16(); // Index into AnimCommand[]
 
-        animations.emplace_back(frameOffset, frameRate, frameSize,
-                                stateID, frameStart, frameEnd, nextAnimation, nextFrame, numStateChanges,
-                                stateChangeOffset, numAnimCommands, animCommandOffset);
+        // Keyframes are added with the model using this animation
+        anim.firstFrame = 0;
+        anim.numFrames = 0;
+        store.addAnimation(anim);
     }
 
     if (numAnimations > 0)
@@ -819,13 +1029,12 @@ void LoaderTR2::loadMoveables() {
         Log::get(LOG_INFO) << "LoaderTR2: No Animations in this level?!" << Log::endl;
 
     uint32_t numStateChanges = file.readU32();
-    std::vector<StateChange_t> stateChanges;
     for (unsigned int s = 0; s < numStateChanges; s++) {
-        uint16_t stateID = file.readU16();
-        uint16_t numAnimDispatches = file.readU16(); // Number of ranges (always 1..5?)
-        uint16_t animDispatchOffset = file.readU16(); // Index into AnimDispatches[]
-
-        stateChanges.emplace_back(stateID, numAnimDispatches, animDispatchOffset);
+        AnimationStore::StateChange change;
+        change.stateID = file.readU16();
+        change.numDispatches = file.readU16(); // Number of ranges (always 1..5?)
+        change.dispatchOffset = file.readU16(); // Index into AnimDispatches[]
+        store.addStateChange(change);
     }
 
     if (numStateChanges > 0)
@@ -834,14 +1043,13 @@ void LoaderTR2::loadMoveables() {
         Log::get(LOG_INFO) << "LoaderTR2: No StateChanges in this level?!" << Log::endl;
 
     uint32_t numAnimDispatches = file.readU32();
-    std::vector<AnimDispatch_t> animDispatches;
     for (unsigned int a = 0; a < numAnimDispatches; a++) {
-        int16_t low = file.read16(); // Lowest frame that uses this range
-        int16_t high = file.read16(); // Highest frame (+1?) that uses this range
-        int16_t nextAnimation = file.read16(); // Animation to go to
-        int16_t nextFrame = file.read16(); // Frame offset to go to
-
-        animDispatches.emplace_back(low, high, nextAnimation, nextFrame);
+        AnimationStore::Dispatch dispatch;
+        dispatch.low = file.read16(); // Lowest frame that uses this range
+        dispatch.high = file.read16(); // Highest frame (+1?) that uses this range
+        dispatch.nextAnimation = file.read16(); // Animation to go to
+        dispatch.nextFrame = file.read16(); // Frame offset to go to
+        store.addDispatch(dispatch);
     }
 
     if (numAnimDispatches > 0)
@@ -851,12 +1059,11 @@ void LoaderTR2::loadMoveables() {
         Log::get(LOG_INFO) << "LoaderTR2: No AnimationDispatches in this level?!" << Log::endl;
 
     uint32_t numAnimCommands = file.readU32();
-    std::vector<int16_t> animCommands;
     for (unsigned int a = 0; a < numAnimCommands; a++) {
         // A list of Opcodes with zero or more operands each,
         // some referring to the whole animation (jump/grab points),
         // some to specific frames (sound, bubbles, ...).
-        animCommands.push_back(file.read16());
+        store.addCommand(file.read16());
     }
 
     if (numAnimCommands > 0)
@@ -866,25 +1073,16 @@ void LoaderTR2::loadMoveables() {
 
     // This is really one uint32_t flags, followed by
     // three int32_t x, y, z. However, we're given the number
-    // of 32bits, as well as byte indices later, so we store
-    // it as a single list of int32_t.
+    // of 32bits, as well as indices into them later, so we
+    // store it as a single list of int32_t.
+    // 0x0002 - Put parent mesh on the mesh stack
+    // 0x0001 - Pop mesh from stack, use as parent mesh
+    // When both are not set, use previous mesh as parent mesh
+    // When both are set, do 0x0001 first, then 0x0002, thereby
+    // reading the stack but not changing it
     uint32_t numMeshTrees = file.readU32();
-    std::vector<int32_t> meshTrees;
-    for (unsigned int m = 0; m < numMeshTrees; m++) {
-        // 0x0002 - Put parent mesh on the mesh stack
-        // 0x0001 - Pop mesh from stack, use as parent mesh
-        // When both are not set, use previous mesh as parent mesh
-        // When both are set, do 0x0001 first, then 0x0002, thereby
-        // reading the stack but not changing it
-        //uint32_t flags = file.readU32();
-
-        // Offset of mesh origin from the parent mesh origin
-        //int32_t x = file.read32();
-        //int32_t y = file.read32();
-        //int32_t z = file.read32();
-
-        meshTrees.push_back(file.read32());
-    }
+    std::vector<int32_t> meshTrees(numMeshTrees);
+    file.readArray(meshTrees.data(), numMeshTrees);
 
     if (numMeshTrees > 0)
         Log::get(LOG_INFO) << "LoaderTR2: Found " << numMeshTrees << " MeshTrees!" << Log::endl;
@@ -892,81 +1090,167 @@ void LoaderTR2::loadMoveables() {
         Log::get(LOG_INFO) << "LoaderTR2: No MeshTrees in this level?!" << Log::endl;
 
     uint32_t numFrames = file.readU32();
-    std::vector<uint16_t> frames;
-    for (unsigned int f = 0; f < numFrames; f++) {
-        // int16 bb1x, bb1y, bb1z
-        // int16 bb2x, bb2y, bb2z
-        // int16 offsetX, offsetY, offsetZ
-        // What follows next is a list of angles with numMeshes (from Moveable) entries.
-        // If the top bit (0x8000) of the first uint16 is set, a single X angle follows,
-        // if the second bit (0x4000) is set, a Y angle follows, both are a Z angle.
-        // If none is set, it's a three-axis rotation. The next 10 bits (0x3FF0) are
-        // the X rotation, the next 10 (0x000F 0xFC00) are Y, the next (0x03FF) are
-        // the Z rotation. The scaling is always 0x100->90deg.
-        // Rotation order: Y, X, Z!
-        frames.push_back(file.readU16());
-    }
+    // int16 bb1x, bb1y, bb1z
+    // int16 bb2x, bb2y, bb2z
+    // int16 offsetX, offsetY, offsetZ
+    // What follows next is a list of angles with numMeshes (from Moveable) entries.
+    // If the top bit (0x8000) of the first uint16 is set, a single X angle follows,
+    // if the second bit (0x4000) is set, a Y angle follows, both are a Z angle.
+    // If none is set, it's a three-axis rotation. The next 10 bits (0x3FF0) are
+    // the X rotation, the next 10 (0x000F 0xFC00) are Y, the next (0x03FF) are
+    // the Z rotation. The scaling is always 0x100->90deg.
+    // Rotation order: Y, X, Z!
+    // Frames[] is parsed in place, straight out of the mapped level file
+    const char* frames = file.span(numFrames * 2);
+    long long framesSize = numFrames * 2;
 
     if (numFrames > 0)
         Log::get(LOG_INFO) << "LoaderTR2: Found " << numFrames << " Frames!" << Log::endl;
     else
         Log::get(LOG_INFO) << "LoaderTR2: No Frames in this level?!" << Log::endl;
 
+    // The animations of a moveable are only known with the next one
     uint32_t numMoveables = file.readU32();
-    for (unsigned int m = 0; m < numMoveables; m++) {
-        // Item identifier, matched in Items[]
-        uint32_t objectID = file.readU32();
-        uint16_t numMeshes = file.readU16();
-        uint16_t startingMesh = file.readU16(); // Offset into MeshPointers[]
-        uint32_t meshTree = file.readU32(); // Offset into MeshTree[]
+    std::vector<Moveable_t> moveables(numMoveables);
+    for (auto& moveable : moveables) {
+        moveable.objectID = file.readU32(); // Item identifier, matched in Items[]
+        moveable.numMeshes = file.readU16();
+        moveable.startingMesh = file.readU16(); // Offset into MeshPointers[]
+        moveable.meshTree = file.readU32(); // Index into MeshTrees[]
         // *Byte* offset into Frames[] (divide by 2 for Frames[i])
-        uint32_t frameOffset = file.readU32(); // Only needed if no animation
+        moveable.frameOffset = file.readU32();
+        moveable.animation = file.readU16();
+    }
+
+    for (unsigned int m = 0; m < numMoveables; m++) {
+        auto& moveable = moveables.at(m);
+        uint32_t frameOffset = moveable.frameOffset; // Only needed if no animation
+        if (framesSize <= frameOffset)
+            continue; // TR1/LEVEL3A crashes without this?!
+
+        AnimationStore::Model model;
+        model.id = moveable.objectID;
+        model.numBones = moveable.numMeshes;
+        model.startingMesh = moveable.startingMesh;
 
         // If animation index is 0xFFFF, the object is stationary or
-        // animated by the engine (ponytail)
-        uint16_t animation = file.readU16();
+        // animated by the engine (ponytail). Otherwise its animations
+        // last until the first animation of the next animated moveable.
+        model.firstAnimation = AnimationStore::noAnimation;
+        model.numAnimations = 0;
+        if (moveable.animation < numAnimations) {
+            uint32_t end = numAnimations;
+            for (unsigned int n = m + 1; n < numMoveables; n++) {
+                if (moveables.at(n).animation != 0xFFFF) {
+                    if (moveables.at(n).animation > moveable.animation)
+                        end = moveables.at(n).animation;
+                    break;
+                }
+            }
+            model.firstAnimation = moveable.animation;
+            model.numAnimations = end - moveable.animation;
+        }
 
-        /*
-        if (animation == 0xFFFF) {
-        */
-        // Just add the frame indicated in frameOffset, nothing else
-        char* tmp = reinterpret_cast<char*>(&frames[0]) + frameOffset;
-        BinaryMemory frame(tmp, (numFrames * 2) - frameOffset);
+        // All keyframes of an animation are stored consecutively
+        long frame = -1;
+        for (unsigned int a = 0; a < model.numAnimations; a++) {
+            auto& anim = store.getAnimation(model.firstAnimation + a);
+            uint32_t offset = frameOffsets.at(model.firstAnimation + a);
+            uint32_t stride = frameSizes.at(model.firstAnimation + a) * 2;
+            uint32_t count = 1;
+            if ((anim.frameRate > 0) && (anim.frameEnd >= anim.frameStart) && (stride > 0))
+                count = ((anim.frameEnd - anim.frameStart) / anim.frameRate) + 1;
+
+            // Already added, if shared with another model
+            if (anim.numFrames > 0)
+                count = 0;
+
+            for (uint32_t f = 0; f < count; f++) {
+                long long start = offset + (static_cast<long long>(f) * stride);
+                if (start >= framesSize)
+                    break;
+
+                long index = loadFrame(frames + start, framesSize - start, model.numBones);
+                if (index < 0)
+                    break;
+                if (anim.numFrames == 0)
+                    anim.firstFrame = index;
+                anim.numFrames++;
+            }
 
-        if (((numFrames * 2) - frameOffset) <= 0)
-            continue; // TR1/LEVEL3A crashes without this?!
+            if ((offset == frameOffset) && (anim.numFrames > 0))
+                frame = anim.firstFrame;
+        }
 
-        BoneFrame* bf = loadFrame(frame, numMeshes, startingMesh, meshTree, numMeshTrees, meshTrees);
-        AnimationFrame* af = new AnimationFrame(0);
-        af->add(bf);
+        // Just add the frame indicated in frameOffset, if it is not part of an animation
+        if (frame < 0)
+            frame = loadFrame(frames + frameOffset, framesSize - frameOffset, model.numBones);
+        if (frame < 0)
+            continue;
 
-        SkeletalModel* sm = new SkeletalModel(objectID);
-        sm->add(af);
-        World::addSkeletalModel(sm);
-        /*
-        } else {
-            // TODO Add the whole animation hierarchy
-            auto& anim = animations.at(animation);
+        // Bone parents follow from the mesh stack operations in MeshTrees[],
+        // four int32_t for every mesh but the first one
+        uint32_t meshTree = moveable.meshTree;
+        if ((model.numBones > 1) && ((meshTree + ((model.numBones - 1) * 4)) > numMeshTrees)) {
+            Log::get(LOG_DEBUG) << "LoaderTR2: Invalid MeshTree " << meshTree << Log::endl;
+            meshTree = numMeshTrees;
+        }
+        std::vector<int> stack;
+        int previous = 0;
+        for (unsigned int b = 0; b < model.numBones; b++) {
+            if (b == 0) {
+                unsigned long bone = store.addBone(-1, 0, 0, 0, 2);
+                model.firstBone = bone;
+                continue;
+            }
 
-            char* tmp = reinterpret_cast<char*>(&frames[0]) + anim.frameOffset;
-            BinaryMemory frame(tmp, (numFrames * 2) - anim.frameOffset);
-            AnimationFrame* af = new AnimationFrame(0);
+            unsigned int t = meshTree + ((b - 1) * 4);
+            int32_t flags = 0, offset[3] = { 0, 0, 0 };
+            if ((t + 4) <= numMeshTrees) {
+                flags = meshTrees.at(t);
+                for (int i = 0; i < 3; i++)
+                    offset[i] = meshTrees.at(t + 1 + i);
+            }
 
-            for (int i = 0; i < ((anim.frameEnd - anim.frameStart) + 1); i++) {
-                BoneFrame* bf = loadFrame(frame, numMeshes, startingMesh,
-                                          meshTree, numMeshTrees, meshTrees);
-                af->add(bf);
+            int parent = previous;
+            if ((flags & 0x01) && (stack.size() > 0)) {
+                parent = stack.back();
+                stack.pop_back();
             }
+            if (flags & 0x02)
+                stack.push_back(parent);
 
-            SkeletalModel* sm = new SkeletalModel(objectID);
-            sm->add(af);
-            World::addSkeletalModel(sm);
+            store.addBone(parent, offset[0], offset[1], offset[2], static_cast<uint8_t>(flags));
+            previous = b;
         }
-        */
+
+        model.frame = frame;
+        store.addModel(model);
+
+        // The SkeletalModel only shows this one frame, built from the store
+        unsigned long count = store.getFrameAngleCount(frame, 1);
+        std::vector<float> rotation(count * 3);
+        store.decodeFrames(frame, 1, &rotation[0], &rotation[count], &rotation[count * 2]);
+
+        BoneFrame* bf = new BoneFrame(store.getFramePosition(frame));
+        for (unsigned int b = 0; b < model.numBones; b++) {
+            unsigned long bone = model.firstBone + b;
+            glm::vec3 rot(rotation[b], rotation[count + b], rotation[(count * 2) + b]);
+            bf->add(new BoneTag(model.startingMesh + b, store.getBoneOffset(bone), rot,
+                                static_cast<char>(store.getBoneFlags(bone))));
+        }
+
+        AnimationFrame* af = new AnimationFrame(0);
+        af->add(bf);
+
+        SkeletalModel* sm = new SkeletalModel(model.id);
+        sm->add(af);
+        World::addSkeletalModel(sm);
     }
 
     if (numMoveables > 0)
-        Log::get(LOG_INFO) << "LoaderTR2: Found " << numMoveables << " Moveables!" << Log::endl;
+        Log::get(LOG_INFO) << "LoaderTR2: Found " << numMoveables << " Moveables, "
+                           << store.sizeFrame() << " Keyframes!" << Log::endl;
     else
         Log::get(LOG_INFO) << "LoaderTR2: No Moveables in this level?!" << Log::endl;
 }
@@ -1018,6 +1302,8 @@ void LoaderTR2::loadItems() {
 
 void LoaderTR2::loadBoxesOverlapsZones() {
     uint32_t numBoxes = file.readU32();
+    std::vector<Navigation::Box> boxes(numBoxes);
+    std::vector<uint16_t> overlapIndices(numBoxes);
     for (unsigned int b = 0; b < numBoxes; b++) {
         // Sectors (* 1024 units)
         uint8_t zMin = file.readU8();
@@ -1029,52 +1315,49 @@ void LoaderTR2::loadBoxesOverlapsZones() {
 
         // Index into overlaps[]. The high bit is sometimes set
         // this occurs in front of swinging doors and the like
-        uint16_t overlapIndex = file.readU16();
-
-        // TODO store boxes somewhere
+        overlapIndices.at(b) = file.readU16();
+
+        Navigation::Box& box = boxes.at(b);
+        box.xMin = xMin * 1024;
+        box.xMax = xMax * 1024;
+        box.zMin = zMin * 1024;
+        box.zMax = zMax * 1024;
+        box.floor = trueFloor;
+        box.flags = 0;
     }
 
+    // Apparently used by NPCs to decide where to go next.
+    // List of neighboring boxes for each box.
+    // Each entry is a uint16, 0x8000 set marks end of list.
     uint32_t numOverlaps = file.readU32();
-    std::vector<std::vector<uint16_t>> overlaps;
-    overlaps.emplace_back();
-    unsigned int list = 0;
-    for (unsigned int o = 0; o < numOverlaps; o++) {
-        // Apparently used by NPCs to decide where to go next.
-        // List of neighboring boxes for each box.
-        // Each entry is a uint16, 0x8000 set marks end of list.
-        uint16_t e = file.readU16();
-        overlaps.at(list).push_back(e);
-        if (e & 0x8000) {
-            overlaps.emplace_back();
-            list++;
-        }
-    }
-
-    // TODO store overlaps somewhere
+    std::vector<uint16_t> overlaps(numOverlaps);
+    if (numOverlaps > 0)
+        file.readArray(&overlaps[0], numOverlaps);
 
-    for (unsigned int z = 0; z < numBoxes; z++) {
-        // Normal room state
-        int16_t ground1 = file.read16();
-        int16_t ground2 = file.read16();
-        int16_t ground3 = file.read16();
-        int16_t ground4 = file.read16();
-        int16_t fly = file.read16();
+    // Ground zones 1 to 4 and fly zone, for the normal and the alternate
+    // room state. Every zone is one array with an entry per box.
+    std::vector<int16_t> zones(numBoxes * Navigation::zoneTables);
+    if (numBoxes > 0)
+        file.readArray(&zones[0], zones.size());
 
-        // Alternate room state
-        int16_t ground1alt = file.read16();
-        int16_t ground2alt = file.read16();
-        int16_t ground3alt = file.read16();
-        int16_t ground4alt = file.read16();
-        int16_t flyAlt = file.read16();
+    buildNavigation(boxes, overlapIndices, overlaps, zones);
+}
 
-        // TODO store zones somewhere
-    }
+void LoaderTR2::buildNavigation(const std::vector<Navigation::Box>& boxes,
+                                const std::vector<uint16_t>& overlapIndices,
+                                const std::vector<uint16_t>& overlaps,
+                                const std::vector<int16_t>& zones) {
+    Navigation& n = World::getNavigation();
+    unsigned long invalid = n.build(boxes, overlapIndices, overlaps, zones);
 
-    if ((numBoxes > 0) || (numOverlaps > 0))
-        Log::get(LOG_INFO) << "LoaderTR2: Found NPC NavigationHints (" << numBoxes
-                           << ", " << numOverlaps << ", " << list << "), unimplemented!" << Log::endl;
+    if (boxes.size() > 0)
+        Log::get(LOG_INFO) << "LoaderTR2: Found " << boxes.size() << " NPC boxes with "
+                           << overlaps.size() << " overlaps" << Log::endl;
     else
         Log::get(LOG_INFO) << "LoaderTR2: No NPC NavigationHints in this level?!" << Log::endl;
+
+    if (invalid > 0)
+        Log::get(LOG_DEBUG) << "LoaderTR2: " << invalid << " invalid box overlaps!" << Log::endl;
 }
 
 // ---- Sound ----
@@ -1151,33 +1434,40 @@ void LoaderTR2::loadExternalSoundFile(std::string f) {
         f = "MAIN.SFX";
     }
 
-    BinaryFile sfx;
-    if (sfx.open(f) != 0) {
+    // Stays mapped, samples are only decoded when they are played
+    int sampleFile = SoundManager::addSampleFile(f);
+    if (sampleFile < 0) {
         Log::get(LOG_INFO) << "LoaderTR2: Can't open \"" << f << "\"!" << Log::endl;
         return;
     }
 
-    Log::get(LOG_INFO) << "LoaderTR2: Loading \"" << f << "\"" << Log::endl;
+    Log::get(LOG_INFO) << "LoaderTR2: Indexing \"" << f << "\"" << Log::endl;
 
-    int riffCount = loadSoundFiles(sfx);
+    long long size = 0;
+    SoundManager::getSampleFile(sampleFile, &size);
+    int riffCount = loadSoundFiles(sampleFile, 0, size);
     if (riffCount > 0)
-        Log::get(LOG_INFO) << "LoaderTR2: Loaded " << riffCount << " SoundSamples" << Log::endl;
+        Log::get(LOG_INFO) << "LoaderTR2: Indexed " << riffCount << " SoundSamples" << Log::endl;
     else if (riffCount == 0)
         Log::get(LOG_INFO) << "LoaderTR2: No SoundSamples found!" << Log::endl;
     else
         Log::get(LOG_ERROR) << "LoaderTR2: Error loading SoundSamples!" << Log::endl;
 }
 
-int LoaderTR2::loadSoundFiles(BinaryReader& sfx, unsigned int count) {
-    int riffCount = 0;
+int LoaderTR2::loadSoundFiles(unsigned int sampleFile, long long offset, long long size,
+                              unsigned int count) {
+    // Only the RIFF headers are read, no sample data is touched
+    const char* data = SoundManager::getSampleFile(sampleFile) + offset;
+    unsigned int riffCount = 0;
+    BinaryMemory sfx(data, size);
     while (!sfx.eof()) {
         if ((count > 0) && (riffCount >= count))
             break;
 
+        long long start = sfx.tell();
         char test[5];
         test[4] = '\0';
-        for (int i = 0; i < 4; i++)
-            test[i] = sfx.read8();
+        sfx.readArray(test, 4);
 
         if (std::string("RIFF") != std::string(test)) {
             Log::get(LOG_DEBUG) << "LoaderTR2: SoundSamples invalid! (" << riffCount
@@ -1187,18 +1477,12 @@ int LoaderTR2::loadSoundFiles(BinaryReader& sfx, unsigned int count) {
 
         // riffSize is (fileLength - 8)
         uint32_t riffSize = sfx.readU32();
-
-        unsigned char* buff = new unsigned char[riffSize + 8];
-        sfx.seek(sfx.tell() - 8);
-        for (int i = 0; i < (riffSize + 8); i++)
-            buff[i] = sfx.readU8();
-
-        int ret = Sound::loadBuffer(buff, riffSize + 8);
-        delete [] buff;
-        orAssertGreaterThanEqual(ret, 0);
-
+        orAssertLessThanEqual(start + riffSize + 8, size);
+        SoundManager::addSample(sampleFile, offset + start, riffSize + 8);
         riffCount++;
+        sfx.seek(start + riffSize + 8);
     }
+
     return riffCount;
 }
 
@@ -18,31 +18,54 @@ int LoaderTR3::load(std::string f) {
         return 2; // Not a TR3 level?!
     }
 
+    beginSection("Palette");
     loadPalette();
+    beginSection("Textures");
     loadTextures();
 
     file.seek(file.tell() + 4); // Unused value?
 
+    beginSection("Rooms");
     loadRooms();
+    beginSection("FloorData");
     loadFloorData();
+    beginSection("Meshes");
     loadMeshes();
+    beginSection("Moveables");
     loadMoveables();
+    beginSection("StaticMeshes");
     loadStaticMeshes();
+    beginSection("Sprites");
     loadSprites();
+    beginSection("Cameras");
     loadCameras();
+    beginSection("SoundSources");
     loadSoundSources();
+    beginSection("BoxesOverlapsZones");
     loadBoxesOverlapsZones();
+    beginSection("AnimatedTextures");
     loadAnimatedTextures();
+    beginSection("Textiles");
     loadTextiles();
+    beginSection("Items");
     loadItems();
 
+    beginSection("LightMap");
     file.seek(file.tell() + 8192); // Skip Light map, only for 8bit coloring
 
+    beginSection("CinematicFrames");
     loadCinematicFrames();
+    beginSection("DemoData");
     loadDemoData();
+    beginSection("SoundMap");
     loadSoundMap();
+    beginSection("SoundDetails");
     loadSoundDetails();
+    beginSection("SampleIndices");
     loadSampleIndices();
+    endSection();
+
+    mergeResults();
 
     loadExternalSoundFile(f);
 
@@ -83,34 +106,16 @@ void LoaderTR3::loadRoomDataEnd(int16_t& alternateRoom, unsigned int& roomFlags)
     // TODO store room-light color (?) somewhere
 }
 
-void LoaderTR3::loadRoomMesh(std::vector<IndexedRectangle>& rectangles,
+void LoaderTR3::loadRoomMesh(BinaryReader& room, long long size,
+                             std::vector<IndexedRectangle>& rectangles,
                              std::vector<IndexedRectangle>& triangles,
                              uint16_t& numRectangles, uint16_t& numTriangles) {
-    numRectangles = file.readU16();
-    for (unsigned int r = 0; r < numRectangles; r++) {
-        // Indices into the vertex list read just before
-        uint16_t vertex1 = file.readU16();
-        uint16_t vertex2 = file.readU16();
-        uint16_t vertex3 = file.readU16();
-        uint16_t vertex4 = file.readU16();
-
-        // Index into the object-texture list
-        uint16_t texture = file.readU16() & 0x7FFF;
-
-        rectangles.emplace_back(texture, vertex1, vertex2, vertex3, vertex4);
-    }
-
-    numTriangles = file.readU16();
-    for (unsigned int t = 0; t < numTriangles; t++) {
-        // Indices into the room vertex list
-        uint16_t vertex1 = file.readU16();
-        uint16_t vertex2 = file.readU16();
-        uint16_t vertex3 = file.readU16();
+    LoaderTR2::loadRoomMesh(room, size, rectangles, triangles, numRectangles, numTriangles);
 
-        // Index into the object-texture list
-        uint16_t texture = file.readU16() & 0x7FFF;
-
-        triangles.emplace_back(texture, vertex1, vertex2, vertex3);
-    }
+    // Top bit of the object-texture index is a flag in TR3
+    for (auto& r : rectangles)
+        r.texture &= 0x7FFF;
+    for (auto& t : triangles)
+        t.texture &= 0x7FFF;
 }
 
@@ -0,0 +1,427 @@
+/*!
+ * \file src/loader/LoaderTR4.cpp
+ * \brief TR4 level file loader
+ *
+ * \author xythobuz
+ */
+
+#include <chrono>
+#include <cstring>
+#include <zlib.h>
+
+#include "global.h"
+#include "AnimationStore.h"
+#include "Game.h"
+#include "Log.h"
+#include "SoundManager.h"
+#include "TextureManager.h"
+#include "utils/pixel.h"
+#include "loader/LoaderTR4.h"
+
+LoaderTR4::~LoaderTR4() {
+    // Inflate jobs still use the container
+    uploadTextures();
+    waitForJobs();
+}
+
+int LoaderTR4::load(std::string f) {
+    if (container.open(f) != 0) {
+        return 1; // Could not open file
+    }
+
+    if ((container.size() < 10) || (container.readU32() != 0x00345254)) {
+        return 2; // Not a TR4 level?!
+    }
+
+    uint16_t numRoomTextures = container.readU16();
+    uint16_t numObjectTextures = container.readU16();
+    uint16_t numBumpTextures = container.readU16();
+    unsigned int numTextures = numRoomTextures + numObjectTextures + numBumpTextures;
+
+    Chunk textures32, textures16, misc, geometry;
+    if ((readChunk("Textures32", textures32) != 0)
+        || (readChunk("Textures16", textures16) != 0)
+        || (readChunk("TexturesMisc", misc) != 0)
+        || (readChunk("Geometry", geometry) != 0)
+        || (geometry.uncompressed == 0)) {
+        return 3; // Truncated level file
+    }
+
+    // The sound samples follow uncompressed, as complete RIFF files
+    std::vector<std::pair<long long, uint32_t>> riffs;
+    if ((container.tell() + 4) <= container.size()) {
+        uint32_t numSamples = container.readU32();
+        for (unsigned int s = 0; s < numSamples; s++) {
+            if ((container.tell() + 8) > container.size())
+                return 3;
+
+            container.seek(container.tell() + 4); // Uncompressed size, unused
+            uint32_t compressedSize = container.readU32();
+            if ((container.tell() + compressedSize) > container.size())
+                return 3;
+
+            riffs.emplace_back(container.tell(), compressedSize);
+            container.seek(container.tell() + compressedSize);
+        }
+    }
+
+    // The 16bit pages are the same images as the 32bit ones,
+    // so they are only inflated if the 32bit chunk is unusable
+    Chunk pages = textures32;
+    unsigned int bpp = 32;
+    if (textures32.uncompressed != (numTextures * 256 * 256 * 4)) {
+        if (textures16.uncompressed != (numTextures * 256 * 256 * 2))
+            return 4; // Texture chunks don't match the page count
+        pages = textures16;
+        bpp = 16;
+    }
+    unsigned int numMisc = misc.uncompressed / (256 * 256 * 4);
+
+    // The geometry is needed first, so queue it before the texture pages
+    auto start = std::chrono::steady_clock::now();
+    char* buffer = new char[geometry.uncompressed];
+    int geometryResult = Z_OK;
+    std::future<void> inflated = pool.push([geometry, buffer, &geometryResult] {
+        uLongf size = geometry.uncompressed;
+        geometryResult = uncompress(reinterpret_cast<Bytef*>(buffer), &size,
+                                    reinterpret_cast<const Bytef*>(geometry.data),
+                                    geometry.compressed);
+        if ((geometryResult == Z_OK) && (size != geometry.uncompressed))
+            geometryResult = Z_DATA_ERROR;
+    });
+
+    // The uploads of all pages are queued after this
+    unsigned int layers = numTextures + numMisc;
+    Game::runOnMainThread([layers]() {
+        TextureManager::reserveTextureArray(layers);
+    });
+
+    if (numTextures > 0) {
+        textureJobs.push_back(pool.push([this, pages, numTextures, bpp] {
+            inflatePages(pages, 0, numTextures, bpp);
+        }));
+    }
+
+    if (numMisc > 0) {
+        textureJobs.push_back(pool.push([this, misc, numTextures, numMisc] {
+            inflatePages(misc, numTextures, numMisc, 32);
+        }));
+    }
+
+    Log::get(LOG_INFO) << "LoaderTR4: Found " << numTextures << " (" << bpp << "bit) + "
+                       << numMisc << " Textures!" << Log::endl;
+
+    inflated.get();
+    if (geometryResult != Z_OK) {
+        delete [] buffer;
+        Log::get(LOG_ERROR) << "LoaderTR4: Could not inflate geometry ("
+                            << geometryResult << ")!" << Log::endl;
+        return 5;
+    }
+
+    Log::get(LOG_INFO) << "LoaderTR4: Geometry inflated in "
+                       << std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now() - start).count()
+                       << "ms (" << geometry.uncompressed << " bytes)" << Log::endl;
+
+    file.open(buffer, geometry.uncompressed);
+    file.seek(4); // Unused value
+
+    beginSection("Rooms");
+    loadRooms();
+    beginSection("FloorData");
+    loadFloorData();
+    beginSection("Meshes");
+    loadMeshes();
+    beginSection("Moveables");
+    loadMoveables();
+    beginSection("StaticMeshes");
+    loadStaticMeshes();
+    beginSection("Sprites");
+    loadSprites();
+    beginSection("Cameras");
+    loadCameras();
+    beginSection("SoundSources");
+    loadSoundSources();
+    beginSection("BoxesOverlapsZones");
+    loadBoxesOverlapsZones();
+    beginSection("AnimatedTextures");
+    loadAnimatedTextures();
+    beginSection("Textiles");
+    loadTextiles();
+    beginSection("Items");
+    loadItems();
+
+    beginSection("AIObjects");
+    uint32_t numAIObjects = file.readU32();
+    file.seek(file.tell() + (numAIObjects * 24)); // Skip AI objects, unimplemented
+
+    beginSection("DemoData");
+    loadDemoData();
+    beginSection("SoundMap");
+    loadSoundMap();
+    beginSection("SoundDetails");
+    loadSoundDetails();
+    beginSection("SampleIndices");
+    loadSampleIndices();
+    endSection();
+
+    mergeResults();
+
+    // Samples stay in the level file, they are only decoded when played
+    int sampleFile = -1;
+    if (riffs.size() > 0)
+        sampleFile = SoundManager::addSampleFile(f);
+    if (sampleFile >= 0) {
+        for (auto& r : riffs)
+            SoundManager::addSample(sampleFile, r.first, r.second);
+    }
+
+    if (sampleFile >= 0)
+        Log::get(LOG_INFO) << "LoaderTR4: Indexed " << riffs.size() << " SoundSamples" << Log::endl;
+    else
+        Log::get(LOG_INFO) << "LoaderTR4: No SoundSamples found!" << Log::endl;
+
+    return 0;
+}
+
+int LoaderTR4::readChunk(std::string name, Chunk& chunk) {
+    if ((container.tell() + 8) > container.size())
+        return -1;
+
+    chunk.uncompressed = container.readU32();
+    chunk.compressed = container.readU32();
+    if ((container.tell() + chunk.compressed) > container.size())
+        return -2;
+
+    if (chunk.compressed > 0) {
+        sections.emplace_back(name, container.tell());
+        sections.back().size = chunk.compressed;
+    }
+
+    chunk.data = container.span(chunk.compressed);
+    return 0;
+}
+
+void LoaderTR4::inflatePages(Chunk chunk, unsigned int first, unsigned int count,
+                             unsigned int bpp) {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(chunk.data));
+    stream.avail_in = chunk.compressed;
+    int result = inflateInit(&stream);
+
+    // 16bit pages are inflated here first, then expanded into the pooled page
+    std::vector<unsigned char> page16((bpp == 16) ? (256 * 256 * 2) : 0);
+
+    for (unsigned int i = first; i < (first + count); i++) {
+        auto start = std::chrono::steady_clock::now();
+        unsigned char* page = texturePool.get();
+        unsigned char* out = (bpp == 16) ? page16.data() : page;
+        unsigned int size = 256 * 256 * (bpp / 8);
+
+        stream.next_out = out;
+        stream.avail_out = size;
+        while ((result == Z_OK) && (stream.avail_out > 0))
+            result = inflate(&stream, Z_NO_FLUSH);
+
+        if (stream.avail_out > 0) {
+            // Keep the page slots intact, so an error can't stall the uploads
+            if (stream.avail_out == size)
+                Log::get(LOG_ERROR) << "LoaderTR4: Could not inflate texture page " << i
+                                    << " (" << result << ")!" << Log::endl;
+            std::memset(out + (size - stream.avail_out), 0, stream.avail_out);
+        }
+
+        if (bpp == 16)
+            argb16torgba32(page16.data(), page, 256, 256);
+        else
+            bgra2rgba32(page, 256, 256);
+
+        textureDecodeTime += std::chrono::duration_cast<std::chrono::microseconds>(
+                                 std::chrono::steady_clock::now() - start).count();
+        queueUpload(i, page);
+    }
+
+    inflateEnd(&stream);
+}
+
+// ---- Geometry ----
+
+void LoaderTR4::loadRoomLights() {
+    uint32_t roomColor = file.readU32(); // Ambient color, ARGB
+
+    uint16_t numLights = file.readU16();
+    for (unsigned int l = 0; l < numLights; l++) {
+        // Position of light, in world coordinates
+        int32_t x = file.read32();
+        int32_t y = file.read32();
+        int32_t z = file.read32();
+
+        uint8_t r = file.readU8();
+        uint8_t g = file.readU8();
+        uint8_t b = file.readU8();
+        uint8_t type = file.readU8(); // Sun, point, spot, shadow or fog bulb
+        uint8_t unknown = file.readU8();
+        uint8_t intensity = file.readU8();
+
+        float in = file.readFloat();
+        float out = file.readFloat();
+        float length = file.readFloat();
+        float cutoff = file.readFloat();
+
+        // Direction, for sun and spot lights
+        float dx = file.readFloat();
+        float dy = file.readFloat();
+        float dz = file.readFloat();
+
+        // TODO store light somewhere
+    }
+}
+
+void LoaderTR4::loadSprites() {
+    char marker[4] = { 0, 0, 0, 0 };
+    file.readArray(marker, 3);
+    if (std::string("SPR") != std::string(marker))
+        Log::get(LOG_DEBUG) << "LoaderTR4: Sprites not marked as such!" << Log::endl;
+
+    LoaderTR2::loadSprites();
+}
+
+void LoaderTR4::loadCameras() {
+    LoaderTR2::loadCameras();
+
+    uint32_t numFlybyCameras = file.readU32();
+    file.seek(file.tell() + (numFlybyCameras * 40));
+
+    // TODO store flyby cameras somewhere
+    if (numFlybyCameras > 0)
+        Log::get(LOG_INFO) << "LoaderTR4: Found " << numFlybyCameras
+                           << " FlybyCameras, unimplemented!" << Log::endl;
+}
+
+void LoaderTR4::loadAnimatedTextures() {
+    LoaderTR2::loadAnimatedTextures();
+
+    uint8_t uvCount = file.readU8(); // Number of UV-rotated animated textures
+}
+
+void LoaderTR4::loadTextiles() {
+    char marker[5] = { 0, 0, 0, 0, 0 };
+    file.readArray(marker, 4);
+    if (std::string("TEX") != std::string(marker + 1))
+        Log::get(LOG_DEBUG) << "LoaderTR4: Textiles not marked as such!" << Log::endl;
+
+    uint32_t numObjectTextures = file.readU32();
+    for (unsigned int o = 0; o < numObjectTextures; o++) {
+        uint16_t attribute = file.readU16();
+
+        // Index into the texture list, the top bit marks triangles
+        uint16_t tile = file.readU16() & 0x7FFF;
+
+        uint16_t flags = file.readU16(); // Mapping correction, bump map level
+
+        TextureTile* t = new TextureTile(attribute, tile);
+
+        // Same layout as in TR2, but the Coordinate values are not as strict
+        for (int i = 0; i < 4; i++) {
+            uint8_t xCoordinate = file.readU8();
+            uint8_t xPixel = file.readU8();
+            uint8_t yCoordinate = file.readU8();
+            uint8_t yPixel = file.readU8();
+
+            t->add(TextureTileVertex(xCoordinate, xPixel, yCoordinate, yPixel));
+        }
+
+        // Original position and size in the texture page, unused
+        file.seek(file.tell() + 16);
+
+        TextureManager::addTile(t);
+    }
+
+    if (numObjectTextures > 0)
+        Log::get(LOG_INFO) << "LoaderTR4: Found " << numObjectTextures << " Textiles!" << Log::endl;
+    else
+        Log::get(LOG_INFO) << "LoaderTR4: No Textiles in this level?!" << Log::endl;
+}
+
+void LoaderTR4::loadAnimationSpeed() {
+    file.seek(file.tell() + 16); // Speed and acceleration, forward and lateral
+}
+
+void LoaderTR4::loadAngleSet(BinaryReader& frame, long long size, uint16_t numBones,
+                             uint32_t* angles) {
+    for (int i = 0; i < numBones; i++) {
+        angles[i] = 0;
+        if ((frame.tell() + 2) > size)
+            continue;
+
+        uint16_t a = frame.readU16();
+        if (a & 0xC000) {
+            // Single angle, 12bit, scaled down to the 10bit of the store
+            uint16_t angle = (a & 0x0FFF) >> 2;
+            if ((a & 0x8000) && (a & 0x4000))
+                angles[i] = AnimationStore::packAngles(0, 0, angle);
+            else if (a & 0x4000)
+                angles[i] = AnimationStore::packAngles(0, angle, 0);
+            else
+                angles[i] = AnimationStore::packAngles(angle, 0, 0);
+        } else if ((frame.tell() + 2) <= size) {
+            // Three angles, 10bit each like in TR2
+            uint16_t b = frame.readU16();
+            angles[i] = AnimationStore::packAngles((a & 0x3FF0) >> 4,
+                                                   ((a & 0x000F) << 6) | ((b & 0xFC00) >> 10),
+                                                   b & 0x03FF);
+        }
+    }
+}
+
+Mesh* LoaderTR4::decodeMesh(const char* data, long long size) {
+    BinaryMemory mem(data, size);
+
+    int16_t mx = mem.read16();
+    int16_t my = mem.read16();
+    int16_t mz = mem.read16();
+    int32_t collisionSize = mem.read32();
+    // TODO store mesh collision info somewhere
+
+    uint16_t numVertices = readCount(mem, size, sizeof(Vertex_t));
+    std::vector<Vertex_t> rawVertices(numVertices);
+    mem.readStruct(rawVertices.data(), numVertices);
+    std::vector<glm::vec3> vertices;
+    vertices.reserve(numVertices);
+    for (auto& v : rawVertices)
+        vertices.emplace_back(v.x, v.y, v.z);
+
+    int16_t numNormals = mem.read16();
+    if (numNormals > 0) {
+        // TODO store normals somewhere
+        mem.seek(mem.tell() + (numNormals * sizeof(Vertex_t)));
+    } else if (numNormals < 0) {
+        // TODO store lights somewhere
+        mem.seek(mem.tell() + (numNormals * -2));
+    }
+
+    // Top bit of the object-texture index marks double sided faces
+    uint16_t numTexturedRectangles = readCount(mem, size, sizeof(RectangleTR4_t));
+    std::vector<RectangleTR4_t> rects(numTexturedRectangles);
+    mem.readStruct(rects.data(), rects.size());
+    std::vector<IndexedRectangle> texturedRectangles;
+    for (auto& r : rects)
+        texturedRectangles.emplace_back(r.texture & 0x7FFF, r.vertices[0], r.vertices[1],
+                                        r.vertices[2], r.vertices[3]);
+
+    uint16_t numTexturedTriangles = readCount(mem, size, sizeof(TriangleTR4_t));
+    std::vector<TriangleTR4_t> tris(numTexturedTriangles);
+    mem.readStruct(tris.data(), tris.size());
+    std::vector<IndexedRectangle> texturedTriangles;
+    for (auto& t : tris)
+        texturedTriangles.emplace_back(t.texture & 0x7FFF, t.vertices[0], t.vertices[1],
+                                       t.vertices[2]);
+
+    // There are no colored faces in TR4
+    return new Mesh(vertices, texturedRectangles, texturedTriangles,
+                    std::vector<IndexedColoredRectangle>(),
+                    std::vector<IndexedColoredRectangle>());
+}
+
@@ -10,6 +10,7 @@
 
 #include "global.h"
 #include "Camera.h"
+#include "Game.h"
 #include "Log.h"
 #include "Menu.h"
 #include "Render.h"
@@ -17,7 +18,6 @@
 #include "SoundManager.h"
 #include "TextureManager.h"
 #include "UI.h"
-#include "World.h"
 #include "commands/Command.h"
 #include "system/Shader.h"
 #include "system/Sound.h"
@@ -212,10 +212,11 @@ int main(int argc, const char* argv[]) {
 
     while (RunTime::isRunning()) {
         Window::eventHandling();
+        Game::update();
         renderFrame();
     }
 
-    World::destroy();
+    Game::destroy();
     Menu::shutdown();
     UI::shutdown();
     Sound::shutdown();
@@ -241,6 +242,7 @@ void renderFrame() {
     UI::display();
     Window::swapBuffers();
     RunTime::updateFPS();
+    ShaderBuffer::resetUploadedBytes();
 }
 
 #if defined(HAVE_EXECINFO_H) && defined(HAVE_BACKTRACE) && defined(HAVE_BACKTRACE_SYMBOLS)
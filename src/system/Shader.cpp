@@ -5,6 +5,8 @@
  * \author xythobuz
  */
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "global.h"
@@ -15,20 +17,23 @@
 
 #include <glbinding/gl/gl.h>
 
+unsigned long ShaderBuffer::uploadedBytes = 0;
+
 ShaderBuffer::~ShaderBuffer() {
     if (created)
         gl::glDeleteBuffers(1, &buffer);
 }
 
-void ShaderBuffer::bufferData(int elem, int size, void* data) {
+void ShaderBuffer::bufferData(int elem, int size, const void* data, gl::GLenum usage) {
     if (!created) {
         gl::glGenBuffers(1, &buffer);
         created = true;
     }
 
     boundSize = elem;
+    uploadedBytes += elem * size;
     gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffer);
-    gl::glBufferData(gl::GL_ARRAY_BUFFER, elem * size, data, gl::GL_DYNAMIC_DRAW);
+    gl::glBufferData(gl::GL_ARRAY_BUFFER, elem * size, data, usage);
 }
 
 void ShaderBuffer::bindBuffer() {
@@ -56,6 +61,106 @@ void ShaderBuffer::unbind(int location) {
     gl::glDisableVertexAttribArray(location);
 }
 
+void ShaderBuffer::bindMatrixBuffer(int location) {
+    if (!created) {
+        gl::glGenBuffers(1, &buffer);
+        created = true;
+    }
+
+    gl::glBindBuffer(gl::GL_ARRAY_BUFFER, buffer);
+    for (int c = 0; c < 4; c++) {
+        gl::glEnableVertexAttribArray(location + c);
+        gl::glVertexAttribPointer(location + c, 4, gl::GL_FLOAT, gl::GL_FALSE, sizeof(glm::mat4),
+                                  reinterpret_cast<void*>(c * sizeof(glm::vec4)));
+        gl::glVertexAttribDivisor(location + c, 1);
+    }
+}
+
+void ShaderBuffer::unbindMatrix(int location) {
+    for (int c = 0; c < 4; c++)
+        gl::glDisableVertexAttribArray(location + c);
+}
+
+// ----------------------------------------------------------------------------
+
+ShaderMesh::~ShaderMesh() {
+    if (vertexArray != 0)
+        gl::glDeleteVertexArrays(1, &vertexArray);
+}
+
+void ShaderMesh::upload(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>& uvs,
+                        const std::vector<unsigned short>& indices) {
+    orAssertEqual(vertices.size(), uvs.size());
+    otherBuffer.bufferData(uvs, gl::GL_STATIC_DRAW);
+    upload(vertices, uvs.data(), 2, indices);
+}
+
+void ShaderMesh::upload(const std::vector<glm::vec3>& vertices,
+                        const std::vector<glm::vec3>& colors,
+                        const std::vector<unsigned short>& indices) {
+    orAssertEqual(vertices.size(), colors.size());
+    otherBuffer.bufferData(colors, gl::GL_STATIC_DRAW);
+    upload(vertices, colors.data(), 3, indices);
+}
+
+void ShaderMesh::upload(const std::vector<glm::vec3>& vertices, const void* other,
+                        int otherSize, const std::vector<unsigned short>& indices) {
+    if (vertexArray == 0)
+        gl::glGenVertexArrays(1, &vertexArray);
+    gl::glBindVertexArray(vertexArray);
+
+    vertexBuffer.bufferData(vertices, gl::GL_STATIC_DRAW);
+    vertexBuffer.bindBuffer(0, 3);
+    otherBuffer.bindBuffer(1, otherSize);
+
+    memory = (vertices.size() * sizeof(glm::vec3))
+             + (vertices.size() * otherSize * sizeof(float));
+    if (!indices.empty()) {
+        indexBuffer.bufferData(indices, gl::GL_STATIC_DRAW);
+        indexBuffer.bindBuffer();
+        memory += indices.size() * sizeof(unsigned short);
+    }
+
+    Shader::bindDefaultVertexArray();
+}
+
+void ShaderMesh::uploadLayers(const std::vector<float>& layers) {
+    orAssert(vertexArray != 0);
+    gl::glBindVertexArray(vertexArray);
+
+    layerBuffer.bufferData(layers, gl::GL_STATIC_DRAW);
+    layerBuffer.bindBuffer(2, 1);
+    memory += layers.size() * sizeof(float);
+
+    Shader::bindDefaultVertexArray();
+}
+
+void ShaderMesh::uploadInstances(const std::vector<glm::mat4>& matrices) {
+    orAssert(vertexArray != 0);
+    gl::glBindVertexArray(vertexArray);
+
+    instanceBuffer.bufferData(matrices);
+    instanceBuffer.bindMatrixBuffer(3);
+
+    Shader::bindDefaultVertexArray();
+}
+
+void ShaderMesh::setInstance(const glm::mat4& matrix) {
+    // Disabled attributes read the current value, which is not part of the vertex array
+    instanceBuffer.unbindMatrix(3);
+    for (int c = 0; c < 4; c++)
+        gl::glVertexAttrib4fv(3 + c, &matrix[c][0]);
+}
+
+void ShaderMesh::bind() {
+    orAssert(vertexArray != 0);
+    gl::glBindVertexArray(vertexArray);
+
+    // Drawing with other indices replaces the index buffer of the vertex array
+    if (indexBuffer.getSize() > 0)
+        indexBuffer.bindBuffer();
+}
+
 // ----------------------------------------------------------------------------
 
 ShaderTexture::ShaderTexture(int w, int h) : width(w), height(h) {
@@ -150,6 +255,10 @@ void Shader::loadUniform(int uni, int texture, TextureStorage store) {
     }
 }
 
+void Shader::loadUniformTextureArray(int uni) {
+    gl::glUniform1i(getUniform(uni), TextureManager::bindTextureArray());
+}
+
 void Shader::use() {
     orAssert(programID >= 0);
     static int lastID = -1;
@@ -254,6 +363,8 @@ std::string Shader::getVersion(bool linked) {
 }
 
 Shader Shader::textureShader;
+Shader Shader::textureArrayShader;
+Shader Shader::levelShader;
 Shader Shader::colorShader;
 Shader Shader::transformedColorShader;
 unsigned int Shader::vertexArrayID = 0;
@@ -291,6 +402,18 @@ int Shader::initialize() {
                                        transformedColorShaderFragment) < 0)
         return -6;
 
+    if (textureArrayShader.compile(textureArrayShaderVertex, textureArrayShaderFragment) < 0)
+        return -7;
+    if (textureArrayShader.addUniform("MVP") < 0)
+        return -8;
+    if (textureArrayShader.addUniform("textureSampler") < 0)
+        return -9;
+
+    if (levelShader.compile(levelShaderVertex, textureArrayShaderFragment) < 0)
+        return -10;
+    if (levelShader.addUniform("textureSampler") < 0)
+        return -11;
+
     return 0;
 }
 
@@ -298,6 +421,56 @@ void Shader::shutdown() {
     gl::glDeleteVertexArrays(1, &vertexArrayID);
 }
 
+void Shader::bindDefaultVertexArray() {
+    gl::glBindVertexArray(vertexArrayID);
+}
+
+void Shader::drawGLInstanced(ShaderMesh& mesh, std::vector<glm::mat4>& matrices,
+                             gl::GLenum mode, ShaderTexture* target, Shader& shader) {
+    if (matrices.size() == 0)
+        return;
+
+    bindProperBuffer(target);
+
+    shader.use();
+    shader.loadUniformTextureArray(0);
+
+    mesh.uploadInstances(matrices);
+    mesh.bind();
+    gl::glDrawElementsInstanced(mode, mesh.getIndexCount(), gl::GL_UNSIGNED_SHORT, nullptr,
+                                matrices.size());
+
+    bindDefaultVertexArray();
+}
+
+bool Shader::isVersionAtLeast(int major, int minor) {
+    gl::GLint ma = 0, mi = 0;
+    gl::glGetIntegerv(gl::GL_MAJOR_VERSION, &ma);
+    gl::glGetIntegerv(gl::GL_MINOR_VERSION, &mi);
+    return (ma > major) || ((ma == major) && (mi >= minor));
+}
+
+bool Shader::hasExtension(const char* name) {
+    orAssert(name != nullptr);
+    gl::GLint count = 0;
+    gl::glGetIntegerv(gl::GL_NUM_EXTENSIONS, &count);
+    for (gl::GLint i = 0; i < count; i++) {
+        const gl::GLubyte* ext = gl::glGetStringi(gl::GL_EXTENSIONS, i);
+        if ((ext != nullptr) && (std::strcmp(reinterpret_cast<const char*>(ext), name) == 0))
+            return true;
+    }
+    return false;
+}
+
+bool Shader::hasMultiDrawIndirect() {
+    static int cache = -1;
+    if (cache < 0) {
+        cache = (isVersionAtLeast(4, 3) || (hasExtension("GL_ARB_multi_draw_indirect")
+                                            && hasExtension("GL_ARB_base_instance"))) ? 1 : 0;
+    }
+    return cache == 1;
+}
+
 void Shader::set2DState(bool on, bool depth) {
     if (on) {
         gl::glDisable(gl::GL_CULL_FACE);
@@ -377,6 +550,162 @@ void Shader::drawGLOnly(std::vector<unsigned short>& indices, glm::mat4 MVP,
     shader.otherBuffer.unbind(1);
 }
 
+void Shader::drawGL(ShaderMesh& mesh, unsigned int first, unsigned int count,
+                    glm::mat4 MVP, unsigned int texture, TextureStorage store,
+                    gl::GLenum mode, ShaderTexture* target, Shader& shader) {
+    orAssertLessThanEqual(first + count, mesh.getIndexCount());
+    bindProperBuffer(target);
+
+    shader.use();
+    shader.loadUniform(0, MVP);
+    shader.loadUniform(1, texture, store);
+
+    mesh.bind();
+    gl::glDrawElements(mode, count, gl::GL_UNSIGNED_SHORT,
+                       reinterpret_cast<void*>(first * sizeof(unsigned short)));
+
+    bindDefaultVertexArray();
+}
+
+void Shader::drawGL(ShaderMesh& mesh, std::vector<unsigned short>& indices, glm::mat4 MVP,
+                    unsigned int texture, TextureStorage store,
+                    gl::GLenum mode, ShaderTexture* target, Shader& shader) {
+    bindProperBuffer(target);
+
+    shader.use();
+    shader.loadUniform(0, MVP);
+    shader.loadUniform(1, texture, store);
+
+    // The index buffer binding becomes part of the mesh vertex array
+    mesh.bind();
+    shader.indexBuffer.bufferData(indices);
+    shader.indexBuffer.bindBuffer();
+
+    gl::glDrawElements(mode, shader.indexBuffer.getSize(), gl::GL_UNSIGNED_SHORT, nullptr);
+
+    bindDefaultVertexArray();
+}
+
+void Shader::drawGL(ShaderMesh& mesh, glm::mat4 MVP, gl::GLenum mode,
+                    ShaderTexture* target, Shader& shader) {
+    bindProperBuffer(target);
+
+    shader.use();
+    shader.loadUniform(0, MVP);
+
+    mesh.bind();
+    gl::glDrawElements(mode, mesh.getIndexCount(), gl::GL_UNSIGNED_SHORT, nullptr);
+
+    bindDefaultVertexArray();
+}
+
+void Shader::drawGLArray(ShaderMesh& mesh, glm::mat4 MVP, gl::GLenum mode,
+                         ShaderTexture* target, Shader& shader) {
+    bindProperBuffer(target);
+
+    shader.use();
+    shader.loadUniform(0, MVP);
+    shader.loadUniformTextureArray(1);
+
+    mesh.bind();
+    gl::glDrawElements(mode, mesh.getIndexCount(), gl::GL_UNSIGNED_SHORT, nullptr);
+
+    bindDefaultVertexArray();
+}
+
+void Shader::drawGLArray(std::vector<glm::vec3>& vertices, std::vector<glm::vec2>& uvs,
+                         std::vector<float>& layers, glm::mat4 MVP, gl::GLenum mode,
+                         ShaderTexture* target, Shader& shader) {
+    bindProperBuffer(target);
+
+    shader.use();
+    shader.loadUniform(0, MVP);
+    shader.loadUniformTextureArray(1);
+
+    shader.vertexBuffer.bufferData(vertices);
+    shader.otherBuffer.bufferData(uvs);
+    shader.layerBuffer.bufferData(layers);
+
+    shader.vertexBuffer.bindBuffer(0, 3);
+    shader.otherBuffer.bindBuffer(1, 2);
+    shader.layerBuffer.bindBuffer(2, 1);
+
+    gl::glDrawArrays(mode, 0, shader.vertexBuffer.getSize());
+
+    shader.vertexBuffer.unbind(0);
+    shader.otherBuffer.unbind(1);
+    shader.layerBuffer.unbind(2);
+}
+
+int Shader::drawGLMulti(ShaderMesh& mesh, std::vector<DrawElementsIndirectCommand>& commands,
+                         std::vector<glm::mat4>& matrices, ShaderTexture* target, Shader& shader) {
+    orAssertEqual(commands.size(), matrices.size());
+    if (commands.size() == 0)
+        return 0;
+
+    bindProperBuffer(target);
+
+    shader.use();
+    shader.loadUniformTextureArray(0);
+
+    int draws = 0;
+    if (hasMultiDrawIndirect()) {
+        // The base instance of each command selects its matrix
+        for (unsigned long i = 0; i < commands.size(); i++)
+            commands.at(i).baseInstance = i;
+        mesh.uploadInstances(matrices);
+        mesh.bind();
+        shader.indirectBuffer.bufferData(commands);
+        gl::glBindBuffer(gl::GL_DRAW_INDIRECT_BUFFER, shader.indirectBuffer.getBuffer());
+        gl::glMultiDrawElementsIndirect(gl::GL_TRIANGLES, gl::GL_UNSIGNED_SHORT, nullptr,
+                                        commands.size(), 0);
+        gl::glBindBuffer(gl::GL_DRAW_INDIRECT_BUFFER, 0);
+        draws++;
+    } else {
+        // Without base instances, all commands sharing one matrix are one draw
+        static std::vector<unsigned long> order;
+        static std::vector<gl::GLsizei> counts;
+        static std::vector<const void*> offsets;
+        static std::vector<gl::GLint> bases;
+
+        // Bytewise, so matrices with NaNs still equal themselves and every group advances
+        auto compare = [&](unsigned long a, unsigned long b) {
+            return std::memcmp(&matrices.at(a), &matrices.at(b), sizeof(glm::mat4));
+        };
+
+        order.resize(commands.size());
+        for (unsigned long i = 0; i < order.size(); i++)
+            order.at(i) = i;
+        std::stable_sort(order.begin(), order.end(), [&](unsigned long a, unsigned long b) {
+            return compare(a, b) < 0;
+        });
+
+        mesh.bind();
+        unsigned long i = 0;
+        while (i < order.size()) {
+            counts.clear();
+            offsets.clear();
+            bases.clear();
+
+            unsigned long first = order.at(i);
+            for (; (i < order.size()) && (compare(order.at(i), first) == 0); i++) {
+                auto& c = commands.at(order.at(i));
+                counts.push_back(c.count);
+                offsets.push_back(reinterpret_cast<void*>(c.firstIndex * sizeof(unsigned short)));
+                bases.push_back(c.baseVertex);
+            }
+
+            mesh.setInstance(matrices.at(first));
+            gl::glMultiDrawElementsBaseVertex(gl::GL_TRIANGLES, &counts[0], gl::GL_UNSIGNED_SHORT,
+                                              &offsets[0], counts.size(), &bases[0]);
+            draws++;
+        }
+    }
+
+    bindDefaultVertexArray();
+    return draws;
+}
+
 void Shader::drawGL(std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& colors,
                     glm::mat4 MVP, gl::GLenum mode, ShaderTexture* target, Shader& shader) {
     bindProperBuffer(target);
@@ -491,6 +820,59 @@ void main() {
 
 // --------------------------------------
 
+const char* Shader::textureArrayShaderVertex = R"!?!(
+#version 330 core
+
+layout(location = 0) in vec3 vertexPosition_modelspace;
+layout(location = 1) in vec2 vertexUV;
+layout(location = 2) in float vertexLayer;
+
+out vec3 UV;
+
+uniform mat4 MVP;
+
+void main() {
+    vec4 pos = MVP * vec4(vertexPosition_modelspace, 1);
+    gl_Position = pos;
+    UV = vec3(vertexUV, vertexLayer);
+}
+)!?!";
+
+const char* Shader::textureArrayShaderFragment = R"!?!(
+#version 330 core
+
+in vec3 UV;
+
+layout(location = 0) out vec4 color;
+
+uniform sampler2DArray textureSampler;
+
+void main() {
+    color = texture(textureSampler, UV);
+}
+)!?!";
+
+// --------------------------------------
+
+const char* Shader::levelShaderVertex = R"!?!(
+#version 330 core
+
+layout(location = 0) in vec3 vertexPosition_modelspace;
+layout(location = 1) in vec2 vertexUV;
+layout(location = 2) in float vertexLayer;
+layout(location = 3) in mat4 MVP;
+
+out vec3 UV;
+
+void main() {
+    vec4 pos = MVP * vec4(vertexPosition_modelspace, 1);
+    gl_Position = pos;
+    UV = vec3(vertexUV, vertexLayer);
+}
+)!?!";
+
+// --------------------------------------
+
 const char* Shader::colorShaderVertex = R"!?!(
 #version 330 core
 
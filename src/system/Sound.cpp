@@ -12,9 +12,13 @@
 #include "system/SoundAL.h"
 #endif
 
+bool Sound::hasBackend = false;
+
 int Sound::initialize() {
 #ifdef USING_AL
-    return SoundAL::initialize();
+    int error = SoundAL::initialize();
+    hasBackend = (error == 0);
+    return error;
 #else
     return 0;
 #endif
@@ -22,13 +26,16 @@ int Sound::initialize() {
 
 void Sound::shutdown() {
 #ifdef USING_AL
-    SoundAL::shutdown();
+    if (hasBackend)
+        SoundAL::shutdown();
 #endif
+    hasBackend = false;
 }
 
 void Sound::clear() {
 #ifdef USING_AL
-    SoundAL::clear();
+    if (hasBackend)
+        SoundAL::clear();
 #endif
 }
 
@@ -40,11 +47,18 @@ int Sound::numBuffers() {
 #endif
 }
 
-int Sound::loadBuffer(unsigned char* buffer, unsigned int length) {
+int Sound::loadBuffer(const unsigned char* buffer, unsigned int length) {
 #ifdef USING_AL
-    return SoundAL::loadBuffer(buffer, length);
-#else
+    if (hasBackend)
+        return SoundAL::loadBuffer(buffer, length);
+#endif
     return 0;
+}
+
+void Sound::deleteBuffer(int buffer) {
+#ifdef USING_AL
+    if (hasBackend)
+        SoundAL::deleteBuffer(buffer);
 #endif
 }
 
@@ -72,6 +86,22 @@ int Sound::sourceAt(int source, glm::vec3 pos) {
 #endif
 }
 
+int Sound::sourceBuffer(int source, int buffer, bool atListener) {
+#ifdef USING_AL
+    return SoundAL::sourceBuffer(source, buffer, atListener);
+#else
+    return 0;
+#endif
+}
+
+bool Sound::isPlaying(int source, bool atListener) {
+#ifdef USING_AL
+    return SoundAL::isPlaying(source, atListener);
+#else
+    return false;
+#endif
+}
+
 void Sound::listenAt(glm::vec3 pos, glm::vec3 at, glm::vec3 up) {
 #ifdef USING_AL
     SoundAL::listenAt(pos, at, up);
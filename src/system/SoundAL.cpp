@@ -111,7 +111,7 @@ int SoundAL::numBuffers() {
     return buffers.size();
 }
 
-int SoundAL::loadBuffer(unsigned char* buffer, unsigned int length) {
+int SoundAL::loadBuffer(const unsigned char* buffer, unsigned int length) {
     if (!init) {
         Log::get(LOG_ERROR) << "SoundAL Error: Buffer load, but not initialized!" << Log::endl;
         return -1;
@@ -123,8 +123,35 @@ int SoundAL::loadBuffer(unsigned char* buffer, unsigned int length) {
         Log::get(LOG_ERROR) << "SoundAL Error: " << alutGetErrorString(alutGetError()) << Log::endl;
         return -2;
     }
+
+    // Slots of deleted buffers are reused, so indices stay small
+    for (unsigned long i = 0; i < buffers.size(); i++) {
+        if (buffers.at(i) == 0) {
+            buffers.at(i) = r;
+            return i;
+        }
+    }
+
     buffers.push_back(r);
-    return r;
+    return buffers.size() - 1;
+}
+
+void SoundAL::deleteBuffer(int buffer) {
+    if (!init)
+        return;
+
+    if ((buffer < 0) || (buffer >= buffers.size()) || (buffers.at(buffer) == 0)) {
+        Log::get(LOG_ERROR) << "SoundAL: Can't delete non-existing buffer!" << Log::endl;
+        return;
+    }
+
+    alGetError();
+    alDeleteBuffers(1, &buffers.at(buffer));
+    if (alGetError() != AL_NO_ERROR) {
+        Log::get(LOG_ERROR) << "SoundAL: Error while deleting buffer (still attached?)!" << Log::endl;
+        return;
+    }
+    buffers.at(buffer) = 0;
 }
 
 int SoundAL::numSources(bool atListener) {
@@ -140,7 +167,7 @@ int SoundAL::addSource(int buffer, float vol, bool atListener, bool loop) {
         return -1;
     }
 
-    if ((buffer < 0) || (buffer >= buffers.size())) {
+    if ((buffer < 0) || (buffer >= buffers.size()) || (buffers.at(buffer) == 0)) {
         Log::get(LOG_ERROR) << "SoundAL Error: Adding source, but '" << buffer
                             << "' invalid (max '" << buffers.size() << "')!" << Log::endl;
         return -2;
@@ -189,6 +216,46 @@ int SoundAL::sourceAt(int source, glm::vec3 pos) {
     return 0;
 }
 
+int SoundAL::sourceBuffer(int source, int buffer, bool atListener) {
+    if (!init) {
+        Log::get(LOG_ERROR) << "SoundAL Error: Binding buffer, but not initialized!" << Log::endl;
+        return -1;
+    }
+
+    std::vector<unsigned int>& v = atListener ? listenerSources : sources;
+    if ((source < 0) || (source >= v.size())) {
+        Log::get(LOG_ERROR) << "SoundAL: Can't bind buffer to non-existing source!" << Log::endl;
+        return -2;
+    }
+
+    // -1 detaches the current buffer, so it can be deleted
+    unsigned int id = 0;
+    if (buffer >= 0) {
+        if ((buffer >= buffers.size()) || (buffers.at(buffer) == 0)) {
+            Log::get(LOG_ERROR) << "SoundAL: Can't bind non-existing buffer!" << Log::endl;
+            return -3;
+        }
+        id = buffers.at(buffer);
+    }
+
+    alSourceStop(v.at(source));
+    alSourcei(v.at(source), AL_BUFFER, id);
+    return 0;
+}
+
+bool SoundAL::isPlaying(int source, bool atListener) {
+    if (!init)
+        return false;
+
+    std::vector<unsigned int>& v = atListener ? listenerSources : sources;
+    if ((source < 0) || (source >= v.size()))
+        return false;
+
+    int state = AL_STOPPED;
+    alGetSourcei(v.at(source), AL_SOURCE_STATE, &state);
+    return (state == AL_PLAYING);
+}
+
 void SoundAL::listenAt(glm::vec3 pos, glm::vec3 at, glm::vec3 up) {
     if (!init) {
         Log::get(LOG_ERROR) << "SoundAL Error: Positioning listener, but not initialized!" << Log::endl;
@@ -0,0 +1,48 @@
+/*!
+ * \file src/utils/BufferPool.cpp
+ * \brief Reusable fixed size buffers
+ *
+ * \author xythobuz
+ */
+
+#include "global.h"
+#include "utils/BufferPool.h"
+
+BufferPool::BufferPool(std::size_t bufferSize, std::size_t maxBuffers)
+    : size(bufferSize), capacity(maxBuffers), allocated(0) {
+    orAssertGreaterThan(size, 0);
+    orAssertGreaterThan(capacity, 0);
+}
+
+BufferPool::~BufferPool() {
+    for (auto b : all)
+        delete [] b;
+}
+
+unsigned char* BufferPool::get() {
+    std::unique_lock<std::mutex> lock(mutex);
+    returned.wait(lock, [this]() {
+        return (free.size() > 0) || (allocated < capacity);
+    });
+
+    if (free.size() > 0) {
+        unsigned char* b = free.back();
+        free.pop_back();
+        return b;
+    }
+
+    unsigned char* b = new unsigned char[size];
+    all.push_back(b);
+    allocated++;
+    return b;
+}
+
+void BufferPool::put(unsigned char* buffer) {
+    orAssert(buffer != nullptr);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free.push_back(buffer);
+    }
+    returned.notify_one();
+}
+
@@ -0,0 +1,250 @@
+/*!
+ * \file src/utils/FolderIndex.cpp
+ * \brief Single pass recursive file search
+ *
+ * \author xythobuz
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "global.h"
+#include "Log.h"
+#include "utils/ThreadPool.h"
+#include "utils/FolderIndex.h"
+
+#if defined(HAVE_DIRENT_H) && defined(HAVE_OPENAT) && defined(HAVE_FDOPENDIR) && defined(HAVE_DT_DIR)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define USE_DIRENT_AT
+#endif
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+/*
+ * One folder of the tree while walking. Every node is only written by the
+ * job reading it, so the tree is built without locking.
+ */
+struct FolderIndex::Node {
+    std::string path;
+    std::vector<std::string> files;
+    std::vector<Node> children;
+#ifdef USE_DIRENT_AT
+    int fd;
+
+    Node() : fd(-1) { }
+#endif
+};
+
+FolderIndex::FolderIndex(std::string folder, bool listDotFiles)
+    : listDot(listDotFiles), scanned(false) {
+    setFolder(folder);
+}
+
+void FolderIndex::setFolder(std::string folder) {
+    // Folder knows how to turn relative and home paths into full ones
+    std::string p = Folder(folder, listDot).getPath();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (p != path) {
+        path = p;
+        scanned = false;
+        folders.clear();
+        files.clear();
+    }
+}
+
+void FolderIndex::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    scanned = false;
+    folders.clear();
+    files.clear();
+}
+
+int FolderIndex::scan(ThreadPool* pool) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (scanned)
+        return 0;
+
+    Node root;
+    root.path = path;
+#ifdef USE_DIRENT_AT
+    root.fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#endif
+    int error = walk(root, pool);
+    if (error != 0) {
+        Log::get(LOG_ERROR) << "Could not open folder " << path << Log::endl;
+        return error;
+    }
+
+    flatten(root);
+    scanned = true;
+    return 0;
+}
+
+unsigned long FolderIndex::fileCount() {
+    scan();
+    std::lock_guard<std::mutex> lock(mutex);
+    return files.size();
+}
+
+unsigned long FolderIndex::folderCount() {
+    scan();
+    std::lock_guard<std::mutex> lock(mutex);
+    return folders.size();
+}
+
+static bool endsWith(const std::string& s, const std::string& suffix, bool casesensitive) {
+    if (s.length() < suffix.length())
+        return false;
+
+    const char* a = s.c_str() + (s.length() - suffix.length());
+    const char* b = suffix.c_str();
+    if (casesensitive)
+        return (std::memcmp(a, b, suffix.length()) == 0);
+
+    for (; *b != '\0'; a++, b++) {
+        if (std::tolower(static_cast<unsigned char>(*a)) != *b)
+            return false;
+    }
+    return true;
+}
+
+void FolderIndex::find(std::vector<File>& found, const std::vector<std::string>& suffixes,
+                       std::string below, bool casesensitive) {
+    scan();
+
+    std::vector<std::string> ends(suffixes);
+    if (!casesensitive) {
+        for (auto& e : ends)
+            std::transform(e.begin(), e.end(), e.begin(), ::tolower);
+    }
+
+    if (below.empty()) {
+        below = path;
+    } else {
+        std::replace(below.begin(), below.end(), '\\', '/');
+        if (below.back() != '/')
+            below += '/';
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Folders are stored depth-first, so a subtree is one contiguous range
+    uint32_t first = 0;
+    while ((first < folders.size()) && (folders.at(first) != below))
+        first++;
+    uint32_t last = first;
+    while ((last < folders.size())
+           && (folders.at(last).compare(0, below.length(), below) == 0))
+        last++;
+
+    auto f = std::lower_bound(files.begin(), files.end(), first,
+    [](const std::pair<uint32_t, std::string>& a, uint32_t b) {
+        return a.first < b;
+    });
+    for (; (f != files.end()) && (f->first < last); ++f) {
+        for (auto& e : ends) {
+            if (endsWith(f->second, e, casesensitive)) {
+                found.emplace_back(folders.at(f->first) + f->second);
+                break;
+            }
+        }
+    }
+}
+
+void FolderIndex::flatten(Node& node) {
+    uint32_t folder = folders.size();
+    folders.push_back(std::move(node.path));
+    for (auto& f : node.files)
+        files.emplace_back(folder, std::move(f));
+    for (auto& c : node.children)
+        flatten(c);
+}
+
+// ----------------------------------------------------------------------------
+
+#ifdef USE_DIRENT_AT
+
+int FolderIndex::walk(Node& node, ThreadPool* pool) {
+    if (node.fd < 0)
+        return 1;
+
+    DIR* dir = fdopendir(node.fd);
+    if (dir == nullptr) {
+        close(node.fd);
+        return 2;
+    }
+
+    // Folders get their '/' before sorting, like in Folder
+    std::vector<std::string> subFolders;
+    struct dirent* ep;
+    while ((ep = readdir(dir)) != nullptr) {
+        const char* name = ep->d_name;
+        if ((strcmp(".", name) == 0) || (strcmp("..", name) == 0))
+            continue;
+        if ((!listDot) && (name[0] == '.'))
+            continue;
+
+        bool isFolder = (ep->d_type == DT_DIR);
+        if (ep->d_type == DT_UNKNOWN) {
+            struct stat st;
+            if (fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+                isFolder = S_ISDIR(st.st_mode);
+        }
+
+        if (isFolder)
+            subFolders.push_back(std::string(name) + '/');
+        else
+            node.files.push_back(name);
+    }
+
+    std::sort(node.files.begin(), node.files.end());
+    std::sort(subFolders.begin(), subFolders.end());
+
+    // Subfolders are opened relative to this one, which stays open meanwhile
+    node.children.resize(subFolders.size());
+    auto readChild = [this, &node, &subFolders, dir, pool](std::size_t i) {
+        Node& child = node.children.at(i);
+        child.path = node.path + subFolders.at(i);
+        subFolders.at(i).pop_back();
+        child.fd = openat(dirfd(dir), subFolders.at(i).c_str(),
+                          O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (walk(child, pool) != 0)
+            Log::get(LOG_ERROR) << "Could not open folder " << child.path << Log::endl;
+    };
+
+    if (pool != nullptr) {
+        pool->parallelFor(subFolders.size(), readChild);
+    } else {
+        for (std::size_t i = 0; i < subFolders.size(); i++)
+            readChild(i);
+    }
+
+    closedir(dir);
+    return 0;
+}
+
+#else
+
+int FolderIndex::walk(Node& node, ThreadPool* pool) {
+    Folder f(node.path, listDot);
+    for (unsigned long i = 0; i < f.fileCount(); i++)
+        node.files.push_back(f.getFile(i).getPath().substr(node.path.length()));
+
+    node.children.resize(f.folderCount());
+    for (unsigned long i = 0; i < f.folderCount(); i++) {
+        node.children.at(i).path = f.getFolder(i).getPath();
+        walk(node.children.at(i), pool);
+    }
+
+    return 0;
+}
+
+#endif
+
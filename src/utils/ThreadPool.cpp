@@ -0,0 +1,117 @@
+/*!
+ * \file src/utils/ThreadPool.cpp
+ * \brief Simple worker thread pool
+ *
+ * \author xythobuz
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#include "global.h"
+#include "utils/ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threads) : stop(false) {
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 2;
+
+    for (unsigned int i = 0; i < threads; i++)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    condition.notify_all();
+
+    for (auto& w : workers)
+        w.join();
+}
+
+std::future<void> ThreadPool::push(std::function<void()> job) {
+    std::packaged_task<void()> task(job);
+    std::future<void> result = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(task));
+    }
+    condition.notify_one();
+    return result;
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stop || !jobs.empty(); });
+            if (stop && jobs.empty())
+                return;
+            task = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        task();
+    }
+}
+
+namespace {
+    struct ParallelFor {
+        std::function<void(std::size_t)> f;
+        std::size_t count;
+        std::atomic<std::size_t> next;
+        std::size_t done;
+        std::exception_ptr error; // First exception thrown by f
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        ParallelFor(std::function<void(std::size_t)> func, std::size_t c)
+            : f(func), count(c), next(0), done(0) { }
+
+        void run() {
+            std::size_t ran = 0;
+            for (std::size_t i = next++; i < count; i = next++, ran++) {
+                // Every index has to be counted as done, or the caller would never return
+                try {
+                    f(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+
+            if (ran > 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done += ran;
+                if (done == count)
+                    finished.notify_all();
+            }
+        }
+    };
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::function<void(std::size_t)> f) {
+    if (count == 0)
+        return;
+
+    // Helpers that start after all indices were taken return immediately,
+    // so the caller never waits on queued jobs, only on running ones.
+    auto state = std::make_shared<ParallelFor>(f, count);
+    std::size_t helpers = std::min<std::size_t>(count - 1, workers.size());
+    for (std::size_t i = 0; i < helpers; i++)
+        push([state] { state->run(); });
+
+    state->run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state] { return state->done == state->count; });
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
+
@@ -0,0 +1,72 @@
+/*!
+ * \file src/utils/WorkQueue.cpp
+ * \brief Jobs that have to run on one specific thread
+ *
+ * \author xythobuz
+ */
+
+#include <chrono>
+
+#include "global.h"
+#include "utils/WorkQueue.h"
+
+WorkQueue::WorkQueue() : owner(std::this_thread::get_id()) {
+}
+
+std::future<void> WorkQueue::push(std::function<void()> job, bool defer) {
+    std::packaged_task<void()> task(job);
+    std::future<void> result = task.get_future();
+
+    if ((!defer) && (std::this_thread::get_id() == owner)) {
+        task();
+    } else {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(task));
+    }
+
+    return result;
+}
+
+unsigned long WorkQueue::run(unsigned long budget) {
+    orAssert(std::this_thread::get_id() == owner);
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned long count = 0;
+    while (true) {
+        std::packaged_task<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (jobs.empty())
+                break;
+            task = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        task();
+        count++;
+
+        if ((budget > 0) && (std::chrono::steady_clock::now() - start
+                             >= std::chrono::milliseconds(budget)))
+            break;
+    }
+
+    return count;
+}
+
+void WorkQueue::wait(std::future<void>& job) {
+    if (std::this_thread::get_id() != owner) {
+        job.wait();
+        return;
+    }
+
+    while (job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (run() == 0)
+            job.wait_for(std::chrono::milliseconds(1));
+    }
+}
+
+bool WorkQueue::empty() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.empty();
+}
+
@@ -5,96 +5,104 @@
  * \author xythobuz
  */
 
+#include <cstring>
+
 #include "global.h"
 #include "utils/binary.h"
 
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP) && defined(HAVE_MUNMAP)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define USE_MMAP
+#endif
+
 BinaryReader::~BinaryReader() {
 }
 
-uint8_t BinaryReader::readU8() {
-    uint8_t ret;
-    char* c = reinterpret_cast<char*>(&ret);
-    read(c, 1);
-    return ret;
-}
+void BinaryReader::readBulk(char* d, std::size_t count, std::size_t size) {
+    std::size_t bytes = count * size;
+    while (bytes > 0) {
+        int chunk = static_cast<int>((bytes > 0x10000000) ? 0x10000000 : bytes);
+        read(d, chunk);
+        d += chunk;
+        bytes -= chunk;
+    }
 
-uint16_t BinaryReader::readU16() {
-    uint16_t a = readU8();
-    uint16_t b = readU8();
-    return static_cast<uint16_t>(a | (b << 8));
+#ifdef WORDS_BIGENDIAN
+    // Level files are little-endian, swap every value in place
+    d -= count * size;
+    if (size > 1) {
+        for (std::size_t n = 0; n < count; n++, d += size) {
+            for (std::size_t i = 0; i < (size / 2); i++) {
+                char tmp = d[i];
+                d[i] = d[size - i - 1];
+                d[size - i - 1] = tmp;
+            }
+        }
+    }
+#endif
 }
 
-uint32_t BinaryReader::readU32() {
-    uint32_t a = readU16();
-    uint32_t b = readU16();
-    return (a | (b << 16));
+int8_t BinaryReader::read8() {
+    int8_t ret;
+    readArray(&ret, 1);
+    return ret;
 }
 
-uint64_t BinaryReader::readU64() {
-    uint64_t a = readU32();
-    uint64_t b = readU32();
-    return (a | (b << 32));
+uint8_t BinaryReader::readU8() {
+    uint8_t ret;
+    readArray(&ret, 1);
+    return ret;
 }
 
-float BinaryReader::readFloat() {
-    uint32_t val = readU32();
-    char* a = reinterpret_cast<char*>(&val);
-
-    float ret;
-    char* b = reinterpret_cast<char*>(&ret);
+int16_t BinaryReader::read16() {
+    int16_t ret;
+    readArray(&ret, 1);
+    return ret;
+}
 
-    for (int i = 0; i < 4; i++)
-        b[i] = a[i];
+uint16_t BinaryReader::readU16() {
+    uint16_t ret;
+    readArray(&ret, 1);
+    return ret;
+}
 
+int32_t BinaryReader::read32() {
+    int32_t ret;
+    readArray(&ret, 1);
     return ret;
 }
 
-/*! \fixme Left-Shift with signed integer is undefined!
- *  So we can't use the same method as for unsigned integers.
- *  Is there a portable way to read multi-byte signed integers,
- *  without having to detect the endianness at run-time?
- */
-const static int bigendiandetection = 1;
-#define ISBIGENDIAN() ((*reinterpret_cast<const char *>(&bigendiandetection)) == 0)
-
-static void swapByteOrder(char* d, unsigned int n) {
-    if (ISBIGENDIAN()) {
-        for (unsigned int i = 0; i < (n / 2); i++) {
-            char tmp = d[i];
-            d[i] = d[n - i - 1];
-            d[n - i - 1] = tmp;
-        }
-    }
+uint32_t BinaryReader::readU32() {
+    uint32_t ret;
+    readArray(&ret, 1);
+    return ret;
 }
 
-int8_t BinaryReader::read8() {
-    int8_t ret;
-    char* p = reinterpret_cast<char*>(&ret);
-    read(p, sizeof(ret));
+int64_t BinaryReader::read64() {
+    int64_t ret;
+    readArray(&ret, 1);
     return ret;
 }
 
-int16_t BinaryReader::read16() {
-    int16_t ret;
-    char* p = reinterpret_cast<char*>(&ret);
-    read(p, sizeof(ret));
-    swapByteOrder(p, 2);
+uint64_t BinaryReader::readU64() {
+    uint64_t ret;
+    readArray(&ret, 1);
     return ret;
 }
 
-int32_t BinaryReader::read32() {
-    int32_t ret;
-    char* p = reinterpret_cast<char*>(&ret);
-    read(p, sizeof(ret));
-    swapByteOrder(p, 4);
+float BinaryReader::readFloat() {
+    float ret;
+    readArray(&ret, 1);
     return ret;
 }
 
-int64_t BinaryReader::read64() {
-    int64_t ret;
-    char* p = reinterpret_cast<char*>(&ret);
-    read(p, sizeof(ret));
-    swapByteOrder(p, 8);
+std::string BinaryReader::readString() {
+    std::string ret(readU32(), '\0');
+    if (!ret.empty())
+        readArray(&ret[0], ret.size());
     return ret;
 }
 
@@ -181,9 +189,155 @@ void BinaryMemory::read(char* d, int c) {
     orAssertGreaterThanEqual(offset, 0);
     orAssertGreaterThan(c, 0);
     orAssertLessThanEqual(offset + c, max);
-    for (int i = 0; i < c; i++) {
-        d[i] = data[offset + i];
+    std::memcpy(d, data + offset, c);
+    offset += c;
+}
+
+// ----------------------------------------------------------------------------
+
+BinaryMapped::BinaryMapped(std::string f) : data(nullptr), offset(0), max(0), mapped(false) {
+    orAssertEqual(open(f), 0);
+}
+
+BinaryMapped::~BinaryMapped() {
+    close();
+}
+
+int BinaryMapped::open(std::string f) {
+    if (data != nullptr)
+        return 1;
+
+    if (f == "")
+        return 0;
+
+#ifdef USE_MMAP
+    int fd = ::open(f.c_str(), O_RDONLY);
+    if (fd < 0)
+        return 1;
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+        ::close(fd);
+        return 1;
+    }
+
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps its own reference
+    if (p == MAP_FAILED)
+        return 1;
+
+    data = static_cast<const char*>(p);
+    max = st.st_size;
+    mapped = true;
+#else
+    std::ifstream file(f, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+    if (!file)
+        return 1;
+
+    long long s = file.tellg();
+    if (s <= 0)
+        return 1;
+
+    char* buffer = new char[s];
+    file.seekg(0);
+    if (!file.read(buffer, s)) {
+        delete [] buffer;
+        return 1;
     }
+
+    data = buffer;
+    max = s;
+    mapped = false;
+#endif
+
+    offset = 0;
+    return 0;
+}
+
+int BinaryMapped::open(char* buffer, long long size) {
+    if (data != nullptr)
+        return 1;
+
+    if ((buffer == nullptr) || (size <= 0))
+        return 1;
+
+    data = buffer;
+    offset = 0;
+    max = size;
+    mapped = false;
+    return 0;
+}
+
+void BinaryMapped::close() {
+    if (data == nullptr)
+        return;
+
+#ifdef USE_MMAP
+    if (mapped)
+        munmap(const_cast<char*>(data), max);
+    else
+        delete [] data;
+#else
+    delete [] data;
+#endif
+
+    data = nullptr;
+    offset = 0;
+    max = 0;
+    mapped = false;
+}
+
+long long BinaryMapped::tell() {
+    orAssert(data != nullptr);
+    return offset;
+}
+
+void BinaryMapped::seek(long long pos) {
+    orAssert(data != nullptr);
+    orAssertGreaterThanEqual(pos, 0);
+    offset = pos;
+}
+
+bool BinaryMapped::eof() {
+    return (offset >= max);
+}
+
+const char* BinaryMapped::pointer(long long pos) {
+    orAssert(data != nullptr);
+    orAssertGreaterThanEqual(pos, 0);
+    orAssertLessThanEqual(pos, max);
+    return data + pos;
+}
+
+const char* BinaryMapped::span(long long n) {
+    orAssertGreaterThanEqual(n, 0);
+    orAssertLessThanEqual(offset + n, max);
+    const char* p = pointer(offset);
+    offset += n;
+    return p;
+}
+
+void BinaryMapped::read(char* d, int c) {
+    orAssert(data != nullptr);
+    orAssertGreaterThan(c, 0);
+    orAssertLessThanEqual(offset + c, max);
+    std::memcpy(d, data + offset, c);
     offset += c;
 }
 
+// ----------------------------------------------------------------------------
+
+uint64_t hashData(const char* data, long long size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    const uint64_t prime = 0x100000001B3ULL;
+    long long i = 0;
+    for (; (i + 8) <= size; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, data + i, 8);
+        hash = (hash ^ w) * prime;
+    }
+    for (; i < size; i++)
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+    return hash;
+}
+
@@ -16,8 +16,15 @@
 #include <stdlib.h>
 #endif
 
-#if defined(HAVE_DIRECT_H) && defined(HAVE__GETCWD)
+#if defined(HAVE_SYS_STAT_H) && (defined(HAVE_MKDIR) || defined(HAVE_STAT))
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#if defined(HAVE_DIRECT_H) && (defined(HAVE__GETCWD) || defined(HAVE__MKDIR))
 #include <direct.h>
+#include <errno.h>
 #endif
 
 #ifdef _WIN32
@@ -71,3 +78,43 @@ std::string getHomeDirectory() {
 #endif
 }
 
+int createDirectory(std::string path) {
+#if defined(HAVE_SYS_STAT_H) && defined(HAVE_MKDIR)
+
+    if ((mkdir(path.c_str(), 0755) == 0) || (errno == EEXIST))
+        return 0;
+    return -1;
+
+#elif defined(HAVE_DIRECT_H) && defined(HAVE__MKDIR)
+
+    if ((_mkdir(path.c_str()) == 0) || (errno == EEXIST))
+        return 0;
+    return -1;
+
+#else
+
+    return -1;
+
+#endif
+}
+
+int getFileInfo(std::string path, uint64_t* size, int64_t* mtime) {
+    orAssert(size != nullptr);
+    orAssert(mtime != nullptr);
+
+#if defined(HAVE_SYS_STAT_H) && defined(HAVE_STAT)
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return -1;
+    *size = st.st_size;
+    *mtime = st.st_mtime;
+    return 0;
+
+#else
+
+    return -1;
+
+#endif
+}
+
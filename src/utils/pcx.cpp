@@ -8,247 +8,268 @@
  * \author xythobuz
  */
 
-#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 #include "global.h"
 #include "Log.h"
+#include "utils/binary.h"
 #include "utils/pcx.h"
 
-int pcxCheck(const char* filename) {
-    orAssert(filename != nullptr);
-    orAssert(filename[0] != '\0');
-
-    std::ifstream file(filename, std::ios::in | std::ios::binary);
-
-    // Read raw PCX header, 128 bytes
-    unsigned char* header = new unsigned char[128];
+const static unsigned long headerSize = 128;
+const static unsigned long paletteSize = 768;
+
+namespace {
+    struct Header {
+        bool compressed;
+        unsigned int width, height;
+        unsigned int planes;
+        unsigned int bytesPerLine;
+        const unsigned char* palette; //!< 256 RGB entries at the end of the file, or nullptr
+    };
+}
 
-    // Basic validation
-    if (!file.read(reinterpret_cast<char*>(&header[0]), 128)) {
+static int parseHeader(const unsigned char* data, unsigned long size, Header& h) {
+    if ((data == nullptr) || (size < headerSize)) {
         Log::get(LOG_ERROR) << "File not big enough for valid PCX header!" << Log::endl;
-        delete [] header;
         return -1;
     }
 
-    if (header[0] != 0x0A) {
-        Log::get(LOG_ERROR) << "Magic number at file start is wrong (" << header[0] << " != 0x0A)" <<
-                            Log::endl;
-        delete [] header;
+    if (data[0] != 0x0A) {
+        Log::get(LOG_ERROR) << "Magic number at file start is wrong (" << int(data[0])
+                            << " != 0x0A)" << Log::endl;
         return -2;
     }
 
-    if ((header[1] != 0) && ((header[1] < 2) || (header[1] > 5))) {
+    if ((data[1] != 0) && ((data[1] < 2) || (data[1] > 5))) {
         // Valid: 0, 2, 3, 4, 5
-        Log::get(LOG_ERROR) << "Unknown PCX file format version (" << header[1] << ")" << Log::endl;
-        delete [] header;
+        Log::get(LOG_ERROR) << "Unknown PCX file format version (" << int(data[1]) << ")" << Log::endl;
         return -3;
     }
 
-    if ((header[2] != 0) && (header[2] != 1)) {
-        Log::get(LOG_ERROR) << "Unknown PCX file encoding (" << header[2] << ")" << Log::endl;
-        delete [] header;
+    if ((data[2] != 0) && (data[2] != 1)) {
+        Log::get(LOG_ERROR) << "Unknown PCX file encoding (" << int(data[2]) << ")" << Log::endl;
         return -4;
     }
 
-    if (header[3] != 8) {
-        Log::get(LOG_ERROR) << "Only supporting 8bit (" << header[3] << "bit)" << Log::endl;
-        delete [] header;
+    if (data[3] != 8) {
+        Log::get(LOG_ERROR) << "Only supporting 8bit (" << int(data[3]) << "bit)" << Log::endl;
         return -5;
     }
 
-    if (header[64] != 0) {
-        Log::get(LOG_ERROR) << "Reserved field is  used (" << header[64] << " != 0)" << Log::endl;
-        delete [] header;
+    if (data[64] != 0) {
+        Log::get(LOG_ERROR) << "Reserved field is  used (" << int(data[64]) << " != 0)" << Log::endl;
         return -6;
     }
 
-    delete [] header;
+    unsigned int xMin = data[4] | (data[5] << 8);
+    unsigned int yMin = data[6] | (data[7] << 8);
+    unsigned int xMax = data[8] | (data[9] << 8);
+    unsigned int yMax = data[10] | (data[11] << 8);
+    h.compressed = (data[2] == 1);
+    h.planes = data[65];
+    h.bytesPerLine = data[66] | (data[67] << 8);
+
+    if ((xMax < xMin) || (yMax < yMin) || (h.bytesPerLine < (xMax - xMin + 1))) {
+        Log::get(LOG_ERROR) << "Invalid PCX image size" << Log::endl;
+        return -7;
+    }
+
+    if ((h.planes != 1) && (h.planes != 3) && (h.planes != 4)) {
+        Log::get(LOG_ERROR) << "Unsupported number of planes (" << h.planes << ")" << Log::endl;
+        return -8;
+    }
+
+    h.width = xMax - xMin + 1;
+    h.height = yMax - yMin + 1;
+
+    // The 256 color palette is always stored in the last 769 bytes
+    h.palette = nullptr;
+    if ((data[1] == 5) && (h.planes == 1) && (size >= (headerSize + paletteSize + 1))
+        && (data[size - paletteSize - 1] == 12))
+        h.palette = data + (size - paletteSize);
+
     return 0;
 }
 
-int pcxLoad(const char* filename, unsigned char** image,
-            unsigned int* width, unsigned int* height,
-            ColorMode* mode, unsigned int* bpp) {
-    orAssert(filename != nullptr);
-    orAssert(filename[0] != '\0');
-    orAssert(image != nullptr);
-    orAssert(width != nullptr);
-    orAssert(height != nullptr);
-    orAssert(mode != nullptr);
-    orAssert(bpp != nullptr);
-
-    std::ifstream file(filename, std::ios::in | std::ios::binary);
+/*
+ * Expands one scanline of all planes. Runs may continue in the next line,
+ * they are carried over in run and value. Literal bytes are copied eight
+ * at a time, as long as none of them starts a run.
+ */
+static const unsigned char* decodeLine(const unsigned char* p, const unsigned char* end,
+                                       unsigned char* line, unsigned long length,
+                                       unsigned int& run, unsigned char& value) {
+    unsigned long i = 0;
+    while (i < length) {
+        if (run > 0) {
+            unsigned long n = std::min<unsigned long>(run, length - i);
+            std::memset(line + i, value, n);
+            i += n;
+            run -= n;
+            continue;
+        }
 
-    // Read raw PCX header, 128 bytes
-    unsigned char* header = new unsigned char[128];
+        while (((length - i) >= 8) && ((end - p) >= 8)) {
+            uint64_t w;
+            std::memcpy(&w, p, 8);
+            if ((w & (w << 1) & 0x8080808080808080ULL) != 0)
+                break;
+            std::memcpy(line + i, p, 8);
+            i += 8;
+            p += 8;
+        }
 
-    // Basic validation
-    if (!file.read(reinterpret_cast<char*>(&header[0]), 128)) {
-        Log::get(LOG_ERROR) << "File not big enough for valid PCX header!" << Log::endl;
-        delete [] header;
-        return -1;
+        if (i >= length)
+            break;
+        if (p >= end)
+            return nullptr;
+
+        unsigned char c = *p++;
+        if ((c & 0xC0) == 0xC0) {
+            if (p >= end)
+                return nullptr;
+            run = c & 0x3F;
+            value = *p++;
+        } else {
+            line[i++] = c;
+        }
     }
 
-    if (header[0] != 0x0A) {
-        Log::get(LOG_ERROR) << "Magic number at file start is wrong (" << header[0] << " != 0x0A)" <<
-                            Log::endl;
-        delete [] header;
-        return -2;
-    }
+    return p;
+}
 
-    if ((header[1] != 0) && ((header[1] < 2) || (header[1] > 5))) {
-        // Valid: 0, 2, 3, 4, 5
-        Log::get(LOG_ERROR) << "Unknown PCX file format version (" << header[1] << ")" << Log::endl;
-        delete [] header;
-        return -3;
-    }
+int pcxCheck(const unsigned char* data, unsigned long size,
+             unsigned int* width, unsigned int* height) {
+    Header h;
+    int error = parseHeader(data, size, h);
+    if (error != 0)
+        return error;
+
+    if (width != nullptr)
+        *width = h.width;
+    if (height != nullptr)
+        *height = h.height;
+    return 0;
+}
 
-    if ((header[2] != 0) && (header[2] != 1)) {
-        Log::get(LOG_ERROR) << "Unknown PCX file encoding (" << header[2] << ")" << Log::endl;
-        delete [] header;
-        return -4;
-    }
+int pcxDecode(const unsigned char* data, unsigned long size, unsigned char* image) {
+    orAssert(image != nullptr);
 
-    if (header[3] != 8) {
-        Log::get(LOG_ERROR) << "Only supporting 8bit (" << header[3] << "bit)" << Log::endl;
-        delete [] header;
-        return -5;
+    Header h;
+    int error = parseHeader(data, size, h);
+    if (error != 0)
+        return error;
+
+    // Single plane images are expanded with a table, gray without palette
+    uint32_t table[256];
+    if (h.planes == 1) {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned char c[4] = { static_cast<unsigned char>(i), static_cast<unsigned char>(i),
+                                   static_cast<unsigned char>(i), 255
+                                 };
+            if (h.palette != nullptr)
+                std::memcpy(c, h.palette + (i * 3), 3);
+            std::memcpy(&table[i], c, 4);
+        }
     }
 
-    if (header[64] != 0) {
-        Log::get(LOG_ERROR) << "Reserved field is  used (" << header[64] << " != 0)" << Log::endl;
-        delete [] header;
-        return -6;
-    }
+    const unsigned char* p = data + headerSize;
+    const unsigned char* end = data + size;
+    if (h.palette != nullptr)
+        end = h.palette - 1;
+
+    unsigned long length = h.planes * h.bytesPerLine;
+    std::vector<unsigned char> line;
+    if (h.compressed)
+        line.resize(length);
+
+    unsigned int run = 0;
+    unsigned char value = 0;
+    for (unsigned int y = 0; y < h.height; y++) {
+        const unsigned char* l;
+        if (h.compressed) {
+            p = decodeLine(p, end, &line[0], length, run, value);
+            l = &line[0];
+        } else {
+            l = ((end - p) >= static_cast<long>(length)) ? p : nullptr;
+            if (l != nullptr)
+                p += length;
+        }
 
-    // Read header informations
-    bool versionFive = (header[1] == 5);
-    bool compressed = (header[2] == 1);
-    //unsigned char bitsPerPixel = header[3];
-    unsigned int xMin = header[4] | (header[5] << 8);
-    unsigned int yMin = header[6] | (header[7] << 8);
-    unsigned int xMax = header[8] | (header[9] << 8);
-    unsigned int yMax = header[10] | (header[11] << 8);
-    //unsigned int hDPI = header[12] | (header[13] << 8);
-    //unsigned int vDPI = header[14] | (header[15] << 8);
-    //unsigned char *colormap = header + 16;
-    unsigned char nPlanes = header[65];
-    unsigned int bytesPerLine = header[66] | (header[67] << 8);
-    //unsigned int paletteInfo = header[68] | (header[69] << 8);
-    //unsigned int hScreenSize = header[70] | (header[71] << 8); // Only in some versionFive files
-    //unsigned int vScreenSize = header[72] | (header[73] << 8); // Only in some versionFive files
-
-    delete [] header;
-
-    // Calculations
-    *width = xMax - xMin + 1;
-    *height = yMax - yMin + 1;
-    unsigned long totalBytes = nPlanes * bytesPerLine; // total bytes per scan line
-    unsigned long imageSize = totalBytes** height;
-    unsigned char* buffer = new unsigned char[imageSize];
-    unsigned long b = 0;
-
-    // Read encoded pixel data
-    for (unsigned long i = 0; i < imageSize;) {
-        unsigned int n = 1; // Run-length-encoding assumes 1
-        int c = file.get();
-        if (!file) {
-            Log::get(LOG_ERROR) << "Could not read data (" << i
-                                << (file.eof() ? " EOF" : "") << ")" << Log::endl;
-            delete [] buffer;
-            return -7;
+        if ((p == nullptr) || (l == nullptr)) {
+            Log::get(LOG_ERROR) << "Could not read data (line " << y << " EOF)" << Log::endl;
+            return -9;
         }
 
-        // Run-Length-Encoding
-        if (compressed) {
-            if ((c & 0xC0) == 0xC0) {
-                n = c & 0x3F;
-                c = file.get();
-                if (!file) {
-                    Log::get(LOG_ERROR) << "Could not read data rle (" << i
-                                        << (file.eof() ? " EOF" : "") << ")" << Log::endl;
-                    delete [] buffer;
-                    return -8;
-                }
+        unsigned char* out = image + (static_cast<unsigned long>(y) * h.width * 4);
+        if (h.planes == 1) {
+            for (unsigned int x = 0; x < h.width; x++)
+                std::memcpy(out + (x * 4), &table[l[x]], 4);
+        } else {
+            const unsigned char* r = l;
+            const unsigned char* g = l + h.bytesPerLine;
+            const unsigned char* b = l + (2 * h.bytesPerLine);
+            const unsigned char* a = (h.planes == 4) ? (l + (3 * h.bytesPerLine)) : nullptr;
+            for (unsigned int x = 0; x < h.width; x++, out += 4) {
+                out[0] = r[x];
+                out[1] = g[x];
+                out[2] = b[x];
+                out[3] = (a != nullptr) ? a[x] : 255;
             }
         }
+    }
 
-        for (unsigned int j = 0; j < n; j++)
-            buffer[b++] = static_cast<unsigned char>(c);
+    return 0;
+}
 
-        i += n;
-    }
+int pcxCheck(const char* filename) {
+    orAssert(filename != nullptr);
+    orAssert(filename[0] != '\0');
 
-    // Read color palette
-    unsigned char* palette = nullptr;
-    if (versionFive) {
-        int c = file.get();
-        if ((c == 12) && file) {
-            palette = new unsigned char[768];
-            for (unsigned int i = 0; i < 768; i++) {
-                palette[i] = static_cast<unsigned char>(file.get());
-                if (!file) {
-                    Log::get(LOG_ERROR) << "Could not read 256 color palette (" << i << ")" << Log::endl;
-                    delete [] buffer;
-                    delete [] palette;
-                    return -9;
-                }
-            }
-        }
+    BinaryMapped file;
+    if ((file.open(filename) != 0) || (file.size() < static_cast<long long>(headerSize))) {
+        Log::get(LOG_ERROR) << "File not big enough for valid PCX header!" << Log::endl;
+        return -1;
     }
 
-    // Bring buffer into preferred format
-    unsigned long size = *width** height * 4;
-    *image = new unsigned char[size];
-    for (unsigned int y = 0; y < *height; y++) {
-        for (unsigned int x = 0; x < *width; x++) {
-            unsigned long baseIndex = (x + (y** width)) * 4;
-            unsigned char alpha = 255, red = 0, green = 0, blue = 0;
-
-            if (palette != nullptr) {
-                if (nPlanes == 1) {
-                    red = palette[buffer[(y * totalBytes) + x] * 3];
-                    green = palette[(buffer[(y * totalBytes) + x] * 3) + 1];
-                    blue = palette[(buffer[(y * totalBytes) + x] * 3) + 2];
-                } else {
-                    Log::get(LOG_ERROR) << "Unsupported number of planes (" << nPlanes << ")" << Log::endl;
-                    delete [] buffer;
-                    delete [] palette;
-                    delete [] *image;
-                    *image = nullptr;
-                    return -10;
-                }
-            } else {
-                if ((nPlanes == 3) || (nPlanes == 4)) {
-                    red = buffer[(y * totalBytes) + x];
-                    green = buffer[(y * totalBytes) + *width + x];
-                    blue = buffer[(y * totalBytes) + (2 * *width) + x];
-                    if (nPlanes == 4)
-                        alpha = buffer[(y * totalBytes) + (3 * *width) + x];
-                } else if (nPlanes == 1) {
-                    red = green = blue = buffer[(y * totalBytes) + x];
-                } else {
-                    Log::get(LOG_ERROR) << "Unsupported number of planes (" << nPlanes << ")" << Log::endl;
-                    delete [] buffer;
-                    delete [] palette;
-                    delete [] *image;
-                    *image = nullptr;
-                    return -11;
-                }
-            }
+    return pcxCheck(reinterpret_cast<const unsigned char*>(file.pointer(0)), file.size());
+}
 
-            (*image)[baseIndex + 0] = red;
-            (*image)[baseIndex + 1] = green;
-            (*image)[baseIndex + 2] = blue;
-            (*image)[baseIndex + 3] = alpha;
-        }
+int pcxLoad(const char* filename, unsigned char** image,
+            unsigned int* width, unsigned int* height,
+            ColorMode* mode, unsigned int* bpp) {
+    orAssert(filename != nullptr);
+    orAssert(filename[0] != '\0');
+    orAssert(image != nullptr);
+    orAssert(width != nullptr);
+    orAssert(height != nullptr);
+    orAssert(mode != nullptr);
+    orAssert(bpp != nullptr);
+
+    BinaryMapped file;
+    if ((file.open(filename) != 0) || (file.size() < static_cast<long long>(headerSize))) {
+        Log::get(LOG_ERROR) << "File not big enough for valid PCX header!" << Log::endl;
+        return -1;
+    }
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file.pointer(0));
+    int error = pcxCheck(data, file.size(), width, height);
+    if (error != 0)
+        return error;
+
+    *image = new unsigned char[static_cast<unsigned long>(*width) * *height * 4];
+    error = pcxDecode(data, file.size(), *image);
+    if (error != 0) {
+        delete [] *image;
+        *image = nullptr;
+        return error;
     }
 
     *mode = ColorMode::RGBA;
     *bpp = 32;
-
-    delete [] buffer;
-    delete [] palette;
     return 0;
 }
 
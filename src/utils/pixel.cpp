@@ -5,33 +5,58 @@
  * \author xythobuz
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
 #include "global.h"
-#include "utils/pixel.h"
 
-unsigned char* generateColorTexture(glm::vec4 rgba, unsigned int width,
-                                    unsigned int height, unsigned int bpp) {
-    orAssert(width > 0);
-    orAssert(height > 0);
-    orAssert((bpp == 24) || (bpp == 32));
+#if (defined(__SSE2__) || defined(_M_X64)) && !defined(WORDS_BIGENDIAN)
+#include <emmintrin.h>
+#define USE_SSE2
 
-    unsigned char* image = new unsigned char[height * width * (bpp / 8)];
-    for (unsigned int i = 0; i < (width * height); i++) {
-        image[i * (bpp / 8)] = static_cast<unsigned char>(rgba.r * 255);
-        image[(i * (bpp / 8)) + 1] = static_cast<unsigned char>(rgba.g * 255);
-        image[(i * (bpp / 8)) + 2] = static_cast<unsigned char>(rgba.b * 255);
-        if (bpp == 32) {
-            image[(i * (bpp / 8)) + 3] = static_cast<unsigned char>(rgba.a * 255);
-        }
-    }
-    return image;
-}
+// AVX2 code is compiled for its functions only, used if the CPU has it
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define USE_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
-void argb2rgba32(unsigned char* image, unsigned int w, unsigned int h) {
-    orAssert(image != nullptr);
-    orAssert(w > 0);
-    orAssert(h > 0);
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(WORDS_BIGENDIAN)
+#include <arm_neon.h>
+#define USE_NEON
+#endif
+
+#include "utils/ThreadPool.h"
+#include "utils/pixel.h"
+
+/*
+ * Every kernel exists as scalar reference, the other versions do as many
+ * pixels as fit their vectors and leave the rest to the scalar one. They
+ * all assume little-endian 32bit pixels, so big-endian CPUs only get the
+ * scalar kernels.
+ */
+namespace {
+    struct PixelKernels {
+        void (*argb2rgba32)(unsigned char* image, unsigned long n);
+        void (*bgra2rgba32)(unsigned char* image, unsigned long n);
+        void (*argb16to32)(const unsigned char* image, unsigned char* out, unsigned long n);
+        void (*argb16torgba32)(const unsigned char* image, unsigned char* out, unsigned long n);
+        void (*grayscale2rgba)(const unsigned char* image, unsigned char* out, unsigned long n);
+        void (*fill32)(unsigned char* out, const unsigned char* color, unsigned long n);
+        void (*fill24)(unsigned char* out, const unsigned char* color, unsigned long n);
+        void (*palette2rgba32)(const unsigned char* image, const unsigned char* palette,
+                               unsigned char* out, unsigned long n);
+    };
+}
 
-    for (unsigned int i = 0; i < (w * h); ++i) {
+static void argb2rgba32Scalar(unsigned char* image, unsigned long n) {
+    for (unsigned long i = 0; i < n; ++i) {
         // 32-bit ARGB to RGBA
         unsigned char swap = image[i * 4];
         image[i * 4] = image[(i * 4) + 1];
@@ -41,13 +66,17 @@ void argb2rgba32(unsigned char* image, unsigned int w, unsigned int h) {
     }
 }
 
-unsigned char* argb16to32(unsigned char* image, unsigned int w, unsigned int h) {
-    orAssert(image != nullptr);
-    orAssert(w > 0);
-    orAssert(h > 0);
+static void bgra2rgba32Scalar(unsigned char* image, unsigned long n) {
+    for (unsigned long i = 0; i < n; ++i) {
+        // 32-bit BGRA to RGBA
+        unsigned char swap = image[i * 4];
+        image[i * 4] = image[(i * 4) + 2];
+        image[(i * 4) + 2] = swap;
+    }
+}
 
-    unsigned char* img = new unsigned char[w * h * 4];
-    for (unsigned int i = 0; i < (w * h); ++i) {
+static void argb16to32Scalar(const unsigned char* image, unsigned char* img, unsigned long n) {
+    for (unsigned long i = 0; i < n; ++i) {
         // arrr.rrgg gggb.bbbb shift to 5bit
         img[i * 4] = (image[(i * 2) + 1] & 0x80) ? 0xFF : 0; // A
         img[(i * 4) + 1] = (image[(i * 2) + 1] & 0x7C) >> 2; // R
@@ -59,160 +88,812 @@ unsigned char* argb16to32(unsigned char* image, unsigned int w, unsigned int h)
         img[(i * 4) + 2] <<= 3; // G
         img[(i * 4) + 3] <<= 3; // B
     }
-    return img;
 }
 
-unsigned char* grayscale2rgba(unsigned char* image, unsigned int w, unsigned int h) {
-    orAssert(image != nullptr);
-    orAssert(w > 0);
-    orAssert(h > 0);
+static void argb16torgba32Scalar(const unsigned char* image, unsigned char* out,
+                                 unsigned long n) {
+    for (unsigned long i = 0; i < n; ++i) {
+        // arrr.rrgg gggb.bbbb, little-endian
+        unsigned int p = image[i * 2] | (image[(i * 2) + 1] << 8);
+        out[i * 4] = static_cast<unsigned char>(((p >> 10) & 0x1F) << 3); // R
+        out[(i * 4) + 1] = static_cast<unsigned char>(((p >> 5) & 0x1F) << 3); // G
+        out[(i * 4) + 2] = static_cast<unsigned char>((p & 0x1F) << 3); // B
+        out[(i * 4) + 3] = (p & 0x8000) ? 0xFF : 0; // A
+    }
+}
 
-    unsigned char* img = new unsigned char[w * h * 4];
-    for (unsigned int i = 0; i < (w * h); i++) {
+static void grayscale2rgbaScalar(const unsigned char* image, unsigned char* img,
+                                 unsigned long n) {
+    for (unsigned long i = 0; i < n; i++) {
         img[i * 4] = image[i];
         img[(i * 4) + 1] = image[i];
         img[(i * 4) + 2] = image[i];
         img[(i * 4) + 3] = (image[i] == 0) ? 0 : 255;
     }
-    return img;
 }
 
-#define NEXT_POWER(x) do {        \
-    unsigned int i;               \
-    for (i = 1; i < (x); i *= 2); \
-    (x) = i;                      \
-} while (false);
+static void fill32Scalar(unsigned char* out, const unsigned char* color, unsigned long n) {
+    for (unsigned long i = 0; i < n; i++)
+        std::memcpy(out + (i * 4), color, 4);
+}
 
-// This code based off on gluScaleImage()
-unsigned char* scaleBuffer(unsigned char* image, unsigned int* w, unsigned int* h,
-                           unsigned int bpp) {
-    unsigned int width = *w;
-    unsigned int height = *h;
-    orAssert(image != nullptr);
-    orAssert(width > 0);
-    orAssert(height > 0);
-    orAssert((bpp % 8) == 0);
+static void fill24Scalar(unsigned char* out, const unsigned char* color, unsigned long n) {
+    for (unsigned long i = 0; i < n; i++)
+        std::memcpy(out + (i * 3), color, 3);
+}
 
-    unsigned int components = bpp / 8;
-    unsigned int original_height = height;
-    unsigned int original_width = width;
+static void palette2rgba32Scalar(const unsigned char* image, const unsigned char* palette,
+                                 unsigned char* out, unsigned long n) {
+    for (unsigned long i = 0; i < n; i++)
+        std::memcpy(out + (i * 4), palette + (image[i] * 4), 4);
+}
 
-    NEXT_POWER(height);
-    NEXT_POWER(width);
+const static PixelKernels scalarKernels = {
+    argb2rgba32Scalar, bgra2rgba32Scalar, argb16to32Scalar, argb16torgba32Scalar,
+    grayscale2rgbaScalar, fill32Scalar, fill24Scalar, palette2rgba32Scalar
+};
 
-    // Check to see if scaling is needed
-    if (height == original_height && width == original_width)
-        return nullptr;
+// ----------------------------------------------------------------------------
 
-    *w = width;
-    *h = height;
+#ifdef USE_SSE2
 
-    unsigned char* timage = new unsigned char[height * width * components];
-    float* tempin = new float[original_width * original_height * components];
-    float* tempout = new float[width * height * components];
+static void argb2rgba32SSE2(unsigned char* image, unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 4) <= n; i += 4) {
+        __m128i* p = reinterpret_cast<__m128i*>(image + (i * 4));
+        __m128i v = _mm_loadu_si128(p);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_srli_epi32(v, 8), _mm_slli_epi32(v, 24)));
+    }
+    argb2rgba32Scalar(image + (i * 4), n - i);
+}
 
-    // Copy user data to float format.
-    for (unsigned int i = 0; i < original_height * original_width * components; ++i) {
-        tempin[i] = image[i];
+static void bgra2rgba32SSE2(unsigned char* image, unsigned long n) {
+    const __m128i ga = _mm_set1_epi32(0xFF00FF00);
+    const __m128i low = _mm_set1_epi32(0xFF);
+    unsigned long i = 0;
+    for (; (i + 4) <= n; i += 4) {
+        __m128i* p = reinterpret_cast<__m128i*>(image + (i * 4));
+        __m128i v = _mm_loadu_si128(p);
+        __m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+        __m128i b = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+        _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(v, ga), _mm_or_si128(r, b)));
     }
+    bgra2rgba32Scalar(image + (i * 4), n - i);
+}
 
-    // Determine which filter to use by checking ratios.
-    float sx;
-    if (width > 1) {
-        sx = (original_width - 1.0f) / (width - 1.0f);
-    } else {
-        sx = original_width - 1.0f;
+// Channels of eight ARGB1555 pixels, shifted to 8bit, in 16bit lanes
+static void split1555SSE2(__m128i p, __m128i& r, __m128i& g, __m128i& b, __m128i& a) {
+    const __m128i mask = _mm_set1_epi16(0xF8);
+    r = _mm_and_si128(_mm_srli_epi16(p, 7), mask);
+    g = _mm_and_si128(_mm_srli_epi16(p, 2), mask);
+    b = _mm_and_si128(_mm_slli_epi16(p, 3), mask);
+    a = _mm_srli_epi16(_mm_srai_epi16(p, 15), 8);
+}
+
+static void argb16to32SSE2(const unsigned char* image, unsigned char* out, unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8) {
+        __m128i r, g, b, a;
+        split1555SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(image + (i * 2))),
+                      r, g, b, a);
+        __m128i ar = _mm_or_si128(a, _mm_slli_epi16(r, 8));
+        __m128i gb = _mm_or_si128(g, _mm_slli_epi16(b, 8));
+        __m128i* o = reinterpret_cast<__m128i*>(out + (i * 4));
+        _mm_storeu_si128(o, _mm_unpacklo_epi16(ar, gb));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(ar, gb));
     }
+    argb16to32Scalar(image + (i * 2), out + (i * 4), n - i);
+}
 
-    float sy;
-    if (height > 1) {
-        sy = (original_height - 1.0f) / (height - 1.0f);
-    } else {
-        sy = original_height - 1.0f;
+static void argb16torgba32SSE2(const unsigned char* image, unsigned char* out, unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8) {
+        __m128i r, g, b, a;
+        split1555SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(image + (i * 2))),
+                      r, g, b, a);
+        __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        __m128i ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+        __m128i* o = reinterpret_cast<__m128i*>(out + (i * 4));
+        _mm_storeu_si128(o, _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(rg, ba));
     }
+    argb16torgba32Scalar(image + (i * 2), out + (i * 4), n - i);
+}
 
-    if (sx < 1.0 && sy < 1.0) { // Magnify both width and height: use weighted sample of 4 pixels
-        for (unsigned int i = 0; i < height; ++i) {
-            unsigned int i0 = static_cast<unsigned int>(i * sy);
-            unsigned int i1 = i0 + 1;
+static void grayscale2rgbaSSE2(const unsigned char* image, unsigned char* out, unsigned long n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    unsigned long i = 0;
+    for (; (i + 16) <= n; i += 16) {
+        __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(image + i));
+        __m128i a = _mm_xor_si128(_mm_cmpeq_epi8(g, zero), ones);
+        __m128i ggLow = _mm_unpacklo_epi8(g, g), ggHigh = _mm_unpackhi_epi8(g, g);
+        __m128i gaLow = _mm_unpacklo_epi8(g, a), gaHigh = _mm_unpackhi_epi8(g, a);
+        __m128i* o = reinterpret_cast<__m128i*>(out + (i * 4));
+        _mm_storeu_si128(o, _mm_unpacklo_epi16(ggLow, gaLow));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(ggLow, gaLow));
+        _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(ggHigh, gaHigh));
+        _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(ggHigh, gaHigh));
+    }
+    grayscale2rgbaScalar(image + i, out + (i * 4), n - i);
+}
 
-            if (i1 >= original_height) {
-                i1 = original_height - 1;
-            }
+static void fill32SSE2(unsigned char* out, const unsigned char* color, unsigned long n) {
+    int c;
+    std::memcpy(&c, color, 4);
+    const __m128i v = _mm_set1_epi32(c);
+    unsigned long i = 0;
+    for (; (i + 4) <= n; i += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + (i * 4)), v);
+    fill32Scalar(out + (i * 4), color, n - i);
+}
 
-            float alpha = i * sy - i0;
+static void fill24SSE2(unsigned char* out, const unsigned char* color, unsigned long n) {
+    // 16 pixels fill exactly three vectors
+    unsigned char pattern[48];
+    fill24Scalar(pattern, color, 16);
+    const __m128i* p = reinterpret_cast<const __m128i*>(pattern);
+    const __m128i a = _mm_loadu_si128(p), b = _mm_loadu_si128(p + 1), c = _mm_loadu_si128(p + 2);
+    unsigned long i = 0;
+    for (; (i + 16) <= n; i += 16) {
+        __m128i* o = reinterpret_cast<__m128i*>(out + (i * 3));
+        _mm_storeu_si128(o, a);
+        _mm_storeu_si128(o + 1, b);
+        _mm_storeu_si128(o + 2, c);
+    }
+    fill24Scalar(out + (i * 3), color, n - i);
+}
 
-            for (unsigned int j = 0; j < width; ++j) {
-                unsigned int j0 = static_cast<unsigned int>(j * sx);
-                unsigned int j1 = j0 + 1;
+static void palette2rgba32SSE2(const unsigned char* image, const unsigned char* palette,
+                               unsigned char* out, unsigned long n) {
+    // No gather in SSE2, but four lookups still become one store
+    int table[256];
+    std::memcpy(table, palette, sizeof(table));
+    unsigned long i = 0;
+    for (; (i + 4) <= n; i += 4) {
+        __m128i v = _mm_set_epi32(table[image[i + 3]], table[image[i + 2]],
+                                  table[image[i + 1]], table[image[i]]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + (i * 4)), v);
+    }
+    palette2rgba32Scalar(image + i, palette, out + (i * 4), n - i);
+}
 
-                if (j1 >= original_width) {
-                    j1 = original_width - 1;
-                }
+const static PixelKernels sse2Kernels = {
+    argb2rgba32SSE2, bgra2rgba32SSE2, argb16to32SSE2, argb16torgba32SSE2,
+    grayscale2rgbaSSE2, fill32SSE2, fill24SSE2, palette2rgba32SSE2
+};
 
-                float beta = j * sx - j0;
+#endif
 
-                // Compute weighted average of pixels in rect (i0,j0)-(i1,j1)
-                float* src00 = tempin + (i0 * original_width + j0) * components;
-                float* src01 = tempin + (i0 * original_width + j1) * components;
-                float* src10 = tempin + (i1 * original_width + j0) * components;
-                float* src11 = tempin + (i1 * original_width + j1) * components;
+// ----------------------------------------------------------------------------
 
-                float* dst = tempout + (i * width + j) * components;
+#ifdef USE_AVX2
 
-                for (unsigned int k = 0; k < components; ++k) {
-                    float s1 = *src00++ * (1.0f - beta) + *src01++ * beta;
-                    float s2 = *src10++ * (1.0f - beta) + *src11++ * beta;
-                    *dst++ = s1 * (1.0f - alpha) + s2 * alpha;
-                }
-            }
-        }
-    } else { // Shrink width and/or height: use an unweighted box filter
-        for (unsigned int i = 0; i < height; ++i) {
-            unsigned int i0 = static_cast<unsigned int>(i * sy);
-            unsigned int i1 = i0 + 1;
+TARGET_AVX2 static void argb2rgba32AVX2(unsigned char* image, unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8) {
+        __m256i* p = reinterpret_cast<__m256i*>(image + (i * 4));
+        __m256i v = _mm256_loadu_si256(p);
+        _mm256_storeu_si256(p, _mm256_or_si256(_mm256_srli_epi32(v, 8), _mm256_slli_epi32(v, 24)));
+    }
+    argb2rgba32Scalar(image + (i * 4), n - i);
+}
 
-            if (i1 >= original_height) {
-                i1 = original_height - 1;
-            }
+TARGET_AVX2 static void bgra2rgba32AVX2(unsigned char* image, unsigned long n) {
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8) {
+        __m256i* p = reinterpret_cast<__m256i*>(image + (i * 4));
+        _mm256_storeu_si256(p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), shuffle));
+    }
+    bgra2rgba32Scalar(image + (i * 4), n - i);
+}
+
+// Eight ARGB1555 pixels widened to 32bit lanes, alpha as 0 or 0xFFFFFFFF
+TARGET_AVX2 static __m256i load1555AVX2(const unsigned char* image, __m256i& alpha) {
+    __m256i p = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(image)));
+    alpha = _mm256_srai_epi32(_mm256_slli_epi32(p, 16), 31);
+    return p;
+}
+
+TARGET_AVX2 static void argb16to32AVX2(const unsigned char* image, unsigned char* out,
+                                       unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8) {
+        __m256i a;
+        __m256i p = load1555AVX2(image + (i * 2), a);
+        __m256i v = _mm256_and_si256(a, _mm256_set1_epi32(0xFF));
+        v = _mm256_or_si256(v, _mm256_and_si256(_mm256_slli_epi32(p, 1), _mm256_set1_epi32(0xF800)));
+        v = _mm256_or_si256(v, _mm256_and_si256(_mm256_slli_epi32(p, 14), _mm256_set1_epi32(0xF80000)));
+        v = _mm256_or_si256(v, _mm256_slli_epi32(p, 27));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (i * 4)), v);
+    }
+    argb16to32Scalar(image + (i * 2), out + (i * 4), n - i);
+}
+
+TARGET_AVX2 static void argb16torgba32AVX2(const unsigned char* image, unsigned char* out,
+        unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8) {
+        __m256i a;
+        __m256i p = load1555AVX2(image + (i * 2), a);
+        __m256i v = _mm256_and_si256(_mm256_srli_epi32(p, 7), _mm256_set1_epi32(0xF8));
+        v = _mm256_or_si256(v, _mm256_and_si256(_mm256_slli_epi32(p, 6), _mm256_set1_epi32(0xF800)));
+        v = _mm256_or_si256(v, _mm256_and_si256(_mm256_slli_epi32(p, 19), _mm256_set1_epi32(0xF80000)));
+        v = _mm256_or_si256(v, _mm256_slli_epi32(a, 24));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (i * 4)), v);
+    }
+    argb16torgba32Scalar(image + (i * 2), out + (i * 4), n - i);
+}
+
+TARGET_AVX2 static void grayscale2rgbaAVX2(const unsigned char* image, unsigned char* out,
+        unsigned long n) {
+    const __m256i gray = _mm256_set1_epi32(0x010101);
+    const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8) {
+        __m256i g = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(image + i)));
+        __m256i a = _mm256_andnot_si256(_mm256_cmpeq_epi32(g, _mm256_setzero_si256()), alpha);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (i * 4)),
+                            _mm256_or_si256(_mm256_mullo_epi32(g, gray), a));
+    }
+    grayscale2rgbaScalar(image + i, out + (i * 4), n - i);
+}
+
+TARGET_AVX2 static void fill32AVX2(unsigned char* out, const unsigned char* color,
+                                   unsigned long n) {
+    int c;
+    std::memcpy(&c, color, 4);
+    const __m256i v = _mm256_set1_epi32(c);
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (i * 4)), v);
+    fill32Scalar(out + (i * 4), color, n - i);
+}
+
+TARGET_AVX2 static void fill24AVX2(unsigned char* out, const unsigned char* color,
+                                   unsigned long n) {
+    // 32 pixels fill exactly three vectors
+    unsigned char pattern[96];
+    fill24Scalar(pattern, color, 32);
+    const __m256i* p = reinterpret_cast<const __m256i*>(pattern);
+    const __m256i a = _mm256_loadu_si256(p), b = _mm256_loadu_si256(p + 1);
+    const __m256i c = _mm256_loadu_si256(p + 2);
+    unsigned long i = 0;
+    for (; (i + 32) <= n; i += 32) {
+        __m256i* o = reinterpret_cast<__m256i*>(out + (i * 3));
+        _mm256_storeu_si256(o, a);
+        _mm256_storeu_si256(o + 1, b);
+        _mm256_storeu_si256(o + 2, c);
+    }
+    fill24Scalar(out + (i * 3), color, n - i);
+}
+
+TARGET_AVX2 static void palette2rgba32AVX2(const unsigned char* image,
+        const unsigned char* palette, unsigned char* out, unsigned long n) {
+    const int* table = reinterpret_cast<const int*>(palette);
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(image + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (i * 4)),
+                            _mm256_i32gather_epi32(table, index, 4));
+    }
+    palette2rgba32Scalar(image + i, palette, out + (i * 4), n - i);
+}
+
+const static PixelKernels avx2Kernels = {
+    argb2rgba32AVX2, bgra2rgba32AVX2, argb16to32AVX2, argb16torgba32AVX2,
+    grayscale2rgbaAVX2, fill32AVX2, fill24AVX2, palette2rgba32AVX2
+};
+
+#endif
+
+// ----------------------------------------------------------------------------
+
+#ifdef USE_NEON
+
+static void argb2rgba32NEON(unsigned char* image, unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 16) <= n; i += 16) {
+        uint8x16x4_t v = vld4q_u8(image + (i * 4));
+        uint8x16x4_t o = { { v.val[1], v.val[2], v.val[3], v.val[0] } };
+        vst4q_u8(image + (i * 4), o);
+    }
+    argb2rgba32Scalar(image + (i * 4), n - i);
+}
 
-            for (unsigned int j = 0; j < width; ++j) {
-                unsigned int j0 = static_cast<unsigned int>(j * sx);
-                unsigned int j1 = j0 + 1;
+static void bgra2rgba32NEON(unsigned char* image, unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 16) <= n; i += 16) {
+        uint8x16x4_t v = vld4q_u8(image + (i * 4));
+        uint8x16x4_t o = { { v.val[2], v.val[1], v.val[0], v.val[3] } };
+        vst4q_u8(image + (i * 4), o);
+    }
+    bgra2rgba32Scalar(image + (i * 4), n - i);
+}
+
+// Channels of eight ARGB1555 pixels, shifted to 8bit
+static void split1555NEON(const unsigned char* image, uint8x8_t& r, uint8x8_t& g,
+                          uint8x8_t& b, uint8x8_t& a) {
+    uint16x8_t p = vld1q_u16(reinterpret_cast<const uint16_t*>(image));
+    const uint16x8_t mask = vdupq_n_u16(0xF8);
+    r = vmovn_u16(vandq_u16(vshrq_n_u16(p, 7), mask));
+    g = vmovn_u16(vandq_u16(vshrq_n_u16(p, 2), mask));
+    b = vmovn_u16(vshlq_n_u16(p, 3));
+    a = vmovn_u16(vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(p), 15)));
+}
+
+static void argb16to32NEON(const unsigned char* image, unsigned char* out, unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8) {
+        uint8x8x4_t o;
+        split1555NEON(image + (i * 2), o.val[1], o.val[2], o.val[3], o.val[0]);
+        vst4_u8(out + (i * 4), o);
+    }
+    argb16to32Scalar(image + (i * 2), out + (i * 4), n - i);
+}
 
-                if (j1 >= original_width) {
-                    j1 = original_width - 1;
-                }
+static void argb16torgba32NEON(const unsigned char* image, unsigned char* out, unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 8) <= n; i += 8) {
+        uint8x8x4_t o;
+        split1555NEON(image + (i * 2), o.val[0], o.val[1], o.val[2], o.val[3]);
+        vst4_u8(out + (i * 4), o);
+    }
+    argb16torgba32Scalar(image + (i * 2), out + (i * 4), n - i);
+}
 
-                float* dst = tempout + (i * width + j) * components;
+static void grayscale2rgbaNEON(const unsigned char* image, unsigned char* out, unsigned long n) {
+    unsigned long i = 0;
+    for (; (i + 16) <= n; i += 16) {
+        uint8x16_t g = vld1q_u8(image + i);
+        uint8x16x4_t o = { { g, g, g, vtstq_u8(g, g) } };
+        vst4q_u8(out + (i * 4), o);
+    }
+    grayscale2rgbaScalar(image + i, out + (i * 4), n - i);
+}
 
-                // Compute average of pixels in the rectangle (i0,j0)-(i1,j1)
-                for (unsigned int k = 0; k < components; ++k) {
-                    float sum = 0.0;
+static void fill32NEON(unsigned char* out, const unsigned char* color, unsigned long n) {
+    uint32_t c;
+    std::memcpy(&c, color, 4);
+    const uint32x4_t v = vdupq_n_u32(c);
+    unsigned long i = 0;
+    for (; (i + 4) <= n; i += 4)
+        vst1q_u32(reinterpret_cast<uint32_t*>(out + (i * 4)), v);
+    fill32Scalar(out + (i * 4), color, n - i);
+}
 
-                    for (unsigned int ii = i0; ii <= i1; ++ii) {
-                        for (unsigned int jj = j0; jj <= j1; ++jj) {
-                            sum += *(tempin + (ii * original_width + jj)
-                                     * components + k);
-                        }
-                    }
+static void fill24NEON(unsigned char* out, const unsigned char* color, unsigned long n) {
+    const uint8x16x3_t v = { { vdupq_n_u8(color[0]), vdupq_n_u8(color[1]), vdupq_n_u8(color[2]) } };
+    unsigned long i = 0;
+    for (; (i + 16) <= n; i += 16)
+        vst3q_u8(out + (i * 3), v);
+    fill24Scalar(out + (i * 3), color, n - i);
+}
 
-                    sum /= (j1 - j0 + 1) * (i1 - i0 + 1);
-                    *dst++ = sum;
-                }
+// NEON has no gather, table lookups only reach 64 bytes
+const static PixelKernels neonKernels = {
+    argb2rgba32NEON, bgra2rgba32NEON, argb16to32NEON, argb16torgba32NEON,
+    grayscale2rgbaNEON, fill32NEON, fill24NEON, palette2rgba32Scalar
+};
+
+#endif
+
+// ----------------------------------------------------------------------------
+
+bool pixelHasSIMD(PixelSIMD s) {
+    switch (s) {
+        case PixelSIMD::SCALAR:
+            return true;
+
+        case PixelSIMD::SSE2:
+#ifdef USE_SSE2
+            return true;
+#else
+            return false;
+#endif
+
+        case PixelSIMD::AVX2:
+#ifdef USE_AVX2
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+
+        case PixelSIMD::NEON:
+#ifdef USE_NEON
+            return true;
+#else
+            return false;
+#endif
+    }
+
+    return false;
+}
+
+static PixelSIMD bestSIMD() {
+    for (PixelSIMD s : { PixelSIMD::AVX2, PixelSIMD::SSE2, PixelSIMD::NEON }) {
+        if (pixelHasSIMD(s))
+            return s;
+    }
+    return PixelSIMD::SCALAR;
+}
+
+static std::atomic<PixelSIMD>& activeSIMD() {
+    static std::atomic<PixelSIMD> active(bestSIMD());
+    return active;
+}
+
+static const PixelKernels& kernels() {
+    switch (activeSIMD().load(std::memory_order_relaxed)) {
+#ifdef USE_SSE2
+        case PixelSIMD::SSE2:
+            return sse2Kernels;
+#endif
+#ifdef USE_AVX2
+        case PixelSIMD::AVX2:
+            return avx2Kernels;
+#endif
+#ifdef USE_NEON
+        case PixelSIMD::NEON:
+            return neonKernels;
+#endif
+        default:
+            return scalarKernels;
+    }
+}
+
+PixelSIMD pixelGetSIMD() {
+    return activeSIMD().load();
+}
+
+int pixelSetSIMD(PixelSIMD s) {
+    if (!pixelHasSIMD(s))
+        return -1;
+
+    activeSIMD().store(s);
+    return 0;
+}
+
+const char* pixelSIMDName(PixelSIMD s) {
+    switch (s) {
+        case PixelSIMD::SSE2:
+            return "SSE2";
+        case PixelSIMD::AVX2:
+            return "AVX2";
+        case PixelSIMD::NEON:
+            return "NEON";
+        default:
+            return "Scalar";
+    }
+}
+
+// ----------------------------------------------------------------------------
+
+unsigned char* generateColorTexture(glm::vec4 rgba, unsigned int width,
+                                    unsigned int height, unsigned int bpp) {
+    orAssert(width > 0);
+    orAssert(height > 0);
+    orAssert((bpp == 24) || (bpp == 32));
+
+    unsigned char color[4] = {
+        static_cast<unsigned char>(rgba.r * 255), static_cast<unsigned char>(rgba.g * 255),
+        static_cast<unsigned char>(rgba.b * 255), static_cast<unsigned char>(rgba.a * 255)
+    };
+
+    unsigned char* image = new unsigned char[height * width * (bpp / 8)];
+    if (bpp == 32)
+        kernels().fill32(image, color, width * height);
+    else
+        kernels().fill24(image, color, width * height);
+    return image;
+}
+
+void argb2rgba32(unsigned char* image, unsigned int w, unsigned int h) {
+    orAssert(image != nullptr);
+    orAssert(w > 0);
+    orAssert(h > 0);
+
+    kernels().argb2rgba32(image, w * h);
+}
+
+void bgra2rgba32(unsigned char* image, unsigned int w, unsigned int h) {
+    orAssert(image != nullptr);
+    orAssert(w > 0);
+    orAssert(h > 0);
+
+    kernels().bgra2rgba32(image, w * h);
+}
+
+unsigned char* argb16to32(const unsigned char* image, unsigned int w, unsigned int h) {
+    orAssert(image != nullptr);
+    orAssert(w > 0);
+    orAssert(h > 0);
+
+    unsigned char* img = new unsigned char[w * h * 4];
+    kernels().argb16to32(image, img, w * h);
+    return img;
+}
+
+void argb16torgba32(const unsigned char* image, unsigned char* out,
+                    unsigned int w, unsigned int h) {
+    orAssert(image != nullptr);
+    orAssert(out != nullptr);
+    orAssert(w > 0);
+    orAssert(h > 0);
+
+    kernels().argb16torgba32(image, out, w * h);
+}
+
+unsigned char* grayscale2rgba(unsigned char* image, unsigned int w, unsigned int h) {
+    orAssert(image != nullptr);
+    orAssert(w > 0);
+    orAssert(h > 0);
+
+    unsigned char* img = new unsigned char[w * h * 4];
+    kernels().grayscale2rgba(image, img, w * h);
+    return img;
+}
+
+void palette2rgba32(const unsigned char* image, const unsigned char* palette,
+                    unsigned char* out, unsigned int w, unsigned int h) {
+    orAssert(image != nullptr);
+    orAssert(palette != nullptr);
+    orAssert(out != nullptr);
+    orAssert(w > 0);
+    orAssert(h > 0);
+
+    kernels().palette2rgba32(image, palette, out, w * h);
+}
+
+// ----------------------------------------------------------------------------
+
+/*
+ * Weights have 14 fractional bits and always add up to exactly one. The
+ * horizontal pass keeps 7 bits more than the source, so intermediate
+ * values and weights both fit the signed 16bit lanes of _mm_madd_epi16.
+ */
+const static int weightBits = 14;
+const static int weightOne = 1 << weightBits;
+const static int extraBits = 7;
+
+namespace {
+    /*
+     * Source pixels and weights for every destination pixel of one axis.
+     * All destination pixels use the same, even, number of taps, unused
+     * ones have a weight of zero.
+     */
+    struct Taps {
+        unsigned int count;
+        std::vector<uint32_t> index;
+        std::vector<int16_t> weight;
+    };
+}
+
+static void makeTaps(Taps& t, unsigned int src, unsigned int dst) {
+    std::vector<std::vector<std::pair<uint32_t, double>>> taps(dst);
+    if (dst > src) {
+        // Bilinear, first and last pixels stay in place like in gluScaleImage
+        double s = (dst > 1) ? ((src - 1.0) / (dst - 1.0)) : 0.0;
+        for (unsigned int i = 0; i < dst; i++) {
+            double pos = i * s;
+            unsigned int i0 = std::min(static_cast<unsigned int>(pos), src - 1);
+            unsigned int i1 = std::min(i0 + 1, src - 1);
+            double f = pos - i0;
+            taps.at(i).emplace_back(i0, 1.0 - f);
+            if (i1 != i0)
+                taps.at(i).emplace_back(i1, f);
+        }
+    } else {
+        // Box, each source pixel weighted by how much of it is covered
+        double s = static_cast<double>(src) / dst;
+        for (unsigned int i = 0; i < dst; i++) {
+            double begin = i * s, end = (i + 1) * s;
+            unsigned int last = std::min(static_cast<unsigned int>(std::ceil(end)), src);
+            for (unsigned int j = static_cast<unsigned int>(begin); j < last; j++) {
+                double covered = std::min<double>(j + 1, end) - std::max<double>(j, begin);
+                if (covered > 0.0)
+                    taps.at(i).emplace_back(j, covered / s);
             }
         }
     }
 
-    // Copy to our results.
-    for (unsigned int i = 0; i < height * width * components; ++i) {
-        timage[i] = static_cast<unsigned char>(tempout[i]);
+    t.count = 2;
+    for (auto& v : taps)
+        t.count = std::max<unsigned int>(t.count, v.size());
+    t.count += t.count & 1;
+
+    t.index.assign(dst * t.count, 0);
+    t.weight.assign(dst * t.count, 0);
+    for (unsigned int i = 0; i < dst; i++) {
+        auto& v = taps.at(i);
+        int sum = 0, largest = 0;
+        for (unsigned int j = 0; j < v.size(); j++) {
+            int w = static_cast<int>((v.at(j).second * weightOne) + 0.5);
+            t.index.at((i * t.count) + j) = v.at(j).first;
+            t.weight.at((i * t.count) + j) = w;
+            sum += w;
+            if (w > t.weight.at((i * t.count) + largest))
+                largest = j;
+        }
+
+        // Rounding errors go to the biggest weight, so flat areas stay flat
+        t.weight.at((i * t.count) + largest) += weightOne - sum;
+        for (unsigned int j = v.size(); j < t.count; j++)
+            t.index.at((i * t.count) + j) = t.index.at(i * t.count);
     }
+}
 
-    // Delete our temp buffers.
-    delete [] tempin;
-    delete [] tempout;
+// One source row into (dstWidth * channels) values with extraBits more precision
+template<unsigned int channels>
+static void resampleRow(const unsigned char* src, int16_t* dst, const Taps& t,
+                        unsigned int dstWidth) {
+    const uint32_t* index = &t.index[0];
+    const int16_t* weight = &t.weight[0];
+    for (unsigned int x = 0; x < dstWidth; x++, index += t.count, weight += t.count) {
+#ifdef USE_SSE2
+        if (channels == 4) {
+            // Two taps at once, the four channels in the 32bit lanes
+            __m128i zero = _mm_setzero_si128();
+            __m128i sum = _mm_setzero_si128();
+            for (unsigned int i = 0; i < t.count; i += 2) {
+                int a, b;
+                std::memcpy(&a, src + (index[i] * 4), 4);
+                std::memcpy(&b, src + (index[i + 1] * 4), 4);
+                __m128i p = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(a),
+                                              _mm_cvtsi32_si128(b)), zero);
+                __m128i w = _mm_set1_epi32((weight[i] & 0xFFFF) | (weight[i + 1] << 16));
+                sum = _mm_add_epi32(sum, _mm_madd_epi16(p, w));
+            }
+            sum = _mm_srai_epi32(_mm_add_epi32(sum,
+                                 _mm_set1_epi32(1 << (weightBits - extraBits - 1))),
+                                 weightBits - extraBits);
+            sum = _mm_packs_epi32(sum, sum);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + (x * 4)), sum);
+            continue;
+        }
+#endif
+
+        for (unsigned int c = 0; c < channels; c++) {
+            int sum = 0;
+            for (unsigned int i = 0; i < t.count; i++)
+                sum += src[(index[i] * channels) + c] * weight[i];
+            dst[(x * channels) + c] = static_cast<int16_t>(
+                (sum + (1 << (weightBits - extraBits - 1))) >> (weightBits - extraBits));
+        }
+    }
+}
+
+// Weighted sum of the rows of the horizontal pass, back to 8bit
+static void resampleColumn(const int16_t* const* rows, const int16_t* weight,
+                           unsigned int count, unsigned char* dst, unsigned int length) {
+    const int round = 1 << (weightBits + extraBits - 1);
+    unsigned int i = 0;
+
+#ifdef USE_SSE2
+    // Eight values at once, two rows at a time
+    for (; (i + 8) <= length; i += 8) {
+        __m128i lo = _mm_set1_epi32(round), hi = lo;
+        for (unsigned int r = 0; r < count; r += 2) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r + 1] + i));
+            __m128i w = _mm_set1_epi32((weight[r] & 0xFFFF) | (weight[r + 1] << 16));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        lo = _mm_srai_epi32(lo, weightBits + extraBits);
+        hi = _mm_srai_epi32(hi, weightBits + extraBits);
+        __m128i v = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(v, v));
+    }
+#endif
+
+    for (; i < length; i++) {
+        int sum = round;
+        for (unsigned int r = 0; r < count; r++)
+            sum += rows[r][i] * weight[r];
+        sum >>= weightBits + extraBits;
+        dst[i] = static_cast<unsigned char>(std::min(std::max(sum, 0), 255));
+    }
+}
 
-    return timage;
+void resampleImage(const unsigned char* image, unsigned int width, unsigned int height,
+                   unsigned char* out, unsigned int outWidth, unsigned int outHeight,
+                   unsigned int channels, ThreadPool* pool) {
+    orAssert(image != nullptr);
+    orAssert(out != nullptr);
+    orAssert((width > 0) && (height > 0));
+    orAssert((outWidth > 0) && (outHeight > 0));
+    orAssert((channels > 0) && (channels <= 4));
+
+    Taps horizontal, vertical;
+    makeTaps(horizontal, width, outWidth);
+    makeTaps(vertical, height, outHeight);
+
+    // Only source rows that are used by the vertical pass are resampled
+    std::vector<uint32_t> rowSlot(height, 0xFFFFFFFF);
+    std::vector<uint32_t> usedRows;
+    for (unsigned int i = 0; i < vertical.index.size(); i++) {
+        uint32_t r = vertical.index.at(i);
+        if (rowSlot.at(r) == 0xFFFFFFFF) {
+            rowSlot.at(r) = usedRows.size();
+            usedRows.push_back(r);
+        }
+    }
+
+    unsigned long rowLength = static_cast<unsigned long>(outWidth) * channels;
+    std::vector<int16_t> temp(usedRows.size() * rowLength);
+
+    // Rows are handed out in blocks, so small images do not drown in jobs
+    const unsigned int block = 16;
+    auto run = [pool](unsigned int rows, std::function<void(unsigned int)> f) {
+        unsigned int blocks = (rows + block - 1) / block;
+        auto job = [&f, rows](std::size_t b) {
+            for (unsigned int r = b * block; (r < ((b + 1) * block)) && (r < rows); r++)
+                f(r);
+        };
+        if ((pool != nullptr) && (blocks > 1)) {
+            pool->parallelFor(blocks, job);
+        } else {
+            for (unsigned int b = 0; b < blocks; b++)
+                job(b);
+        }
+    };
+
+    run(usedRows.size(), [&](unsigned int r) {
+        const unsigned char* src = image + (static_cast<unsigned long>(usedRows.at(r)) * width * channels);
+        int16_t* dst = &temp[r * rowLength];
+        switch (channels) {
+            case 1:
+                resampleRow<1>(src, dst, horizontal, outWidth);
+                break;
+            case 2:
+                resampleRow<2>(src, dst, horizontal, outWidth);
+                break;
+            case 3:
+                resampleRow<3>(src, dst, horizontal, outWidth);
+                break;
+            default:
+                resampleRow<4>(src, dst, horizontal, outWidth);
+                break;
+        }
+    });
+
+    run(outHeight, [&](unsigned int y) {
+        std::vector<const int16_t*> rows(vertical.count);
+        for (unsigned int i = 0; i < vertical.count; i++)
+            rows.at(i) = &temp[rowSlot.at(vertical.index.at((y * vertical.count) + i)) * rowLength];
+        resampleColumn(&rows[0], &vertical.weight[y * vertical.count], vertical.count,
+                       out + (y * rowLength), rowLength);
+    });
+}
+
+static unsigned int nextPower(unsigned int x) {
+    unsigned int i;
+    for (i = 1; i < x; i *= 2);
+    return i;
+}
+
+unsigned char* scaleBuffer(unsigned char* image, unsigned int* w, unsigned int* h,
+                           unsigned int bpp, ThreadPool* pool) {
+    orAssert(image != nullptr);
+    orAssert(*w > 0);
+    orAssert(*h > 0);
+    orAssert(((bpp % 8) == 0) && (bpp <= 32));
+
+    unsigned int width = nextPower(*w);
+    unsigned int height = nextPower(*h);
+
+    // Check to see if scaling is needed
+    if ((width == *w) && (height == *h))
+        return nullptr;
+
+    unsigned char* scaled = new unsigned char[width * height * (bpp / 8)];
+    resampleImage(image, *w, *h, scaled, width, height, bpp / 8, pool);
+    *w = width;
+    *h = height;
+    return scaled;
 }
 
@@ -0,0 +1,179 @@
+/*!
+ * \file test/FloorData.cpp
+ * \brief FloorData Decoder Unit Test
+ *
+ * \author xythobuz
+ */
+
+#include <iostream>
+
+#include "global.h"
+#include "FloorData.h"
+
+const static uint16_t testData[] = {
+    0x0000, // Dummy
+
+    // 1: Portal to room 7, floor slope, ceiling slope
+    0x0001, 0x0007,
+    0x0002, 0xFF02, // x 2, z -1
+    0x8003, 0x01FD, // x -3, z 1
+
+    // 7: Kill, climbable +Z and -X walls
+    0x0005,
+    0x8906,
+
+    // 9: Switch trigger with object and camera action
+    0x8204,
+    0x3F05, // Timer 5, once, full mask
+    0x000C, // Object 12
+    0x0403, // Camera 3
+    0x8142, // Timer 0x42, once
+
+    // 14: TR3 floor and ceiling triangulation, monkey swing
+    0x0007, 0x1234,
+    0x0009, 0x5678,
+    0x8013,
+
+    // 19: Pad trigger, last action without camera data
+    0x8104,
+    0x0000,
+    0x0000, // Object 0
+    0x8C01, // Flip map 1
+
+    // 23: Unknown function, then a slope that must not be read
+    0x001F,
+    0x8002, 0x0101,
+
+    // 26: Truncated slope
+    0x0002
+};
+
+const static unsigned long testSize = sizeof(testData) / sizeof(testData[0]);
+
+static int testEmpty(FloorData& f) {
+    if (f.sizeInfo() != 1) {
+        std::cout << "Error, no empty record!" << std::endl;
+        return 1;
+    }
+
+    const FloorData::Info& i = f.getInfo(0);
+    if ((i.portal != FloorData::noPortal) || (i.trigger != FloorData::noTrigger)
+        || (i.flags != 0) || (i.floorSlopeX != 0) || (i.ceilingSlopeZ != 0)) {
+        std::cout << "Error, empty record not empty!" << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
+
+static int testGeometry(FloorData& f) {
+    const FloorData::Info& i = f.getInfo(f.decode(testData, testSize, 1));
+    if (i.portal != 7) {
+        std::cout << "Error decoding portal!" << std::endl;
+        return 3;
+    }
+
+    if ((i.floorSlopeX != 2) || (i.floorSlopeZ != -1)
+        || (i.ceilingSlopeX != -3) || (i.ceilingSlopeZ != 1)) {
+        std::cout << "Error decoding slopes!" << std::endl;
+        return 4;
+    }
+
+    if ((i.flags != 0) || (i.trigger != FloorData::noTrigger)) {
+        std::cout << "Error, chain did not end!" << std::endl;
+        return 5;
+    }
+
+    // Heights grow downward, the slope repeats in every sector
+    if ((FloorData::floorHeight(i, 0, 0, 0) != 511) || (FloorData::floorHeight(i, 0, 1023, 1023) != 256)
+        || (FloorData::floorHeight(i, 0, 2048, 2048) != FloorData::floorHeight(i, 0, 0, 0))) {
+        std::cout << "Error interpolating floor slope!" << std::endl;
+        return 6;
+    }
+
+    const FloorData::Info& flags = f.getInfo(f.decode(testData, testSize, 7));
+    if (flags.flags != (FloorDataFlagKill | FloorDataFlagClimbPosZ | FloorDataFlagClimbNegX)) {
+        std::cout << "Error decoding kill and climb flags!" << std::endl;
+        return 7;
+    }
+
+    const FloorData::Info& split = f.getInfo(f.decode(testData, testSize, 14));
+    if ((split.floorSplit != 0x07) || (split.floorCorners != 0x1234)
+        || (split.ceilingSplit != 0x09) || (split.ceilingCorners != 0x5678)
+        || (split.flags != FloorDataFlagMonkeySwing)) {
+        std::cout << "Error decoding triangulation!" << std::endl;
+        return 8;
+    }
+
+    return 0;
+}
+
+static int testTriggers(FloorData& f) {
+    const FloorData::Info& i = f.getInfo(f.decode(testData, testSize, 9));
+    if (i.trigger != 0) {
+        std::cout << "Error, no trigger record!" << std::endl;
+        return 9;
+    }
+
+    const FloorData::Trigger& t = f.getTrigger(i.trigger);
+    if ((t.type != 2) || (t.timer != 5) || (t.oneShot != 1) || (t.mask != 0x1F)
+        || (t.firstAction != 0) || (t.numActions != 2)) {
+        std::cout << "Error decoding trigger!" << std::endl;
+        return 10;
+    }
+
+    const FloorData::Action& object = f.getAction(0);
+    const FloorData::Action& camera = f.getAction(1);
+    if ((object.type != FloorDataActionObject) || (object.parameter != 12)
+        || (camera.type != FloorDataActionCamera) || (camera.parameter != 3)
+        || (camera.timer != 0x42) || (camera.once != 1)) {
+        std::cout << "Error decoding trigger actions!" << std::endl;
+        return 11;
+    }
+
+    const FloorData::Info& pad = f.getInfo(f.decode(testData, testSize, 19));
+    const FloorData::Trigger& t2 = f.getTrigger(pad.trigger);
+    if ((pad.trigger != 1) || (t2.type != 1) || (t2.firstAction != 2) || (t2.numActions != 2)
+        || (f.getAction(3).type != FloorDataActionFlipMap) || (f.getAction(3).parameter != 1)) {
+        std::cout << "Error decoding second trigger!" << std::endl;
+        return 12;
+    }
+
+    return 0;
+}
+
+static int testInvalid(FloorData& f) {
+    const FloorData::Info& i = f.getInfo(f.decode(testData, testSize, 23));
+    if ((f.getUnknownFunctions() != 1) || (i.floorSlopeX != 0)) {
+        std::cout << "Error, decoded past an unknown function!" << std::endl;
+        return 13;
+    }
+
+    const FloorData::Info& t = f.getInfo(f.decode(testData, testSize, 26));
+    if (t.floorSlopeX != 0) {
+        std::cout << "Error, decoded past the end!" << std::endl;
+        return 14;
+    }
+
+    if (f.sizeInfo() != 8) {
+        std::cout << "Error, wrong number of records!" << std::endl;
+        return 15;
+    }
+
+    f.clear();
+    return testEmpty(f);
+}
+
+int main() {
+    FloorData f;
+    int error = testEmpty(f);
+    if (error == 0)
+        error = testGeometry(f);
+    if (error == 0)
+        error = testTriggers(f);
+    if (error == 0)
+        error = testInvalid(f);
+
+    return error;
+}
+
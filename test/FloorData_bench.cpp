@@ -0,0 +1,194 @@
+/*!
+ * \file test/FloorData_bench.cpp
+ * \brief Sector Height Query Benchmark
+ *
+ * \author xythobuz
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "Log.h"
+#include "RunTime.h"
+#include "SoundManager.h"
+#include "TextureManager.h"
+#include "World.h"
+#include "loader/Loader.h"
+#include "utils/filesystem.h"
+#include "LevelGenerator.h"
+#include "bench.h"
+
+// Every frame, all points of a room are queried with one heightsAt() call
+struct Batch {
+    unsigned long room;
+    std::vector<glm::vec3> points;
+    std::vector<SectorHeight> heights;
+};
+
+static void fillBatches(std::vector<Batch>& batches, unsigned int points) {
+    uint32_t state = 1;
+    auto random = [&state](int max) {
+        state = (state * 1103515245) + 12345;
+        return static_cast<int>((state >> 16) % max);
+    };
+
+    for (unsigned long r = 0; r < World::sizeRoom(); r++) {
+        Room& room = World::getRoom(r);
+        if (room.sizeSectors() == 0)
+            continue;
+
+        glm::vec3 min = room.getBoundingBox().getCorner(0);
+        batches.emplace_back();
+        Batch& b = batches.back();
+        b.room = r;
+        for (unsigned int p = 0; p < points; p++) {
+            // Some points are outside, beyond the wall portals
+            int x = random((room.getNumXSectors() + 1) * 1024) - 512;
+            int z = random((room.getNumZSectors() + 1) * 1024) - 512;
+            b.points.emplace_back(min.x + x, -random(4096), min.z + z);
+        }
+        b.heights.resize(points);
+    }
+}
+
+static void report(const char* what, double ms, unsigned long queries, unsigned int frames,
+                   long long sum) {
+    std::cout << what << ": " << (ms / frames) << "ms per frame, "
+              << ((ms * 1000000.0) / queries) << "ns per query (" << sum << ")" << std::endl;
+}
+
+static int bench(unsigned int points, unsigned int frames) {
+    std::vector<Batch> batches;
+    fillBatches(batches, points);
+    if (batches.empty()) {
+        std::cout << "No rooms with sectors!" << std::endl;
+        return 1;
+    }
+
+    FloorData& f = World::getFloorData();
+    std::cout << batches.size() << " rooms, " << points << " points each, " << frames
+              << " frames" << std::endl;
+    std::cout << "FloorData: " << f.sizeInfo() << " records, " << f.sizeTrigger() << " triggers, "
+              << f.sizeAction() << " actions, " << f.getMemorySize() << " bytes" << std::endl;
+
+    unsigned long queries = batches.size() * points * frames;
+
+    // Plain floor height of the sector, no portals, slopes or triggers
+    auto start = std::chrono::steady_clock::now();
+    long long sum = 0;
+    for (unsigned int i = 0; i < frames; i++) {
+        for (auto& b : batches) {
+            Room& room = World::getRoom(b.room);
+            for (auto& p : b.points) {
+                float y = 0.0f;
+                room.getHeightAtPosition(p.x, &y, p.z);
+                sum += static_cast<long long>(y);
+            }
+        }
+    }
+    report("getHeightAtPosition", elapsed(start), queries, frames, sum);
+
+    // Everything under the point, following portals and applying slopes
+    start = std::chrono::steady_clock::now();
+    sum = 0;
+    for (unsigned int i = 0; i < frames; i++) {
+        for (auto& b : batches) {
+            World::getRoom(b.room).heightsAt(&b.points[0], &b.heights[0], b.points.size());
+            for (auto& h : b.heights) {
+                const FloorData::Info& info = f.getInfo(h.info);
+                sum += static_cast<long long>(h.floor) + h.room
+                       + ((info.trigger != FloorData::noTrigger) ? 1 : 0);
+            }
+        }
+    }
+    report("heightsAt", elapsed(start), queries, frames, sum);
+
+    return 0;
+}
+
+static void usage() {
+    std::cout << "Usage: bench_floordata [options]" << std::endl
+              << "  --rooms N        Number of rooms" << std::endl
+              << "  --points N       Queries per room and frame" << std::endl
+              << "  --frames N       Number of frames" << std::endl
+              << "  --level FILE     Benchmark an existing level instead" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    LevelConfig config;
+    std::string level;
+    unsigned int points = 64;
+    unsigned int frames = 1000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((i + 1) >= argc) {
+            usage();
+            return 1;
+        }
+
+        std::string value = argv[++i];
+        unsigned int n = std::strtoul(value.c_str(), nullptr, 10);
+        if (arg == "--rooms") {
+            config.rooms = n;
+        } else if (arg == "--points") {
+            points = (n > 0) ? n : 1;
+        } else if (arg == "--frames") {
+            frames = (n > 0) ? n : 1;
+        } else if (arg == "--level") {
+            level = value;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    Log::initialize();
+    RunTime::setHeadless(true);
+
+    char tmpDir[] = "/tmp/openraider_floordata_0";
+    FILE* f;
+    while ((f = fopen(tmpDir, "r")) != NULL) {
+        fclose(f);
+        tmpDir[26]++;
+    }
+    std::string dir = tmpDir;
+
+    std::string file = level;
+    if (level.length() == 0) {
+        file = dir + "/BENCH.TR2";
+        if ((createDirectory(dir) != 0) || (generateLevel(config, file) != 0)) {
+            std::cout << "Error generating \"" << file << "\"!" << std::endl;
+            return 1;
+        }
+    }
+
+    int error = -1;
+    auto loader = Loader::createLoader(file);
+    if (loader)
+        error = loader->load(file);
+    loader.reset();
+
+    if (level.length() == 0) {
+        remove(file.c_str());
+        remove((dir + "/MAIN.SFX").c_str());
+        remove(dir.c_str());
+    }
+
+    if (error != 0) {
+        std::cout << "Error " << error << " loading \"" << file << "\"!" << std::endl;
+        return 1;
+    }
+
+    error = bench(points, frames);
+    World::destroy();
+    TextureManager::clear();
+    SoundManager::clear();
+    return error;
+}
+
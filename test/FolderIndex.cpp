@@ -0,0 +1,172 @@
+/*!
+ * \file test/FolderIndex.cpp
+ * \brief Recursive File Search Unit Test
+ *
+ * \author xythobuz
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "Log.h"
+#include "utils/filesystem.h"
+#include "utils/Folder.h"
+#include "utils/FolderIndex.h"
+#include "utils/ThreadPool.h"
+
+// Folders end with '/', "a-b/" sorts before "a/" like in Folder
+const static char* testTree[] = {
+    "TOMBPC.DAT",
+    "readme.txt",
+    ".hidden.pcx",
+    "a/",
+    "a/title.PCX",
+    "a/tombpc.dat",
+    "a/data/",
+    "a/data/level1.phd",
+    "a/data/level2.PHD",
+    "a/data/load.pcx",
+    "a/pix/",
+    "a/pix/shot.png",
+    "a-b/",
+    "a-b/other.tga",
+    "a-b/x.pcx.txt",
+    ".git/",
+    ".git/config.pcx",
+    "b/",
+    "b/c/",
+    "b/c/d/",
+    "b/c/d/deep.jpg",
+    "b/c/d/deep.pcx",
+};
+
+static void createTree(std::string root) {
+    createDirectory(root);
+    for (auto t : testTree) {
+        std::string p = root + t;
+        if (p.back() == '/') {
+            createDirectory(p);
+        } else {
+            FILE* f = std::fopen(p.c_str(), "w");
+            if (f != nullptr)
+                std::fclose(f);
+        }
+    }
+}
+
+static void removeTree(std::string root) {
+    for (int i = (sizeof(testTree) / sizeof(testTree[0])) - 1; i >= 0; i--)
+        std::remove((root + testTree[i]).c_str());
+    std::remove((root + "new.pcx").c_str());
+    std::remove(root.c_str());
+}
+
+static bool samePaths(std::vector<File>& a, std::vector<File>& b) {
+    if (a.size() != b.size())
+        return false;
+    for (unsigned long i = 0; i < a.size(); i++) {
+        if (a.at(i).getPath() != b.at(i).getPath())
+            return false;
+    }
+    return true;
+}
+
+static int test(std::string root, ThreadPool* pool) {
+    FolderIndex index(root);
+    if (index.scan(pool) != 0) {
+        std::cout << "Error scanning " << root << "!" << std::endl;
+        return 1;
+    }
+
+    if ((index.folderCount() != 8) || (index.fileCount() != 12)) {
+        std::cout << "Error, found " << index.folderCount() << " folders and "
+                  << index.fileCount() << " files!" << std::endl;
+        return 2;
+    }
+
+    // Same results, in the same order, as walking with Folder
+    const char* suffixes[] = { ".pcx", ".phd", "tombpc.dat", ".txt", ".PNG" };
+    for (auto s : suffixes) {
+        std::vector<File> a, b;
+        Folder(root).findRecursiveFilesEndingWith(a, s);
+        index.find(b, { s });
+        if ((a.size() == 0) || !samePaths(a, b)) {
+            std::cout << "Error, different results for \"" << s << "\"!" << std::endl;
+            return 3;
+        }
+    }
+
+    // Many suffixes at once, in tree order
+    std::vector<File> images;
+    index.find(images, { ".pcx", ".bmp", ".png", ".tga", ".jpg" });
+    std::vector<std::string> expected = {
+        "a-b/other.tga", "a/title.PCX", "a/data/load.pcx",
+        "a/pix/shot.png", "b/c/d/deep.jpg", "b/c/d/deep.pcx"
+    };
+    if (images.size() != expected.size()) {
+        std::cout << "Error, found " << images.size() << " images!" << std::endl;
+        return 4;
+    }
+    for (unsigned long i = 0; i < expected.size(); i++) {
+        if (images.at(i).getPath() != (root + expected.at(i))) {
+            std::cout << "Error, expected " << expected.at(i) << " but got "
+                      << images.at(i).getPath() << "!" << std::endl;
+            return 5;
+        }
+    }
+
+    // Only one subtree, with or without trailing slash
+    std::vector<File> below, below2;
+    index.find(below, { ".pcx", ".png" }, root + "a");
+    index.find(below2, { ".pcx", ".png" }, root + "a/");
+    if ((below.size() != 3) || !samePaths(below, below2)) {
+        std::cout << "Error, found " << below.size() << " images below a!" << std::endl;
+        return 6;
+    }
+
+    std::vector<File> none;
+    index.find(none, { ".pcx" }, root + "missing");
+    index.find(none, { ".pcx" }, root + "a/data/level1.phd");
+    index.find(none, { ".phd" }, root, true);
+    if (none.size() != 1) {
+        std::cout << "Error, found " << none.size() << " files that do not exist!" << std::endl;
+        return 7;
+    }
+
+    // New files only show up after invalidating
+    FILE* f = std::fopen((root + "new.pcx").c_str(), "w");
+    if (f != nullptr)
+        std::fclose(f);
+    std::vector<File> before, after;
+    index.find(before, { ".pcx" });
+    index.invalidate();
+    index.find(after, { ".pcx" });
+    std::remove((root + "new.pcx").c_str());
+    if ((before.size() + 1) != after.size()) {
+        std::cout << "Error, index was not invalidated!" << std::endl;
+        return 8;
+    }
+
+    return 0;
+}
+
+int main() {
+    Log::initialize();
+
+    std::string root = getCurrentWorkingDirectory() + "/folderindex_test/";
+    removeTree(root);
+    createTree(root);
+
+    int error = test(root, nullptr);
+    if (error == 0) {
+        ThreadPool pool(4);
+        error = test(root, &pool);
+    }
+
+    removeTree(root);
+    return error;
+}
+
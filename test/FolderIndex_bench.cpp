@@ -0,0 +1,167 @@
+/*!
+ * \file test/FolderIndex_bench.cpp
+ * \brief Recursive File Search Benchmark
+ *
+ * \author xythobuz
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "Log.h"
+#include "utils/filesystem.h"
+#include "utils/Folder.h"
+#include "utils/FolderIndex.h"
+#include "utils/ThreadPool.h"
+#include "bench.h"
+
+const static char* fileSuffixes[] = {
+    ".pcx", ".tr2", ".phd", ".TGA", ".wav", ".txt", ".png", ".dat"
+};
+
+const static std::vector<std::string> imageSuffixes = {
+    ".pcx", ".bmp", ".png", ".tga", ".jpg"
+};
+
+/*
+ * Tree of folders with eight subfolders each, filled breadth-first, with
+ * perFolder files in every folder. Returns all created paths, parents first.
+ */
+static std::vector<std::string> generateTree(std::string root, unsigned int files,
+        unsigned int perFolder) {
+    std::vector<std::string> created;
+    std::vector<std::string> folders = { root };
+    createDirectory(root);
+    created.push_back(root);
+
+    unsigned int count = 0;
+    for (unsigned long i = 0; count < files; i++) {
+        std::string folder = folders.at(i);
+        for (unsigned int f = 0; (f < perFolder) && (count < files); f++, count++) {
+            std::string file = folder + "file" + std::to_string(count)
+                               + fileSuffixes[count % (sizeof(fileSuffixes) / sizeof(fileSuffixes[0]))];
+            FILE* fp = std::fopen(file.c_str(), "w");
+            if (fp != nullptr)
+                std::fclose(fp);
+            created.push_back(file);
+        }
+
+        for (unsigned int s = 0; (s < 8) && ((folders.size() * perFolder) < files); s++) {
+            std::string sub = folder + "dir" + std::to_string(s) + "/";
+            createDirectory(sub);
+            folders.push_back(sub);
+            created.push_back(sub);
+        }
+    }
+
+    return created;
+}
+
+static void usage() {
+    std::cout << "Usage: bench_folderindex [options]" << std::endl
+              << "  --files N        Number of files to generate" << std::endl
+              << "  --per-folder N   Files in each folder" << std::endl
+              << "  --threads N      Worker threads, 0 for one per core" << std::endl
+              << "  --old N          Also time Folder, 0 to skip, only up to 20000 files by default" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int files = 100000;
+    unsigned int perFolder = 40;
+    unsigned int threads = 0;
+    unsigned int old = 2; // Folder needs minutes for the default tree
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((i + 1) >= argc) {
+            usage();
+            return 1;
+        }
+
+        unsigned int n = std::strtoul(argv[++i], nullptr, 10);
+        if (arg == "--files") {
+            files = n;
+        } else if (arg == "--per-folder") {
+            perFolder = (n > 0) ? n : 1;
+        } else if (arg == "--threads") {
+            threads = n;
+        } else if (arg == "--old") {
+            old = (n != 0) ? 1 : 0;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    Log::initialize();
+
+    std::string root = getCurrentWorkingDirectory() + "/folderindex_bench/";
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> created = generateTree(root, files, perFolder);
+    std::cout << files << " files in " << (created.size() - files) << " folders, generated in "
+              << elapsed(start) << "ms" << std::endl;
+
+    int error = 0;
+    std::vector<File> found;
+
+    // Once to fill the kernel caches, so all runs below start from the same state
+    FolderIndex warm(root);
+    warm.scan();
+
+    unsigned long expected = 0;
+    {
+        FolderIndex index(root);
+        start = std::chrono::steady_clock::now();
+        index.find(found, imageSuffixes);
+        std::cout << "FolderIndex, one thread: " << elapsed(start) << "ms, "
+                  << found.size() << " images" << std::endl;
+        expected = found.size();
+
+        ThreadPool pool(threads);
+        index.invalidate();
+        found.clear();
+        start = std::chrono::steady_clock::now();
+        index.scan(&pool);
+        index.find(found, imageSuffixes);
+        std::cout << "FolderIndex, " << (pool.size() + 1) << " threads: " << elapsed(start)
+                  << "ms, " << found.size() << " images" << std::endl;
+        if (found.size() != expected)
+            error = 1;
+
+        const unsigned int queries = 10;
+        start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < queries; i++) {
+            found.clear();
+            index.find(found, imageSuffixes);
+        }
+        std::cout << "FolderIndex, cached: " << (elapsed(start) / queries) << "ms per query"
+                  << std::endl;
+        if (found.size() != expected)
+            error = 2;
+    }
+
+    if ((old == 1) || ((old == 2) && (files <= 20000))) {
+        found.clear();
+        start = std::chrono::steady_clock::now();
+        Folder f(root);
+        for (auto& s : imageSuffixes)
+            f.findRecursiveFilesEndingWith(found, s);
+        std::cout << "Folder, one walk per suffix: " << elapsed(start) << "ms, "
+                  << found.size() << " images" << std::endl;
+        if (found.size() != expected)
+            error = 3;
+    }
+
+    for (auto it = created.rbegin(); it != created.rend(); ++it)
+        std::remove(it->c_str());
+
+    if (error != 0)
+        std::cout << "Error, results differ!" << std::endl;
+    return error;
+}
+
@@ -0,0 +1,610 @@
+/*!
+ * \file test/LevelGenerator.cpp
+ * \brief Synthetic level file generator
+ *
+ * \author xythobuz
+ */
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include "LevelGenerator.h"
+
+// Level files are little-endian, independent of the host
+class LevelWriter {
+  public:
+    void u8(uint8_t v) { data.push_back(static_cast<char>(v)); }
+    void u16(uint16_t v) { u8(v & 0xFF); u8(v >> 8); }
+    void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+    void i16(int16_t v) { u16(static_cast<uint16_t>(v)); }
+    void i32(int32_t v) { u32(static_cast<uint32_t>(v)); }
+    void tag(const char* t) { while (*t != '\0') u8(*t++); }
+    void zero(std::size_t n) { data.insert(data.end(), n, 0); }
+    void append(const LevelWriter& w) { data.insert(data.end(), w.data.begin(), w.data.end()); }
+    std::size_t size() { return data.size(); }
+
+    int write(std::string file) {
+        std::ofstream out(file, std::ios_base::out | std::ios_base::binary);
+        out.write(data.data(), data.size());
+        return out ? 0 : 1;
+    }
+
+  private:
+    std::vector<char> data;
+};
+
+const static unsigned int sectorsPerSide = 8;
+const static unsigned int meshVertices = 24;
+const static unsigned int keyframesPerAnimation = 4;
+const static unsigned int meshesPerMoveable = 4;
+const static unsigned int spriteTextures = 8;
+const static unsigned int sampleLength = 4096;
+
+// FloorData chains shared by all rooms, followed by one wall portal per room
+const static uint16_t floorDataSlope = 1;
+const static uint16_t floorDataKill = 3;
+const static uint16_t floorDataTrigger = 4;
+const static uint16_t floorDataPortals = 9;
+
+static uint16_t sectorFloorData(unsigned int r, unsigned int s) {
+    unsigned int x = s / sectorsPerSide, z = s % sectorsPerSide;
+    if ((x == (sectorsPerSide - 1)) && (z == 1))
+        return floorDataPortals + (r * 2); // Where the room portal is
+    switch (s % 8) {
+        case 1:
+            return floorDataSlope;
+        case 2:
+            return floorDataTrigger;
+        case 5:
+            return floorDataKill;
+        default:
+            return 0;
+    }
+}
+
+static void writeFloorData(LevelWriter& w, const LevelConfig& c) {
+    if (!c.floorData) {
+        w.u32(0);
+        return;
+    }
+
+    w.u32(floorDataPortals + (c.rooms * 2));
+    w.u16(0); // Dummy
+    w.u16(0x8002); // Floor slope
+    w.u16(0xFF02); // x 2, z -1
+    w.u16(0x8005); // Kill
+    w.u16(0x8104); // Pad trigger
+    w.u16(0x3E00); // Full activation mask
+    w.u16(0x0005); // Object 5
+    w.u16(0x0402); // Camera 2
+    w.u16(0x8103); // 3 seconds, once
+    for (unsigned int r = 0; r < c.rooms; r++) {
+        w.u16(0x8001); // Portal
+        w.u16((r + 1) % c.rooms);
+    }
+}
+
+// Simple LCG, so every generated level is the same
+static uint32_t randomState = 1;
+static int16_t randomValue(int16_t max) {
+    randomState = (randomState * 1103515245) + 12345;
+    return static_cast<int16_t>((randomState >> 16) % max);
+}
+
+static void writeSample(LevelWriter& w, unsigned int i) {
+    w.tag("RIFF");
+    w.u32(36 + sampleLength);
+    w.tag("WAVE");
+    w.tag("fmt ");
+    w.u32(16);
+    w.u16(1); // PCM
+    w.u16(1); // Mono
+    w.u32(11025);
+    w.u32(11025 * 2);
+    w.u16(2);
+    w.u16(16);
+    w.tag("data");
+    w.u32(sampleLength);
+    for (unsigned int s = 0; s < (sampleLength / 2); s++)
+        w.i16(static_cast<int16_t>((s * (i + 1) * 64) & 0x7FFF) - 0x4000);
+}
+
+static void writeRoom(LevelWriter& w, const LevelConfig& c, unsigned int r,
+                      unsigned int textiles) {
+    // Room header, rooms are placed in a grid
+    w.i32((r % 64) * sectorsPerSide * 1024);
+    w.i32((r / 64) * sectorsPerSide * 1024);
+    w.i32(0);
+    w.i32(-4096);
+
+    // Vertices, faces and sprites
+    LevelWriter data;
+    unsigned int numVertices = (c.vertices < 4) ? 4 : c.vertices;
+    data.u16(numVertices);
+    for (unsigned int v = 0; v < numVertices; v++) {
+        data.i16(randomValue(sectorsPerSide * 1024));
+        data.i16(-randomValue(4096));
+        data.i16(randomValue(sectorsPerSide * 1024));
+        data.i16(0x1000); // Light
+        if (c.version > 1) {
+            data.u16(0); // Attributes
+            data.i16(0x1000); // Light2
+        }
+    }
+
+    unsigned int numRectangles = numVertices / 2;
+    data.u16(numRectangles);
+    for (unsigned int f = 0; f < numRectangles; f++) {
+        for (unsigned int i = 0; i < 4; i++)
+            data.u16((f + i) % numVertices);
+        data.u16(f % textiles);
+    }
+
+    unsigned int numTriangles = numVertices / 4;
+    data.u16(numTriangles);
+    for (unsigned int f = 0; f < numTriangles; f++) {
+        for (unsigned int i = 0; i < 3; i++)
+            data.u16((f * 3 + i) % numVertices);
+        data.u16(f % textiles);
+    }
+
+    data.u16(2); // Sprites
+    for (unsigned int s = 0; s < 2; s++) {
+        data.u16(s);
+        data.u16(s % spriteTextures);
+    }
+
+    w.u32(data.size() / 2);
+    w.append(data);
+
+    // Portal to the next room
+    w.u16((c.rooms > 1) ? 1 : 0);
+    if (c.rooms > 1) {
+        w.u16((r + 1) % c.rooms);
+        w.i16(-1);
+        w.i16(0);
+        w.i16(0);
+        for (unsigned int v = 0; v < 4; v++) {
+            w.i16(sectorsPerSide * 1024);
+            w.i16((v < 2) ? 0 : -1024);
+            w.i16(((v == 0) || (v == 3)) ? 1024 : 2048);
+        }
+    }
+
+    w.u16(sectorsPerSide);
+    w.u16(sectorsPerSide);
+    for (unsigned int s = 0; s < (sectorsPerSide * sectorsPerSide); s++) {
+        w.u16(sectorFloorData(r, s));
+        w.u16(r * 4 + (s % 4)); // Box
+        w.u16(0xFF); // No room below, floor at 0
+        w.u16(0xFF | (0xF0 << 8)); // No room above, ceiling at -16
+    }
+
+    // Lights
+    w.i16(0x1000);
+    if (c.version > 1)
+        w.i16(0x1000);
+    if (c.version == 2)
+        w.i16(0); // Light mode
+    w.u16(1);
+    w.i32(1024);
+    w.i32(-1024);
+    w.i32(1024);
+    w.u16(0x1000);
+    if (c.version > 1)
+        w.u16(0x1000);
+    w.u32(4096);
+    if (c.version > 1)
+        w.u32(4096);
+
+    // Static meshes
+    w.u16(2);
+    for (unsigned int s = 0; s < 2; s++) {
+        w.i32(512 + (s * 1024));
+        w.i32(0);
+        w.i32(512);
+        w.u16(s << 14);
+        w.u16(0xFFFF);
+        if (c.version > 1)
+            w.u16(0xFFFF);
+        w.u16(s);
+    }
+
+    w.i16(-1); // Alternate room
+    w.u16(0); // Flags
+    if (c.version == 3)
+        w.zero(3); // Water scheme, reverb, filler
+}
+
+static void writeMesh(LevelWriter& data, unsigned int m, unsigned int textiles) {
+    data.i16(0);
+    data.i16(-256);
+    data.i16(0);
+    data.i32(512);
+
+    data.u16(meshVertices);
+    for (unsigned int v = 0; v < meshVertices; v++) {
+        data.i16(randomValue(512) - 256);
+        data.i16(randomValue(512) - 512);
+        data.i16(randomValue(512) - 256);
+    }
+
+    // Alternate between normals and internal lighting
+    if (m % 2) {
+        data.i16(meshVertices);
+        for (unsigned int v = 0; v < meshVertices; v++) {
+            data.i16(0);
+            data.i16(-16384);
+            data.i16(0);
+        }
+    } else {
+        data.i16(-static_cast<int16_t>(meshVertices));
+        for (unsigned int v = 0; v < meshVertices; v++)
+            data.i16(0x1000);
+    }
+
+    for (unsigned int type = 0; type < 4; type++) {
+        bool rectangles = ((type % 2) == 0);
+        unsigned int count = (type < 2) ? (meshVertices / 2) : 2;
+        data.i16(count);
+        for (unsigned int f = 0; f < count; f++) {
+            for (unsigned int i = 0; i < (rectangles ? 4u : 3u); i++)
+                data.u16((f + i) % meshVertices);
+            data.u16((type < 2) ? (f % textiles) : (f & 0xFF));
+        }
+    }
+}
+
+static void writeMeshes(LevelWriter& w, const LevelConfig& c, unsigned int textiles) {
+    // Like in retail levels, some pointers share an offset and
+    // some meshes are stored twice with identical data
+    LevelWriter data;
+    std::vector<uint32_t> pointers;
+    LevelWriter previous;
+    for (unsigned int m = 0; m < c.meshes; m++) {
+        if ((m % 4) == 3) {
+            pointers.push_back(pointers.back());
+        } else if ((m % 8) == 6) {
+            pointers.push_back(data.size());
+            data.append(previous);
+        } else {
+            pointers.push_back(data.size());
+            previous = LevelWriter();
+            writeMesh(previous, m, textiles);
+            data.append(previous);
+        }
+    }
+
+    w.u32(data.size() / 2);
+    w.append(data);
+    w.u32(pointers.size());
+    for (auto p : pointers)
+        w.u32(p);
+}
+
+static void writeMoveables(LevelWriter& w, const LevelConfig& c) {
+    unsigned int numMeshes = (c.meshes < meshesPerMoveable) ? c.meshes : meshesPerMoveable;
+    unsigned int numFrames = (c.animations > 0) ? c.animations : 1;
+    unsigned int frameSize = 9 + ((c.version == 1) ? 1 : 0) + (numMeshes * 2);
+
+    // Keyframes of every animation, with a three-axis angle for every mesh
+    LevelWriter frames;
+    std::vector<uint32_t> frameOffsets;
+    for (unsigned int f = 0; f < numFrames; f++) {
+        frameOffsets.push_back(frames.size());
+        for (unsigned int k = 0; k < keyframesPerAnimation; k++) {
+            for (unsigned int i = 0; i < 9; i++)
+                frames.i16(randomValue(256) - 128); // Bounding box, offset
+            if (c.version == 1)
+                frames.u16(numMeshes);
+            for (unsigned int m = 0; m < numMeshes; m++) {
+                frames.u16(randomValue(0x3FFF) & 0x3FFF);
+                frames.u16(randomValue(0x3FFF));
+            }
+        }
+    }
+
+    w.u32(c.animations);
+    for (unsigned int a = 0; a < c.animations; a++) {
+        w.u32(frameOffsets.at(a));
+        w.u8(1); // Frame rate
+        w.u8(frameSize);
+        w.u16(a % 16); // State
+        w.zero(8); // Speed, acceleration
+        w.u16(0); // First frame
+        w.u16(keyframesPerAnimation - 1); // Last frame
+        w.u16(a); // Next animation
+        w.u16(0); // Next frame
+        w.u16(1); // State changes
+        w.u16(a);
+        w.u16(2); // Commands
+        w.u16(a * 2);
+    }
+
+    w.u32(c.animations); // State changes
+    for (unsigned int a = 0; a < c.animations; a++) {
+        w.u16(a % 16);
+        w.u16(1);
+        w.u16(a);
+    }
+
+    w.u32(c.animations); // Dispatches
+    for (unsigned int a = 0; a < c.animations; a++) {
+        w.i16(a);
+        w.i16(a + 1);
+        w.i16(a);
+        w.i16(a);
+    }
+
+    w.u32(c.animations * 2); // Commands
+    for (unsigned int a = 0; a < (c.animations * 2); a++)
+        w.i16(0);
+
+    // Every moveable shares the same mesh tree
+    unsigned int numMeshTrees = (numMeshes > 1) ? ((numMeshes - 1) * 4) : 0;
+    w.u32(numMeshTrees);
+    for (unsigned int m = 0; m < numMeshTrees; m++)
+        w.i32(((m % 4) == 0) ? 0 : 128);
+
+    w.u32(frames.size() / 2);
+    w.append(frames);
+
+    unsigned int numMoveables = (numMeshes > 0) ? ((numFrames + 3) / 4) : 0;
+    w.u32(numMoveables);
+    for (unsigned int m = 0; m < numMoveables; m++) {
+        w.u32(m); // Object ID, 0 is Lara
+        w.u16(numMeshes);
+        w.u16((m * numMeshes) % (c.meshes - numMeshes + 1));
+        w.u32(0); // Mesh tree
+        w.u32(frameOffsets.at(m * 4));
+        w.u16((c.animations > 0) ? (m * 4) : 0xFFFF);
+    }
+}
+
+static void writeStaticMeshes(LevelWriter& w, const LevelConfig& c) {
+    unsigned int numStaticMeshes = (c.meshes < 16) ? c.meshes : 16;
+    w.u32(numStaticMeshes);
+    for (unsigned int s = 0; s < numStaticMeshes; s++) {
+        w.u32(s);
+        w.u16(s);
+        for (unsigned int b = 0; b < 2; b++) {
+            w.i16(-256);
+            w.i16(-512);
+            w.i16(-256);
+            w.i16(256);
+            w.i16(0);
+            w.i16(256);
+        }
+        w.u16(2);
+    }
+}
+
+static void writeTextiles(LevelWriter& w, const LevelConfig& c, unsigned int textiles) {
+    w.u32(textiles);
+    for (unsigned int t = 0; t < textiles; t++) {
+        w.u16(t % 2); // Attribute
+        w.u16((c.textures > 0) ? (t % c.textures) : 0);
+        for (unsigned int v = 0; v < 4; v++) {
+            bool right = ((v == 1) || (v == 2));
+            bool bottom = (v >= 2);
+            w.u8(right ? 255 : 1);
+            w.u8(((t % 4) * 64) + (right ? 63 : 0));
+            w.u8(bottom ? 255 : 1);
+            w.u8((((t / 4) % 4) * 64) + (bottom ? 63 : 0));
+        }
+    }
+}
+
+static void writeSprites(LevelWriter& w) {
+    w.u32(spriteTextures);
+    for (unsigned int s = 0; s < spriteTextures; s++) {
+        w.u16(0);
+        w.u8(s * 32);
+        w.u8(0);
+        w.u16((31 * 256) + 255);
+        w.u16((31 * 256) + 255);
+        w.i16(-128);
+        w.i16(-256);
+        w.i16(128);
+        w.i16(0);
+    }
+
+    w.u32(1);
+    w.i32(200);
+    w.i16(-static_cast<int16_t>(spriteTextures));
+    w.i16(0);
+}
+
+static void writeBoxesOverlapsZones(LevelWriter& w, const LevelConfig& c) {
+    unsigned int numBoxes = c.rooms * 4;
+    w.u32(numBoxes);
+    for (unsigned int b = 0; b < numBoxes; b++) {
+        unsigned int x = (b % 2) * 4, z = ((b / 2) % 2) * 4;
+        if (c.version == 1) {
+            w.i32(z * 1024);
+            w.i32((z + 4) * 1024);
+            w.i32(x * 1024);
+            w.i32((x + 4) * 1024);
+        } else {
+            w.u8(z);
+            w.u8(z + 4);
+            w.u8(x);
+            w.u8(x + 4);
+        }
+        w.i16(0);
+        w.u16(b);
+    }
+
+    // Every box overlaps the next one
+    w.u32(numBoxes);
+    for (unsigned int b = 0; b < numBoxes; b++)
+        w.u16(0x8000 | ((b + 1) % numBoxes));
+
+    // One array per zone table, all boxes are connected
+    unsigned int zones = (c.version == 1) ? 6 : 10;
+    for (unsigned int z = 0; z < zones; z++)
+        for (unsigned int b = 0; b < numBoxes; b++)
+            w.i16(0);
+}
+
+static void writeItems(LevelWriter& w, const LevelConfig& c) {
+    unsigned int numItems = c.rooms * 2;
+    w.u32(numItems);
+    for (unsigned int i = 0; i < numItems; i++) {
+        unsigned int room = i / 2;
+        w.i16((i == 0) ? 0 : (100 + (i % 50)));
+        w.i16(room);
+        w.i32(((room % 64) * sectorsPerSide * 1024) + 2048);
+        w.i32(0);
+        w.i32(((room / 64) * sectorsPerSide * 1024) + 2048);
+        w.u16((i % 4) << 14);
+        w.i16(-1);
+        if (c.version > 1)
+            w.i16(-1);
+        w.u16(0x0100);
+    }
+}
+
+int generateLevel(const LevelConfig& c, std::string file) {
+    if ((c.version < 1) || (c.version > 3) || (c.rooms == 0))
+        return 1;
+
+    randomState = 1;
+    unsigned int textiles = (c.textures > 0) ? (c.textures * 16) : 1;
+
+    LevelWriter w;
+    if (c.version == 1)
+        w.u32(0x20);
+    else if (c.version == 2)
+        w.u32(0x2D);
+    else
+        w.u32(0xFF080038);
+
+    if (c.version > 1) {
+        w.zero(768); // 8bit palette
+        for (unsigned int i = 0; i < 256; i++) {
+            w.u8(i);
+            w.u8(255 - i);
+            w.u8(i / 2);
+            w.u8(0);
+        }
+    }
+
+    w.u32(c.textures);
+    for (unsigned int t = 0; t < c.textures; t++)
+        for (unsigned int p = 0; p < (256 * 256); p++)
+            w.u8((p + t) & 0xFF);
+    if (c.version > 1) {
+        for (unsigned int t = 0; t < c.textures; t++)
+            for (unsigned int p = 0; p < (256 * 256); p++)
+                w.u16(0x8000 | ((p + t) & 0x7FFF));
+    }
+
+    w.u32(0); // Unused
+
+    w.u16(c.rooms);
+    for (unsigned int r = 0; r < c.rooms; r++)
+        writeRoom(w, c, r, textiles);
+
+    writeFloorData(w, c);
+
+    writeMeshes(w, c, textiles);
+    writeMoveables(w, c);
+    writeStaticMeshes(w, c);
+
+    if (c.version < 3) {
+        writeTextiles(w, c, textiles);
+        writeSprites(w);
+    } else {
+        writeSprites(w);
+    }
+
+    w.u32(c.rooms / 4); // Cameras
+    for (unsigned int i = 0; i < (c.rooms / 4); i++) {
+        w.i32(1024);
+        w.i32(-1024);
+        w.i32(1024);
+        w.i16(i * 4);
+        w.u16(0);
+    }
+
+    w.u32(c.rooms / 2); // Sound sources
+    for (unsigned int i = 0; i < (c.rooms / 2); i++) {
+        w.i32(1024);
+        w.i32(-512);
+        w.i32(1024);
+        w.u16((c.samples > 0) ? (i % c.samples) : 0);
+        w.u16(0x40);
+    }
+
+    writeBoxesOverlapsZones(w, c);
+
+    // One animated texture range over the first two textiles
+    bool animated = (textiles >= 2);
+    w.u32(animated ? 4 : 1);
+    w.u16(animated ? 1 : 0);
+    if (animated) {
+        w.u16(1);
+        w.u16(0);
+        w.u16(1);
+    }
+
+    if (c.version == 3)
+        writeTextiles(w, c, textiles);
+
+    writeItems(w, c);
+
+    w.zero(8192); // Light map
+
+    if (c.version == 1) {
+        for (unsigned int i = 0; i < 256; i++) {
+            w.u8(i / 4);
+            w.u8(63 - (i / 4));
+            w.u8(i / 8);
+        }
+    }
+
+    w.u16(0); // Cinematic frames
+    w.u16(0); // Demo data
+
+    for (unsigned int i = 0; i < ((c.version == 1) ? 256u : 370u); i++)
+        w.i16((i < c.samples) ? i : -1);
+
+    w.u32(c.samples); // Sound details
+    for (unsigned int i = 0; i < c.samples; i++) {
+        w.u16(i);
+        w.u16(0x7FFF);
+        w.u16(0);
+        w.u16(1 << 2);
+    }
+
+    LevelWriter sfx;
+    std::vector<uint32_t> offsets;
+    for (unsigned int i = 0; i < c.samples; i++) {
+        offsets.push_back(sfx.size());
+        writeSample(sfx, i);
+    }
+
+    if (c.version == 1) {
+        // Samples are embedded in TR1 levels
+        w.u32(sfx.size());
+        w.append(sfx);
+        w.u32(offsets.size());
+        for (auto o : offsets)
+            w.u32(o);
+    } else {
+        w.u32(c.samples);
+        for (unsigned int i = 0; i < c.samples; i++)
+            w.u32(i);
+
+        std::string dir = file;
+        std::size_t pos = dir.find_last_of("/\\");
+        dir = (pos != std::string::npos) ? dir.substr(0, pos + 1) : "";
+        if (sfx.write(dir + "MAIN.SFX") != 0)
+            return 2;
+    }
+
+    return w.write(file);
+}
+
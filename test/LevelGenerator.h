@@ -0,0 +1,42 @@
+/*!
+ * \file test/LevelGenerator.h
+ * \brief Synthetic level file generator
+ *
+ * \author xythobuz
+ */
+
+#ifndef _TEST_LEVEL_GENERATOR_H_
+#define _TEST_LEVEL_GENERATOR_H_
+
+#include <string>
+
+/*!
+ * \brief Scale of a generated level
+ */
+struct LevelConfig {
+    int version; //!< 1, 2 or 3
+    unsigned int rooms;
+    unsigned int vertices; //!< Per room
+    unsigned int meshes;
+    unsigned int textures; //!< 256x256 pages
+    unsigned int animations;
+    unsigned int samples;
+    bool floorData; //!< Without it, sectors point into an empty FloorData array
+
+    LevelConfig() : version(2), rooms(200), vertices(256), meshes(400),
+        textures(16), animations(200), samples(64), floorData(true) { }
+};
+
+/*!
+ * \brief Writes a synthetic level, that can be opened by the matching Loader.
+ *
+ * All sections are present and structurally valid, their contents are
+ * deterministic filler. TR2 and TR3 levels get a MAIN.SFX next to them.
+ * \param config scale of the level
+ * \param file level file to write
+ * \returns 0 on success
+ */
+int generateLevel(const LevelConfig& config, std::string file);
+
+#endif
+
@@ -0,0 +1,275 @@
+/*!
+ * \file test/Navigation.cpp
+ * \brief NPC Path Finding Unit Test
+ *
+ * \author xythobuz
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "global.h"
+#include "Navigation.h"
+#include "utils/ThreadPool.h"
+
+static uint32_t randomState = 1;
+static uint32_t randomValue(uint32_t max) {
+    randomState = (randomState * 1103515245) + 12345;
+    return ((randomState >> 8) & 0xFFFFFF) % max;
+}
+
+/*
+ * Grid of one sector boxes with random floors, every box overlaps its
+ * four neighbours. Pillars are in ground zone 1 only, blocked boxes are
+ * marked as such. With split set, the last column is its own island, with
+ * the same zone IDs but without overlaps into the rest of the grid.
+ */
+static void buildGrid(Navigation& nav, unsigned int size, unsigned int pillars,
+                      unsigned int blocked, bool split) {
+    unsigned int n = size * size;
+    std::vector<Navigation::Box> boxes(n);
+    std::vector<uint16_t> overlapIndices(n);
+    std::vector<uint16_t> overlaps;
+    std::vector<int16_t> zones(n * Navigation::zoneTables, 0);
+
+    for (unsigned int b = 0; b < n; b++) {
+        unsigned int x = b % size, z = b / size;
+        Navigation::Box& box = boxes.at(b);
+        box.xMin = x * 1024;
+        box.xMax = box.xMin + 1024;
+        box.zMin = z * 1024;
+        box.zMax = box.zMin + 1024;
+        box.floor = -static_cast<int16_t>(randomValue(8) * 256);
+        box.flags = 0;
+
+        bool edge = split && (x == (size - 2));
+        overlapIndices.at(b) = overlaps.size();
+        if ((blocked > 0) && (randomValue(blocked) == 0))
+            overlapIndices.at(b) |= 0xC000;
+
+        std::vector<uint16_t> list;
+        if ((x > 0) && !(split && (x == (size - 1))))
+            list.push_back(b - 1);
+        if ((x < (size - 1)) && !edge)
+            list.push_back(b + 1);
+        if (z > 0)
+            list.push_back(b - size);
+        if (z < (size - 1))
+            list.push_back(b + size);
+        list.back() |= 0x8000;
+        overlaps.insert(overlaps.end(), list.begin(), list.end());
+
+        if ((pillars > 0) && (randomValue(pillars) == 0)) {
+            zones.at((NavigationZoneGround1 * n) + b) = 1;
+            zones.at(((NavigationZoneGround1 + NavigationZoneCount) * n) + b) = 1;
+        }
+    }
+
+    nav.build(boxes, overlapIndices, overlaps, zones);
+}
+
+static uint32_t distance(const Navigation& nav, uint32_t a, uint32_t b) {
+    const Navigation::Box& ba = nav.getBox(a);
+    const Navigation::Box& bb = nav.getBox(b);
+    return std::abs(((ba.xMin + ba.xMax) / 2) - ((bb.xMin + bb.xMax) / 2))
+           + std::abs(ba.floor - bb.floor)
+           + std::abs(((ba.zMin + ba.zMax) / 2) - ((bb.zMin + bb.zMax) / 2));
+}
+
+static bool allowed(const Navigation& nav, uint32_t box, const Navigation::Query& q) {
+    return (nav.getZone(box, q.zone, q.flipped) == nav.getZone(q.start, q.zone, q.flipped))
+           && !(nav.getBox(box).flags & NavigationBoxBlocked);
+}
+
+// Plain Dijkstra over the same rules, costs of all boxes from q.start
+static void reference(Navigation& nav, const Navigation::Query& q, std::vector<uint32_t>& cost) {
+    cost.assign(nav.sizeBox(), Navigation::noPath);
+    std::vector<bool> done(nav.sizeBox(), false);
+    cost.at(q.start) = 0;
+
+    while (true) {
+        uint32_t next = Navigation::noPath;
+        for (uint32_t b = 0; b < nav.sizeBox(); b++) {
+            if ((!done.at(b)) && (cost.at(b) != Navigation::noPath)
+                && ((next == Navigation::noPath) || (cost.at(b) < cost.at(next))))
+                next = b;
+        }
+        if (next == Navigation::noPath)
+            break;
+
+        done.at(next) = true;
+        const uint32_t* neighbours = nav.getNeighbours(next);
+        for (unsigned long i = 0; i < nav.sizeNeighbours(next); i++) {
+            uint32_t n = neighbours[i];
+            if (!allowed(nav, n, q))
+                continue;
+
+            uint32_t c = cost.at(next) + distance(nav, next, n);
+            if (c < cost.at(n))
+                cost.at(n) = c;
+        }
+    }
+}
+
+static int checkPath(Navigation& nav, const Navigation::Query& q, uint32_t expected,
+                     uint32_t cost, const std::vector<uint32_t>& path) {
+    if (cost != expected) {
+        std::cout << "Path " << q.start << " -> " << q.goal << " (zone " << int(q.zone)
+                  << ") costs " << cost << ", expected " << expected << "!" << std::endl;
+        return 1;
+    }
+
+    if (cost == Navigation::noPath) {
+        if (path.size() > 0) {
+            std::cout << "Unreachable " << q.start << " -> " << q.goal
+                      << " returned a path!" << std::endl;
+            return 2;
+        }
+        return 0;
+    }
+
+    if ((path.size() == 0) || (path.front() != q.start) || (path.back() != q.goal)) {
+        std::cout << "Path " << q.start << " -> " << q.goal
+                  << " does not connect start and goal!" << std::endl;
+        return 3;
+    }
+
+    uint32_t sum = 0;
+    for (unsigned long i = 1; i < path.size(); i++) {
+        const uint32_t* neighbours = nav.getNeighbours(path.at(i - 1));
+        bool overlap = false;
+        for (unsigned long n = 0; n < nav.sizeNeighbours(path.at(i - 1)); n++)
+            overlap |= (neighbours[n] == path.at(i));
+
+        if ((!overlap) || !allowed(nav, path.at(i), q)) {
+            std::cout << "Path " << q.start << " -> " << q.goal << " uses invalid step "
+                      << path.at(i - 1) << " -> " << path.at(i) << "!" << std::endl;
+            return 4;
+        }
+        sum += distance(nav, path.at(i - 1), path.at(i));
+    }
+
+    if (sum != cost) {
+        std::cout << "Path " << q.start << " -> " << q.goal << " has length " << sum
+                  << ", but costs " << cost << "!" << std::endl;
+        return 5;
+    }
+
+    return 0;
+}
+
+// Every pair of boxes, in every zone and room state
+static int testAllPairs(Navigation& nav, ThreadPool& pool, unsigned long& reachable,
+                        unsigned long& unreachable) {
+    std::vector<uint32_t> cost, path;
+    for (uint8_t zone = 0; zone < NavigationZoneCount; zone++) {
+        for (int flipped = 0; flipped < 2; flipped++) {
+            std::vector<Navigation::Query> queries;
+            std::vector<uint32_t> expected;
+            for (uint32_t start = 0; start < nav.sizeBox(); start++) {
+                Navigation::Query q = { start, 0, zone, (flipped != 0) };
+                reference(nav, q, cost);
+                for (q.goal = 0; q.goal < nav.sizeBox(); q.goal++) {
+                    uint32_t result = nav.findPath(q, path);
+                    int error = checkPath(nav, q, cost.at(q.goal), result, path);
+                    if (error != 0)
+                        return error;
+
+                    if (cost.at(q.goal) == Navigation::noPath)
+                        unreachable++;
+                    else
+                        reachable++;
+
+                    queries.push_back(q);
+                    expected.push_back(cost.at(q.goal));
+                }
+            }
+
+            // The same queries spread over the pool
+            std::vector<Navigation::Result> results;
+            nav.findPaths(queries, results, pool);
+            for (unsigned long i = 0; i < queries.size(); i++) {
+                int error = checkPath(nav, queries.at(i), expected.at(i),
+                                      results.at(i).cost, results.at(i).path);
+                if (error != 0)
+                    return error;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int testSpecial() {
+    Navigation nav;
+    buildGrid(nav, 4, 0, 0, true);
+    std::vector<uint32_t> path;
+
+    // Same box, even if it is blocked
+    Navigation::Query q = { 5, 5, NavigationZoneGround1, false };
+    nav.setBlocked(5, true);
+    uint32_t cost = nav.findPath(q, path);
+    if ((cost != 0) || (path.size() != 1) || (path.at(0) != 5)) {
+        std::cout << "Path from a box to itself is wrong (" << cost << ", "
+                  << path.size() << " boxes)!" << std::endl;
+        return 10;
+    }
+
+    // Blocked goal, then unblocked again
+    q.start = 0;
+    cost = nav.findPath(q, path);
+    if ((cost != Navigation::noPath) || (path.size() > 0)) {
+        std::cout << "Path into a blocked box found!" << std::endl;
+        return 11;
+    }
+    nav.setBlocked(5, false);
+    if (nav.findPath(q, path) == Navigation::noPath) {
+        std::cout << "No path after unblocking a box!" << std::endl;
+        return 12;
+    }
+
+    // Same zone ID, but on the island without overlaps
+    q.goal = 3;
+    if ((nav.findPath(q, path) != Navigation::noPath) || (path.size() > 0)) {
+        std::cout << "Path onto an unconnected island found!" << std::endl;
+        return 13;
+    }
+
+    // Out of range boxes and zones
+    q.goal = nav.sizeBox();
+    if (nav.findPath(q, path) != Navigation::noPath) {
+        std::cout << "Path to an invalid box found!" << std::endl;
+        return 14;
+    }
+    q.goal = 1;
+    q.zone = NavigationZoneCount;
+    if (nav.findPath(q, path) != Navigation::noPath) {
+        std::cout << "Path in an invalid zone found!" << std::endl;
+        return 15;
+    }
+
+    return 0;
+}
+
+int main() {
+    int error = testSpecial();
+
+    ThreadPool pool;
+    unsigned long reachable = 0, unreachable = 0;
+    for (unsigned int grid = 0; (grid < 4) && (error == 0); grid++) {
+        // Open, with pillars, with blocked boxes, and with everything and an island
+        Navigation nav;
+        buildGrid(nav, 6 + grid, (grid > 0) ? 4 : 0, ((grid % 2) == 0) ? 0 : 6, grid == 3);
+        error = testAllPairs(nav, pool, reachable, unreachable);
+    }
+
+    if ((error == 0) && ((reachable == 0) || (unreachable == 0))) {
+        std::cout << "Grids only had " << reachable << " reachable and " << unreachable
+                  << " unreachable pairs!" << std::endl;
+        error = 20;
+    }
+
+    return error;
+}
+
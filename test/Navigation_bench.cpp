@@ -0,0 +1,167 @@
+/*!
+ * \file test/Navigation_bench.cpp
+ * \brief NPC Path Finding Benchmark
+ *
+ * \author xythobuz
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "Navigation.h"
+#include "utils/ThreadPool.h"
+#include "bench.h"
+
+static uint32_t randomState = 1;
+static uint32_t randomValue(uint32_t max) {
+    randomState = (randomState * 1103515245) + 12345;
+    return ((randomState >> 8) & 0xFFFFFF) % max;
+}
+
+/*
+ * Square grid of one sector boxes, every box overlaps its four neighbours.
+ * About one in five boxes is a pillar in its own ground zone, so ground
+ * paths have to go around them while flying ones do not.
+ */
+static void buildGrid(Navigation& nav, unsigned int size) {
+    unsigned int n = size * size;
+    std::vector<Navigation::Box> boxes(n);
+    std::vector<uint16_t> overlapIndices(n);
+    std::vector<uint16_t> overlaps;
+    std::vector<int16_t> zones(n * Navigation::zoneTables, 0);
+
+    for (unsigned int b = 0; b < n; b++) {
+        unsigned int x = b % size, z = b / size;
+        Navigation::Box& box = boxes.at(b);
+        box.xMin = x * 1024;
+        box.xMax = box.xMin + 1024;
+        box.zMin = z * 1024;
+        box.zMax = box.zMin + 1024;
+        box.floor = -static_cast<int16_t>(randomValue(4) * 256);
+        box.flags = 0;
+
+        overlapIndices.at(b) = overlaps.size();
+        std::vector<uint16_t> list;
+        if (x > 0)
+            list.push_back(b - 1);
+        if (x < (size - 1))
+            list.push_back(b + 1);
+        if (z > 0)
+            list.push_back(b - size);
+        if (z < (size - 1))
+            list.push_back(b + size);
+        list.back() |= 0x8000;
+        overlaps.insert(overlaps.end(), list.begin(), list.end());
+
+        if ((randomValue(5) == 0) && (b != 0)) {
+            for (unsigned int t = NavigationZoneGround1; t < NavigationZoneFly; t++) {
+                zones.at((t * n) + b) = 1;
+                zones.at(((t + NavigationZoneCount) * n) + b) = 1;
+            }
+        }
+    }
+
+    nav.build(boxes, overlapIndices, overlaps, zones);
+}
+
+static void makeQueries(Navigation& nav, std::vector<Navigation::Query>& queries,
+                        unsigned int count, uint8_t zone) {
+    queries.clear();
+    while (queries.size() < count) {
+        Navigation::Query q;
+        q.start = randomValue(nav.sizeBox());
+        q.goal = randomValue(nav.sizeBox());
+        q.zone = zone;
+        q.flipped = false;
+        if (nav.getZone(q.start, zone, false) == 0)
+            queries.push_back(q);
+    }
+}
+
+static void report(const char* what, double ms, std::vector<Navigation::Result>& results) {
+    unsigned long found = 0, expanded = 0, length = 0;
+    for (auto& r : results) {
+        if (r.cost != Navigation::noPath)
+            found++;
+        expanded += r.expanded;
+        length += r.path.size();
+    }
+
+    std::cout << what << ": " << ms << "ms, " << ((ms * 1000.0) / results.size())
+              << "us per query, " << found << " found, " << (expanded / results.size())
+              << " boxes expanded, " << (length / ((found > 0) ? found : 1))
+              << " boxes per path" << std::endl;
+}
+
+static void bench(Navigation& nav, const char* name, uint8_t zone, unsigned int count,
+                  ThreadPool& pool) {
+    std::vector<Navigation::Query> queries;
+    makeQueries(nav, queries, count, zone);
+    std::vector<Navigation::Result> results(queries.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < queries.size(); i++)
+        results[i].cost = nav.findPath(queries[i], results[i].path, &results[i].expanded);
+    std::string what = std::string(name) + ", one thread";
+    report(what.c_str(), elapsed(start), results);
+
+    start = std::chrono::steady_clock::now();
+    nav.findPaths(queries, results, pool);
+    what = std::string(name) + ", " + std::to_string(pool.size() + 1) + " threads";
+    report(what.c_str(), elapsed(start), results);
+}
+
+static void usage() {
+    std::cout << "Usage: bench_navigation [options]" << std::endl
+              << "  --size N         Boxes per side of the grid" << std::endl
+              << "  --queries N      Number of path queries" << std::endl
+              << "  --threads N      Worker threads, 0 for one per core" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int size = 64;
+    unsigned int queries = 10000;
+    unsigned int threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((i + 1) >= argc) {
+            usage();
+            return 1;
+        }
+
+        unsigned int n = std::strtoul(argv[++i], nullptr, 10);
+        if (arg == "--size") {
+            size = (n > 1) ? n : 2;
+        } else if (arg == "--queries") {
+            queries = (n > 0) ? n : 1;
+        } else if (arg == "--threads") {
+            threads = n;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    // Overlap lists are indexed with 14bits in the level files
+    if ((4 * size * (size - 1)) > 0x3FFF) {
+        std::cout << "Overlap indices are limited to 14bits, use a smaller grid!" << std::endl;
+        return 1;
+    }
+
+    Navigation nav;
+    auto start = std::chrono::steady_clock::now();
+    buildGrid(nav, size);
+    std::cout << nav.sizeBox() << " boxes, built in " << elapsed(start) << "ms, "
+              << nav.getMemorySize() << " bytes" << std::endl;
+
+    ThreadPool pool(threads);
+    bench(nav, "Ground", NavigationZoneGround1, queries, pool);
+    bench(nav, "Fly", NavigationZoneFly, queries, pool);
+    return 0;
+}
+
@@ -0,0 +1,99 @@
+/*!
+ * \file test/PCXGenerator.cpp
+ * \brief Synthetic PCX image generator
+ *
+ * \author xythobuz
+ */
+
+#include "PCXGenerator.h"
+
+static void writeU16(std::vector<unsigned char>& v, unsigned long pos, unsigned int value) {
+    v.at(pos) = value & 0xFF;
+    v.at(pos + 1) = (value >> 8) & 0xFF;
+}
+
+static void encode(std::vector<unsigned char>& out, const std::vector<unsigned char>& data) {
+    for (unsigned long i = 0; i < data.size();) {
+        unsigned char c = data.at(i);
+        unsigned long n = 1;
+        while (((i + n) < data.size()) && (data.at(i + n) == c) && (n < 63))
+            n++;
+
+        if ((n > 1) || ((c & 0xC0) == 0xC0)) {
+            out.push_back(0xC0 | n);
+            out.push_back(c);
+        } else {
+            out.push_back(c);
+        }
+        i += n;
+    }
+}
+
+void generatePCX(std::vector<unsigned char>& file, std::vector<unsigned char>& rgba,
+                 unsigned int width, unsigned int height, unsigned int planes,
+                 bool compressed, bool crossLines, unsigned int seed) {
+    unsigned int bytesPerLine = width + (width & 1);
+
+    file.assign(128, 0);
+    file.at(0) = 0x0A;
+    file.at(1) = 5;
+    file.at(2) = compressed ? 1 : 0;
+    file.at(3) = 8;
+    writeU16(file, 8, width - 1);
+    writeU16(file, 10, height - 1);
+    file.at(65) = planes;
+    writeU16(file, 66, bytesPerLine);
+
+    std::vector<unsigned char> palette(768);
+    for (unsigned int i = 0; i < palette.size(); i++)
+        palette.at(i) = (i * 7) + (i / 3);
+
+    // Planes of all lines, one after the other
+    std::vector<unsigned char> data;
+    rgba.assign(width * height * 4, 255);
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int p = 0; p < planes; p++) {
+            for (unsigned int x = 0; x < bytesPerLine; x++) {
+                unsigned char c = 0;
+                if (x < width) {
+                    seed = (seed * 1103515245) + 12345;
+                    if (((x / 16) + (y / 8)) % 3 == 0)
+                        c = (seed >> 16) & 0xFF; // Noise
+                    else
+                        c = ((x / 32) * 40) + (y / 16) + (p * 64); // Flat
+                }
+                data.push_back(c);
+
+                if (x >= width)
+                    continue;
+                unsigned char* d = &rgba.at(((y * width) + x) * 4);
+                if (planes == 1) {
+                    d[0] = palette.at(c * 3);
+                    d[1] = palette.at((c * 3) + 1);
+                    d[2] = palette.at((c * 3) + 2);
+                } else {
+                    d[p] = c;
+                }
+            }
+        }
+    }
+
+    if (!compressed) {
+        file.insert(file.end(), data.begin(), data.end());
+    } else if (crossLines) {
+        encode(file, data);
+    } else {
+        unsigned long length = planes * bytesPerLine;
+        for (unsigned int y = 0; y < height; y++) {
+            std::vector<unsigned char> line(data.begin() + (y * length),
+                                            data.begin() + ((y + 1) * length));
+            encode(file, line);
+        }
+    }
+
+    if (planes == 1) {
+        file.push_back(12);
+        file.insert(file.end(), palette.begin(), palette.end());
+    }
+}
+
@@ -0,0 +1,29 @@
+/*!
+ * \file test/PCXGenerator.h
+ * \brief Synthetic PCX image generator
+ *
+ * \author xythobuz
+ */
+
+#ifndef _TEST_PCX_GENERATOR_H_
+#define _TEST_PCX_GENERATOR_H_
+
+#include <vector>
+
+/*!
+ * \brief Encodes a deterministic test picture as PCX file.
+ *
+ * Pictures mix flat areas, that become long runs, with noise. Lines are
+ * padded to an even number of bytes, like ZSoft specifies, and with
+ * crossLines runs are allowed to continue into the next scanline.
+ * \param file will contain the complete PCX file
+ * \param rgba will contain the picture, as pcxDecode() should return it
+ * \param planes 1 for 256 colors with palette, 3 for RGB or 4 for RGBA
+ * \param compressed RLE or raw image data
+ */
+void generatePCX(std::vector<unsigned char>& file, std::vector<unsigned char>& rgba,
+                 unsigned int width, unsigned int height, unsigned int planes,
+                 bool compressed, bool crossLines, unsigned int seed);
+
+#endif
+
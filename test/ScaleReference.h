@@ -0,0 +1,22 @@
+/*!
+ * \file test/ScaleReference.h
+ * \brief The scaleBuffer() resampler, before it was replaced
+ *
+ * \author xythobuz
+ */
+
+#ifndef _TEST_SCALE_REFERENCE_H_
+#define _TEST_SCALE_REFERENCE_H_
+
+/*!
+ * \brief Float port of gluScaleImage() to the next power of two sizes.
+ *
+ * Bilinear if both sizes grow, otherwise it averages two by two pixels.
+ * Results are truncated, not rounded.
+ * \returns newly allocated buffer, nullptr if already power-of-two sized
+ */
+unsigned char* scaleBufferReference(unsigned char* image, unsigned int* w, unsigned int* h,
+                                    unsigned int bpp);
+
+#endif
+
@@ -0,0 +1,21 @@
+/*!
+ * \file test/bench.h
+ * \brief Helpers shared by the benchmarks
+ *
+ * \author xythobuz
+ */
+
+#ifndef _TEST_BENCH_H_
+#define _TEST_BENCH_H_
+
+#include <chrono>
+
+//! Milliseconds since start, a steady_clock time point
+template<typename T>
+double elapsed(T start) {
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+#endif
+
@@ -36,8 +36,9 @@ static void fillFile(const char* name) {
     file.write(reinterpret_cast<char*>(&f2), sizeof(f2));
 }
 
+template<typename T>
 static int test(const char* name) {
-    BinaryFile file;
+    T file;
     if (file.open(name) != 0) {
         std::cout << "Error opening file " << name << std::endl;
         return 1;
@@ -83,8 +84,6 @@ static int test(const char* name) {
         return 9;
     }
 
-    std::cout << "This test will fail on big-endian machines!" << std::endl;
-
     if (file.readFloat() != f1) {
         std::cout << "Error reading float1!" << std::endl;
         return 10;
@@ -103,6 +102,89 @@ static int test(const char* name) {
     return 0;
 }
 
+static int testMapped(const char* name) {
+    BinaryMapped file;
+    if (file.open(name) != 0) {
+        std::cout << "Error mapping file " << name << std::endl;
+        return 13;
+    }
+
+    if (file.size() != 38) {
+        std::cout << "Error, mapped size wrong!" << std::endl;
+        return 14;
+    }
+
+    const char* p = file.span(3);
+    if ((p[0] != testData[0]) || (p[2] != testData[2]) || (file.tell() != 3)) {
+        std::cout << "Error reading span!" << std::endl;
+        return 15;
+    }
+
+    if (file.pointer(3)[0] != testData[3]) {
+        std::cout << "Error reading pointer!" << std::endl;
+        return 16;
+    }
+
+    if (file.readU32() != 707406378) {
+        std::cout << "Error reading U32 after span!" << std::endl;
+        return 17;
+    }
+
+    file.seek(38);
+    if (!file.eof()) {
+        std::cout << "Error, no EOF at end of mapping!" << std::endl;
+        return 18;
+    }
+
+    return 0;
+}
+
+struct TestStruct_t {
+    typedef uint16_t Field;
+    uint16_t a, b;
+};
+
+template<typename T>
+static int testBulk(const char* name) {
+    T file;
+    if (file.open(name) != 0) {
+        std::cout << "Error opening file " << name << std::endl;
+        return 19;
+    }
+
+    uint8_t bytes[3];
+    file.readArray(bytes, 3);
+    if ((bytes[0] != 255) || (bytes[1] != 255) || (bytes[2] != 255)) {
+        std::cout << "Error reading U8 array!" << std::endl;
+        return 20;
+    }
+
+    uint16_t words[2];
+    file.readArray(words, 2);
+    if ((words[0] != 10794) || (words[1] != 10794)) {
+        std::cout << "Error reading U16 array!" << std::endl;
+        return 21;
+    }
+
+    file.seek(1);
+    TestStruct_t s[2];
+    file.readStruct(s, 2);
+    if ((s[0].a != 65535) || (s[0].b != 10794) || (s[1].a != 10794) || (s[1].b != 65535)) {
+        std::cout << "Error reading struct array!" << std::endl;
+        return 22;
+    }
+
+    file.seek(30);
+    float f[2];
+    file.readArray(f, 2);
+    if ((f[0] != f1) || (f[1] != f2)) {
+        std::cout << "Error reading float array!" << std::endl;
+        return 23;
+    }
+
+    return 0;
+}
+
 int main() {
     char tmpFile[] = "/tmp/openraider_unit_test_0";
     FILE* f;
@@ -112,7 +194,15 @@ int main() {
     }
 
     fillFile(tmpFile);
-    int error = test(tmpFile);
+    int error = test<BinaryFile>(tmpFile);
+    if (error == 0)
+        error = test<BinaryMapped>(tmpFile);
+    if (error == 0)
+        error = testMapped(tmpFile);
+    if (error == 0)
+        error = testBulk<BinaryFile>(tmpFile);
+    if (error == 0)
+        error = testBulk<BinaryMapped>(tmpFile);
     remove(tmpFile);
 
     return error;
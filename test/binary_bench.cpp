@@ -0,0 +1,120 @@
+/*!
+ * \file test/binary_bench.cpp
+ * \brief Binary File Reading Benchmark
+ *
+ * \author xythobuz
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include "global.h"
+#include "utils/binary.h"
+
+static const unsigned int benchSize = 16 * 1024 * 1024;
+
+static void fillFile(const char* name) {
+    std::vector<char> data(benchSize);
+    for (unsigned int i = 0; i < benchSize; i++)
+        data[i] = static_cast<char>((i * 7) ^ (i >> 8));
+
+    std::ofstream file(name, std::ios_base::out | std::ios_base::binary);
+    file.write(&data[0], data.size());
+}
+
+template<typename T>
+static void report(const char* what, T start, uint32_t sum) {
+    auto end = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    std::cout << what << ": " << ms << "ms, "
+              << ((benchSize / (1024.0 * 1024.0)) / (ms / 1000.0)) << "MB/s"
+              << " (" << sum << ")" << std::endl;
+}
+
+// Same access pattern as the level loaders, one value at a time
+template<typename T>
+static int benchReader(const char* what, const char* name) {
+    auto start = std::chrono::steady_clock::now();
+
+    T file;
+    if (file.open(name) != 0) {
+        std::cout << "Error opening file " << name << std::endl;
+        return 1;
+    }
+
+    uint32_t sum = 0;
+    for (unsigned int i = 0; i < (benchSize / 2); i++)
+        sum += file.readU16();
+
+    report(what, start, sum);
+    return 0;
+}
+
+// Same data read with one bulk call
+template<typename T>
+static int benchBulk(const char* what, const char* name) {
+    auto start = std::chrono::steady_clock::now();
+
+    T file;
+    if (file.open(name) != 0) {
+        std::cout << "Error opening file " << name << std::endl;
+        return 1;
+    }
+
+    std::vector<uint16_t> data(benchSize / 2);
+    file.readArray(&data[0], data.size());
+    uint32_t sum = 0;
+    for (auto d : data)
+        sum += d;
+
+    report(what, start, sum);
+    return 0;
+}
+
+// Parsing in place, like loadMeshes() does with the mesh data block
+static int benchSpan(const char* name) {
+    auto start = std::chrono::steady_clock::now();
+
+    BinaryMapped file;
+    if (file.open(name) != 0) {
+        std::cout << "Error mapping file " << name << std::endl;
+        return 1;
+    }
+
+    const char* data = file.span(benchSize);
+    BinaryMemory mem(data, benchSize);
+    uint32_t sum = 0;
+    for (unsigned int i = 0; i < (benchSize / 2); i++)
+        sum += mem.readU16();
+
+    report("BinaryMapped (span)", start, sum);
+    return 0;
+}
+
+int main() {
+    char tmpFile[] = "/tmp/openraider_bench_0";
+    FILE* f;
+    while ((f = fopen(tmpFile, "r")) != NULL) {
+        fclose(f);
+        tmpFile[22]++;
+    }
+
+    fillFile(tmpFile);
+
+    int error = benchReader<BinaryFile>("BinaryFile", tmpFile);
+    if (error == 0)
+        error = benchReader<BinaryMapped>("BinaryMapped", tmpFile);
+    if (error == 0)
+        error = benchSpan(tmpFile);
+    if (error == 0)
+        error = benchBulk<BinaryFile>("BinaryFile (bulk)", tmpFile);
+    if (error == 0)
+        error = benchBulk<BinaryMapped>("BinaryMapped (bulk)", tmpFile);
+
+    remove(tmpFile);
+    return error;
+}
+
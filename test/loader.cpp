@@ -0,0 +1,103 @@
+/*!
+ * \file test/loader.cpp
+ * \brief Level Loader Unit Test
+ *
+ * \author xythobuz
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "global.h"
+#include "Log.h"
+#include "RunTime.h"
+#include "SoundManager.h"
+#include "TextureManager.h"
+#include "World.h"
+#include "loader/Loader.h"
+#include "utils/filesystem.h"
+#include "LevelGenerator.h"
+
+static void unload() {
+    World::destroy();
+    TextureManager::clear();
+    SoundManager::clear();
+}
+
+// Sectors still reference FloorData, but the level has none
+static int testEmptyFloorData(std::string dir, int version) {
+    LevelConfig config;
+    config.version = version;
+    config.rooms = 4;
+    config.vertices = 16;
+    config.meshes = 8;
+    config.textures = 1;
+    config.animations = 4;
+    config.samples = 1;
+    config.floorData = false;
+
+    std::ostringstream name;
+    name << dir << "/EMPTY" << version << ".TR2";
+    std::string file = name.str();
+    if (generateLevel(config, file) != 0) {
+        std::cout << "Error generating \"" << file << "\"!" << std::endl;
+        return 1;
+    }
+
+    int error = -1;
+    auto loader = Loader::createLoader(file);
+    if (loader)
+        error = loader->load(file);
+    loader.reset();
+    remove(file.c_str());
+    remove((dir + "/MAIN.SFX").c_str());
+
+    if (error != 0) {
+        std::cout << "Error " << error << " loading TR" << version
+                  << " level without FloorData!" << std::endl;
+        return 2;
+    }
+
+    unsigned long sectors = 0;
+    for (unsigned long r = 0; r < World::sizeRoom(); r++) {
+        Room& room = World::getRoom(r);
+        for (unsigned long s = 0; s < room.sizeSectors(); s++, sectors++) {
+            if (room.getSector(s).floorData != 0) {
+                std::cout << "TR" << version << " sector " << s << " in room " << r
+                          << " has FloorData record " << room.getSector(s).floorData
+                          << "!" << std::endl;
+                return 3;
+            }
+        }
+    }
+
+    if (sectors == 0) {
+        std::cout << "TR" << version << " level without FloorData has no sectors!" << std::endl;
+        return 4;
+    }
+
+    unload();
+    return 0;
+}
+
+int main() {
+    Log::initialize();
+    RunTime::setHeadless(true);
+
+    std::string dir = "/tmp/openraider_loader_test";
+    if (createDirectory(dir) != 0) {
+        std::cout << "Error creating \"" << dir << "\"!" << std::endl;
+        return 1;
+    }
+
+    int error = 0;
+    for (int version = 1; (version <= 3) && (error == 0); version++)
+        error = testEmptyFloorData(dir, version);
+
+    unload();
+    remove(dir.c_str());
+    return error;
+}
+
@@ -0,0 +1,393 @@
+/*!
+ * \file test/loader_bench.cpp
+ * \brief Level Loader Benchmark
+ *
+ * \author xythobuz
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <vector>
+
+#include "global.h"
+#include "Log.h"
+#include "RunTime.h"
+#include "SoundManager.h"
+#include "TextureManager.h"
+#include "World.h"
+#include "loader/Loader.h"
+#include "utils/filesystem.h"
+#include "LevelGenerator.h"
+
+// ---- Allocation counting ----
+
+static std::atomic<unsigned long long> allocationCount(0);
+static std::atomic<unsigned long long> allocationBytes(0);
+
+void* operator new(std::size_t size) {
+    allocationCount++;
+    allocationBytes += size;
+    void* p = std::malloc((size > 0) ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+struct Snapshot {
+    std::chrono::steady_clock::time_point time;
+    unsigned long long count, bytes;
+
+    Snapshot() : time(std::chrono::steady_clock::now()),
+        count(allocationCount), bytes(allocationBytes) { }
+};
+
+// ---- Results ----
+
+struct Measurement {
+    std::string name;
+    long long offset, size;
+    double time; // Microseconds
+    double count, bytes; // Allocations
+
+    Measurement(std::string n, long long o = 0, long long s = 0)
+        : name(n), offset(o), size(s), time(0.0), count(0.0), bytes(0.0) { }
+
+    void add(double t, const Snapshot& a, const Snapshot& b) {
+        time += t;
+        count += b.count - a.count;
+        bytes += b.bytes - a.bytes;
+    }
+
+    void scale(double f) {
+        time *= f;
+        count *= f;
+        bytes *= f;
+    }
+
+    double bytesPerSecond() {
+        return (time > 0.0) ? (size / (time / 1000000.0)) : 0.0;
+    }
+};
+
+struct Result {
+    LevelConfig config;
+    std::string level;
+    long long fileSize;
+    unsigned int iterations;
+    std::vector<Measurement> sections;
+    Measurement merge, total;
+    std::vector<std::pair<std::string, unsigned long>> counts;
+    Loader::MeshStats meshes;
+
+    Result() : fileSize(0), iterations(0), merge("Merge"), total("Total") { }
+};
+
+static long long duration(const Snapshot& a, const Snapshot& b) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(b.time - a.time).count();
+}
+
+static int loadLevel(Result& result) {
+    std::vector<Snapshot> snapshots;
+    snapshots.reserve(256);
+
+    Snapshot start;
+    auto loader = Loader::createLoader(result.level);
+    if (!loader) {
+        std::cout << "No loader for \"" << result.level << "\"!" << std::endl;
+        return -1;
+    }
+
+    // Called before the first and after every section
+    loader->setProgressCallback([&snapshots](float) {
+        snapshots.emplace_back();
+    });
+
+    int error = loader->load(result.level);
+    Snapshot end;
+    if (error != 0) {
+        std::cout << "Error " << error << " loading \"" << result.level << "\"!" << std::endl;
+        return error;
+    }
+
+    auto& sections = loader->getSections();
+    if (snapshots.size() != (sections.size() + 1)) {
+        std::cout << "Unexpected progress calls (" << snapshots.size() << " for "
+                  << sections.size() << " sections)!" << std::endl;
+        return -2;
+    }
+
+    if (result.sections.size() == 0) {
+        for (auto& s : sections)
+            result.sections.emplace_back(s.name, s.offset, s.size);
+    }
+
+    for (unsigned long i = 0; i < sections.size(); i++)
+        result.sections.at(i).add(sections.at(i).time, snapshots.at(i), snapshots.at(i + 1));
+
+    // Waiting for the decoding jobs, texture uploads and external sound files
+    result.merge.add(duration(snapshots.back(), end), snapshots.back(), end);
+    result.total.add(duration(start, end), start, end);
+    result.total.size = result.fileSize;
+    result.merge.size = result.fileSize;
+
+    result.counts.clear();
+    result.counts.emplace_back("rooms", World::sizeRoom());
+    result.counts.emplace_back("meshes", World::sizeMesh());
+    result.counts.emplace_back("meshResources", World::sizeMeshResource());
+    result.counts.emplace_back("skeletalModels", World::sizeSkeletalModel());
+    result.counts.emplace_back("staticMeshes", World::sizeStaticMesh());
+    result.counts.emplace_back("animations", World::getAnimations().sizeAnimation());
+    result.counts.emplace_back("keyframes", World::getAnimations().sizeFrame());
+    result.counts.emplace_back("animationBytes", World::getAnimations().getMemorySize());
+    result.counts.emplace_back("sprites", World::sizeSprite());
+    result.counts.emplace_back("entities", World::sizeEntity());
+    result.counts.emplace_back("textures", TextureManager::numTextures());
+    result.counts.emplace_back("tiles", TextureManager::numTiles());
+
+    result.meshes = loader->getMeshStats();
+
+    loader.reset();
+    World::destroy();
+    TextureManager::clear();
+    SoundManager::clear();
+    return 0;
+}
+
+// ---- Output ----
+
+static void printTable(Result& r) {
+    std::cout << std::endl << "TR" << r.config.version << ": \"" << r.level << "\", "
+              << r.fileSize << " bytes, " << r.iterations << " iterations" << std::endl;
+    std::cout << std::left << std::setw(20) << "Section" << std::right
+              << std::setw(12) << "Bytes" << std::setw(12) << "Time (ms)"
+              << std::setw(12) << "MB/s" << std::setw(12) << "Allocs"
+              << std::setw(12) << "Alloc KB" << std::endl;
+
+    auto print = [](Measurement& m) {
+        std::cout << std::left << std::setw(20) << m.name << std::right
+                  << std::setw(12) << m.size
+                  << std::setw(12) << std::fixed << std::setprecision(3) << (m.time / 1000.0)
+                  << std::setw(12) << std::setprecision(1) << (m.bytesPerSecond() / (1024.0 * 1024.0))
+                  << std::setw(12) << std::setprecision(0) << m.count
+                  << std::setw(12) << (m.bytes / 1024.0) << std::endl;
+    };
+
+    for (auto& s : r.sections)
+        print(s);
+    print(r.merge);
+    print(r.total);
+
+    for (auto& c : r.counts)
+        std::cout << c.first << ": " << c.second << "  ";
+    std::cout << std::endl;
+
+    auto& m = r.meshes;
+    std::cout << "Mesh pointers: " << m.pointers << ", " << m.offsets << " offsets, "
+              << m.decoded << " decoded, " << m.bytesSkipped << " bytes not decoded, "
+              << m.memorySaved << " bytes shared" << std::endl;
+}
+
+static void writeJSON(std::ostream& out, std::vector<Result>& results) {
+    auto measurement = [&out](Measurement& m, bool section) {
+        out << "{\"name\": \"" << m.name << "\", ";
+        if (section)
+            out << "\"offset\": " << m.offset << ", ";
+        out << "\"bytes\": " << m.size << ", \"timeUs\": " << std::fixed << std::setprecision(1)
+            << m.time << ", \"bytesPerSecond\": " << std::setprecision(0) << m.bytesPerSecond()
+            << ", \"allocations\": " << m.count << ", \"allocatedBytes\": " << m.bytes << "}";
+    };
+
+    out << "[" << std::endl;
+    for (unsigned long i = 0; i < results.size(); i++) {
+        auto& r = results.at(i);
+        auto& c = r.config;
+        out << "  {" << std::endl;
+        out << "    \"version\": " << c.version << ", \"file\": \"" << r.level << "\", \"fileSize\": "
+            << r.fileSize << ", \"iterations\": " << r.iterations << "," << std::endl;
+        out << "    \"config\": {\"rooms\": " << c.rooms << ", \"vertices\": " << c.vertices
+            << ", \"meshes\": " << c.meshes << ", \"textures\": " << c.textures
+            << ", \"animations\": " << c.animations << ", \"samples\": " << c.samples << "},"
+            << std::endl;
+
+        out << "    \"sections\": [" << std::endl;
+        for (unsigned long s = 0; s < r.sections.size(); s++) {
+            out << "      ";
+            measurement(r.sections.at(s), true);
+            out << ((s < (r.sections.size() - 1)) ? "," : "") << std::endl;
+        }
+        out << "    ]," << std::endl << "    \"merge\": ";
+        measurement(r.merge, false);
+        out << "," << std::endl << "    \"total\": ";
+        measurement(r.total, false);
+        out << "," << std::endl << "    \"world\": {";
+        for (unsigned long n = 0; n < r.counts.size(); n++)
+            out << ((n > 0) ? ", " : "") << "\"" << r.counts.at(n).first << "\": "
+                << r.counts.at(n).second;
+        out << "}," << std::endl;
+        auto& m = r.meshes;
+        out << "    \"meshes\": {\"pointers\": " << m.pointers << ", \"offsets\": " << m.offsets
+            << ", \"decoded\": " << m.decoded << ", \"bytesSkipped\": " << m.bytesSkipped
+            << ", \"memorySaved\": " << m.memorySaved << "}" << std::endl;
+        out << "  }" << ((i < (results.size() - 1)) ? "," : "") << std::endl;
+    }
+    out << "]" << std::endl;
+}
+
+static void usage() {
+    std::cout << "Usage: bench_loader [options]" << std::endl
+              << "  --version N      Level version to generate (1, 2 or 3), can be repeated" << std::endl
+              << "  --rooms N        Number of rooms" << std::endl
+              << "  --vertices N     Vertices per room" << std::endl
+              << "  --meshes N       Number of meshes" << std::endl
+              << "  --textures N     Number of texture pages" << std::endl
+              << "  --animations N   Number of animations" << std::endl
+              << "  --samples N      Number of sound samples" << std::endl
+              << "  --iterations N   Loads per level, results are averaged" << std::endl
+              << "  --level FILE     Benchmark an existing level instead" << std::endl
+              << "  --json FILE      Write results as JSON (- for stdout)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    LevelConfig config;
+    std::vector<int> versions;
+    std::string level, json;
+    unsigned int iterations = 3;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((i + 1) >= argc) {
+            usage();
+            return 1;
+        }
+
+        std::string value = argv[++i];
+        unsigned int n = std::strtoul(value.c_str(), nullptr, 10);
+        if (arg == "--version") {
+            versions.push_back(n);
+        } else if (arg == "--rooms") {
+            config.rooms = n;
+        } else if (arg == "--vertices") {
+            config.vertices = n;
+        } else if (arg == "--meshes") {
+            config.meshes = n;
+        } else if (arg == "--textures") {
+            config.textures = n;
+        } else if (arg == "--animations") {
+            config.animations = n;
+        } else if (arg == "--samples") {
+            config.samples = n;
+        } else if (arg == "--iterations") {
+            iterations = (n > 0) ? n : 1;
+        } else if (arg == "--level") {
+            level = value;
+        } else if (arg == "--json") {
+            json = value;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (versions.size() == 0)
+        versions = { 1, 2, 3 };
+
+    Log::initialize();
+    RunTime::setHeadless(true);
+
+    char tmpDir[] = "/tmp/openraider_levels_0";
+    FILE* f;
+    while ((f = fopen(tmpDir, "r")) != NULL) {
+        fclose(f);
+        tmpDir[23]++;
+    }
+    std::string dir = tmpDir;
+
+    if ((level.length() == 0) && (createDirectory(dir) != 0)) {
+        std::cout << "Error creating \"" << dir << "\"!" << std::endl;
+        return 1;
+    }
+
+    std::vector<Result> results;
+    int error = 0;
+    for (unsigned long v = 0; (v < versions.size()) && (error == 0); v++) {
+        Result r;
+        r.config = config;
+        r.config.version = versions.at(v);
+        r.level = level;
+        if (level.length() == 0) {
+            std::ostringstream name;
+            name << dir << "/BENCH" << r.config.version << ".TR2";
+            r.level = name.str();
+
+            if (generateLevel(r.config, r.level) != 0) {
+                std::cout << "Error generating \"" << r.level << "\"!" << std::endl;
+                error = 1;
+                break;
+            }
+        } else {
+            r.config.version = Loader::checkFile(level);
+        }
+
+        std::ifstream file(r.level, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+        r.fileSize = file.tellg();
+
+        for (unsigned int i = 0; (i < iterations) && (error == 0); i++)
+            error = loadLevel(r);
+
+        if (error == 0) {
+            double f = 1.0 / iterations;
+            for (auto& s : r.sections)
+                s.scale(f);
+            r.merge.scale(f);
+            r.total.scale(f);
+            r.iterations = iterations;
+            printTable(r);
+            results.push_back(r);
+        }
+
+        if (level.length() > 0)
+            break;
+    }
+
+    if (level.length() == 0) {
+        for (auto v : versions) {
+            std::ostringstream name;
+            name << dir << "/BENCH" << v << ".TR2";
+            remove(name.str().c_str());
+        }
+        remove((dir + "/MAIN.SFX").c_str());
+        remove(dir.c_str());
+    }
+
+    if ((error == 0) && (json.length() > 0)) {
+        if (json == "-") {
+            writeJSON(std::cout, results);
+        } else {
+            std::ofstream out(json);
+            writeJSON(out, results);
+        }
+    }
+
+    return error;
+}
+
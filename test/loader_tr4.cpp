@@ -0,0 +1,219 @@
+/*!
+ * \file test/loader_tr4.cpp
+ * \brief TR4 Level Loader Unit Test
+ *
+ * \author xythobuz
+ */
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <zlib.h>
+
+#include "global.h"
+#include "Log.h"
+#include "RunTime.h"
+#include "SoundManager.h"
+#include "TextureManager.h"
+#include "World.h"
+#include "loader/Loader.h"
+
+// Level files are little-endian, independent of the host
+class Writer {
+  public:
+    void u8(uint8_t v) { data.push_back(static_cast<char>(v)); }
+    void u16(uint16_t v) { u8(v & 0xFF); u8(v >> 8); }
+    void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+    void tag(const char* t, unsigned int n) { for (unsigned int i = 0; i < n; i++) u8(t[i]); }
+    void zero(std::size_t n) { data.insert(data.end(), n, 0); }
+
+    std::vector<char> data;
+};
+
+// Single angles are 12bit in TR4, three-axis angles 10bit like in TR2
+const static uint16_t frameAngles[] = {
+    0x8400, // X 90deg
+    0x4800, // Y 180deg
+    0xCC00, // Z 270deg
+    0x1002, 0x0040, // X 90deg, Y 45deg, Z 22.5deg
+};
+
+const static float expectedAngles[4][3] = {
+    { 90.0f, 0.0f, 0.0f },
+    { 0.0f, 180.0f, 0.0f },
+    { 0.0f, 0.0f, 270.0f },
+    { 90.0f, 45.0f, 22.5f }
+};
+
+const static unsigned int numBones = 4;
+
+// Everything but one moveable with a single keyframe is empty
+static std::vector<char> geometry() {
+    Writer w;
+    w.u32(0); // Unused
+    w.u16(0); // Rooms
+    w.u32(0); // FloorData
+    w.u32(0); // Mesh data
+    w.u32(0); // Mesh pointers
+
+    unsigned int frameWords = 9 + (sizeof(frameAngles) / sizeof(frameAngles[0]));
+    w.u32(1); // Animations
+    w.u32(0); // Frame offset
+    w.u8(1); // Frame rate
+    w.u8(frameWords);
+    w.u16(0); // State
+    w.zero(16); // Speed, acceleration, lateral too
+    w.u16(0); // First frame
+    w.u16(0); // Last frame
+    w.u16(0); // Next animation
+    w.u16(0); // Next frame
+    w.zero(8); // No state changes and commands
+    w.u32(0); // State changes
+    w.u32(0); // Dispatches
+    w.u32(0); // Commands
+
+    w.u32((numBones - 1) * 4); // Mesh trees
+    w.zero((numBones - 1) * 4 * 4);
+
+    w.u32(frameWords);
+    w.zero(9 * 2); // Bounding box, offset
+    for (auto a : frameAngles)
+        w.u16(a);
+
+    w.u32(1); // Moveables
+    w.u32(0); // Object ID
+    w.u16(numBones);
+    w.u16(0); // Starting mesh
+    w.u32(0); // Mesh tree
+    w.u32(0); // Frame offset
+    w.u16(0); // Animation
+
+    w.u32(0); // Static meshes
+    w.tag("SPR", 3);
+    w.u32(0); // Sprite textures
+    w.u32(0); // Sprite sequences
+    w.u32(0); // Cameras
+    w.u32(0); // Flyby cameras
+    w.u32(0); // Sound sources
+    w.u32(0); // Boxes
+    w.u32(0); // Overlaps
+    w.u32(1); // Animated textures
+    w.u16(0);
+    w.u8(0); // UV rotated textures
+    w.tag("\0TEX", 4);
+    w.u32(0); // Textiles
+    w.u32(0); // Items
+    w.u32(0); // AI objects
+    w.u16(0); // Demo data
+    for (unsigned int i = 0; i < 370; i++)
+        w.u16(0xFFFF); // Sound map
+    w.u32(0); // Sound details
+    w.u32(0); // Sample indices
+    return w.data;
+}
+
+static int writeLevel(std::string file) {
+    std::vector<char> raw = geometry();
+    uLongf size = compressBound(raw.size());
+    std::vector<char> compressed(size);
+    if (compress(reinterpret_cast<Bytef*>(compressed.data()), &size,
+                 reinterpret_cast<const Bytef*>(raw.data()), raw.size()) != Z_OK)
+        return 1;
+
+    Writer w;
+    w.tag("TR4\0", 4);
+    w.zero(6); // No room, object or bump textures
+    w.zero(8); // Textures32
+    w.zero(8); // Textures16
+    w.zero(8); // TexturesMisc
+    w.u32(raw.size());
+    w.u32(size);
+    w.data.insert(w.data.end(), compressed.begin(), compressed.begin() + size);
+    w.u32(0); // Sound samples
+
+    std::ofstream out(file, std::ios_base::out | std::ios_base::binary);
+    out.write(w.data.data(), w.data.size());
+    return out ? 0 : 1;
+}
+
+static int testAngles(std::string file) {
+    auto loader = Loader::createLoader(file);
+    if (!loader) {
+        std::cout << "No loader for the TR4 level!" << std::endl;
+        return 1;
+    }
+
+    int error = loader->load(file);
+    if (error != 0) {
+        std::cout << "Error " << error << " loading the TR4 level!" << std::endl;
+        return 2;
+    }
+
+    AnimationStore& store = World::getAnimations();
+    if ((store.sizeModel() != 1) || (store.sizeFrame() != 1)
+        || (store.getFrameAngleCount(0, 1) != numBones)) {
+        std::cout << "Unexpected animation data (" << store.sizeModel() << " models, "
+                  << store.sizeFrame() << " keyframes)!" << std::endl;
+        return 3;
+    }
+
+    float x[numBones], y[numBones], z[numBones];
+    store.decodeFrames(0, 1, x, y, z);
+    for (unsigned int b = 0; b < numBones; b++) {
+        float angles[3] = { x[b], y[b], z[b] };
+        for (unsigned int i = 0; i < 3; i++) {
+            if (std::fabs(angles[i] - expectedAngles[b][i]) > 0.01f) {
+                std::cout << "Bone " << b << " axis " << i << ": " << angles[i]
+                          << " != " << expectedAngles[b][i] << "!" << std::endl;
+                return 4;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int testCancel(std::string file) {
+    std::atomic<bool> cancel(true);
+    auto loader = Loader::createLoader(file);
+    loader->setCancelFlag(&cancel);
+    try {
+        loader->load(file);
+    } catch (Loader::Cancelled&) {
+        if (World::getAnimations().sizeModel() > 0) {
+            std::cout << "Cancelled load still decoded the moveables!" << std::endl;
+            return 6;
+        }
+        return 0;
+    }
+
+    std::cout << "Cancelled load did not stop!" << std::endl;
+    return 5;
+}
+
+int main() {
+    Log::initialize();
+    RunTime::setHeadless(true);
+
+    std::string file = "/tmp/openraider_test.tr4";
+    int error = writeLevel(file);
+    if (error != 0)
+        std::cout << "Error writing \"" << file << "\"!" << std::endl;
+    else
+        error = testAngles(file);
+
+    if (error == 0) {
+        World::destroy();
+        error = testCancel(file);
+    }
+
+    World::destroy();
+    TextureManager::clear();
+    SoundManager::clear();
+    remove(file.c_str());
+    return error;
+}
+
@@ -0,0 +1,136 @@
+/*!
+ * \file test/pcx.cpp
+ * \brief PCX Reader Unit Test
+ *
+ * \author xythobuz
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "global.h"
+#include "Log.h"
+#include "utils/pcx.h"
+#include "PCXGenerator.h"
+
+static int roundTrip(unsigned int width, unsigned int height, unsigned int planes,
+                     bool compressed, bool crossLines) {
+    std::vector<unsigned char> file, expected;
+    generatePCX(file, expected, width, height, planes, compressed, crossLines, width * height);
+
+    unsigned int w = 0, h = 0;
+    if ((pcxCheck(&file[0], file.size(), &w, &h) != 0) || (w != width) || (h != height)) {
+        std::cout << "Error, invalid header for " << width << "x" << height << "!" << std::endl;
+        return 1;
+    }
+
+    std::vector<unsigned char> image(w * h * 4);
+    if (pcxDecode(&file[0], file.size(), &image[0]) != 0) {
+        std::cout << "Error decoding " << width << "x" << height << ", " << planes
+                  << " planes!" << std::endl;
+        return 2;
+    }
+
+    if (image != expected) {
+        std::cout << "Error, wrong pixels for " << width << "x" << height << ", " << planes
+                  << " planes" << (compressed ? ", RLE" : "")
+                  << (crossLines ? ", runs across lines" : "") << "!" << std::endl;
+        return 3;
+    }
+
+    // Image data that ends too early has to be noticed
+    if (compressed && ((width * height) >= 64)) {
+        std::vector<unsigned char> cut(file.begin(), file.begin() + 140);
+        if (pcxDecode(&cut[0], cut.size(), &image[0]) == 0) {
+            std::cout << "Error, decoded truncated image!" << std::endl;
+            return 4;
+        }
+    }
+
+    return 0;
+}
+
+static int fromFile() {
+    std::vector<unsigned char> file, expected;
+    generatePCX(file, expected, 33, 17, 1, true, false, 42);
+
+    const char* name = "pcx_test.pcx";
+    FILE* f = std::fopen(name, "wb");
+    if (f == nullptr)
+        return 5;
+    std::fwrite(&file[0], 1, file.size(), f);
+    std::fclose(f);
+
+    unsigned char* image = nullptr;
+    unsigned int w, h, bpp;
+    ColorMode mode;
+    int error = 0;
+    if (pcxCheck(name) != 0) {
+        error = 6;
+    } else if ((pcxLoad(name, &image, &w, &h, &mode, &bpp) != 0)
+               || (w != 33) || (h != 17) || (bpp != 32) || (mode != ColorMode::RGBA)) {
+        error = 7;
+    } else if (!std::equal(expected.begin(), expected.end(), image)) {
+        error = 8;
+    }
+
+    if (error != 0)
+        std::cout << "Error loading PCX file (" << error << ")!" << std::endl;
+
+    delete [] image;
+    std::remove(name);
+    return error;
+}
+
+static int invalid() {
+    std::vector<unsigned char> file, expected;
+    generatePCX(file, expected, 8, 8, 3, true, false, 1);
+
+    std::vector<unsigned char> broken(file);
+    broken.at(0) = 0x0B;
+    if (pcxCheck(&broken[0], broken.size()) != -2)
+        return 9;
+
+    broken = file;
+    broken.at(3) = 4;
+    if (pcxCheck(&broken[0], broken.size()) != -5)
+        return 10;
+
+    broken = file;
+    broken.at(65) = 2;
+    if (pcxCheck(&broken[0], broken.size()) != -8)
+        return 11;
+
+    if (pcxCheck(&file[0], 100) != -1)
+        return 12;
+
+    return 0;
+}
+
+int main() {
+    Log::initialize();
+
+    const unsigned int sizes[][2] = { { 1, 1 }, { 7, 3 }, { 64, 64 }, { 321, 200 } };
+    for (auto& s : sizes) {
+        for (unsigned int planes : { 1, 3, 4 }) {
+            int error = roundTrip(s[0], s[1], planes, false, false);
+            if (error == 0)
+                error = roundTrip(s[0], s[1], planes, true, false);
+            if (error == 0)
+                error = roundTrip(s[0], s[1], planes, true, true);
+            if (error != 0)
+                return error;
+        }
+    }
+
+    int error = fromFile();
+    if (error != 0)
+        return error;
+
+    error = invalid();
+    if (error != 0)
+        std::cout << "Error, accepted invalid header (" << error << ")!" << std::endl;
+    return error;
+}
+
@@ -0,0 +1,191 @@
+/*!
+ * \file test/pcx_bench.cpp
+ * \brief PCX Reader Benchmark
+ *
+ * \author xythobuz
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "Log.h"
+#include "utils/pcx.h"
+#include "PCXGenerator.h"
+#include "bench.h"
+
+/*
+ * The reader this replaced, one ifstream::get() per byte and a second
+ * pass expanding the palette pixel by pixel. Kept to compare against.
+ */
+static int oldLoad(const char* filename, std::vector<unsigned char>& image) {
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    unsigned char header[128];
+    if (!file.read(reinterpret_cast<char*>(header), 128))
+        return -1;
+
+    bool compressed = (header[2] == 1);
+    unsigned int width = (header[8] | (header[9] << 8)) - (header[4] | (header[5] << 8)) + 1;
+    unsigned int height = (header[10] | (header[11] << 8)) - (header[6] | (header[7] << 8)) + 1;
+    unsigned int nPlanes = header[65];
+    unsigned long totalBytes = nPlanes * (header[66] | (header[67] << 8));
+    std::vector<unsigned char> buffer(totalBytes * height);
+
+    for (unsigned long i = 0; i < buffer.size();) {
+        unsigned int n = 1;
+        int c = file.get();
+        if (!file)
+            return -7;
+        if (compressed && ((c & 0xC0) == 0xC0)) {
+            n = c & 0x3F;
+            c = file.get();
+            if (!file)
+                return -8;
+        }
+        for (unsigned int j = 0; (j < n) && (i < buffer.size()); j++)
+            buffer[i++] = static_cast<unsigned char>(c);
+    }
+
+    std::vector<unsigned char> palette;
+    if ((header[1] == 5) && (file.get() == 12) && file) {
+        palette.resize(768);
+        for (unsigned int i = 0; i < 768; i++)
+            palette[i] = static_cast<unsigned char>(file.get());
+    }
+
+    image.resize(width * height * 4);
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < width; x++) {
+            unsigned char* d = &image[(x + (y * width)) * 4];
+            const unsigned char* line = &buffer[y * totalBytes];
+            unsigned int bpl = totalBytes / nPlanes;
+            if (!palette.empty()) {
+                d[0] = palette[line[x] * 3];
+                d[1] = palette[(line[x] * 3) + 1];
+                d[2] = palette[(line[x] * 3) + 2];
+                d[3] = 255;
+            } else {
+                d[0] = line[x];
+                d[1] = line[bpl + x];
+                d[2] = line[(2 * bpl) + x];
+                d[3] = (nPlanes == 4) ? line[(3 * bpl) + x] : 255;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void report(const char* what, double ms, unsigned long bytes) {
+    std::cout << what << ": " << ms << "ms, "
+              << ((bytes / (1024.0 * 1024.0)) / (ms / 1000.0)) << " MB/s RGBA" << std::endl;
+}
+
+static int bench(const char* name, unsigned int images, unsigned int width, unsigned int height,
+                 unsigned int planes) {
+    std::vector<std::vector<unsigned char>> files(images);
+    std::vector<unsigned char> expected;
+    std::vector<std::string> names;
+    unsigned long fileBytes = 0;
+    for (unsigned int i = 0; i < images; i++) {
+        generatePCX(files.at(i), expected, width, height, planes, true, false, i + 1);
+        fileBytes += files.at(i).size();
+
+        names.push_back(std::string("pcx_bench_") + std::to_string(i) + ".pcx");
+        FILE* f = std::fopen(names.back().c_str(), "wb");
+        if (f != nullptr) {
+            std::fwrite(&files.at(i)[0], 1, files.at(i).size(), f);
+            std::fclose(f);
+        }
+    }
+
+    unsigned long bytes = static_cast<unsigned long>(width) * height * 4 * images;
+    std::cout << name << ", " << images << " images " << width << "x" << height << ", "
+              << (fileBytes / 1024) << "KB of PCX files" << std::endl;
+
+    int error = 0;
+    std::vector<unsigned char> image;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& n : names) {
+        if (oldLoad(n.c_str(), image) != 0)
+            error = 1;
+    }
+    report("  Old reader, from file", elapsed(start), bytes);
+    if (image != expected)
+        error = 2;
+
+    start = std::chrono::steady_clock::now();
+    for (auto& n : names) {
+        unsigned char* data;
+        unsigned int w, h, bpp;
+        ColorMode mode;
+        if (pcxLoad(n.c_str(), &data, &w, &h, &mode, &bpp) != 0)
+            error = 3;
+        else
+            delete [] data;
+    }
+    report("  pcxLoad, from file", elapsed(start), bytes);
+
+    image.resize(width * height * 4);
+    start = std::chrono::steady_clock::now();
+    for (auto& f : files) {
+        if (pcxDecode(&f[0], f.size(), &image[0]) != 0)
+            error = 4;
+    }
+    report("  pcxDecode, in memory", elapsed(start), bytes);
+    if (image != expected)
+        error = 5;
+
+    for (auto& n : names)
+        std::remove(n.c_str());
+
+    if (error != 0)
+        std::cout << "Error, results differ (" << error << ")!" << std::endl;
+    return error;
+}
+
+static void usage() {
+    std::cout << "Usage: bench_pcx [options]" << std::endl
+              << "  --images N       Number of images per format" << std::endl
+              << "  --width N        Image width" << std::endl
+              << "  --height N       Image height" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int images = 50;
+    unsigned int width = 640;
+    unsigned int height = 480;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((i + 1) >= argc) {
+            usage();
+            return 1;
+        }
+
+        unsigned int n = std::strtoul(argv[++i], nullptr, 10);
+        if (arg == "--images") {
+            images = (n > 0) ? n : 1;
+        } else if (arg == "--width") {
+            width = (n > 0) ? n : 1;
+        } else if (arg == "--height") {
+            height = (n > 0) ? n : 1;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    Log::initialize();
+
+    int error = bench("256 colors", images, width, height, 1);
+    if (error == 0)
+        error = bench("RGB", images, width, height, 3);
+    return error;
+}
+
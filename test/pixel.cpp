@@ -0,0 +1,146 @@
+/*!
+ * \file test/pixel.cpp
+ * \brief Image Resampler Unit Test
+ *
+ * \author xythobuz
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "global.h"
+#include "utils/pixel.h"
+#include "utils/ThreadPool.h"
+#include "ScaleReference.h"
+
+static uint32_t randomState = 1;
+static unsigned char randomByte() {
+    randomState = (randomState * 1103515245) + 12345;
+    return (randomState >> 16) & 0xFF;
+}
+
+static std::vector<unsigned char> makeNoise(unsigned int w, unsigned int h, unsigned int c) {
+    std::vector<unsigned char> v(w * h * c);
+    for (auto& b : v)
+        b = randomByte();
+    return v;
+}
+
+// Rises by one per pixel in both directions, w + h + 30 must stay below 256
+static std::vector<unsigned char> makeGradient(unsigned int w, unsigned int h, unsigned int c) {
+    std::vector<unsigned char> v(w * h * c);
+    for (unsigned int y = 0; y < h; y++) {
+        for (unsigned int x = 0; x < w; x++) {
+            for (unsigned int i = 0; i < c; i++)
+                v[(((y * w) + x) * c) + i] = x + y + (i * 10);
+        }
+    }
+    return v;
+}
+
+static int maxDifference(const unsigned char* a, const unsigned char* b, unsigned long n) {
+    int d = 0;
+    for (unsigned long i = 0; i < n; i++)
+        d = std::max(d, std::abs(a[i] - b[i]));
+    return d;
+}
+
+static int compareOld(std::vector<unsigned char> image, unsigned int w, unsigned int h,
+                      unsigned int c, int tolerance) {
+    unsigned int w1 = w, h1 = h, w2 = w, h2 = h;
+    unsigned char* a = scaleBufferReference(&image[0], &w1, &h1, c * 8);
+    unsigned char* b = scaleBuffer(&image[0], &w2, &h2, c * 8);
+
+    int error = 0;
+    if ((a == nullptr) || (b == nullptr) || (w1 != w2) || (h1 != h2)) {
+        std::cout << "Error, different sizes for " << w << "x" << h << "!" << std::endl;
+        error = 1;
+    } else {
+        int d = maxDifference(a, b, w1 * h1 * c);
+        if (d > tolerance) {
+            std::cout << "Error, " << w << "x" << h << "x" << c << " differs by " << d
+                      << " from the old resampler!" << std::endl;
+            error = 2;
+        }
+    }
+
+    delete [] a;
+    delete [] b;
+    return error;
+}
+
+int main() {
+    // Both sizes grow, the old code interpolates too but truncates
+    const unsigned int grow[][2] = { { 3, 5 }, { 33, 17 }, { 100, 60 }, { 320, 200 } };
+    for (auto& s : grow) {
+        for (unsigned int c : { 1, 3, 4 }) {
+            int error = compareOld(makeNoise(s[0], s[1], c), s[0], s[1], c, 1);
+            if (error != 0)
+                return error;
+        }
+    }
+
+    // One size is already fine, the old code blurs pairs of pixels there
+    const unsigned int half[][2] = { { 64, 50 }, { 90, 128 } };
+    for (auto& s : half) {
+        for (unsigned int c : { 3, 4 }) {
+            int error = compareOld(makeGradient(s[0], s[1], c), s[0], s[1], c, 2);
+            if (error != 0)
+                return error;
+        }
+    }
+
+    unsigned int w = 64, h = 32;
+    if (scaleBuffer(&makeNoise(w, h, 3)[0], &w, &h, 24) != nullptr) {
+        std::cout << "Error, scaled an image that already had power-of-two sizes!" << std::endl;
+        return 3;
+    }
+
+    // Shrinking averages all covered pixels, exactly for a checkerboard
+    std::vector<unsigned char> checker(256 * 256 * 4);
+    for (unsigned int i = 0; i < (256 * 256); i++) {
+        unsigned char v = (((i % 256) + (i / 256)) & 1) ? 255 : 0;
+        for (unsigned int c = 0; c < 4; c++)
+            checker[(i * 4) + c] = v;
+    }
+    std::vector<unsigned char> thumb(128 * 128 * 4);
+    resampleImage(&checker[0], 256, 256, &thumb[0], 128, 128, 4);
+    for (auto b : thumb) {
+        if ((b != 127) && (b != 128)) {
+            std::cout << "Error, checkerboard did not average to gray (" << int(b) << ")!"
+                      << std::endl;
+            return 4;
+        }
+    }
+
+    // Flat areas stay flat for any ratio
+    for (unsigned int size : { 1, 7, 128, 333 }) {
+        std::vector<unsigned char> flat(300 * 200 * 3, 200);
+        std::vector<unsigned char> out(size * size * 3);
+        resampleImage(&flat[0], 300, 200, &out[0], size, size, 3);
+        for (auto b : out) {
+            if (b != 200) {
+                std::cout << "Error, flat image changed to " << int(b) << " at " << size
+                          << "!" << std::endl;
+                return 5;
+            }
+        }
+    }
+
+    // Splitting rows across threads does not change the result
+    ThreadPool pool(4);
+    std::vector<unsigned char> noise = makeNoise(500, 300, 4);
+    for (auto& s : { std::make_pair(512u, 512u), std::make_pair(128u, 128u) }) {
+        std::vector<unsigned char> a(s.first * s.second * 4), b(a.size());
+        resampleImage(&noise[0], 500, 300, &a[0], s.first, s.second, 4);
+        resampleImage(&noise[0], 500, 300, &b[0], s.first, s.second, 4, &pool);
+        if (a != b) {
+            std::cout << "Error, threads changed the result!" << std::endl;
+            return 6;
+        }
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,123 @@
+/*!
+ * \file test/pixel_bench.cpp
+ * \brief Image Resampler Benchmark
+ *
+ * \author xythobuz
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "utils/pixel.h"
+#include "utils/ThreadPool.h"
+#include "ScaleReference.h"
+#include "bench.h"
+
+static void report(const char* what, double ms, unsigned int count) {
+    std::cout << "  " << what << ": " << (ms / count) << "ms per image" << std::endl;
+}
+
+static void benchPower(unsigned int w, unsigned int h, unsigned int channels,
+                       unsigned int count, ThreadPool& pool) {
+    std::vector<unsigned char> image(w * h * channels);
+    for (unsigned long i = 0; i < image.size(); i++)
+        image[i] = (i * 7) + (i / 1000);
+
+    unsigned int ow = w, oh = h;
+    delete [] scaleBuffer(&image[0], &ow, &oh, channels * 8);
+    std::cout << w << "x" << h << "x" << channels << " to " << ow << "x" << oh << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int x = w, y = h;
+        delete [] scaleBufferReference(&image[0], &x, &y, channels * 8);
+    }
+    report("Old float resampler", elapsed(start), count);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int x = w, y = h;
+        delete [] scaleBuffer(&image[0], &x, &y, channels * 8);
+    }
+    report("scaleBuffer, one thread", elapsed(start), count);
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int x = w, y = h;
+        delete [] scaleBuffer(&image[0], &x, &y, channels * 8, &pool);
+    }
+    std::string what = "scaleBuffer, " + std::to_string(pool.size() + 1) + " threads";
+    report(what.c_str(), elapsed(start), count);
+}
+
+static void benchThumbnail(unsigned int w, unsigned int h, unsigned int count) {
+    std::vector<unsigned char> image(w * h * 4);
+    for (unsigned long i = 0; i < image.size(); i++)
+        image[i] = (i * 13) + (i / 500);
+
+    std::cout << w << "x" << h << "x4 to 128x128 thumbnail" << std::endl;
+    std::vector<unsigned char> thumb(128 * 128 * 4);
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++)
+        resampleImage(&image[0], w, h, &thumb[0], 128, 128, 4);
+    report("resampleImage, direct", elapsed(start), count);
+
+    // Without a direct downscale, the image had to be scaled in halves
+    start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        std::vector<unsigned char> a(image), b;
+        unsigned int x = w, y = h;
+        while ((x > 128) || (y > 128)) {
+            unsigned int nx = std::max(128u, x / 2), ny = std::max(128u, y / 2);
+            b.resize(nx * ny * 4);
+            resampleImage(&a[0], x, y, &b[0], nx, ny, 4);
+            a.swap(b);
+            x = nx;
+            y = ny;
+        }
+    }
+    report("resampleImage, in halves", elapsed(start), count);
+}
+
+static void usage() {
+    std::cout << "Usage: bench_pixel [options]" << std::endl
+              << "  --images N       Number of images per size" << std::endl
+              << "  --threads N      Worker threads, 0 for one per core" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int images = 20;
+    unsigned int threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((i + 1) >= argc) {
+            usage();
+            return 1;
+        }
+
+        unsigned int n = std::strtoul(argv[++i], nullptr, 10);
+        if (arg == "--images") {
+            images = (n > 0) ? n : 1;
+        } else if (arg == "--threads") {
+            threads = n;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    ThreadPool pool(threads);
+    benchPower(320, 200, 4, images, pool);
+    benchPower(640, 480, 4, images, pool);
+    benchPower(640, 480, 3, images, pool);
+    benchPower(1000, 700, 4, images, pool);
+    benchThumbnail(1024, 768, images);
+    benchThumbnail(2048, 2048, images);
+    return 0;
+}
+
@@ -0,0 +1,186 @@
+/*!
+ * \file test/pixel_simd.cpp
+ * \brief Pixel Format Kernel Unit Test
+ *
+ * \author xythobuz
+ */
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "global.h"
+#include "utils/pixel.h"
+
+const static PixelSIMD levels[] = {
+    PixelSIMD::SCALAR, PixelSIMD::SSE2, PixelSIMD::AVX2, PixelSIMD::NEON
+};
+
+// Covers every tail after full vectors of 4, 8, 16 and 32 pixels
+const static unsigned int maxLength = 67;
+
+static uint32_t randomState = 1;
+static unsigned char randomByte() {
+    randomState = (randomState * 1103515245) + 12345;
+    return (randomState >> 16) & 0xFF;
+}
+
+/*
+ * Output of one kernel for all inputs, each length from 1 to maxLength
+ * starting at every offset, so unaligned loads and stores are covered.
+ */
+template<typename F>
+static std::vector<unsigned char> run(F kernel, const std::vector<unsigned char>& input,
+                                      unsigned int inBytes, unsigned int outBytes) {
+    std::vector<unsigned char> result;
+    unsigned int count = input.size() / inBytes;
+    for (unsigned int length = 1; length <= maxLength; length++) {
+        for (unsigned int offset = 0; (offset + length) <= count; offset += 61) {
+            std::vector<unsigned char> out(length * outBytes, 0x5A);
+            kernel(&input[offset * inBytes], &out[0], length);
+            result.insert(result.end(), out.begin(), out.end());
+        }
+    }
+
+    // All pixels at once
+    std::vector<unsigned char> out(count * outBytes, 0x5A);
+    kernel(&input[0], &out[0], count);
+    result.insert(result.end(), out.begin(), out.end());
+    return result;
+}
+
+static std::vector<std::vector<unsigned char>> runAll(const std::vector<unsigned char>& all16,
+        const std::vector<unsigned char>& all8, const std::vector<unsigned char>& noise,
+        const unsigned char* palette) {
+    std::vector<std::vector<unsigned char>> r;
+    r.push_back(run([](const unsigned char* in, unsigned char* out, unsigned int n) {
+        std::memcpy(out, in, n * 4);
+        argb2rgba32(out, n, 1);
+    }, noise, 4, 4));
+    r.push_back(run([](const unsigned char* in, unsigned char* out, unsigned int n) {
+        std::memcpy(out, in, n * 4);
+        bgra2rgba32(out, 1, n);
+    }, noise, 4, 4));
+    r.push_back(run([](const unsigned char* in, unsigned char* out, unsigned int n) {
+        unsigned char* img = argb16to32(in, n, 1);
+        std::memcpy(out, img, n * 4);
+        delete [] img;
+    }, all16, 2, 4));
+    r.push_back(run([](const unsigned char* in, unsigned char* out, unsigned int n) {
+        argb16torgba32(in, out, n, 1);
+    }, all16, 2, 4));
+    r.push_back(run([](const unsigned char* in, unsigned char* out, unsigned int n) {
+        unsigned char* img = grayscale2rgba(const_cast<unsigned char*>(in), n, 1);
+        std::memcpy(out, img, n * 4);
+        delete [] img;
+    }, all8, 1, 4));
+    r.push_back(run([palette](const unsigned char* in, unsigned char* out, unsigned int n) {
+        palette2rgba32(in, palette, out, n, 1);
+    }, all8, 1, 4));
+    for (unsigned int bpp : { 24, 32 }) {
+        for (unsigned int n = 1; n <= maxLength; n++) {
+            unsigned char* img = generateColorTexture(glm::vec4(0.2f, 0.4f, 0.6f, 0.8f), n, 1, bpp);
+            r.push_back(std::vector<unsigned char>(img, img + (n * bpp / 8)));
+            delete [] img;
+        }
+    }
+    return r;
+}
+
+// The scalar kernels against values computed by hand
+static int checkReference(const std::vector<std::vector<unsigned char>>& r) {
+    const std::vector<unsigned char>& rgba16 = r.at(3);
+    const std::vector<unsigned char>& argb16 = r.at(2);
+    unsigned long last = rgba16.size() - (65536 * 4);
+    for (unsigned int p = 0; p < 65536; p++) {
+        unsigned char e[4] = {
+            static_cast<unsigned char>(((p >> 10) & 0x1F) * 8),
+            static_cast<unsigned char>(((p >> 5) & 0x1F) * 8),
+            static_cast<unsigned char>((p & 0x1F) * 8),
+            static_cast<unsigned char>((p & 0x8000) ? 255 : 0)
+        };
+        const unsigned char* a = &rgba16[last + (p * 4)];
+        const unsigned char* b = &argb16[last + (p * 4)];
+        if ((a[0] != e[0]) || (a[1] != e[1]) || (a[2] != e[2]) || (a[3] != e[3])
+            || (b[0] != e[3]) || (b[1] != e[0]) || (b[2] != e[1]) || (b[3] != e[2])) {
+            std::cout << "Error, wrong color for 16bit pixel " << p << "!" << std::endl;
+            return 1;
+        }
+    }
+
+    const std::vector<unsigned char>& gray = r.at(4);
+    last = gray.size() - (256 * 4);
+    for (unsigned int g = 0; g < 256; g++) {
+        const unsigned char* a = &gray[last + (g * 4)];
+        if ((a[0] != g) || (a[1] != g) || (a[2] != g) || (a[3] != ((g == 0) ? 0 : 255))) {
+            std::cout << "Error, wrong color for gray " << g << "!" << std::endl;
+            return 2;
+        }
+    }
+
+    const unsigned char color[4] = { 51, 102, 153, 204 };
+    const std::vector<unsigned char>& fill = r.back();
+    for (unsigned long i = 0; i < fill.size(); i++) {
+        if (fill[i] != color[i % 4]) {
+            std::cout << "Error, wrong fill color " << int(fill[i]) << "!" << std::endl;
+            return 3;
+        }
+    }
+
+    return 0;
+}
+
+int main() {
+    // Every 16bit value, every 8bit value, and random 32bit pixels
+    std::vector<unsigned char> all16(65536 * 2), all8(256), noise(4096 * 4);
+    for (unsigned int i = 0; i < 65536; i++) {
+        all16[i * 2] = i & 0xFF;
+        all16[(i * 2) + 1] = i >> 8;
+    }
+    for (unsigned int i = 0; i < 256; i++)
+        all8[i] = i;
+    for (auto& b : noise)
+        b = randomByte();
+    unsigned char palette[256 * 4];
+    for (auto& b : palette)
+        b = randomByte();
+
+    if (pixelSetSIMD(PixelSIMD::SCALAR) != 0) {
+        std::cout << "Error, scalar kernels not available!" << std::endl;
+        return 1;
+    }
+    auto reference = runAll(all16, all8, noise, palette);
+    int error = checkReference(reference);
+    if (error != 0)
+        return error + 1;
+
+    // Every instruction set this CPU has must give exactly the same bytes
+    for (PixelSIMD s : levels) {
+        if (!pixelHasSIMD(s)) {
+            std::cout << pixelSIMDName(s) << ": not supported" << std::endl;
+            if (pixelSetSIMD(s) == 0) {
+                std::cout << "Error, could select unsupported " << pixelSIMDName(s) << "!" << std::endl;
+                return 5;
+            }
+            continue;
+        }
+
+        pixelSetSIMD(s);
+        if (pixelGetSIMD() != s) {
+            std::cout << "Error, could not select " << pixelSIMDName(s) << "!" << std::endl;
+            return 6;
+        }
+
+        auto result = runAll(all16, all8, noise, palette);
+        for (unsigned long k = 0; k < result.size(); k++) {
+            if (result.at(k) != reference.at(k)) {
+                std::cout << "Error, " << pixelSIMDName(s) << " kernel " << k
+                          << " differs from scalar!" << std::endl;
+                return 7;
+            }
+        }
+        std::cout << pixelSIMDName(s) << ": identical" << std::endl;
+    }
+
+    return 0;
+}
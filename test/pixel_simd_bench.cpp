@@ -0,0 +1,114 @@
+/*!
+ * \file test/pixel_simd_bench.cpp
+ * \brief Pixel Format Kernel Benchmark
+ *
+ * \author xythobuz
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "utils/pixel.h"
+#include "bench.h"
+
+template<typename F>
+static void bench(const char* what, unsigned int pixels, unsigned int count, F kernel) {
+    kernel();
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++)
+        kernel();
+    double ms = elapsed(start);
+    std::cout << "  " << what << ": " << (ms / count) << "ms, "
+              << ((static_cast<double>(pixels) * count) / (ms * 1000.0)) << " MPixel/s" << std::endl;
+}
+
+static void usage() {
+    std::cout << "Usage: bench_pixel_simd [options]" << std::endl
+              << "  --size N     Width and height of the test image" << std::endl
+              << "  --count N    Runs of every kernel" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int size = 256;
+    unsigned int count = 2000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((i + 1) >= argc) {
+            usage();
+            return 1;
+        }
+
+        unsigned int n = std::strtoul(argv[++i], nullptr, 10);
+        if (arg == "--size") {
+            size = (n > 0) ? n : 1;
+        } else if (arg == "--count") {
+            count = (n > 0) ? n : 1;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    // A texture page, the unit all level textures come in
+    unsigned int pixels = size * size;
+    std::vector<unsigned char> image(pixels * 4), out(pixels * 4), palette(256 * 4);
+    for (unsigned long i = 0; i < image.size(); i++)
+        image[i] = (i * 7) + (i / 1000);
+    for (unsigned long i = 0; i < palette.size(); i++)
+        palette[i] = i * 3;
+
+    // The old palette expansion went through floats for every pixel
+    std::vector<glm::vec4> colors(256);
+    for (unsigned int i = 0; i < 256; i++)
+        colors[i] = glm::vec4(palette[i * 4], palette[(i * 4) + 1], palette[(i * 4) + 2],
+                              palette[(i * 4) + 3]) / 255.0f;
+    std::cout << size << "x" << size << " pixels" << std::endl;
+    bench("Old float palette", pixels, count, [&]() {
+        for (unsigned int j = 0; j < pixels; j++) {
+            auto col = colors[image[j]];
+            out[j * 4] = static_cast<unsigned char>(col.x * 255);
+            out[(j * 4) + 1] = static_cast<unsigned char>(col.y * 255);
+            out[(j * 4) + 2] = static_cast<unsigned char>(col.z * 255);
+            out[(j * 4) + 3] = static_cast<unsigned char>(col.w * 255);
+        }
+    });
+
+    for (PixelSIMD s : { PixelSIMD::SCALAR, PixelSIMD::SSE2, PixelSIMD::AVX2, PixelSIMD::NEON }) {
+        if (pixelSetSIMD(s) != 0)
+            continue;
+
+        std::cout << pixelSIMDName(s) << std::endl;
+        bench("argb2rgba32", pixels, count, [&]() {
+            argb2rgba32(&image[0], size, size);
+        });
+        bench("bgra2rgba32", pixels, count, [&]() {
+            bgra2rgba32(&image[0], size, size);
+        });
+        bench("argb16to32", pixels, count, [&]() {
+            delete [] argb16to32(&image[0], size, size);
+        });
+        bench("argb16torgba32", pixels, count, [&]() {
+            argb16torgba32(&image[0], &out[0], size, size);
+        });
+        bench("grayscale2rgba", pixels, count, [&]() {
+            delete [] grayscale2rgba(&image[0], size, size);
+        });
+        bench("palette2rgba32", pixels, count, [&]() {
+            palette2rgba32(&image[0], &palette[0], &out[0], size, size);
+        });
+        bench("generateColorTexture 24", pixels, count, [&]() {
+            delete [] generateColorTexture(glm::vec4(0.5f), size, size, 24);
+        });
+        bench("generateColorTexture 32", pixels, count, [&]() {
+            delete [] generateColorTexture(glm::vec4(0.5f), size, size, 32);
+        });
+    }
+
+    return 0;
+}